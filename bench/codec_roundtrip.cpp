@@ -0,0 +1,130 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "../network_reactor.h"
+#include "../network_codec.hpp"
+
+/*
+   Measures the time taken to write and read back the header of a file transfer, once as the text message the client
+   sends today ('snprintf' and 'split_transfer_message') and once as a binary frame from a compile-time schema. A stream
+   of mixed frames is then decoded with 'decode_any', to show the cost of choosing between several messages.
+*/
+
+
+/* ---- Structs ---- */
+
+/* Header sent before the contents of a file. */
+struct transfer_request {
+	uint32_t client_id;
+	uint64_t transfer_bytes;
+	std::string_view file_name;
+};
+
+/* Chat message sent to a topic. */
+struct topic_publish {
+	std::string_view topic_name, topic_message;
+};
+
+using transfer_request_message = network::codec::message<
+	0x10, transfer_request,
+	network::codec::field<&transfer_request::client_id, network::codec::fixed<uint32_t>>,
+	network::codec::field<&transfer_request::transfer_bytes, network::codec::varint>,
+	network::codec::field<&transfer_request::file_name, network::codec::bytes>
+>;
+using topic_publish_message = network::codec::message<
+	0x11, topic_publish,
+	network::codec::field<&topic_publish::topic_name, network::codec::bytes>,
+	network::codec::field<&topic_publish::topic_message, network::codec::bytes>
+>;
+
+/* Encoding and decoding also work at compile time, so a frame can be checked without running anything */
+static_assert([] {
+	char frame[64] = {};
+	const size_t frame_bytes = transfer_request_message::encode(transfer_request{ 7, 300, "notes.txt" }, frame, sizeof frame);
+	transfer_request decoded_request{};
+	return frame_bytes == 19 && transfer_request_message::decode(frame, frame_bytes, decoded_request) == 19 &&
+		decoded_request.client_id == 7 && decoded_request.transfer_bytes == 300 && decoded_request.file_name == "notes.txt";
+}());
+
+
+int main(int argc, char *argv[])
+{
+	long iterations_count = 10000000;
+	if (argc > 2 || (argc == 2 && (iterations_count = std::strtol(argv[1], nullptr, 10)) < 1)) {
+		std::fprintf(stderr, "Usage:  %s [iterations]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	/* The values change every iteration, so neither way can be worked out once and reused */
+	const char file_name[] = "holiday_photos_2025.tar.gz";
+	unsigned long long checksum = 0;
+
+	uint64_t start_time_nanoseconds = network_reactor_time();
+	for (long i = 0; i < iterations_count; ++i) {
+		char transfer_message[320];
+		std::snprintf(transfer_message, sizeof transfer_message, "%c%ld:%llu:%.255s", network_global_transfer_message, i & 0xFFFF, (unsigned long long)i * 4099, file_name);
+
+		long client_id;
+		unsigned long long transfer_bytes;
+		const char *decoded_file_name = split_transfer_message(transfer_message, &client_id, &transfer_bytes);
+		checksum += (unsigned long long)client_id + transfer_bytes + (unsigned long long)std::strlen(decoded_file_name);
+	}
+	const double text_nanoseconds = (double)(network_reactor_time() - start_time_nanoseconds) / (double)iterations_count;
+
+	start_time_nanoseconds = network_reactor_time();
+	for (long i = 0; i < iterations_count; ++i) {
+		char transfer_frame[320];
+		const size_t frame_bytes = transfer_request_message::encode(
+			transfer_request{ (uint32_t)(i & 0xFFFF), (uint64_t)i * 4099, file_name }, transfer_frame, sizeof transfer_frame
+		);
+
+		transfer_request decoded_request;
+		if (transfer_request_message::decode(transfer_frame, frame_bytes, decoded_request) <= 0) return EXIT_FAILURE;
+		checksum -= decoded_request.client_id + decoded_request.transfer_bytes + decoded_request.file_name.size();
+	}
+	const double codec_nanoseconds = (double)(network_reactor_time() - start_time_nanoseconds) / (double)iterations_count;
+
+	/* A buffer of alternating messages, as they would be recieved from a stream, decoded one frame at a time */
+	char stream_buffer[0x10000];
+	size_t stream_bytes = 0, stream_frames_count = 0;
+	for (; stream_bytes + 128 < sizeof stream_buffer; ++stream_frames_count) {
+		stream_bytes += stream_frames_count % 2 ?
+			topic_publish_message::encode(topic_publish{ "news.weather", "Sunny all week." }, stream_buffer + stream_bytes, sizeof stream_buffer - stream_bytes) :
+			transfer_request_message::encode(transfer_request{ 3, stream_frames_count, file_name }, stream_buffer + stream_bytes, sizeof stream_buffer - stream_bytes);
+	}
+
+	unsigned long long decoded_frames_count = 0, decoded_payload_bytes = 0;
+	start_time_nanoseconds = network_reactor_time();
+	while (decoded_frames_count < (unsigned long long)iterations_count) {
+		for (size_t stream_offset = 0; stream_offset < stream_bytes; ++decoded_frames_count) {
+			const ssize_t frame_bytes = network::codec::decode_any<transfer_request_message, topic_publish_message>(
+				stream_buffer + stream_offset,
+				stream_bytes - stream_offset,
+				[&](const auto &decoded_message) {
+					if constexpr (std::is_same_v<std::decay_t<decltype(decoded_message)>, topic_publish>) decoded_payload_bytes += decoded_message.topic_message.size();
+					else decoded_payload_bytes += decoded_message.transfer_bytes;
+				}
+			);
+			if (frame_bytes <= 0) return EXIT_FAILURE;
+			stream_offset += (size_t)frame_bytes;
+		}
+	}
+	const double dispatch_nanoseconds = (double)(network_reactor_time() - start_time_nanoseconds) / (double)decoded_frames_count;
+
+	if (checksum != 0) {
+		std::fprintf(stderr, "Decoded transfer headers do not match.\n");
+		return EXIT_FAILURE;
+	}
+	std::printf("Transfer header, text (snprintf + split_transfer_message): %.1f ns\n", text_nanoseconds);
+	std::printf("Transfer header, schema codec (encode + decode):          %.1f ns\n", codec_nanoseconds);
+	std::printf("Mixed frames decoded with decode_any:                     %.1f ns each (%llu payload bytes seen)\n", dispatch_nanoseconds, decoded_payload_bytes);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "../network_coroutine.hpp"
+
+/*
+   Runs many chat bots against a server at once, each being a coroutine with its own connection, all on a single thread.
+   Every bot subscribes to its own topic and repeatedly publishes to it, waiting for each message to come back before
+   sending the next one (and pausing now and then, as a real bot would). Reports how many messages made the round trip
+   per second, and roughly how much memory each bot took up.
+*/
+
+/* Round trips a bot makes between each of its pauses */
+#define BOT_ROUND_TRIPS_PER_PAUSE 16
+/* Length of each pause of a bot */
+#define BOT_PAUSE_NANOSECONDS 1000000ULL
+
+
+/* ---- Structs ---- */
+
+/* Settings and results shared by every bot. */
+struct bot_run_state {
+	const char *server_address, *server_port;
+	uint64_t end_time_nanoseconds;
+	unsigned long long round_trips_count;
+	long connected_bots_count, failed_bots_count;
+};
+
+
+/* ---- Function declarations ---- */
+
+/* Runs a single bot with the given ID until the end time is reached or its connection is closed. */
+static network::task run_chat_bot(network::scheduler &bot_scheduler, bot_run_state &run_state, long bot_id);
+/* Returns the peak memory used by this process so far in kilobytes. */
+static long get_peak_memory_kilobytes(void);
+
+
+int main(int argc, char *argv[])
+{
+	long bots_count = 100, duration_seconds = 5;
+	int given_option;
+	while ((given_option = getopt(argc, argv, "c:d:")) != -1) {
+		if (given_option == 'c') bots_count = std::strtol(optarg, nullptr, 10);
+		else if (given_option == 'd') duration_seconds = std::strtol(optarg, nullptr, 10);
+		else goto print_usage;
+	}
+
+	if (argc - optind != 2 || bots_count < 1 || bots_count > 100000 || duration_seconds < 1 || duration_seconds > 3600) {
+	print_usage:
+		std::fprintf(stderr, "Usage:  %s [-c <bots>] [-d <seconds>] <server_address> <server_port>\n", argv[0]);
+		std::fprintf(stderr, "\tBots: Number of bots connected to the server at once. [1, 100000]\n");
+		std::fprintf(stderr, "\tSeconds: How long the bots send messages for. [1, 3600]\n");
+		return EXIT_FAILURE;
+	}
+
+	/* Every bot needs its own socket, which can be more than the default limit of open files */
+	struct rlimit open_files_limit;
+	if (getrlimit(RLIMIT_NOFILE, &open_files_limit) == 0 && open_files_limit.rlim_cur < (rlim_t)bots_count + 64) {
+		open_files_limit.rlim_cur = open_files_limit.rlim_max < (rlim_t)bots_count + 64 ? open_files_limit.rlim_max : (rlim_t)bots_count + 64;
+		setrlimit(RLIMIT_NOFILE, &open_files_limit);
+	}
+
+	network::scheduler bot_scheduler;
+	bot_run_state run_state = { argv[optind], argv[optind + 1], 0, 0, 0, 0 };
+	const uint64_t start_time_nanoseconds = network_reactor_time();
+	run_state.end_time_nanoseconds = start_time_nanoseconds + (uint64_t)duration_seconds * 1000000000ULL;
+
+	const long start_memory_kilobytes = get_peak_memory_kilobytes();
+	for (long i = 0; i < bots_count; ++i) bot_scheduler.spawn(run_chat_bot(bot_scheduler, run_state, i));
+	bot_scheduler.run();
+	const long end_memory_kilobytes = get_peak_memory_kilobytes();
+
+	const double elapsed_seconds = (double)(network_reactor_time() - start_time_nanoseconds) / 1e9;
+	std::printf(
+		"%ld bots (%ld failed), %.0f round trips/s, ~%.1f KiB per bot\n",
+		run_state.connected_bots_count,
+		run_state.failed_bots_count,
+		(double)run_state.round_trips_count / elapsed_seconds,
+		(double)(end_memory_kilobytes - start_memory_kilobytes) / (double)bots_count
+	);
+	return run_state.failed_bots_count == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/*  ---- Function definitions ---- */
+
+
+network::task run_chat_bot(network::scheduler &bot_scheduler, bot_run_state &run_state, long bot_id)
+{
+	network::connection server_connection(bot_scheduler);
+	if (co_await server_connection.connect(run_state.server_address, run_state.server_port) == -1) {
+		++run_state.failed_bots_count;
+		co_return;
+	}
+	++run_state.connected_bots_count;
+
+	const std::string topic_name = "bot." + std::to_string(bot_id);
+	const std::string published_prefix = "[" + topic_name + "] ";
+	std::string sent_message;
+	if (co_await server_connection.write_frame("/sub " + topic_name) == -1) co_return;
+
+	for (unsigned long long round_trip = 1; network_reactor_time() < run_state.end_time_nanoseconds; ++round_trip) {
+		sent_message = "/pub " + topic_name + " " + std::to_string(round_trip);
+		if (co_await server_connection.write_frame(sent_message) == -1) co_return;
+
+		/* Other messages from the server (such as command replies) are skipped until the published one comes back */
+		for (;;) {
+			const std::optional<std::string_view> recieved_message = co_await server_connection.read_frame();
+			if (!recieved_message) co_return;
+			if (!recieved_message->starts_with(published_prefix)) continue;
+
+			unsigned long long recieved_round_trip = 0;
+			const std::string_view round_trip_text = recieved_message->substr(published_prefix.size());
+			std::from_chars(round_trip_text.data(), round_trip_text.data() + round_trip_text.size(), recieved_round_trip);
+			if (recieved_round_trip == round_trip) break;
+		}
+		++run_state.round_trips_count;
+
+		if (round_trip % BOT_ROUND_TRIPS_PER_PAUSE == 0) co_await bot_scheduler.sleep_for(BOT_PAUSE_NANOSECONDS);
+	}
+}
+
+long get_peak_memory_kilobytes(void)
+{
+	struct rusage process_usage;
+	if (getrusage(RUSAGE_SELF, &process_usage) == -1) return 0;
+	return process_usage.ru_maxrss;
+}
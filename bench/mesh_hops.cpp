@@ -0,0 +1,199 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "../network_reactor.h"
+#include "../network_shared.h"
+#include "../network_mesh.hpp"
+
+/*
+   Measures how many messages per second can be handed from one thread to the next, with each thread waiting for its
+   doorbell as a reactor would. Every thread starts with a number of tokens, and hands each token it recieves on to the
+   next thread, so the tokens go around the threads until the time is up. Few tokens show the latency of a hop, whilst
+   many show how well hops are batched. The same is measured with a queue for each thread behind a lock, as the server
+   group first used, and every message is checked to arrive in the order it was sent.
+*/
+
+
+/* ---- Structs ---- */
+
+/* Queues behind a lock with the same interface as the mesh, for comparison */
+class locked_queues {
+public:
+	explicit locked_queues(size_t nodes_count) : queue_nodes(nodes_count)
+	{
+		for (locked_node &node : queue_nodes) {
+			node.doorbell_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			check_error(node.doorbell_fd, "Failed to create doorbell", 1);
+		}
+	}
+	~locked_queues()
+	{
+		for (locked_node &node : queue_nodes) close(node.doorbell_fd);
+	}
+
+	int get_doorbell_socket(size_t node_index) const noexcept { return queue_nodes[node_index].doorbell_fd; }
+
+	void send(size_t, size_t to_node, uint32_t message_type, int32_t message_target, uint32_t message_argument, std::string_view message_data)
+	{
+		locked_node &node = queue_nodes[to_node];
+		bool was_empty;
+		{
+			std::lock_guard<std::mutex> queue_lock(node.queue_mutex);
+			was_empty = node.queued_messages.empty();
+			node.queued_messages.push_back({ message_type, message_target, message_argument, std::string(message_data) });
+		}
+		if (was_empty) wake(to_node);
+	}
+	size_t flush(size_t) noexcept { return 0; }
+
+	template<typename F>
+	size_t recieve(size_t to_node, F &&on_message)
+	{
+		locked_node &node = queue_nodes[to_node];
+		uint64_t doorbell_count;
+		if (read(node.doorbell_fd, &doorbell_count, sizeof doorbell_count) == -1) doorbell_count = 0;
+		{
+			std::lock_guard<std::mutex> queue_lock(node.queue_mutex);
+			node.handled_messages.swap(node.queued_messages);
+		}
+		for (const queued_message &message : node.handled_messages) {
+			on_message(0, network::mesh_message{ message.message_type, message.message_target, message.message_argument, message.message_data });
+		}
+		const size_t messages_count = node.handled_messages.size();
+		node.handled_messages.clear();
+		return messages_count;
+	}
+
+	void wake(size_t node_index) noexcept
+	{
+		const uint64_t doorbell_count = 1;
+		if (write(queue_nodes[node_index].doorbell_fd, &doorbell_count, sizeof doorbell_count) == -1) return;
+	}
+
+private:
+	/* The sending node is never needed, as each thread only recieves from the one before it */
+	struct queued_message {
+		uint32_t message_type;
+		int32_t message_target;
+		uint32_t message_argument;
+		std::string message_data;
+	};
+	struct locked_node {
+		int doorbell_fd = -1;
+		std::mutex queue_mutex;
+		std::vector<queued_message> queued_messages, handled_messages;
+	};
+
+	std::vector<locked_node> queue_nodes;
+};
+
+
+/* ---- Function declarations ---- */
+
+/* Hands tokens around the given number of threads for the given time, returning the number of hops per second or -1 if
+   a message arrived out of order. */
+template<typename M>
+static double measure_hops(M &messages, size_t threads_count, size_t tokens_count, size_t token_bytes, double duration_seconds);
+
+
+int main(int argc, char *argv[])
+{
+	size_t threads_count = 4, tokens_count = 1, token_bytes = 16;
+	double duration_seconds = 2.0;
+	int given_option;
+	while ((given_option = getopt(argc, argv, "t:n:s:d:")) != -1) {
+		const long option_value = std::strtol(optarg, nullptr, 10);
+		if (given_option == 't' && option_value >= 2 && option_value <= 64) threads_count = (size_t)option_value;
+		else if (given_option == 'n' && option_value >= 1 && option_value <= 100000) tokens_count = (size_t)option_value;
+		else if (given_option == 's' && option_value >= 0 && option_value <= 0xFFFF) token_bytes = (size_t)option_value;
+		else if (given_option == 'd' && option_value >= 1 && option_value <= 600) duration_seconds = (double)option_value;
+		else goto print_usage;
+	}
+
+	if (optind != argc) {
+	print_usage:
+		std::fprintf(stderr, "Usage:  %s [-t <threads>] [-n <tokens>] [-s <bytes>] [-d <seconds>]\n", argv[0]);
+		std::fprintf(stderr, "\tThreads: Number of threads handing tokens around. [2, 64]\n");
+		std::fprintf(stderr, "\tTokens: Number of tokens each thread starts with. [1, 100000]\n");
+		std::fprintf(stderr, "\tBytes: Size of the data of each token. [0, 65535]\n");
+		std::fprintf(stderr, "\tSeconds: How long to measure each for. [1, 600]\n");
+		return EXIT_FAILURE;
+	}
+
+	network::message_mesh ring_mesh(threads_count);
+	const double mesh_hops = measure_hops(ring_mesh, threads_count, tokens_count, token_bytes, duration_seconds);
+	locked_queues queues(threads_count);
+	const double locked_hops = measure_hops(queues, threads_count, tokens_count, token_bytes, duration_seconds);
+	if (mesh_hops < 0 || locked_hops < 0) {
+		std::fprintf(stderr, "A message arrived out of order.\n");
+		return EXIT_FAILURE;
+	}
+
+	std::printf("%zu threads, %zu token(s) each, %zu-byte tokens:\n", threads_count, tokens_count, token_bytes);
+	std::printf("Mesh of rings:       %.0f hops/s\n", mesh_hops);
+	std::printf("Queues behind locks: %.0f hops/s\n", locked_hops);
+	return EXIT_SUCCESS;
+}
+
+
+/*  ---- Function definitions ---- */
+
+
+template<typename M>
+double measure_hops(M &messages, size_t threads_count, size_t tokens_count, size_t token_bytes, double duration_seconds)
+{
+	std::atomic<bool> is_stopped = false, is_out_of_order = false;
+	std::atomic<unsigned long long> total_hops_count = 0;
+	const std::string token_data(token_bytes, 't');
+
+	std::vector<std::thread> token_threads;
+	for (size_t i = 0; i < threads_count; ++i) {
+		token_threads.emplace_back([&, i] {
+			const size_t next_node = (i + 1) % threads_count;
+			uint32_t sent_count = 0, expected_count = 0;
+			unsigned long long hops_count = 0;
+
+			/* Each message carries how many were sent before it, which the next thread checks */
+			for (size_t j = 0; j < tokens_count; ++j) messages.send(i, next_node, 0, 0, sent_count++, token_data);
+			messages.flush(i);
+
+			struct pollfd doorbell_poll = { messages.get_doorbell_socket(i), POLLIN, 0 };
+			while (!is_stopped.load(std::memory_order_relaxed)) {
+				if (poll(&doorbell_poll, 1, 100) <= 0) continue;
+				messages.recieve(i, [&](size_t, const network::mesh_message &message) {
+					if (message.message_argument != expected_count++ || message.message_data.size() != token_bytes) is_out_of_order = true;
+					messages.send(i, next_node, 0, 0, sent_count++, message.message_data);
+					++hops_count;
+				});
+				messages.flush(i);
+			}
+			total_hops_count += hops_count;
+		});
+	}
+
+	const uint64_t start_time_nanoseconds = network_reactor_time();
+	usleep((useconds_t)(duration_seconds * 1e6));
+	is_stopped = true;
+	for (size_t i = 0; i < threads_count; ++i) messages.wake(i);
+	for (std::thread &token_thread : token_threads) token_thread.join();
+	const double elapsed_seconds = (double)(network_reactor_time() - start_time_nanoseconds) / 1e9;
+
+	if (is_out_of_order) return -1;
+	return (double)total_hops_count / elapsed_seconds;
+}
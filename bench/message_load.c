@@ -0,0 +1,210 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "../network_shared.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+   Sends messages of a fixed size to a server over many connections at once for a fixed amount of time, and reports how
+   many messages the server took in per second. Running it against the same server in its full, echo and discard modes
+   ('-m') shows how much of the cost of each message is the server's own handling rather than the network itself.
+
+   With '-e', the messages are expected to be echoed back: each connection only has a limited number of messages
+   waiting to be echoed at once, and only messages that came back are counted. Otherwise messages are sent as fast as
+   the server takes them in, and anything the server sends back is read and ignored.
+*/
+
+/* Messages each connection may have waiting to be echoed back at once */
+#define LOAD_ECHO_WINDOW_MESSAGES 64
+/* Size of the buffer of repeated messages that data is sent from */
+#define LOAD_SEND_BUFFER_BYTES 0x10000
+
+
+/* ---- Structs ---- */
+
+/* Progress of a single connection to the server. */
+struct load_connection {
+	int connection_sockfd;
+	unsigned long long sent_bytes, recieved_bytes;
+};
+
+
+/* ---- Function declarations ---- */
+
+/* Connects to the server at the given address and port, returning the non-blocking socket and -1 on failure. */
+static int connect_load_server(const char *server_address, const char *server_port);
+/* Returns the current time of the monotonic clock in seconds. */
+static double get_load_time(void);
+
+
+int main(int argc, char *argv[])
+{
+	long connections_count = 16, message_bytes = 64, duration_seconds = 5;
+	int is_echoed = 0, given_option;
+	while ((given_option = getopt(argc, argv, "ec:s:d:")) != -1) {
+		if (given_option == 'e') is_echoed = 1;
+		else if (given_option == 'c') connections_count = strtol(optarg, NULL, 10);
+		else if (given_option == 's') message_bytes = strtol(optarg, NULL, 10);
+		else if (given_option == 'd') duration_seconds = strtol(optarg, NULL, 10);
+		else goto print_usage;
+	}
+
+	if (argc - optind != 2 || connections_count < 1 || connections_count > 10000 ||
+	    message_bytes < 2 || message_bytes > LOAD_SEND_BUFFER_BYTES || duration_seconds < 1 || duration_seconds > 3600
+	) {
+	print_usage:
+		fprintf(stderr, "Usage:  %s [-e] [-c <connections>] [-s <bytes>] [-d <seconds>] <server_address> <server_port>\n", argv[0]);
+		fprintf(stderr, "\t-e: Wait for messages to be echoed back, for a server in echo mode.\n");
+		fprintf(stderr, "\tConnections: Number of connections sending messages at once. [1, 10000]\n");
+		fprintf(stderr, "\tBytes: Size of each message, including its terminator. [2, 65536]\n");
+		fprintf(stderr, "\tSeconds: How long messages are sent for. [1, 3600]\n");
+		return EXIT_FAILURE;
+	}
+
+	/* Messages are a run of letters followed by a terminator, repeated for as many whole messages as fit in the buffer */
+	const size_t message_size = (size_t)message_bytes;
+	const size_t send_buffer_bytes = LOAD_SEND_BUFFER_BYTES - LOAD_SEND_BUFFER_BYTES % message_size;
+	char *send_buffer = malloc(send_buffer_bytes);
+	char recieve_buffer[LOAD_SEND_BUFFER_BYTES];
+	check_error_null(send_buffer, "Failed to allocate send buffer", 1);
+	for (size_t i = 0; i < send_buffer_bytes; ++i) send_buffer[i] = (i + 1) % message_size == 0 ? '\0' : (char)('a' + i % 26);
+
+	struct load_connection *connections = calloc((size_t)connections_count, sizeof *connections);
+	struct pollfd *poll_sockfds = calloc((size_t)connections_count, sizeof *poll_sockfds);
+	check_error_null(connections, "Failed to allocate connections", 1);
+	check_error_null(poll_sockfds, "Failed to allocate poll requests", 1);
+	for (long i = 0; i < connections_count; ++i) {
+		if ((connections[i].connection_sockfd = connect_load_server(argv[optind], argv[optind + 1])) == -1) return EXIT_FAILURE;
+		poll_sockfds[i].fd = connections[i].connection_sockfd;
+	}
+
+	const unsigned long long echo_window_bytes = (unsigned long long)message_size * LOAD_ECHO_WINDOW_MESSAGES;
+	const double start_time = get_load_time(), end_time = start_time + (double)duration_seconds;
+	double current_time = start_time;
+	while ((current_time = get_load_time()) < end_time) {
+		/* Connections are always read from, and written to unless they have enough messages waiting to be echoed */
+		for (long i = 0; i < connections_count; ++i) {
+			const struct load_connection *connection = connections + i;
+			const int is_window_full = is_echoed && connection->sent_bytes - connection->recieved_bytes >= echo_window_bytes;
+			poll_sockfds[i].events = (short)(POLLIN | (is_window_full ? 0 : POLLOUT));
+		}
+		if (poll(poll_sockfds, (nfds_t)connections_count, 100) == -1 && errno != EINTR) {
+			check_error(-1, "Failed to poll connections", 0);
+			break;
+		}
+
+		for (long i = 0; i < connections_count; ++i) {
+			struct load_connection *connection = connections + i;
+			if (poll_sockfds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+				const ssize_t total_bytes_recieved = recv(connection->connection_sockfd, recieve_buffer, sizeof recieve_buffer, 0);
+				if (total_bytes_recieved == 0 || (total_bytes_recieved == -1 && errno != EAGAIN)) {
+					fprintf(stderr, "Connection %ld was closed by the server.\n", i);
+					return EXIT_FAILURE;
+				}
+				if (total_bytes_recieved > 0) connection->recieved_bytes += (unsigned long long)total_bytes_recieved;
+			}
+
+			if (poll_sockfds[i].revents & POLLOUT) {
+				/* Sending carries on from the same place in the repeated messages, so no message is ever cut short */
+				const size_t send_offset = (size_t)(connection->sent_bytes % send_buffer_bytes);
+				size_t next_send_bytes = send_buffer_bytes - send_offset;
+				if (is_echoed && next_send_bytes > echo_window_bytes - (connection->sent_bytes - connection->recieved_bytes)) {
+					next_send_bytes = (size_t)(echo_window_bytes - (connection->sent_bytes - connection->recieved_bytes));
+				}
+
+				const ssize_t total_bytes_sent = send(connection->connection_sockfd, send_buffer + send_offset, next_send_bytes, MSG_NOSIGNAL);
+				if (total_bytes_sent == -1 && errno != EAGAIN) {
+					check_error(-1, "Failed to send messages", 0);
+					return EXIT_FAILURE;
+				}
+				if (total_bytes_sent > 0) connection->sent_bytes += (unsigned long long)total_bytes_sent;
+			}
+		}
+	}
+
+	/* Only whole messages count, and when echoed, only those that came back */
+	unsigned long long counted_bytes = 0;
+	for (long i = 0; i < connections_count; ++i) {
+		counted_bytes += is_echoed ? connections[i].recieved_bytes : connections[i].sent_bytes;
+		close(connections[i].connection_sockfd);
+	}
+	const double elapsed_seconds = current_time - start_time;
+	const unsigned long long counted_messages = counted_bytes / message_size;
+	printf(
+		"%ld connections, %ld-byte messages, %s: %.0f messages/s (%.2f MiB/s)\n",
+		connections_count,
+		message_bytes,
+		is_echoed ? "echoed" : "sent",
+		(double)counted_messages / elapsed_seconds,
+		(double)(counted_messages * message_size) / elapsed_seconds / 1048576.0
+	);
+
+	free(connections);
+	free(poll_sockfds);
+	free(send_buffer);
+	return EXIT_SUCCESS;
+}
+
+
+/*  ---- Function definitions ---- */
+
+
+int connect_load_server(const char *server_address, const char *server_port)
+{
+	struct addrinfo address_info_hints, *server_address_info;
+	memset(&address_info_hints, 0, sizeof address_info_hints);
+	address_info_hints.ai_family = AF_UNSPEC;
+	address_info_hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(server_address, server_port, &address_info_hints, &server_address_info) != 0) {
+		fprintf(stderr, "Failed to find server '%s' on port %s.\n", server_address, server_port);
+		return -1;
+	}
+
+	int connection_sockfd = -1;
+	for (const struct addrinfo *current_address = server_address_info; current_address != NULL; current_address = current_address->ai_next) {
+		connection_sockfd = socket(current_address->ai_family, current_address->ai_socktype, current_address->ai_protocol);
+		if (connection_sockfd == -1) continue;
+		if (connect(connection_sockfd, current_address->ai_addr, current_address->ai_addrlen) == 0) break;
+		close(connection_sockfd);
+		connection_sockfd = -1;
+	}
+	freeaddrinfo(server_address_info);
+	if (check_error(connection_sockfd, "Failed to connect to server", 0) == -1) return -1;
+
+	/* Small messages are sent straight away, as they would be by many seperate clients */
+	const int disable_delay = 1;
+	setsockopt(connection_sockfd, IPPROTO_TCP, TCP_NODELAY, &disable_delay, sizeof disable_delay);
+	fcntl(connection_sockfd, F_SETFL, fcntl(connection_sockfd, F_GETFL) | O_NONBLOCK);
+	return connection_sockfd;
+}
+
+double get_load_time(void)
+{
+	struct timespec current_time;
+	clock_gettime(CLOCK_MONOTONIC, &current_time);
+	return (double)current_time.tv_sec + (double)current_time.tv_nsec / 1e9;
+}
+
+#ifdef __cplusplus
+}
+#endif
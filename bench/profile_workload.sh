@@ -0,0 +1,37 @@
+#!/bin/sh
+#	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+#	under the MIT License (https://opensource.org/license/mit)
+#
+# Runs a representative loopback workload against the built server and client, being used both to train profile-guided
+# builds and to measure them. A few chat clients subscribe and publish to topics whilst 'bench/message_load' sends small
+# and larger messages to the server in its full mode, which prints the throughput of each. The server is stopped with
+# Ctrl+C (and the clients by its disconnect) so that both exit normally, which is when their profiles are written.
+#
+# Usage: bench/profile_workload.sh [port]
+
+port=${1:-5990}
+
+./server "$port" -1 0 > /dev/null &
+server_pid=$!
+sleep 0.5
+
+# Each client's input is kept open after its messages, as the client exits on its own once the server stops
+for client_number in 1 2 3 4; do
+	(
+		printf '/sub room.#\n'
+		message_number=0
+		while [ $message_number -lt 200 ]; do
+			message_number=$((message_number + 1))
+			printf '/pub room.%d message %d from client %d\n' "$client_number" "$message_number" "$client_number"
+			printf 'hello %d\n' "$message_number"
+		done
+		sleep 8
+	) | ./client 127.0.0.1 "$port" > /dev/null &
+done
+sleep 0.5
+
+./bench/message_load -c 16 -s 64 -d 3 127.0.0.1 "$port"
+./bench/message_load -c 16 -s 1024 -d 2 127.0.0.1 "$port"
+
+kill -INT $server_pid
+wait
@@ -0,0 +1,158 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#include <signal.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "../network_server_core.hpp"
+#include "../network_server_group.hpp"
+
+/*
+   Runs the templated server core with the given policies, either specialised at compile time for exactly those policies
+   or with the runtime-configured policies that choose between all of them on every call. Running 'bench/message_load'
+   against each (with '-e' for the echo handler) shows what the specialisation gains. Given several threads, a group of
+   cores is run instead, one on each thread, with the kernel or an acceptor thread (with '-a') spreading the clients.
+*/
+
+
+/* ---- Function declarations ---- */
+
+/* Ctrl+C handler to stop the server core gracefully */
+static void signal_core_end(int param);
+/* Runs a server core (or a group of them, if given more than one thread) with the given policies on the given port
+   until stopped, returning the exit status. */
+template<typename B, typename F, typename L, typename H>
+static int run_server_core(const char *listen_port);
+/* Runs the server core specialised for the policies in the runtime settings. */
+static int run_specialised_core(const char *listen_port);
+
+/* Stops the server core being run */
+static void (*stop_running_core)(void) = nullptr;
+/* Number of threads to run cores on */
+static size_t server_threads_count = 1;
+/* How a group of cores spreads clients between them */
+static network::core::connection_balance server_balance = network::core::connection_balance::reuseport;
+/* Difference in clients between threads above which clients are moved, 0 to never move them */
+static size_t server_rebalance_threshold = 0;
+
+
+int main(int argc, char *argv[])
+{
+	using namespace network::core;
+	bool is_runtime_configured = false;
+	int given_option;
+	while ((given_option = getopt(argc, argv, "rb:f:l:m:t:a:M:")) != -1) {
+		if (given_option == 'r') is_runtime_configured = true;
+		else if (given_option == 't') {
+			const long threads_count = std::strtol(optarg, nullptr, 10);
+			if (threads_count < 1 || threads_count > 32) goto print_usage;
+			server_threads_count = (size_t)threads_count;
+		}
+		else if (given_option == 'M') {
+			const long rebalance_threshold = std::strtol(optarg, nullptr, 10);
+			if (rebalance_threshold < 1 || rebalance_threshold > 100000) goto print_usage;
+			server_rebalance_threshold = (size_t)rebalance_threshold;
+		}
+		else if (given_option == 'a' && std::strcmp(optarg, "connections") == 0) server_balance = connection_balance::least_connections;
+		else if (given_option == 'a' && std::strcmp(optarg, "bytes") == 0) server_balance = connection_balance::least_recieved_bytes;
+		else if (given_option == 'b' && std::strcmp(optarg, "poll") == 0) runtime_settings::io_backend = io_backend_type::poll;
+		else if (given_option == 'b' && std::strcmp(optarg, "epoll") == 0) runtime_settings::io_backend = io_backend_type::epoll;
+		else if (given_option == 'b' && std::strcmp(optarg, "uring") == 0) runtime_settings::io_backend = io_backend_type::uring;
+		else if (given_option == 'f' && std::strcmp(optarg, "text") == 0) runtime_settings::framing = framing_type::text;
+		else if (given_option == 'f' && std::strcmp(optarg, "binary") == 0) runtime_settings::framing = framing_type::binary;
+		else if (given_option == 'l' && std::strcmp(optarg, "pulse") == 0) runtime_settings::liveness = liveness_type::pulse;
+		else if (given_option == 'l' && std::strcmp(optarg, "keepalive") == 0) runtime_settings::liveness = liveness_type::keepalive;
+		else if (given_option == 'm' && std::strcmp(optarg, "echo") == 0) runtime_settings::handler = handler_type::echo;
+		else if (given_option == 'm' && std::strcmp(optarg, "broadcast") == 0) runtime_settings::handler = handler_type::broadcast;
+		else if (given_option == 'm' && std::strcmp(optarg, "discard") == 0) runtime_settings::handler = handler_type::discard;
+		else goto print_usage;
+	}
+
+	if (argc - optind != 1) {
+	print_usage:
+		std::fprintf(stderr, "Usage:  %s [-r] [-t <threads>] [-a <balance>] [-M <difference>] [-b <backend>] [-f <framing>] [-l <liveness>] [-m <mode>] <port>\n", argv[0]);
+		std::fprintf(stderr, "\t-r: Choose the policies at runtime on every call, rather than specialising the server for them.\n");
+		std::fprintf(stderr, "\tThreads: Number of threads to run cores on, each taking some of the clients. [1, 32]\n");
+		std::fprintf(stderr, "\tBalance: Accept clients on a thread of its own, handing each to the thread with the fewest 'connections' or recieving the fewest 'bytes'.\n");
+		std::fprintf(stderr, "\tDifference: Move clients between threads whilst connected once their numbers of clients differ by more than this. [1, 100000]\n");
+		std::fprintf(stderr, "\tBackend: 'poll', 'epoll' or 'uring'.\n");
+		std::fprintf(stderr, "\tFraming: 'text' (terminated messages) or 'binary' (frames with a header).\n");
+		std::fprintf(stderr, "\tLiveness: 'pulse' (checked by the server) or 'keepalive' (checked by the kernel).\n");
+		std::fprintf(stderr, "\tMode: 'echo' sends frames back to their sender, 'broadcast' sends them to every client and 'discard' drops them.\n");
+		return EXIT_FAILURE;
+	}
+
+	signal(SIGINT, signal_core_end); /* Clean shutdown on Ctrl+C */
+	if (is_runtime_configured) return run_server_core<runtime_backend, runtime_framing, runtime_liveness, runtime_handler>(argv[optind]);
+	return run_specialised_core(argv[optind]);
+}
+
+
+/*  ---- Function definitions ---- */
+
+
+void signal_core_end(int param)
+{
+	(void)param; /* Hide unused argument warning */
+	if (stop_running_core != nullptr) stop_running_core();
+}
+
+template<typename B, typename F, typename L, typename H>
+int run_server_core(const char *listen_port)
+{
+	if (server_threads_count > 1) {
+		static network::core::server_group<B, F, L, H> *running_group;
+		network::core::server_group<B, F, L, H> group(server_threads_count);
+		if (group.listen(listen_port, server_balance) == -1) return EXIT_FAILURE;
+		group.set_rebalance_threshold(server_rebalance_threshold);
+
+		running_group = &group;
+		stop_running_core = [] { running_group->stop(); };
+		group.run();
+		stop_running_core = nullptr;
+		return EXIT_SUCCESS;
+	}
+
+	static network::core::server_core<B, F, L, H> *running_core;
+	network::core::server_core<B, F, L, H> core;
+	if (core.listen(listen_port) == -1) return EXIT_FAILURE;
+
+	running_core = &core;
+	stop_running_core = [] { running_core->stop(); };
+	core.run();
+	stop_running_core = nullptr;
+	return EXIT_SUCCESS;
+}
+
+int run_specialised_core(const char *listen_port)
+{
+	using namespace network::core;
+
+	/* Each setting picks a type in turn, building a server for every combination of policies */
+	const auto with_handler = [&]<typename B, typename F, typename L>() {
+		switch (runtime_settings::handler) {
+			case handler_type::echo: return run_server_core<B, F, L, echo_handler>(listen_port);
+			case handler_type::broadcast: return run_server_core<B, F, L, broadcast_handler>(listen_port);
+			default: return run_server_core<B, F, L, discard_handler>(listen_port);
+		}
+	};
+	const auto with_liveness = [&]<typename B, typename F>() {
+		return runtime_settings::liveness == liveness_type::pulse ?
+			with_handler.template operator()<B, F, pulse_liveness>() : with_handler.template operator()<B, F, keepalive_liveness>();
+	};
+	const auto with_framing = [&]<typename B>() {
+		return runtime_settings::framing == framing_type::text ?
+			with_liveness.template operator()<B, text_framing>() : with_liveness.template operator()<B, binary_framing>();
+	};
+	switch (runtime_settings::io_backend) {
+		case io_backend_type::epoll: return with_framing.template operator()<epoll_backend>();
+		case io_backend_type::uring: return with_framing.template operator()<uring_backend>();
+		default: return with_framing.template operator()<poll_backend>();
+	}
+}
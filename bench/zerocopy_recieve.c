@@ -0,0 +1,238 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <unistd.h>
+#include <time.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../network_shared.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+   Measures the CPU time spent recieving bulk data over loopback with 'recv' (copying it) and with TCP_ZEROCOPY_RECEIVE
+   (mapping it), as used by the client to recieve files. Each byte recieved is also read once, as a real recipient would.
+
+   The sender uses MSG_ZEROCOPY in both cases: over loopback, only data sent this way arrives in whole, page-aligned pages
+   that can be mapped (the kernel copies it into new pages when it is delivered locally), whereas data from a remote sender
+   arrives in whole pages as long as the network card splits headers from the data. This moves a copy into the sender, so
+   the CPU time of both processes is shown.
+*/
+
+/* Size of each send, and the most recieved at once */
+#define BENCH_CHUNK_BYTES 0x100000
+
+
+/* ---- Structs ---- */
+
+/* CPU time and results of recieving with one of the methods. */
+struct bench_result {
+	double recieve_cpu_seconds, send_cpu_seconds, wall_seconds;
+	unsigned long long mapped_bytes, copied_bytes;
+	uint64_t data_checksum; /* Sum of the data recieved, so that reading it is not optimized out */
+};
+
+
+/* ---- Function declarations ---- */
+
+/* Sends the given number of bytes to the given address as fast as possible, then exits. Run in a child process. */
+static void run_bench_sender(const struct sockaddr_in *listen_address, unsigned long long total_bytes);
+/* Recieves the given number of bytes through a new loopback connection, mapping them if 'use_zerocopy' is non-zero.
+   Returns 0 on success and -1 on failure. */
+static int run_bench_trial(int use_zerocopy, unsigned long long total_bytes, struct bench_result *result);
+/* Returns the user and system CPU time of the given usage, in seconds. */
+static double get_cpu_seconds(const struct rusage *usage);
+
+
+int main(int argc, char *argv[])
+{
+	const long total_gibibytes = argc > 1 ? strtol(argv[1], NULL, 10) : 2;
+	if (total_gibibytes < 1 || total_gibibytes > 64) {
+		fprintf(stderr, "Usage:  %s [gibibytes]\n", argv[0]);
+		fprintf(stderr, "\tGibibytes: Amount of data recieved with each method. [1, 64]\n");
+		return EXIT_FAILURE;
+	}
+	const unsigned long long total_bytes = (unsigned long long)total_gibibytes << 30;
+
+	printf("Recieving %ld GiB over loopback with each method (CPU seconds per GiB):\n", total_gibibytes);
+
+	struct bench_result copy_result, zerocopy_result;
+	if (run_bench_trial(0, total_bytes, &copy_result) == -1 || run_bench_trial(1, total_bytes, &zerocopy_result) == -1) {
+		return EXIT_FAILURE;
+	}
+
+	const struct bench_result *results[2] = { &copy_result, &zerocopy_result };
+	const char *result_names[2] = { "recv", "zero-copy" };
+	for (int i = 0; i < 2; ++i) {
+		const struct bench_result *result = results[i];
+		printf(
+			"%-10s recieve %.3f, send %.3f, %.1f%% of bytes mapped, %.2f GiB/s\n",
+			result_names[i],
+			result->recieve_cpu_seconds / (double)total_gibibytes,
+			result->send_cpu_seconds / (double)total_gibibytes,
+			100.0 * (double)result->mapped_bytes / (double)(result->mapped_bytes + result->copied_bytes),
+			(double)total_gibibytes / result->wall_seconds
+		);
+	}
+
+	const double saved_cpu_seconds = (copy_result.recieve_cpu_seconds - zerocopy_result.recieve_cpu_seconds) / (double)total_gibibytes;
+	printf(
+		"Recieving CPU saved by zero-copy: %.3f seconds per GiB (%.1f%%)\n",
+		saved_cpu_seconds,
+		100.0 * saved_cpu_seconds * (double)total_gibibytes / copy_result.recieve_cpu_seconds
+	);
+	if (copy_result.data_checksum != zerocopy_result.data_checksum) fprintf(stderr, "Recieved data differs between methods.\n");
+	return EXIT_SUCCESS;
+}
+
+
+/*  ---- Function definitions ---- */
+
+
+void run_bench_sender(const struct sockaddr_in *listen_address, unsigned long long total_bytes)
+{
+	const int sender_sockfd = socket(AF_INET, SOCK_STREAM, 0);
+	check_error(sender_sockfd, "Failed to create sender socket", 1);
+
+	/* Data sent with MSG_ZEROCOPY is sent from the buffer's own pages, falling back to copying if not supported */
+	const int enable_zerocopy = 1;
+	const int send_flags = setsockopt(sender_sockfd, SOL_SOCKET, SO_ZEROCOPY, &enable_zerocopy, sizeof enable_zerocopy) == 0 ? MSG_ZEROCOPY : 0;
+	check_error(connect(sender_sockfd, (const struct sockaddr*)listen_address, sizeof *listen_address), "Failed to connect sender", 1);
+
+	char *send_buffer = aligned_alloc(0x1000, BENCH_CHUNK_BYTES);
+	check_error_null(send_buffer, "Failed to allocate send buffer", 1);
+	for (size_t i = 0; i < BENCH_CHUNK_BYTES; ++i) send_buffer[i] = (char)i;
+
+	for (unsigned long long sent_bytes = 0; sent_bytes < total_bytes; ) {
+		const size_t next_send_bytes = total_bytes - sent_bytes < BENCH_CHUNK_BYTES ? (size_t)(total_bytes - sent_bytes) : BENCH_CHUNK_BYTES;
+		const ssize_t recent_sent_bytes = send(sender_sockfd, send_buffer, next_send_bytes, send_flags);
+		check_error((int)recent_sent_bytes, "Failed to send benchmark data", 1);
+		sent_bytes += (unsigned long long)recent_sent_bytes;
+
+		/* Completions of zero-copy sends have to be read, or they stop further zero-copy sends once too many are waiting.
+		   The buffer is never changed, so it does not matter when the kernel is done with it. */
+		char completion_control[128];
+		struct msghdr completion_header;
+		memset(&completion_header, 0, sizeof completion_header);
+		completion_header.msg_control = completion_control;
+		completion_header.msg_controllen = sizeof completion_control;
+		while (send_flags != 0 && recvmsg(sender_sockfd, &completion_header, MSG_ERRQUEUE | MSG_DONTWAIT) != -1) {
+			completion_header.msg_controllen = sizeof completion_control;
+		}
+	}
+
+	close(sender_sockfd);
+	free(send_buffer);
+	exit(EXIT_SUCCESS);
+}
+
+int run_bench_trial(int use_zerocopy, unsigned long long total_bytes, struct bench_result *result)
+{
+	memset(result, 0, sizeof *result);
+
+	/* Listen on any free port of the loopback address */
+	struct sockaddr_in listen_address;
+	socklen_t listen_address_bytes = sizeof listen_address;
+	memset(&listen_address, 0, sizeof listen_address);
+	listen_address.sin_family = AF_INET;
+	listen_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	const int listen_sockfd = socket(AF_INET, SOCK_STREAM, 0);
+	if (check_error(listen_sockfd, "Failed to create listening socket", 0) == -1) return -1;
+	if (check_error(bind(listen_sockfd, (struct sockaddr*)&listen_address, sizeof listen_address), "Failed to bind listening socket", 0) == -1 ||
+	    check_error(getsockname(listen_sockfd, (struct sockaddr*)&listen_address, &listen_address_bytes), "Failed to get listening address", 0) == -1 ||
+	    check_error(listen(listen_sockfd, 1), "Failed to listen", 0) == -1
+	) goto close_listen_socket;
+
+	fflush(stdout); /* Otherwise anything not printed yet is printed again by the sender */
+	const pid_t sender_pid = fork();
+	if (check_error(sender_pid, "Failed to start sender", 0) == -1) goto close_listen_socket;
+	if (sender_pid == 0) run_bench_sender(&listen_address, total_bytes);
+
+	const int recieve_sockfd = accept(listen_sockfd, NULL, NULL);
+	if (check_error(recieve_sockfd, "Failed to accept sender", 0) == -1) goto close_listen_socket;
+
+	/* Without a region to map into, the reader only copies */
+	struct network_zerocopy_reader recieve_reader;
+	if (check_error(
+		init_zerocopy_reader(&recieve_reader, recieve_sockfd, use_zerocopy ? BENCH_CHUNK_BYTES : 0),
+		"Failed to create reader", 0
+	) == -1) goto close_recieve_socket;
+	if (use_zerocopy && recieve_reader.mapped_region == NULL) fprintf(stderr, "Zero-copy recieving is not available.\n");
+
+	struct rusage start_usage, end_usage, sender_usage;
+	struct timespec start_time, end_time;
+	getrusage(RUSAGE_SELF, &start_usage);
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+	unsigned long long recieved_bytes = 0;
+	while (recieved_bytes < total_bytes) {
+		const char *recieved_data;
+		const ssize_t recent_recieved_bytes = recieve_zerocopy_bytes(&recieve_reader, recieve_sockfd, BENCH_CHUNK_BYTES, &recieved_data);
+		if (recent_recieved_bytes < 1) break;
+
+		/* Read every byte a word at a time, adding up its bytes in two 32-bit halves (which cannot overflow in one chunk) */
+		size_t i = 0;
+		uint64_t halves_sum = 0;
+		for (uint64_t data_word; i + sizeof data_word <= (size_t)recent_recieved_bytes; i += sizeof data_word) {
+			memcpy(&data_word, recieved_data + i, sizeof data_word);
+			for (int byte_shift = 0; byte_shift < 32; byte_shift += 8) halves_sum += (data_word >> byte_shift) & 0x000000FF000000FFull;
+		}
+		result->data_checksum += (halves_sum & 0xFFFFFFFFull) + (halves_sum >> 32);
+		for (; i < (size_t)recent_recieved_bytes; ++i) result->data_checksum += (unsigned char)recieved_data[i];
+		recieved_bytes += (unsigned long long)recent_recieved_bytes;
+	}
+
+	getrusage(RUSAGE_SELF, &end_usage);
+	clock_gettime(CLOCK_MONOTONIC, &end_time);
+	waitpid(sender_pid, NULL, 0);
+	getrusage(RUSAGE_CHILDREN, &sender_usage);
+
+	/* The usage of children adds up over every trial, so the previous trials' usage is taken away */
+	static double previous_sender_cpu_seconds = 0.0;
+	result->recieve_cpu_seconds = get_cpu_seconds(&end_usage) - get_cpu_seconds(&start_usage);
+	result->send_cpu_seconds = get_cpu_seconds(&sender_usage) - previous_sender_cpu_seconds;
+	previous_sender_cpu_seconds = get_cpu_seconds(&sender_usage);
+	result->wall_seconds = (double)(end_time.tv_sec - start_time.tv_sec) + (double)(end_time.tv_nsec - start_time.tv_nsec) / 1e9;
+	result->mapped_bytes = recieve_reader.mapped_bytes_total;
+	result->copied_bytes = recieve_reader.copied_bytes_total;
+	free_zerocopy_reader(&recieve_reader);
+
+	close(recieve_sockfd);
+	close(listen_sockfd);
+	if (recieved_bytes < total_bytes) {
+		fprintf(stderr, "Connection with sender lost after %llu bytes.\n", recieved_bytes);
+		return -1;
+	}
+	return 0;
+
+close_recieve_socket:
+	close(recieve_sockfd);
+close_listen_socket:
+	close(listen_sockfd);
+	return -1;
+}
+
+double get_cpu_seconds(const struct rusage *usage)
+{
+	return (double)(usage->ru_utime.tv_sec + usage->ru_stime.tv_sec) +
+	       (double)(usage->ru_utime.tv_usec + usage->ru_stime.tv_usec) / 1e6;
+}
+
+#ifdef __cplusplus
+}
+#endif
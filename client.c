@@ -7,6 +7,11 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <fcntl.h>
 
 #include <pthread.h>
 #include <signal.h>
@@ -18,6 +23,7 @@
 #include <stdio.h>
 
 #include "network_shared.h"
+#include "network_reactor.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -25,16 +31,60 @@ extern "C" {
 
 
 volatile sig_atomic_t client_running = 0; /* Determines the 'active' state of the client. */ 
+volatile sig_atomic_t connected_server_sockfd = -1; /* Socket of the connected server, which changes when redirected. */
+int client_wake_fd = -1; /* Event written once the client stops, waking the response handler that otherwise waits without a limit. */
+const char *client_identity = NULL; /* Identity to be placed by across servers, or NULL if none was given. */
+pthread_mutex_t client_send_mutex = PTHREAD_MUTEX_INITIALIZER; /* Held whilst sending, so pulse replies are never sent in the middle of a file. */
+int client_zerocopy_recieve = 0; /* Non-zero if recieved files are mapped from the socket rather than copied ('-z'). */
+char *client_session_token = NULL; /* Last session token given by the server, presented again after reconnecting, or NULL if none. */
+char connected_server_address[NI_MAXHOST + NI_MAXSERV + 2], connected_server_port[NI_MAXHOST + NI_MAXSERV + 2]; /* Server connected to, reconnected to if the connection is lost. */
+
+/* Size of the region recieved files are mapped into when recieving with zero-copy */
+#define CLIENT_ZEROCOPY_REGION_BYTES 0x100000
+/* Attempts to reconnect after the connection is lost, with the wait between them doubling up to the maximum */
+#define CLIENT_RECONNECT_ATTEMPTS 8
+#define CLIENT_RECONNECT_MAXIMUM_DELAY_SECONDS 30
+
+/* ---- Structs ---- */
+
+/* Data kept by the handler of server responses between the events of the server socket. */
+struct client_response_state {
+	struct network_message_reader server_message_reader; /* Messages from the server are stored until they are complete */
+	long printed_stream_id; /* Stream whose chunks are being printed on the current line, or -1 if none */
+};
 
 /* ---- Function declarations ---- */
 
 /* Attempts to connect to the server with the given port and address strings, returning the server's socket file descriptor if found.
-   Exits on failure to find or connect to a server. */
-int init_server_connection(const char *server_address, const char *server_port);
+   If an identity is given, it is sent to the server, which may redirect the client to the server owning that identity, followed
+   by the given session token (if not NULL) to resume that session. Redirects are followed automatically.
+   Returns -1 on failure to find or connect to a server. */
+int init_server_connection(const char *server_address, const char *server_port, const char *identity, const char *session_token);
+/* Recieves the reply of the server to the identity sent to it into the given buffer, leaving any messages after it for the
+   response handler. Returns the size of the reply, or 0 or -1 as with 'recv'. */
+static ssize_t recieve_identity_reply(int server_sockfd, char *reply_buffer, size_t reply_buffer_bytes);
+/* Attempts to connect to any of the addresses found for the given server address and port.
+   Returns the server's socket file descriptor on success and -1 on failure. */
+static int connect_server_address(const char *server_address, const char *server_port);
+/* Splits a redirect address ('<host>:<port>') into seperate host and port strings in place.
+   Returns 0 on success and -1 if the address is invalid. */
+static int split_redirect_address(char *redirect_address, char **redirect_host, char **redirect_port);
 /* The main loop for sending messages to the connected server. */
 void begin_client_loop(int server_sockfd);
-/* Seperate handler for interpreting and printing server responses or messages. */
-static void *handle_server_responses(void *v_server_sockfd);
+/* Seperate handler for interpreting and printing server responses or messages, including redirects to other servers. */
+static void *handle_server_responses(void *v_unused);
+/* Reads and handles the messages available from the server, called by the reactor of the response handler. */
+static void handle_server_event(struct network_reactor *reactor, struct pollfd *server_poll_sockfd, void *v_response_state);
+/* Clears the event written once the client stops, called by the reactor of the response handler. */
+static void handle_client_wake_event(struct network_reactor *reactor, struct pollfd *wake_poll_sockfd, void *event_data);
+
+/* Sends a file to another client through the server, given as '<client ID> <path>' (typed as '/sendfile <client ID> <path>').
+   Returns 0 on success and -1 on failure. */
+static int send_client_file(int server_sockfd, const char *transfer_arguments);
+/* Recieves the file following the given transfer message into the current directory, starting with any of it already in the reader.
+   Returns 0 on success and -1 if the connection with the server was lost or the transfer message was malformed,
+   as the file bytes following it could not be told apart from the messages after them. */
+static int recieve_client_file(int server_sockfd, struct network_message_reader *server_message_reader, char *transfer_message);
 
 /* Ctrl+C handler to stop client gracefully */
 static void signal_client_end(int param);
@@ -42,20 +92,32 @@ static void signal_client_end(int param);
 
 int main(int argc, char *argv[])
 {
-	if (argc < 3) {
-		fprintf(stderr, "Usage:  %s <server_address> <server_port>\n", argv[0]);
+	/* Check for any options given before the other arguments */
+	int given_option;
+	while ((given_option = getopt(argc, argv, "+z")) != -1) {
+		if (given_option == 'z') client_zerocopy_recieve = 1;
+		else goto print_usage;
+	}
+
+	if (argc - optind < 2) {
+	print_usage:
+		fprintf(stderr, "Usage:  %s [-z] <server_address> <server_port> [identity]\n", argv[0]);
+		fprintf(stderr, "\t-z: Map recieved files from the socket instead of copying them, where supported.\n");
 		fprintf(stderr, "\tAddress: The address or device name to connect to.\n");
 		fprintf(stderr, "\tPort: The port of the server to connect to. [1024, 65535]\n");
+		fprintf(stderr, "\tIdentity: Optional name used to place this client on the server owning it when servers are linked.\n");
 		return EXIT_FAILURE;
 	}
 
 	/* Convert given server port to a numerical value for bounds checking */
-	const long server_port_long = strtol(argv[2], NULL, 10);
+	const long server_port_long = strtol(argv[optind + 1], NULL, 10);
 	if (server_port_long < 1024 || server_port_long > 65535) {
 		fprintf(stderr, "Server port must be a number between 1024 and 65535.\n");
 		return EXIT_FAILURE;
 	}
-	const int server_sockfd = init_server_connection(argv[1], argv[2]); /* Attempt to connect to given server */
+	if (argc - optind > 2) client_identity = argv[optind + 2];
+	const int server_sockfd = init_server_connection(argv[optind], argv[optind + 1], client_identity, NULL); /* Attempt to connect to given server */
+	if (server_sockfd == -1) return EXIT_FAILURE;
 	begin_client_loop(server_sockfd); /* Send encryption details to server and begin main message loop */
 
 	return EXIT_SUCCESS;
@@ -65,7 +127,88 @@ int main(int argc, char *argv[])
 /*  ---- Function definitions ---- */
 
 
-int init_server_connection(const char *server_address, const char *server_port)
+int init_server_connection(const char *server_address, const char *server_port, const char *identity, const char *session_token)
+{
+	/* Redirects are limited to avoid bouncing between servers forever whilst they disagree on placement */
+	const int maximum_redirects = 4;
+	char redirect_message[NI_MAXHOST + NI_MAXSERV + 2];
+	int found_server_sockfd;
+
+	for (int redirect_count = 0; ; ++redirect_count) {
+		if ((found_server_sockfd = connect_server_address(server_address, server_port)) == -1) return -1;
+		if (identity == NULL) break; /* No identity to be placed by, any server will do */
+
+		/* Send the identity, preceded by its control character, and wait for the server to accept or redirect it */
+		struct iovec identity_message_parts[2] = {
+			{ &network_global_identity_message, sizeof network_global_identity_message },
+			{ (void*)identity, strlen(identity) + 1 }
+		};
+		if (check_error((int)writev(found_server_sockfd, identity_message_parts, 2), "Failed to send identity", 0) == -1) goto connection_failed;
+
+		ssize_t identity_response_bytes;
+		do {
+			identity_response_bytes = recieve_identity_reply(found_server_sockfd, redirect_message, sizeof redirect_message);
+			if (identity_response_bytes < 1) {
+				fprintf(stderr, "Connection with server lost whilst sending identity.\n");
+				goto connection_failed;
+			}
+		} while (*redirect_message == network_global_pulse_message); /* Pulses are answered after connecting */
+
+		if (*redirect_message != network_global_redirect_message) {
+			/* Identity accepted, with the session given before the connection was lost resumed by presenting its token */
+			if (session_token != NULL) {
+				struct iovec session_message_parts[2] = {
+					{ &network_global_session_message, sizeof network_global_session_message },
+					{ (void*)session_token, strlen(session_token) + 1 }
+				};
+				if (check_error((int)writev(found_server_sockfd, session_message_parts, 2), "Failed to send session token", 0) == -1) goto connection_failed;
+			}
+			break;
+		}
+
+		/* Connect to the given server instead */
+		char *redirect_host, *redirect_port;
+		close(found_server_sockfd);
+		if (split_redirect_address(redirect_message + 1, &redirect_host, &redirect_port) == -1 ||
+		    redirect_count == maximum_redirects
+		) {
+			fprintf(stderr, "Failed to follow redirect from server.\n");
+			return -1;
+		}
+
+		printf("Redirected to server '%s:%s'.\n", redirect_host, redirect_port);
+		server_address = redirect_host;
+		server_port = redirect_port;
+	}
+
+	/* Remember the server to reconnect to it, which may be given from the remembered address itself */
+	if (server_address != connected_server_address) snprintf(connected_server_address, sizeof connected_server_address, "%s", server_address);
+	if (server_port != connected_server_port) snprintf(connected_server_port, sizeof connected_server_port, "%s", server_port);
+
+	signal(SIGINT, signal_client_end); /* Clean client shutdown on Ctrl+C */
+	return connected_server_sockfd = found_server_sockfd;
+
+connection_failed:
+	close(found_server_sockfd);
+	return -1;
+}
+
+ssize_t recieve_identity_reply(int server_sockfd, char *reply_buffer, size_t reply_buffer_bytes)
+{
+	/* Look at what was recieved without taking it, as session tokens and other replies can follow straight after */
+	const ssize_t peeked_bytes = recv(server_sockfd, reply_buffer, reply_buffer_bytes, MSG_PEEK);
+	if (peeked_bytes < 1) return peeked_bytes;
+
+	size_t reply_bytes = (size_t)peeked_bytes;
+	if (*reply_buffer == network_global_pulse_message) reply_bytes = network_global_pulse_bytes;
+	else {
+		const char *reply_end = memchr(reply_buffer, '\0', (size_t)peeked_bytes);
+		if (reply_end != NULL) reply_bytes = (size_t)(reply_end - reply_buffer) + 1;
+	}
+	return recv(server_sockfd, reply_buffer, reply_bytes, 0);
+}
+
+int connect_server_address(const char *server_address, const char *server_port)
 {
 	/* Initial values to be filled by server address conncections */
 	struct addrinfo addr_info_hints, *server_address_list, *server_address_info_iterator;
@@ -79,12 +222,12 @@ int init_server_connection(const char *server_address, const char *server_port)
 	addr_info_hints.ai_socktype = SOCK_STREAM;
 
 	/* Get all the different linked addresses to attempt a connection */
-	check_error(getaddrinfo(
+	if (check_error(getaddrinfo(
 		server_address,
 		server_port,
 		&addr_info_hints,
 		&server_address_list
-	), "Failed to get server address information", 1);
+	), "Failed to get server address information", 0) == -1) return -1;
 
 	/* Go through each address in the linked list of server addresses, connecting to the first one that works. */
 	int address_found_counter = 0;
@@ -126,97 +269,395 @@ int init_server_connection(const char *server_address, const char *server_port)
 	}
 
 	/* If the loop ended at a NULL address pointer, none of the addresses in the given linked list worked. */
-	if (server_address_info_iterator == NULL) {
-		fprintf(stderr, "Failed to connect to the %d found address(es).\n", address_found_counter);
-		exit(EXIT_FAILURE);
-	}
+	fprintf(stderr, "Failed to connect to the %d found address(es).\n", address_found_counter);
+	found_server_sockfd = -1;
 
 address_search_success:
-	signal(SIGINT, signal_client_end); /* Clean client shutdown on Ctrl+C */
 	freeaddrinfo(server_address_list); /* Only the server socket is needed after this. */
 	return found_server_sockfd;
 }
 
+int split_redirect_address(char *redirect_address, char **redirect_host, char **redirect_port)
+{
+	/* The port follows the last ':' in the address */
+	char *port_seperator = strrchr(redirect_address, ':');
+	if (port_seperator == NULL || port_seperator == redirect_address || port_seperator[1] == '\0') return -1;
+
+	*port_seperator = '\0';
+	*redirect_host = redirect_address;
+	*redirect_port = port_seperator + 1;
+	return 0;
+}
+
 void begin_client_loop(int server_sockfd)
 {
 	client_running = 1; /* Set client as active */
+	connected_server_sockfd = server_sockfd;
 
-	const size_t client_input_buffer_size = 0xFFF;
+	/* Lines longer than the buffer are streamed to the server in chunks of the buffer's size */
+	const size_t client_input_buffer_size = NETWORK_STREAM_CHUNK_BYTES + 1;
 	char *client_input_buffer = calloc(sizeof(char), client_input_buffer_size);
 	check_error_null(client_input_buffer, "Calloc failed on input buffer", 1);
 
-	/* Create thread for handling server messages */
+	/* Create thread for handling server messages, which is woken up through an event once the client stops */
+	client_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	check_error(client_wake_fd, "Failed to create wake event", 1);
 	pthread_t response_handler_thread;
-	pthread_create(&response_handler_thread, NULL, handle_server_responses, &server_sockfd);
+	pthread_create(&response_handler_thread, NULL, handle_server_responses, NULL);
 
 	printf("Type messages to be sent to server:\n");
 
+	int is_streaming_line = 0; /* Non-zero whilst the rest of a line cut off by the input buffer is still being read */
 	do {
 		/* Get user input from stdin */
 		const size_t input_message_len = get_stdin_input(
 			client_input_buffer,
 			client_input_buffer_size
 		);
-		if (input_message_len == 0) continue;
+		if (input_message_len == 0) {
+			/* Nothing more will be typed, so only wait for the server's messages until either side ends the connection */
+			if (feof(stdin)) pthread_join(response_handler_thread, NULL);
+			continue;
+		}
+
+		/* A line that did not fit is sent as a chunk of a stream, which the chunk holding the end of the line finishes */
+		const int is_line_cut_off = input_message_len == client_input_buffer_size;
+		if (is_line_cut_off || is_streaming_line) {
+			const char chunk_stream_id[] = "0:";
+			struct iovec chunk_message_parts[3] = {
+				{ is_line_cut_off ? &network_global_stream_chunk_message : &network_global_stream_end_message, 1 },
+				{ (void*)chunk_stream_id, sizeof chunk_stream_id - 1 },
+				{ client_input_buffer, input_message_len }
+			};
+			pthread_mutex_lock(&client_send_mutex);
+			check_error((int)writev(connected_server_sockfd, chunk_message_parts, 3), "Failed to send message chunk", 0);
+			pthread_mutex_unlock(&client_send_mutex);
+			is_streaming_line = is_line_cut_off;
+			continue;
+		}
+
+		/* Files are sent by the client itself rather than as a message */
+		const char send_file_command[] = "/sendfile ";
+		if (strncmp(client_input_buffer, send_file_command, sizeof send_file_command - 1) == 0) {
+			send_client_file(connected_server_sockfd, client_input_buffer + sizeof send_file_command - 1);
+			continue;
+		}
 
+		/* Send input to server, which may have changed since the last message if the client was redirected */
+		pthread_mutex_lock(&client_send_mutex);
 		check_error((int)send_bytes(
-			server_sockfd,
+			connected_server_sockfd,
 			client_input_buffer,
 			input_message_len
-		), "Failed to send message", 0); /* Send input to server */
+		), "Failed to send message", 0);
+		pthread_mutex_unlock(&client_send_mutex);
 	} while (client_running);
 
 	if (client_running == 0) printf("\nClosing connection with server...\n");
 
-	close(server_sockfd); /* Close server socket */
+	close(connected_server_sockfd); /* Close server socket */
 	free(client_input_buffer); /* Free allocated input buffer */
 }
 
-void *handle_server_responses(void *v_server_sockfd)
+void *handle_server_responses(void *v_unused)
 {
-	const int server_sockfd = *(int*)v_server_sockfd; /* Get server socket from thread pointer argument */
+	(void)v_unused; /* Avoid unused parameter warning */
+
+	struct client_response_state response_state;
+	memset(&response_state, 0, sizeof response_state);
+	response_state.printed_stream_id = -1;
+
+	/* Wait for messages from the server, which is replaced in the reactor whenever the client is redirected */
+	struct network_reactor response_reactor;
+	check_error(network_reactor_init(&response_reactor), "Failed to create reactor", 1);
+	check_error(network_reactor_add(
+		&response_reactor,
+		connected_server_sockfd,
+		POLLIN,
+		handle_server_event,
+		&response_state
+	), "Failed to listen for server messages", 1);
+	check_error(network_reactor_add(
+		&response_reactor,
+		client_wake_fd,
+		POLLIN,
+		handle_client_wake_event,
+		NULL
+	), "Failed to listen for wake event", 1);
+
+	/* Nothing but messages from the server and the client stopping wakes the handler up, so no time limit is needed */
+	while (client_running) {
+		if (network_reactor_run_once(&response_reactor, -1) == -1 && errno != EINTR) {
+			check_error(-1, "Failed to wait for server messages", 0);
+		}
+	}
 
-	/* Allocate a buffer to store messages from the server */
-	const size_t server_response_buffer_size = 0xFFFF;
-	char *server_response_buffer = calloc(sizeof(char), server_response_buffer_size);
+	network_reactor_free(&response_reactor);
+	free(response_state.server_message_reader.reader_buffer);
+	return NULL;
+}
 
-	do {
-		/* Block and wait to recieve buffer from server */
-		const ssize_t total_bytes_recieved = recieve_bytes(
-			server_sockfd,
-			server_response_buffer,
-			server_response_buffer_size
-		);
+void handle_server_event(struct network_reactor *reactor, struct pollfd *server_poll_sockfd, void *v_response_state)
+{
+	struct client_response_state *response_state = (struct client_response_state*)v_response_state;
+	struct network_message_reader *server_message_reader = &response_state->server_message_reader;
+	int server_sockfd = server_poll_sockfd->fd;
+
+	/* The server socket has data (or its disconnect) waiting, so this does not block */
+	const ssize_t total_bytes_recieved = read_network_messages(server_message_reader, server_sockfd, 0);
 
-		if (total_bytes_recieved == 0) {
-			/* Recieving '0 bytes' means the connection has been closed, stop client as well */
+	if (total_bytes_recieved == 0) {
+		/* Recieving '0 bytes' means the connection has been closed, which is only recovered from if there is a session to resume */
+		if (client_session_token == NULL) {
 			printf("Connection with server lost, exiting...\n");
 			close(server_sockfd);
 			exit(EXIT_SUCCESS);
-			return NULL;
 		}
 
-		check_error((int)total_bytes_recieved, "Failed to recieve server message", 0);
+		/* Give a restarting server time to listen again, with any server sharing its key able to resume the session.
+		   Messages typed in the meantime fail to send, as the lost connection is closed straight away. */
+		printf("Connection with server lost, resuming session...\n");
+		network_reactor_remove(reactor, server_sockfd);
+		close(server_sockfd);
+		unsigned reconnect_delay_seconds = 1;
+		for (int i = 0; ; ++i) {
+			sleep(reconnect_delay_seconds);
+			server_sockfd = init_server_connection(connected_server_address, connected_server_port, client_identity, client_session_token);
+			if (server_sockfd != -1) break;
+			if (i + 1 == CLIENT_RECONNECT_ATTEMPTS) {
+				printf("Failed to resume session, exiting...\n");
+				exit(EXIT_FAILURE);
+			}
+			reconnect_delay_seconds *= 2;
+			if (reconnect_delay_seconds > CLIENT_RECONNECT_MAXIMUM_DELAY_SECONDS) reconnect_delay_seconds = CLIENT_RECONNECT_MAXIMUM_DELAY_SECONDS;
+			printf("Retrying in %u second(s)...\n", reconnect_delay_seconds);
+		}
+		check_error(
+			network_reactor_add(reactor, server_sockfd, POLLIN, handle_server_event, response_state),
+			"Failed to listen for server messages", 1
+		);
+		server_message_reader->buffer_start = server_message_reader->buffer_end;
+		return;
+	}
+
+	if (check_error((int)total_bytes_recieved, "Failed to recieve server message", 0) == -1) return;
+
+	char *server_message;
+	size_t server_message_bytes;
+	while ((server_message = find_network_message(server_message_reader, &server_message_bytes)) != NULL) {
+		server_message_reader->buffer_start += server_message_bytes;
 
 		/* If the message recieved is the 'pulse' message, respond so the server knows the 
 		   client is still connected to avoid disconnection during large periods of inactivity */
-		if (*server_response_buffer == network_global_pulse_message) {
+		if (*server_message == network_global_pulse_message) {
+			pthread_mutex_lock(&client_send_mutex);
 			check_error((int)send_bytes(
 				server_sockfd,
 				&network_global_pulse_null_response,
 				network_global_pulse_bytes
 			), "Failed to reply to pulse message", 0);
-		} else printf("Message recieved from server: %s\n", server_response_buffer);
-	} while (client_running);
+			pthread_mutex_unlock(&client_send_mutex);
+			continue;
+		}
 
-	return NULL;
+		/* The raw bytes of a file sent by another client follow straight after its transfer message */
+		if (*server_message == network_global_transfer_message) {
+			if (recieve_client_file(server_sockfd, server_message_reader, server_message) == -1) {
+				printf("Connection with server lost, exiting...\n");
+				close(server_sockfd);
+				exit(EXIT_SUCCESS);
+			}
+			continue;
+		}
+
+		/* Chunks of a streamed message are printed as they arrive, continuing the line of the stream they belong to */
+		if (is_stream_chunk(server_message)) {
+			const int is_last_chunk = *server_message == network_global_stream_end_message;
+			long stream_id;
+			const char *chunk_data = split_stream_chunk(server_message, &stream_id);
+			if (chunk_data == NULL) continue;
+
+			if (stream_id != response_state->printed_stream_id) {
+				if (response_state->printed_stream_id != -1) putchar('\n');
+				printf("Message recieved from server: ");
+			}
+			fputs(chunk_data, stdout);
+			if (is_last_chunk) putchar('\n');
+			response_state->printed_stream_id = is_last_chunk ? -1 : stream_id;
+			fflush(stdout);
+			continue;
+		}
+
+		/* Any other message starts a new line, leaving a stream's line unfinished until its next chunk */
+		if (response_state->printed_stream_id != -1) {
+			putchar('\n');
+			response_state->printed_stream_id = -1;
+		}
+
+		/* The server moved this client to another server, such as after that server joined */
+		if (*server_message == network_global_redirect_message) {
+			char *redirect_host, *redirect_port;
+			if (split_redirect_address(server_message + 1, &redirect_host, &redirect_port) == -1) continue;
+			printf("Redirected to server '%s:%s'.\n", redirect_host, redirect_port);
+
+			/* Connect to the new server before closing the old one, so sent messages always have a valid socket to go to */
+			const int previous_server_sockfd = server_sockfd;
+			server_sockfd = init_server_connection(redirect_host, redirect_port, client_identity, client_session_token);
+			if (server_sockfd == -1) exit(EXIT_FAILURE);
+			network_reactor_remove(reactor, previous_server_sockfd);
+			close(previous_server_sockfd);
+			check_error(
+				network_reactor_add(reactor, server_sockfd, POLLIN, handle_server_event, response_state),
+				"Failed to listen for server messages", 1
+			);
+
+			/* Anything else recieved from the previous server is no longer relevant */
+			server_message_reader->buffer_start = server_message_reader->buffer_end;
+			break;
+		}
+		/* Keep the latest session token to resume with, which is never printed. An empty one ends the session. */
+		else if (*server_message == network_global_session_message) {
+			free(client_session_token);
+			client_session_token = server_message[1] != '\0' ? strdup(server_message + 1) : NULL;
+		}
+		else printf("Message recieved from server: %s\n", server_message);
+	}
 }
 
+int send_client_file(int server_sockfd, const char *transfer_arguments)
+{
+	/* Split the client ID from the path that follows it */
+	char *client_id_end;
+	const long target_client_id = strtol(transfer_arguments, &client_id_end, 10);
+	if (client_id_end == transfer_arguments || *client_id_end != ' ' || client_id_end[1] == '\0') {
+		fprintf(stderr, "Usage: /sendfile <client ID> <path>\n");
+		return -1;
+	}
+	const char *file_path = client_id_end + 1;
+
+	const int file_fd = open(file_path, O_RDONLY);
+	if (check_error(file_fd, "Failed to open file", 0) == -1) return -1;
+	struct stat file_status;
+	if (check_error(fstat(file_fd, &file_status), "Failed to get file size", 0) == -1) goto close_file;
+
+	/* Only the name of the file is sent, not the directories it is in */
+	const char *file_name = strrchr(file_path, '/');
+	file_name = file_name != NULL ? file_name + 1 : file_path;
+
+	char transfer_message[320];
+	snprintf(
+		transfer_message,
+		sizeof transfer_message,
+		"%c%ld:%llu:%.255s",
+		network_global_transfer_message,
+		target_client_id,
+		(unsigned long long)file_status.st_size,
+		file_name
+	);
+	printf("Sending '%s' (%llu bytes) to client %ld...\n", file_name, (unsigned long long)file_status.st_size, target_client_id);
+
+	/* The file follows straight after the transfer message, sent from the file to the socket without copying it into the client */
+	pthread_mutex_lock(&client_send_mutex);
+	int transfer_result = (int)send_bytes(server_sockfd, transfer_message, strlen(transfer_message) + 1);
+	for (off_t file_offset = 0; transfer_result != -1 && file_offset < file_status.st_size; ) {
+		if (sendfile(server_sockfd, file_fd, &file_offset, (size_t)(file_status.st_size - file_offset)) < 1) transfer_result = -1;
+	}
+	pthread_mutex_unlock(&client_send_mutex);
+	check_error(transfer_result, "Failed to send file", 0);
+
+	close(file_fd);
+	return transfer_result == -1 ? -1 : 0;
+
+close_file:
+	close(file_fd);
+	return -1;
+}
+
+int recieve_client_file(int server_sockfd, struct network_message_reader *server_message_reader, char *transfer_message)
+{
+	long sender_client_id;
+	unsigned long long transfer_bytes;
+	const char *file_name = split_transfer_message(transfer_message, &sender_client_id, &transfer_bytes);
+	if (file_name == NULL) {
+		fprintf(stderr, "Malformed file transfer message recieved from server.\n");
+		return -1;
+	}
+
+	/* Files are saved under their own name (without any directories) in the current directory */
+	const char *file_name_start = strrchr(file_name, '/');
+	if (file_name_start != NULL) file_name = file_name_start + 1;
+	char saved_file_name[320];
+	snprintf(saved_file_name, sizeof saved_file_name, "recieved_%s", file_name);
+
+	/* The file is still recieved if it cannot be saved, as the following messages come after it */
+	const int file_fd = open(saved_file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	check_error(file_fd, "Failed to create recieved file", 0);
+
+	/* The rest of the file is recieved after the buffered part, either mapped or copied ('-z' not given or not supported) */
+	struct network_zerocopy_reader transfer_reader;
+	if (check_error(
+		init_zerocopy_reader(&transfer_reader, server_sockfd, client_zerocopy_recieve ? CLIENT_ZEROCOPY_REGION_BYTES : 0),
+		"Failed to create file reader", 0
+	) == -1) {
+		if (file_fd != -1) close(file_fd);
+		return -1;
+	}
+
+	unsigned long long remaining_bytes = transfer_bytes;
+	while (remaining_bytes != 0) {
+		/* Part of the file may have been recieved along with earlier messages */
+		const char *recieved_data = server_message_reader->reader_buffer + server_message_reader->buffer_start;
+		size_t recieved_bytes = server_message_reader->buffer_end - server_message_reader->buffer_start;
+		if (recieved_bytes != 0) {
+			if (recieved_bytes > remaining_bytes) recieved_bytes = (size_t)remaining_bytes;
+			server_message_reader->buffer_start += recieved_bytes;
+		} else {
+			const size_t next_recieve_bytes = remaining_bytes < CLIENT_ZEROCOPY_REGION_BYTES ? (size_t)remaining_bytes : CLIENT_ZEROCOPY_REGION_BYTES;
+			const ssize_t total_bytes_recieved = recieve_zerocopy_bytes(&transfer_reader, server_sockfd, next_recieve_bytes, &recieved_data);
+			if (total_bytes_recieved < 1) {
+				free_zerocopy_reader(&transfer_reader);
+				if (file_fd != -1) close(file_fd);
+				return -1;
+			}
+			recieved_bytes = (size_t)total_bytes_recieved;
+		}
+
+		if (file_fd != -1 && write(file_fd, recieved_data, recieved_bytes) != (ssize_t)recieved_bytes) {
+			check_error(-1, "Failed to write recieved file", 0);
+		}
+		remaining_bytes -= recieved_bytes;
+	}
+
+	if (client_zerocopy_recieve) {
+		printf("Mapped %llu of %llu bytes recieved from the socket.\n", transfer_reader.mapped_bytes_total, transfer_bytes);
+	}
+	free_zerocopy_reader(&transfer_reader);
+	if (file_fd != -1) {
+		close(file_fd);
+		printf("Recieved '%s' (%llu bytes) from client %ld, saved as '%s'.\n", file_name, transfer_bytes, sender_client_id, saved_file_name);
+	}
+	return 0;
+}
+
+
+void handle_client_wake_event(struct network_reactor *reactor, struct pollfd *wake_poll_sockfd, void *event_data)
+{
+	(void)reactor; /* Avoid unused parameter warnings */
+	(void)event_data;
+
+	/* The loop checks whether the client is still running after every round, so there is nothing to do but clear the event */
+	uint64_t wake_count;
+	if (read(wake_poll_sockfd->fd, &wake_count, sizeof wake_count) == -1) return;
+}
 
 void signal_client_end(int param)
 {
 	(void)param; /* Avoid unused parameter warning */
 	client_running = 0; /* Stop client loop and begin resource cleanup */
+
+	/* Only 'write' is used, so this is safe in a signal handler */
+	const uint64_t wake_count = 1;
+	if (client_wake_fd != -1 && write(client_wake_fd, &wake_count, sizeof wake_count) == -1) return;
 }
 
 #ifdef __cplusplus
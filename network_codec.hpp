@@ -0,0 +1,293 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#pragma once
+#ifndef NETWORK_DEMO_CODEC_HPP
+#define NETWORK_DEMO_CODEC_HPP
+
+#include <sys/types.h>
+
+#include <concepts>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "network_shared.h"
+
+/*
+   Binary messages whose encoders and decoders are generated at compile time from a schema. A schema lists the members
+   of a struct in the order they are sent, along with how each one is written:
+
+	struct transfer_request {
+		uint32_t client_id;
+		uint64_t transfer_bytes;
+		std::string_view file_name;
+	};
+	using transfer_request_message = network::codec::message<
+		0x10, transfer_request,
+		network::codec::field<&transfer_request::client_id, network::codec::fixed<uint32_t>>,
+		network::codec::field<&transfer_request::transfer_bytes, network::codec::varint>,
+		network::codec::field<&transfer_request::file_name, network::codec::bytes>
+	>;
+
+   Every message is sent as a frame, starting with a fixed-layout header of the message's ID (1 byte) and the size of the
+   rest of the frame (2 bytes, little-endian), followed by each field in turn:
+	- 'fixed<T>': An integer of the same size as T, little-endian.
+	- 'varint': An unsigned integer in 7-bit groups (least significant first), with the top bit set on all but the last.
+	- 'bytes': A varint size followed by that many bytes, decoded as a view into the recieved data rather than a copy.
+
+   Encoding and decoding only work on the given buffers, never allocating memory or calling through virtual functions.
+   Decoded views are only valid whilst the buffer they were decoded from is. Frames recieved from a stream can be found
+   with 'find_frame', and decoded straight into the message they hold with 'decode_any'.
+*/
+
+namespace network::codec {
+
+/* Bytes of the header at the start of every frame */
+inline constexpr size_t frame_header_bytes = 3;
+/* Most bytes the rest of a frame can hold, as given by its header */
+inline constexpr size_t maximum_payload_bytes = NETWORK_MAXIMUM_MESSAGE_BYTES;
+
+/* Fixed-layout header at the start of every frame. */
+struct frame_header {
+	uint8_t message_id;
+	uint16_t payload_bytes; /* Bytes of the frame after the header */
+};
+
+
+namespace detail {
+	template<typename M> struct member_traits;
+	template<typename S, typename T> struct member_traits<T S::*> {
+		using struct_type = S;
+		using member_type = T;
+	};
+
+	/* Unsigned integer of the same size as the given integer or enum */
+	template<typename T> struct unsigned_of { using type = std::make_unsigned_t<T>; };
+	template<typename T> requires std::is_enum_v<T> struct unsigned_of<T> { using type = std::make_unsigned_t<std::underlying_type_t<T>>; };
+}
+
+
+/* ---- Field encodings ---- */
+
+/* Integer written as the given number of bytes, little-endian. */
+template<typename T> requires (std::integral<T> && !std::is_same_v<T, bool>) || std::is_enum_v<T>
+struct fixed {
+	using value_type = T;
+	using unsigned_type = typename detail::unsigned_of<T>::type;
+	static constexpr size_t maximum_bytes = sizeof(T);
+
+	static constexpr size_t size(value_type) noexcept { return sizeof(T); }
+	static constexpr char *encode(value_type value, char *target_buffer) noexcept
+	{
+		unsigned_type unsigned_value = static_cast<unsigned_type>(value);
+		for (size_t i = 0; i < sizeof(T); ++i, unsigned_value = static_cast<unsigned_type>(unsigned_value >> 8)) {
+			*target_buffer++ = static_cast<char>(unsigned_value & 0xFFu);
+		}
+		return target_buffer;
+	}
+	static constexpr const char *decode(const char *source_data, const char *source_end, value_type &value) noexcept
+	{
+		if (source_end - source_data < static_cast<ptrdiff_t>(sizeof(T))) return nullptr;
+		unsigned_type unsigned_value = 0;
+		for (size_t i = sizeof(T); i-- > 0; ) {
+			unsigned_value = static_cast<unsigned_type>((unsigned_value << 8) | static_cast<unsigned char>(source_data[i]));
+		}
+		value = static_cast<value_type>(unsigned_value);
+		return source_data + sizeof(T);
+	}
+};
+
+/* Unsigned integer written in as few bytes as it fits in, 7 bits per byte. */
+struct varint {
+	using value_type = uint64_t;
+	static constexpr size_t maximum_bytes = 10;
+
+	static constexpr size_t size(value_type value) noexcept
+	{
+		size_t value_bytes = 1;
+		while (value >= 0x80u) { value >>= 7; ++value_bytes; }
+		return value_bytes;
+	}
+	static constexpr char *encode(value_type value, char *target_buffer) noexcept
+	{
+		for (; value >= 0x80u; value >>= 7) *target_buffer++ = static_cast<char>((value & 0x7Fu) | 0x80u);
+		*target_buffer++ = static_cast<char>(value);
+		return target_buffer;
+	}
+	static constexpr const char *decode(const char *source_data, const char *source_end, value_type &value) noexcept
+	{
+		value = 0;
+		for (unsigned shift = 0; source_data != source_end && shift < 64; shift += 7) {
+			const uint64_t current_byte = static_cast<unsigned char>(*source_data++);
+			/* The last byte of the largest values only has one bit left to give */
+			if (shift == 63 && current_byte > 1) return nullptr;
+			value |= (current_byte & 0x7Fu) << shift;
+			if ((current_byte & 0x80u) == 0) return source_data;
+		}
+		return nullptr;
+	}
+};
+
+/* Bytes written after their size (as a varint), being decoded as a view into the recieved data. */
+struct bytes {
+	using value_type = std::string_view;
+	static constexpr size_t maximum_bytes = 3 + maximum_payload_bytes;
+
+	static constexpr size_t size(value_type value) noexcept { return varint::size(value.size()) + value.size(); }
+	static constexpr char *encode(value_type value, char *target_buffer) noexcept
+	{
+		target_buffer = varint::encode(value.size(), target_buffer);
+		for (const char current_char : value) *target_buffer++ = current_char;
+		return target_buffer;
+	}
+	static constexpr const char *decode(const char *source_data, const char *source_end, value_type &value) noexcept
+	{
+		uint64_t value_bytes;
+		if ((source_data = varint::decode(source_data, source_end, value_bytes)) == nullptr) return nullptr;
+		if (value_bytes > static_cast<uint64_t>(source_end - source_data)) return nullptr;
+		value = value_type(source_data, static_cast<size_t>(value_bytes));
+		return source_data + value_bytes;
+	}
+};
+
+/* What a field encoding must provide. Encoding assumes the buffer has room, and decoding returns NULL on invalid data. */
+template<typename E>
+concept field_encoding = requires(typename E::value_type value, char *target_buffer, const char *source_data) {
+	{ E::maximum_bytes } -> std::convertible_to<size_t>;
+	{ E::size(value) } -> std::same_as<size_t>;
+	{ E::encode(value, target_buffer) } -> std::same_as<char*>;
+	{ E::decode(source_data, source_data, value) } -> std::same_as<const char*>;
+};
+
+
+/* ---- Schemas ---- */
+
+/* A member of a message's struct, sent with the given encoding. */
+template<auto member, field_encoding E>
+struct field {
+	using struct_type = typename detail::member_traits<decltype(member)>::struct_type;
+	using member_type = typename detail::member_traits<decltype(member)>::member_type;
+	using encoding = E;
+	static_assert(std::is_convertible_v<member_type, typename E::value_type>, "Member cannot be written with its encoding");
+	static_assert(std::is_convertible_v<typename E::value_type, member_type>, "Member cannot be read with its encoding");
+
+	static constexpr size_t size(const struct_type &object) noexcept { return E::size(static_cast<typename E::value_type>(object.*member)); }
+	static constexpr char *encode(const struct_type &object, char *target_buffer) noexcept
+	{
+		return E::encode(static_cast<typename E::value_type>(object.*member), target_buffer);
+	}
+	static constexpr const char *decode(const char *source_data, const char *source_end, struct_type &object) noexcept
+	{
+		typename E::value_type value{};
+		if ((source_data = E::decode(source_data, source_end, value)) == nullptr) return nullptr;
+
+		/* Integers too large for their member are invalid rather than cut short */
+		if constexpr (std::is_integral_v<member_type> && std::is_integral_v<typename E::value_type>) {
+			if (!std::in_range<member_type>(value)) return nullptr;
+		}
+		object.*member = static_cast<member_type>(value);
+		return source_data;
+	}
+};
+
+/* A message with the given ID, sending the given fields of its struct in order. */
+template<uint8_t id, typename S, typename... F>
+	requires (std::is_same_v<typename F::struct_type, S> && ...)
+struct message {
+	using struct_type = S;
+	static constexpr uint8_t message_id = id;
+	/* Most bytes a frame of this message can take up, for sizing buffers at compile time */
+	static constexpr size_t maximum_bytes = frame_header_bytes + (F::encoding::maximum_bytes + ... + 0);
+	static_assert(((std::is_same_v<typename F::encoding, bytes> ? 0 : F::encoding::maximum_bytes) + ... + 0) <= maximum_payload_bytes,
+		"Message does not fit in a frame");
+
+	/* Returns the bytes the given message takes up as a frame. */
+	static constexpr size_t encoded_size(const S &object) noexcept { return frame_header_bytes + (F::size(object) + ... + 0); }
+
+	/* Writes the given message as a frame into the given buffer, returning the bytes written.
+	   Returns 0 if the buffer is too small or the message does not fit in a frame. */
+	static constexpr size_t encode(const S &object, char *target_buffer, size_t target_buffer_bytes) noexcept
+	{
+		const size_t frame_bytes = encoded_size(object);
+		if (frame_bytes > target_buffer_bytes || frame_bytes - frame_header_bytes > maximum_payload_bytes) return 0;
+
+		char *target_position = fixed<uint8_t>::encode(id, target_buffer);
+		target_position = fixed<uint16_t>::encode(static_cast<uint16_t>(frame_bytes - frame_header_bytes), target_position);
+		((target_position = F::encode(object, target_position)), ...);
+		return frame_bytes;
+	}
+
+	/* Reads the message from the payload of a frame (the data after its header), returning 0 on success and -1 if the
+	   payload is not a valid message. Views are given into the payload, only being valid whilst it is. */
+	static constexpr int decode_payload(const char *payload_data, size_t payload_bytes, S &object) noexcept
+	{
+		const char *source_position = payload_data, *const source_end = payload_data + payload_bytes;
+		const bool is_decoded = (((source_position = F::decode(source_position, source_end, object)) != nullptr) && ...);
+		return is_decoded && source_position == source_end ? 0 : -1;
+	}
+
+	/* Reads the message from the frame at the start of the given data, returning the bytes of the frame.
+	   Returns 0 if the frame is not complete yet, and -1 if it is not a valid frame of this message. */
+	static constexpr ssize_t decode(const char *source_data, size_t source_bytes, S &object) noexcept;
+};
+
+
+/* ---- Frames ---- */
+
+/* Reads the header of the frame at the start of the given data, returning the bytes of the whole frame.
+   Returns 0 if the header or the rest of the frame has not been recieved yet. */
+constexpr size_t find_frame(const char *source_data, size_t source_bytes, frame_header &header) noexcept
+{
+	header = frame_header{};
+	if (source_bytes < frame_header_bytes) return 0;
+	const char *source_position = fixed<uint8_t>::decode(source_data, source_data + source_bytes, header.message_id);
+	fixed<uint16_t>::decode(source_position, source_data + source_bytes, header.payload_bytes);
+	const size_t frame_bytes = frame_header_bytes + header.payload_bytes;
+	return frame_bytes <= source_bytes ? frame_bytes : 0;
+}
+
+template<uint8_t id, typename S, typename... F>
+	requires (std::is_same_v<typename F::struct_type, S> && ...)
+constexpr ssize_t message<id, S, F...>::decode(const char *source_data, size_t source_bytes, S &object) noexcept
+{
+	frame_header header{};
+	const size_t frame_bytes = find_frame(source_data, source_bytes, header);
+	if (frame_bytes == 0) return 0;
+	if (header.message_id != id || decode_payload(source_data + frame_header_bytes, header.payload_bytes, object) == -1) return -1;
+	return static_cast<ssize_t>(frame_bytes);
+}
+
+/*
+   Decodes the frame at the start of the given data as whichever of the given messages has its ID, and calls the handler
+   with the decoded struct. The message is chosen by comparing IDs directly (much like a switch statement), without any
+   lookup tables or virtual calls. Returns the bytes of the frame, 0 if it is not complete yet, and -1 if it is not a
+   valid frame of any of the messages (in which case the handler is not called).
+*/
+template<typename... M, typename H>
+constexpr ssize_t decode_any(const char *source_data, size_t source_bytes, H &&handler)
+{
+	static_assert(sizeof...(M) != 0, "No messages given to decode");
+	frame_header header{};
+	const size_t frame_bytes = find_frame(source_data, source_bytes, header);
+	if (frame_bytes == 0) return 0;
+
+	const auto try_decode = [&]<typename N>() -> bool {
+		if (header.message_id != N::message_id) return false;
+		typename N::struct_type object{};
+		if (N::decode_payload(source_data + frame_header_bytes, header.payload_bytes, object) == -1) return false;
+		handler(static_cast<const typename N::struct_type&>(object));
+		return true;
+	};
+	return (try_decode.template operator()<M>() || ...) ? static_cast<ssize_t>(frame_bytes) : -1;
+}
+
+} /* namespace network::codec */
+
+#endif /* NETWORK_DEMO_CODEC_HPP */
@@ -0,0 +1,446 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#pragma once
+#ifndef NETWORK_DEMO_COROUTINE_HPP
+#define NETWORK_DEMO_COROUTINE_HPP
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "network_shared.h"
+#include "network_reactor.h"
+
+/*
+   C++20 coroutines on top of the reactor, so that many sessions with a server (such as chat bots) can each be written as
+   straight-line code whilst all of them run on a single thread. A session is a coroutine returning 'network::task', which
+   is started with 'scheduler::spawn' and waits for its connection or a timer with 'co_await':
+
+	network::task run_bot(network::scheduler &bot_scheduler)
+	{
+		network::connection server_connection(bot_scheduler);
+		if (co_await server_connection.connect("localhost", "5000") == -1) co_return;
+		co_await server_connection.write_frame("Hello!");
+		while (std::optional<std::string_view> message = co_await server_connection.read_frame()) { ... }
+	}
+
+   Waiting never blocks the thread: a waiting coroutine is resumed by the scheduler once its socket is ready or its timer
+   is due, so each session only costs its coroutine frame (its local variables, such as its connection) rather than a
+   thread with its own stack. Pulse checks from the server are answered by the connection itself.
+
+   A connection is only used by the coroutines of the scheduler it was made with. Only one coroutine may read from a
+   connection at a time, and only one may write to it at a time. Connections cannot be copied or moved, as the reactor
+   refers to them whilst they are open.
+*/
+
+namespace network {
+
+class scheduler;
+
+/* A coroutine run by a scheduler, which frees itself once it has finished. */
+class task {
+public:
+	struct promise_type {
+		scheduler *owner_scheduler = nullptr; /* Scheduler running the coroutine, set once it is spawned */
+
+		task get_return_object() noexcept { return task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		/* Coroutines only start once spawned, and their frame is freed as soon as they finish */
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { std::terminate(); }
+		~promise_type();
+	};
+
+	task(task &&other) noexcept : coroutine_handle(std::exchange(other.coroutine_handle, nullptr)) {}
+	task(const task&) = delete;
+	task &operator=(const task&) = delete;
+	task &operator=(task&&) = delete;
+	/* A coroutine that was never spawned is freed without running */
+	~task() { if (coroutine_handle) coroutine_handle.destroy(); }
+
+private:
+	friend class scheduler;
+	explicit task(std::coroutine_handle<promise_type> handle) noexcept : coroutine_handle(handle) {}
+	std::coroutine_handle<promise_type> coroutine_handle;
+};
+
+
+/* Runs coroutines on a reactor, resuming each one once what it waits for is ready. */
+class scheduler {
+public:
+	scheduler()
+	{
+		check_error(network_reactor_init(&scheduler_reactor), "(Coroutine) Failed to create reactor", 1);
+		check_error(sleep_timer_id = network_reactor_add_timer(&scheduler_reactor, 0, nullptr, nullptr), "(Coroutine) Failed to create timer", 1);
+	}
+	scheduler(const scheduler&) = delete;
+	scheduler &operator=(const scheduler&) = delete;
+	~scheduler() { network_reactor_free(&scheduler_reactor); }
+
+	/* Starts running the given coroutine, which runs until it first waits before this returns. */
+	void spawn(task new_task)
+	{
+		std::coroutine_handle<task::promise_type> coroutine_handle = std::exchange(new_task.coroutine_handle, nullptr);
+		coroutine_handle.promise().owner_scheduler = this;
+		++active_tasks_count;
+		coroutine_handle.resume();
+	}
+
+	/* Runs every spawned coroutine until all of them have finished or 'stop' is called. */
+	void run()
+	{
+		is_stopped = false;
+		while (active_tasks_count != 0 && !is_stopped) {
+			resume_ready_coroutines();
+			if (active_tasks_count == 0 || is_stopped) break;
+
+			/* The reactor only wakes up for the earliest sleeping coroutine, and does not wait at all if any are ready */
+			network_reactor_set_timer(&scheduler_reactor, sleep_timer_id, sleeping_coroutines.empty() ? 0 : sleeping_coroutines.top().wake_time_nanoseconds);
+			if (network_reactor_run_once(&scheduler_reactor, ready_coroutines.empty() ? -1 : 0) == -1 && errno != EINTR) {
+				check_error(-1, "(Coroutine) Error encountered whilst polling", 0);
+			}
+
+			const uint64_t current_time_nanoseconds = network_reactor_time();
+			while (!sleeping_coroutines.empty() && sleeping_coroutines.top().wake_time_nanoseconds <= current_time_nanoseconds) {
+				ready_coroutines.push_back(sleeping_coroutines.top().coroutine_handle);
+				sleeping_coroutines.pop();
+			}
+		}
+	}
+
+	/* Has 'run' return once the coroutine currently running waits. Safe to call from a signal handler. */
+	void stop() noexcept { is_stopped = true; }
+
+	/* Waits for the given number of nanoseconds. */
+	auto sleep_for(uint64_t sleep_nanoseconds)
+	{
+		struct sleep_awaiter {
+			scheduler *owner_scheduler;
+			uint64_t wake_time_nanoseconds;
+
+			bool await_ready() const noexcept { return false; }
+			void await_suspend(std::coroutine_handle<> coroutine_handle)
+			{
+				owner_scheduler->sleeping_coroutines.push(sleeping_coroutine{ wake_time_nanoseconds, coroutine_handle });
+			}
+			void await_resume() const noexcept {}
+		};
+		return sleep_awaiter{ this, network_reactor_time() + sleep_nanoseconds };
+	}
+
+	/* Returns the reactor the coroutines are run on, for adding other sockets and timers to. */
+	network_reactor *get_reactor() noexcept { return &scheduler_reactor; }
+	/* Returns the number of coroutines that were spawned and have not finished yet. */
+	size_t get_active_tasks_count() const noexcept { return active_tasks_count; }
+
+private:
+	friend struct task::promise_type;
+	friend class connection;
+
+	struct sleeping_coroutine {
+		uint64_t wake_time_nanoseconds;
+		std::coroutine_handle<> coroutine_handle;
+		bool operator>(const sleeping_coroutine &other) const noexcept { return wake_time_nanoseconds > other.wake_time_nanoseconds; }
+	};
+
+	/* Resumes every coroutine whose wait has ended, including those made ready whilst doing so */
+	void resume_ready_coroutines()
+	{
+		while (!ready_coroutines.empty()) {
+			resumed_coroutines.swap(ready_coroutines);
+			for (std::coroutine_handle<> coroutine_handle : resumed_coroutines) coroutine_handle.resume();
+			resumed_coroutines.clear();
+		}
+	}
+
+	network_reactor scheduler_reactor;
+	int sleep_timer_id = -1; /* Timer waking the reactor up for the earliest sleeping coroutine */
+	std::vector<std::coroutine_handle<>> ready_coroutines, resumed_coroutines;
+	std::priority_queue<sleeping_coroutine, std::vector<sleeping_coroutine>, std::greater<sleeping_coroutine>> sleeping_coroutines;
+	size_t active_tasks_count = 0;
+	volatile sig_atomic_t is_stopped = false;
+};
+
+inline task::promise_type::~promise_type()
+{
+	if (owner_scheduler != nullptr) --owner_scheduler->active_tasks_count;
+}
+
+
+/* A connection to a server, sending and recieving whole messages (frames) without blocking the thread. */
+class connection {
+public:
+	explicit connection(scheduler &owner) noexcept : owner_scheduler(&owner) { std::memset(&frame_reader, 0, sizeof frame_reader); }
+	connection(const connection&) = delete;
+	connection &operator=(const connection&) = delete;
+	~connection() { close(); }
+
+	/*
+	   Connects to the server with the given address and port, returning 0 on success and -1 on failure. The address is
+	   looked up without waiting for it to be ready (as 'getaddrinfo' blocks), so addresses that need a slow lookup should
+	   be given as numbers. Only the first address a connection could be started with is tried.
+	*/
+	auto connect(const char *server_address, const char *server_port)
+	{
+		struct connect_awaiter {
+			connection *owner_connection;
+			bool await_ready() const noexcept { return owner_connection->connect_sockfd == -1; }
+			void await_suspend(std::coroutine_handle<> coroutine_handle) { owner_connection->wait(coroutine_handle, POLLOUT); }
+			int await_resume() const noexcept { return owner_connection->finish_connect(); }
+		};
+		start_connect(server_address, server_port);
+		return connect_awaiter{ this };
+	}
+
+	/* Waits for the next message from the server, returning it without its terminator, or nothing if the connection closed or failed.
+	   The message is only valid until this is next called. Pulse checks are answered without being returned. */
+	auto read_frame()
+	{
+		struct read_awaiter {
+			connection *owner_connection;
+			bool await_ready() { return owner_connection->find_next_frame(); }
+			void await_suspend(std::coroutine_handle<> coroutine_handle) { owner_connection->wait(coroutine_handle, POLLIN); }
+			std::optional<std::string_view> await_resume() const noexcept
+			{
+				if (owner_connection->current_frame == nullptr) return std::nullopt;
+				return std::string_view(owner_connection->current_frame, owner_connection->current_frame_bytes - 1);
+			}
+		};
+
+		/* The previous message is only removed now, as it was valid until this call */
+		frame_reader.buffer_start += current_frame_bytes;
+		current_frame = nullptr;
+		current_frame_bytes = 0;
+		return read_awaiter{ this };
+	}
+
+	/* Sends the given message followed by its terminator, waiting until all of it was sent.
+	   Returns 0 on success and -1 if the connection closed or failed. */
+	auto write_frame(std::string_view message)
+	{
+		struct write_awaiter {
+			connection *owner_connection;
+			bool await_ready() { return owner_connection->continue_write(); }
+			void await_suspend(std::coroutine_handle<> coroutine_handle) { owner_connection->wait(coroutine_handle, POLLOUT); }
+			int await_resume() const noexcept { return owner_connection->is_write_failed ? -1 : 0; }
+		};
+
+		/* A pulse reply that could not be sent before goes first, as a message cannot be interrupted by one.
+		   Any others stay pending for the next write or for once no message is being written. */
+		write_parts[0] = { &network_global_pulse_null_response, pulse_replies_pending ? network_global_pulse_bytes : 0 };
+		write_parts[1] = { const_cast<char*>(message.data()), message.size() };
+		write_parts[2] = { const_cast<char*>(&frame_terminator), sizeof frame_terminator };
+		if (pulse_replies_pending != 0) --pulse_replies_pending;
+		is_write_failed = sockfd == -1;
+		return write_awaiter{ this };
+	}
+
+	/* Closes the connection. Any coroutine waiting on it must have been resumed beforehand. */
+	void close() noexcept
+	{
+		if (sockfd != -1) {
+			network_reactor_remove(&owner_scheduler->scheduler_reactor, sockfd);
+			::close(sockfd);
+			sockfd = -1;
+		}
+		free(frame_reader.reader_buffer);
+		std::memset(&frame_reader, 0, sizeof frame_reader);
+		current_frame = nullptr;
+		current_frame_bytes = 0;
+	}
+
+	/* Returns the socket of the connection, or -1 if it is not connected. */
+	int get_sockfd() const noexcept { return sockfd; }
+
+private:
+	/* Starts connecting without blocking, leaving the socket to wait for in 'connect_sockfd' (or -1 if it already failed) */
+	void start_connect(const char *server_address, const char *server_port)
+	{
+		close();
+		struct addrinfo address_info_hints, *server_address_list;
+		std::memset(&address_info_hints, 0, sizeof address_info_hints);
+		address_info_hints.ai_family = AF_UNSPEC;
+		address_info_hints.ai_socktype = SOCK_STREAM;
+		if (getaddrinfo(server_address, server_port, &address_info_hints, &server_address_list) != 0) return;
+
+		for (const struct addrinfo *current_address = server_address_list; current_address != nullptr; current_address = current_address->ai_next) {
+			const int new_sockfd = socket(current_address->ai_family, current_address->ai_socktype, current_address->ai_protocol);
+			if (new_sockfd == -1) continue;
+			if (fcntl(new_sockfd, F_SETFL, fcntl(new_sockfd, F_GETFL) | O_NONBLOCK) != -1 &&
+			    (::connect(new_sockfd, current_address->ai_addr, current_address->ai_addrlen) == 0 || errno == EINPROGRESS) &&
+			    network_reactor_add(&owner_scheduler->scheduler_reactor, new_sockfd, 0, handle_connection_event, this) != -1
+			) {
+				/* Every frame is sent whole in a single call, so there is nothing to gain from delaying small ones */
+				const int disable_delay = 1;
+				setsockopt(new_sockfd, IPPROTO_TCP, TCP_NODELAY, &disable_delay, sizeof disable_delay);
+				sockfd = connect_sockfd = new_sockfd;
+				break;
+			}
+			::close(new_sockfd);
+		}
+		freeaddrinfo(server_address_list);
+	}
+
+	/* Returns 0 if the connection started by 'start_connect' succeeded, closing it and returning -1 otherwise */
+	int finish_connect() noexcept
+	{
+		const int connected_sockfd = std::exchange(connect_sockfd, -1);
+		int connect_error = -1;
+		socklen_t connect_error_bytes = sizeof connect_error;
+		if (connected_sockfd == -1 ||
+		    getsockopt(connected_sockfd, SOL_SOCKET, SO_ERROR, &connect_error, &connect_error_bytes) == -1 ||
+		    connect_error != 0
+		) {
+			close();
+			return -1;
+		}
+		return 0;
+	}
+
+	/* Finds the next complete message that is not a pulse check, answering any pulse checks found before it.
+	   Returns true if a message was found or the connection is closed, and false if more data is needed. */
+	bool find_next_frame()
+	{
+		if (sockfd == -1) return true;
+		size_t frame_bytes;
+		char *next_frame;
+		while ((next_frame = find_network_message(&frame_reader, &frame_bytes)) != nullptr) {
+			if (*next_frame != network_global_pulse_message) {
+				current_frame = next_frame;
+				current_frame_bytes = frame_bytes;
+				return true;
+			}
+			frame_reader.buffer_start += frame_bytes;
+			++pulse_replies_pending;
+		}
+		if (pulse_replies_pending != 0) send_pulse_replies();
+		return false;
+	}
+
+	/* Sends as much of the message being written as possible, returning true once it was all sent or sending failed */
+	bool continue_write() noexcept
+	{
+		while (!is_write_failed) {
+			struct iovec *first_part = write_parts;
+			while (first_part != write_parts + 3 && first_part->iov_len == 0) ++first_part;
+			if (first_part == write_parts + 3) return true;
+
+			struct msghdr write_message_header;
+			std::memset(&write_message_header, 0, sizeof write_message_header);
+			write_message_header.msg_iov = first_part;
+			write_message_header.msg_iovlen = (size_t)(write_parts + 3 - first_part);
+			ssize_t sent_bytes = sendmsg(sockfd, &write_message_header, MSG_DONTWAIT | MSG_NOSIGNAL);
+			if (sent_bytes == -1) {
+				if (errno == EAGAIN || errno == EWOULDBLOCK) return false;
+				if (errno != EINTR) is_write_failed = true;
+				continue;
+			}
+
+			/* Skip past whatever was sent, which may end part way through any of the parts */
+			for (struct iovec *current_part = first_part; sent_bytes > 0; ++current_part) {
+				const size_t part_sent_bytes = (size_t)sent_bytes < current_part->iov_len ? (size_t)sent_bytes : current_part->iov_len;
+				current_part->iov_base = static_cast<char*>(current_part->iov_base) + part_sent_bytes;
+				current_part->iov_len -= part_sent_bytes;
+				sent_bytes -= (ssize_t)part_sent_bytes;
+			}
+		}
+		return true;
+	}
+
+	/* Sends pulse replies straight away if no message is being written, leaving them for the next write otherwise */
+	void send_pulse_replies() noexcept
+	{
+		if (write_waiter) return;
+		while (pulse_replies_pending != 0 &&
+		       send(sockfd, &network_global_pulse_null_response, network_global_pulse_bytes, MSG_DONTWAIT | MSG_NOSIGNAL) == (ssize_t)network_global_pulse_bytes
+		) --pulse_replies_pending;
+	}
+
+	/* Has the given coroutine resumed once the given event occurs on the socket */
+	void wait(std::coroutine_handle<> coroutine_handle, short waited_event)
+	{
+		if (waited_event == POLLIN) read_waiter = coroutine_handle;
+		else write_waiter = coroutine_handle;
+		update_listened_events();
+	}
+
+	void update_listened_events() noexcept
+	{
+		struct pollfd *connection_poll_sockfd = network_reactor_find(&owner_scheduler->scheduler_reactor, sockfd);
+		if (connection_poll_sockfd != nullptr) connection_poll_sockfd->events = (short)((read_waiter ? POLLIN : 0) | (write_waiter ? POLLOUT : 0));
+	}
+
+	/*
+	   Reads and writes as much as possible once the socket is ready, making each waiting coroutine ready once what it waits
+	   for is done. Coroutines are only resumed by the scheduler after the reactor's round, as resuming one could close the
+	   connection whilst it is still being handled here.
+	*/
+	static void handle_connection_event(network_reactor *reactor, struct pollfd *event_poll_sockfd, void *v_connection)
+	{
+		(void)reactor; /* Avoid unused parameter warning */
+		connection *event_connection = static_cast<connection*>(v_connection);
+		std::vector<std::coroutine_handle<>> &ready_coroutines = event_connection->owner_scheduler->ready_coroutines;
+		const short recieved_events = event_poll_sockfd->revents;
+
+		if (event_connection->read_waiter && (recieved_events & (POLLIN | POLLHUP | POLLERR))) {
+			const ssize_t total_bytes_recieved = read_network_messages(&event_connection->frame_reader, event_connection->sockfd, MSG_DONTWAIT);
+			const bool is_closed = total_bytes_recieved == 0 ||
+				(total_bytes_recieved == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+			if (is_closed || event_connection->find_next_frame()) {
+				if (is_closed) event_connection->current_frame = nullptr;
+				ready_coroutines.push_back(std::exchange(event_connection->read_waiter, nullptr));
+			}
+		}
+
+		if (event_connection->write_waiter && (recieved_events & (POLLOUT | POLLHUP | POLLERR))) {
+			/* A connection being started is done once it becomes writable or fails, which is checked once resumed */
+			if (event_connection->connect_sockfd != -1 || event_connection->continue_write()) {
+				ready_coroutines.push_back(std::exchange(event_connection->write_waiter, nullptr));
+			}
+		}
+
+		event_connection->update_listened_events();
+	}
+
+	scheduler *owner_scheduler;
+	int sockfd = -1, connect_sockfd = -1; /* Socket of the connection, also given in 'connect_sockfd' whilst connecting */
+
+	struct network_message_reader frame_reader; /* Data recieved that has not been returned yet */
+	char *current_frame = nullptr; /* Message last returned by 'read_frame', being valid until it is next called */
+	size_t current_frame_bytes = 0;
+	size_t pulse_replies_pending = 0; /* Pulse checks that were not answered yet */
+
+	static constexpr char frame_terminator = '\0';
+	struct iovec write_parts[3] = {}; /* Parts of the message being written not sent yet: pulse replies, the message and its terminator */
+	bool is_write_failed = false;
+
+	std::coroutine_handle<> read_waiter, write_waiter; /* Coroutines waiting to read and write, if any */
+};
+
+} /* namespace network */
+
+#endif /* NETWORK_DEMO_COROUTINE_HPP */
@@ -0,0 +1,223 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#pragma once
+#ifndef NETWORK_DEMO_EPOCH_HPP
+#define NETWORK_DEMO_EPOCH_HPP
+
+#include <sched.h>
+
+#include <atomic>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+   Epoch-based reclamation, letting any number of threads read data published by another thread without taking a lock,
+   whilst the data they could still be reading is only freed once they have all moved on:
+
+	network::epoch_published<connection_list> published_connections;
+
+	Any thread reads the latest list, which stays valid until the guard is left however often a new one is published:
+	{
+		network::epoch_guard guard(domain);
+		const connection_list *connections = published_connections.read();
+		...
+	}
+
+	The publishing thread replaces the list, and now and then (such as once every round) frees the old lists that
+	nothing is reading any more:
+	published_connections.publish(domain, retired_lists, new connection_list(...));
+	retired_lists.reclaim(domain);
+
+   Each reader announces the epoch it started reading in, and every publish ends the current epoch. An object replaced
+   in some epoch can only still be seen by readers that started in that epoch or before, so it is freed once the oldest
+   reader started after it. Reading only costs a store and a fence on a cache line of the reader's own.
+*/
+
+namespace network {
+
+class epoch_domain {
+public:
+	/* Most threads that can be reading at once */
+	static constexpr size_t maximum_readers = 64;
+
+	epoch_domain() = default;
+	epoch_domain(const epoch_domain&) = delete;
+	epoch_domain &operator=(const epoch_domain&) = delete;
+
+	/* Claims a reader slot for the calling thread to read with, returning its index or -1 if every slot is taken. */
+	int register_reader() noexcept
+	{
+		for (size_t i = 0; i < maximum_readers; ++i) {
+			bool is_claimed = false;
+			if (reader_slots[i].is_claimed.compare_exchange_strong(is_claimed, true, std::memory_order_acquire)) return (int)i;
+		}
+		return -1;
+	}
+	/* Gives back a slot claimed with 'register_reader', which must not be reading. */
+	void unregister_reader(int reader_id) noexcept
+	{
+		reader_slots[(size_t)reader_id].is_claimed.store(false, std::memory_order_release);
+	}
+
+	/* Starts reading with the given slot: anything loaded from published data afterwards stays allocated until 'leave'.
+	   Reading with a slot can be nested, only being left once the outermost read ends. */
+	void enter(int reader_id) noexcept
+	{
+		reader_slot &slot = reader_slots[(size_t)reader_id];
+		if (slot.nested_reads_count++ != 0) return;
+
+		/* The epoch has to be visible to publishers before anything is loaded, which only a full fence ensures */
+		slot.reader_epoch.store(current_epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+	}
+	void leave(int reader_id) noexcept
+	{
+		reader_slot &slot = reader_slots[(size_t)reader_id];
+		if (--slot.nested_reads_count == 0) slot.reader_epoch.store(0, std::memory_order_release);
+	}
+
+	/* Ends the current epoch, returning it. Called after replacing published data, which is then tagged with the result. */
+	uint64_t advance() noexcept { return current_epoch.fetch_add(1, std::memory_order_seq_cst); }
+
+	/* Returns the earliest epoch any reader started reading in, or the current epoch if none is reading. Anything
+	   tagged with an earlier epoch can no longer be seen by any reader. */
+	uint64_t get_oldest_reader_epoch() const noexcept
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		uint64_t oldest_epoch = current_epoch.load(std::memory_order_relaxed);
+		for (size_t i = 0; i < maximum_readers; ++i) {
+			const uint64_t reader_epoch = reader_slots[i].reader_epoch.load(std::memory_order_acquire);
+			if (reader_epoch != 0 && reader_epoch < oldest_epoch) oldest_epoch = reader_epoch;
+		}
+		return oldest_epoch;
+	}
+
+	/* Waits until every reader that was reading when called has left, so that anything replaced beforehand can no
+	   longer be seen. Must not be called whilst reading. */
+	void synchronize() noexcept
+	{
+		const uint64_t ended_epoch = advance();
+		while (get_oldest_reader_epoch() <= ended_epoch) sched_yield();
+	}
+
+private:
+	/* Each slot is on its own cache line, so readers never write to a line another thread is using */
+	struct alignas(64) reader_slot {
+		std::atomic<uint64_t> reader_epoch{ 0 }; /* Epoch the reader started reading in, or 0 if it is not reading */
+		std::atomic<bool> is_claimed{ false };
+		unsigned nested_reads_count = 0; /* Only used by the thread owning the slot */
+	};
+
+	alignas(64) std::atomic<uint64_t> current_epoch{ 1 };
+	reader_slot reader_slots[maximum_readers];
+};
+
+/*
+   Reads under a domain for as long as the guard exists, either with a slot the thread already registered or with a slot
+   claimed just for the guard (for threads that only read now and then).
+*/
+class epoch_guard {
+public:
+	epoch_guard(epoch_domain &domain, int reader_id) noexcept : guarded_domain(domain), reader_id(reader_id)
+	{
+		guarded_domain.enter(reader_id);
+	}
+	explicit epoch_guard(epoch_domain &domain) noexcept : guarded_domain(domain), is_slot_claimed(true)
+	{
+		while ((reader_id = guarded_domain.register_reader()) == -1) sched_yield();
+		guarded_domain.enter(reader_id);
+	}
+	epoch_guard(const epoch_guard&) = delete;
+	epoch_guard &operator=(const epoch_guard&) = delete;
+	~epoch_guard()
+	{
+		guarded_domain.leave(reader_id);
+		if (is_slot_claimed) guarded_domain.unregister_reader(reader_id);
+	}
+
+private:
+	epoch_domain &guarded_domain;
+	int reader_id = -1;
+	bool is_slot_claimed = false;
+};
+
+/* Objects replaced by a single publishing thread, waiting to be freed until no reader can still see them. */
+class epoch_retire_list {
+public:
+	epoch_retire_list() = default;
+	epoch_retire_list(const epoch_retire_list&) = delete;
+	epoch_retire_list &operator=(const epoch_retire_list&) = delete;
+	~epoch_retire_list() { clear(); }
+
+	/* Frees the given object (allocated with 'new') once every reader that could still see it has left. */
+	template<typename T>
+	void retire(epoch_domain &domain, const T *object)
+	{
+		retired_objects.push_back({ object, [](const void *retired_object) { delete static_cast<const T*>(retired_object); }, domain.advance() });
+	}
+
+	/* Frees the objects that no reader can see any more, returning how many are still waiting. */
+	size_t reclaim(const epoch_domain &domain)
+	{
+		if (retired_objects.empty()) return 0;
+
+		/* Objects are retired in order of their epochs, so those that can be freed are all at the start */
+		const uint64_t oldest_reader_epoch = domain.get_oldest_reader_epoch();
+		size_t freed_count = 0;
+		while (freed_count < retired_objects.size() && retired_objects[freed_count].retired_epoch < oldest_reader_epoch) {
+			retired_objects[freed_count].object_deleter(retired_objects[freed_count].object);
+			++freed_count;
+		}
+		retired_objects.erase(retired_objects.begin(), retired_objects.begin() + (std::ptrdiff_t)freed_count);
+		return retired_objects.size();
+	}
+
+	/* Frees every object straight away, which is only safe once no thread is reading. */
+	void clear() noexcept
+	{
+		for (const retired_object &object : retired_objects) object.object_deleter(object.object);
+		retired_objects.clear();
+	}
+
+private:
+	struct retired_object {
+		const void *object;
+		void (*object_deleter)(const void*);
+		uint64_t retired_epoch;
+	};
+
+	std::vector<retired_object> retired_objects;
+};
+
+/* A pointer published by a single thread, which any thread can read under an epoch guard. */
+template<typename T>
+class epoch_published {
+public:
+	epoch_published() = default;
+	epoch_published(const epoch_published&) = delete;
+	epoch_published &operator=(const epoch_published&) = delete;
+	/* Only once no thread is reading */
+	~epoch_published() { delete published_object.load(std::memory_order_relaxed); }
+
+	/* Returns the latest object, or null if none was published. Only valid whilst the reading guard exists. */
+	const T *read() const noexcept { return published_object.load(std::memory_order_acquire); }
+
+	/* Replaces the object (allocated with 'new'), retiring the previous one. */
+	void publish(epoch_domain &domain, epoch_retire_list &retired_objects, const T *new_object)
+	{
+		const T *previous_object = published_object.exchange(new_object, std::memory_order_seq_cst);
+		if (previous_object != nullptr) retired_objects.retire(domain, previous_object);
+	}
+
+private:
+	std::atomic<const T*> published_object{ nullptr };
+};
+
+} /* namespace network */
+
+#endif /* NETWORK_DEMO_EPOCH_HPP */
@@ -0,0 +1,317 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#pragma once
+#ifndef NETWORK_DEMO_MESH_HPP
+#define NETWORK_DEMO_MESH_HPP
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "network_shared.h"
+
+/*
+   Messages handed between threads (nodes) without locks, through a ring of bytes from every node to every other node
+   that only its two nodes use. Each node also has a doorbell (an 'eventfd') its reactor waits for alongside its sockets:
+
+	network::message_mesh reactor_mesh(4);
+
+	Node 0 sends any number of messages during a round, and makes them visible (waking up their nodes) once it ends:
+	reactor_mesh.send(0, 2, message_type, target_sockfd, 0, message_data);
+	reactor_mesh.flush(0);
+
+	Node 2 recieves them once its doorbell is readable:
+	reactor_mesh.recieve(2, [](size_t from_node, const network::mesh_message &message) { ... });
+
+   Sending copies the message into the ring straight after the last one, only touching cache lines the sending node
+   already owns. Messages are made visible to their node by 'flush', which moves the end of each ring written to once and
+   rings each node's doorbell at most once, and only if it was not already rung since the node last recieved. A ring that
+   is full keeps its messages in a backlog of the sending node, retried on its next 'flush', and the reciever rings the
+   sender's doorbell once it made space so that the sender does not wait for an unrelated event.
+*/
+
+namespace network {
+
+/* A message recieved from another node. The data is only valid until the function it was given to returns. */
+struct mesh_message {
+	uint32_t message_type;
+	int32_t message_target; /* Such as the socket the message is for */
+	uint32_t message_argument;
+	std::string_view message_data;
+};
+
+/* A ring of bytes written by one thread and read by another, holding messages one after another. */
+class spsc_ring {
+public:
+	/* The size is rounded up to a power of two, which must be at least twice the largest message */
+	explicit spsc_ring(size_t ring_bytes)
+	{
+		while (ring_capacity < ring_bytes) ring_capacity *= 2;
+		ring_buffer = static_cast<char*>(std::aligned_alloc(64, ring_capacity));
+		check_error_null(ring_buffer, "(Mesh) Failed to allocate ring", 1);
+	}
+	spsc_ring(const spsc_ring&) = delete;
+	spsc_ring &operator=(const spsc_ring&) = delete;
+	~spsc_ring() { std::free(ring_buffer); }
+
+	/* Returns the most data a single message can hold. */
+	size_t get_maximum_data_bytes() const noexcept { return ring_capacity / 2 - sizeof(ring_record_header); }
+
+	/* Called by the writing thread: copies a message into the ring without making it visible yet, returning false if
+	   there is not enough space for it. */
+	bool write(uint32_t message_type, int32_t message_target, uint32_t message_argument, std::string_view message_data) noexcept
+	{
+		const size_t record_bytes = sizeof(ring_record_header) + message_data.size();
+		const size_t aligned_record_bytes = align_record_bytes(record_bytes);
+		if (aligned_record_bytes > ring_capacity / 2) return false;
+
+		/* A message is never split at the end of the ring, with the rest of the ring being skipped instead */
+		const size_t record_offset = writer_tail & (ring_capacity - 1);
+		const size_t skipped_bytes = ring_capacity - record_offset < aligned_record_bytes ? ring_capacity - record_offset : 0;
+		if (writer_tail + skipped_bytes + aligned_record_bytes - writer_cached_head > ring_capacity) {
+			/* The reader's position is only loaded again when the ring looks full, as it is on the reader's cache line */
+			writer_cached_head = reader_head.load(std::memory_order_acquire);
+			if (writer_tail + skipped_bytes + aligned_record_bytes - writer_cached_head > ring_capacity) return false;
+		}
+
+		if (skipped_bytes != 0) {
+			const ring_record_header skip_header = { (uint32_t)skipped_bytes, RING_SKIP_TYPE, 0, 0 };
+			std::memcpy(ring_buffer + record_offset, &skip_header, sizeof skip_header);
+			writer_tail += skipped_bytes;
+		}
+		const ring_record_header record_header = { (uint32_t)record_bytes, message_type, message_target, message_argument };
+		char *const record = ring_buffer + (writer_tail & (ring_capacity - 1));
+		std::memcpy(record, &record_header, sizeof record_header);
+		if (!message_data.empty()) std::memcpy(record + sizeof record_header, message_data.data(), message_data.size());
+		writer_tail += aligned_record_bytes;
+		return true;
+	}
+
+	/* Called by the writing thread: makes every message written so far visible to the reader, returning false if there
+	   were none. */
+	bool publish() noexcept
+	{
+		if (writer_tail == writer_published_tail.load(std::memory_order_relaxed)) return false;
+		writer_published_tail.store(writer_tail, std::memory_order_release);
+		return true;
+	}
+
+	/* Called by the reading thread: gives every visible message to the given function, then frees their space.
+	   Returns the number of messages read. */
+	template<typename F>
+	size_t read(F &&on_message)
+	{
+		const size_t visible_tail = writer_published_tail.load(std::memory_order_acquire);
+		size_t head = reader_head.load(std::memory_order_relaxed), messages_count = 0;
+		while (head != visible_tail) {
+			const char *const record = ring_buffer + (head & (ring_capacity - 1));
+			ring_record_header record_header;
+			std::memcpy(&record_header, record, sizeof record_header);
+			if (record_header.message_type == RING_SKIP_TYPE) {
+				head += record_header.record_bytes;
+				continue;
+			}
+
+			on_message(mesh_message{
+				record_header.message_type,
+				record_header.message_target,
+				record_header.message_argument,
+				std::string_view(record + sizeof record_header, record_header.record_bytes - sizeof record_header)
+			});
+			head += align_record_bytes(record_header.record_bytes);
+			++messages_count;
+		}
+		reader_head.store(head, std::memory_order_release);
+		return messages_count;
+	}
+
+private:
+	/* Type of the record skipping the rest of the ring, which no message can have */
+	static constexpr uint32_t RING_SKIP_TYPE = UINT32_MAX;
+
+	/* Every record starts on a multiple of the header's size, so a header always fits before the end of the ring */
+	struct ring_record_header {
+		uint32_t record_bytes; /* Header and data, before being rounded up */
+		uint32_t message_type;
+		int32_t message_target;
+		uint32_t message_argument;
+	};
+	static constexpr size_t align_record_bytes(size_t record_bytes) noexcept
+	{
+		return (record_bytes + sizeof(ring_record_header) - 1) & ~(sizeof(ring_record_header) - 1);
+	}
+
+	/* The writer's and reader's positions are on cache lines of their own, each along with what only its thread uses */
+	alignas(64) std::atomic<size_t> writer_published_tail{ 0 };
+	size_t writer_tail = 0, writer_cached_head = 0;
+	alignas(64) std::atomic<size_t> reader_head{ 0 };
+	alignas(64) char *ring_buffer = nullptr;
+	size_t ring_capacity = 64;
+};
+
+/* Rings between every pair of nodes, with a doorbell for each node. */
+class message_mesh {
+public:
+	/* Room for a few of the largest messages the server reads */
+	static constexpr size_t default_ring_bytes = 0x40000;
+
+	explicit message_mesh(size_t nodes_count, size_t ring_bytes = default_ring_bytes) : mesh_nodes(nodes_count)
+	{
+		for (size_t i = 0; i < nodes_count * nodes_count; ++i) {
+			mesh_links.push_back(i / nodes_count != i % nodes_count ? std::make_unique<mesh_link>(ring_bytes) : nullptr);
+		}
+		for (mesh_node &node : mesh_nodes) {
+			node.doorbell_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			check_error(node.doorbell_fd, "(Mesh) Failed to create doorbell", 1);
+		}
+	}
+	message_mesh(const message_mesh&) = delete;
+	message_mesh &operator=(const message_mesh&) = delete;
+	~message_mesh()
+	{
+		for (mesh_node &node : mesh_nodes) close(node.doorbell_fd);
+	}
+
+	/* Returns the number of nodes in the mesh. */
+	size_t get_nodes_count() const noexcept { return mesh_nodes.size(); }
+	/* Returns the doorbell of the given node, which is readable whilst messages are waiting for it. */
+	int get_doorbell_socket(size_t node_index) const noexcept { return mesh_nodes[node_index].doorbell_fd; }
+	/* Returns the most data a single message can hold. */
+	size_t get_maximum_data_bytes() const noexcept { return mesh_nodes.size() > 1 ? get_link(0, 1).ring.get_maximum_data_bytes() : 0; }
+
+	/* Called by the sending node: queues a message for another node, which it recieves after the next 'flush'. */
+	void send(size_t from_node, size_t to_node, uint32_t message_type, int32_t message_target, uint32_t message_argument, std::string_view message_data)
+	{
+		mesh_link &link = get_link(from_node, to_node);
+		if (link.backlog.empty() && link.ring.write(message_type, message_target, message_argument, message_data)) {
+			link.is_written = true;
+			return;
+		}
+		link.backlog.push_back({ message_type, message_target, message_argument, std::string(message_data) });
+	}
+
+	/* Called by the sending node: makes its messages visible and rings the doorbell of each node they are for, retrying
+	   any backlogged messages first. Returns the number of messages still in a backlog. */
+	size_t flush(size_t from_node)
+	{
+		size_t backlogged_count = flush_links(from_node);
+		if (backlogged_count == 0) return 0;
+
+		/*
+		   The nodes the messages are for wake this one up once they made space. Space made before they could see that
+		   is found by trying again afterwards, so that the backlog is never left waiting for a wake up that does not come.
+		*/
+		std::atomic<bool> &is_waiting_for_space = mesh_nodes[from_node].is_waiting_for_space;
+		is_waiting_for_space.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if ((backlogged_count = flush_links(from_node)) == 0) is_waiting_for_space.store(false, std::memory_order_relaxed);
+		return backlogged_count;
+	}
+
+	/* Called by the recieving node: gives every visible message for it to the given function (as '(from_node, message)'),
+	   returning the number of messages recieved. Messages from each node are recieved in the order they were sent. */
+	template<typename F>
+	size_t recieve(size_t to_node, F &&on_message)
+	{
+		/* The doorbell's count is taken before it is marked as not rung, so that a node ringing it afterwards writes to it
+		   again rather than the ring being lost with the count. The rings are read after, so messages made visible before
+		   any ring seen by marking it are read too. */
+		mesh_node &node = mesh_nodes[to_node];
+		uint64_t doorbell_count;
+		if (read(node.doorbell_fd, &doorbell_count, sizeof doorbell_count) == -1) doorbell_count = 0;
+		node.is_doorbell_rung.exchange(false, std::memory_order_seq_cst);
+
+		size_t messages_count = 0;
+		for (size_t from_node = 0; from_node < mesh_nodes.size(); ++from_node) {
+			if (from_node == to_node) continue;
+			const size_t link_messages_count = get_link(from_node, to_node).ring.read([&](const mesh_message &message) { on_message(from_node, message); });
+			if (link_messages_count == 0) continue;
+			messages_count += link_messages_count;
+
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (mesh_nodes[from_node].is_waiting_for_space.exchange(false, std::memory_order_relaxed)) wake(from_node);
+		}
+		return messages_count;
+	}
+
+	/* Wakes the given node up without giving it any message, such as to stop it. Only 'write' is used, so this is safe
+	   to call from a signal handler. */
+	void wake(size_t node_index) noexcept
+	{
+		const uint64_t doorbell_count = 1;
+		if (write(mesh_nodes[node_index].doorbell_fd, &doorbell_count, sizeof doorbell_count) == -1) return;
+	}
+
+private:
+	struct backlogged_message {
+		uint32_t message_type;
+		int32_t message_target;
+		uint32_t message_argument;
+		std::string message_data;
+	};
+
+	/* Ring from one node to another, with the backlog and state only the sending node uses */
+	struct mesh_link {
+		explicit mesh_link(size_t ring_bytes) : ring(ring_bytes) {}
+		spsc_ring ring;
+		std::deque<backlogged_message> backlog;
+		bool is_written = false; /* Written to since the last flush */
+	};
+
+	struct alignas(64) mesh_node {
+		int doorbell_fd = -1;
+		std::atomic<bool> is_doorbell_rung{ false }; /* Rung since the node last recieved, so ringing again is not needed */
+		std::atomic<bool> is_waiting_for_space{ false }; /* Has messages in a backlog, waiting for others to recieve */
+	};
+
+	mesh_link &get_link(size_t from_node, size_t to_node) const noexcept { return *mesh_links[from_node * mesh_nodes.size() + to_node]; }
+
+	/* Retries the backlogs of the given node and publishes its rings, returning the number of messages still backlogged */
+	size_t flush_links(size_t from_node)
+	{
+		size_t backlogged_count = 0;
+		for (size_t to_node = 0; to_node < mesh_nodes.size(); ++to_node) {
+			if (to_node == from_node) continue;
+			mesh_link &link = get_link(from_node, to_node);
+			while (!link.backlog.empty()) {
+				const backlogged_message &message = link.backlog.front();
+				if (!link.ring.write(message.message_type, message.message_target, message.message_argument, message.message_data)) break;
+				link.is_written = true;
+				link.backlog.pop_front();
+			}
+			backlogged_count += link.backlog.size();
+
+			if (!link.is_written) continue;
+			link.is_written = false;
+			link.ring.publish();
+			ring_doorbell(to_node);
+		}
+		return backlogged_count;
+	}
+
+	void ring_doorbell(size_t node_index) noexcept
+	{
+		if (!mesh_nodes[node_index].is_doorbell_rung.exchange(true, std::memory_order_seq_cst)) wake(node_index);
+	}
+
+	std::vector<mesh_node> mesh_nodes;
+	std::vector<std::unique_ptr<mesh_link>> mesh_links; /* Indexed by sending node, then recieving node */
+};
+
+} /* namespace network */
+
+#endif /* NETWORK_DEMO_MESH_HPP */
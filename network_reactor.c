@@ -0,0 +1,280 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#include <errno.h>
+#include <time.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "network_shared.h"
+#include "network_reactor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*  ---- Function definitions ---- */
+
+
+int network_reactor_init(struct network_reactor *reactor)
+{
+	memset(reactor, 0, sizeof *reactor);
+
+	/* Start off with some amount of allocated requests to avoid excessive reallocating at the start */
+	reactor->poll_sockfds_alloc_count = 4;
+	reactor->poll_sockfds = malloc(sizeof *reactor->poll_sockfds * reactor->poll_sockfds_alloc_count);
+	reactor->handlers = malloc(sizeof *reactor->handlers * reactor->poll_sockfds_alloc_count);
+	if (reactor->poll_sockfds == NULL || reactor->handlers == NULL) {
+		network_reactor_free(reactor);
+		return -1;
+	}
+	return 0;
+}
+
+void network_reactor_free(struct network_reactor *reactor)
+{
+	free(reactor->poll_sockfds);
+	free(reactor->handlers);
+	free(reactor->socket_indices);
+	free(reactor->timers);
+	memset(reactor, 0, sizeof *reactor);
+}
+
+int network_reactor_listen(struct network_reactor *reactor, const char *port, network_reactor_callback callback, void *callback_data)
+{
+	const int listen_sockfd = open_listening_socket(port);
+	if (listen_sockfd == -1) return -1;
+
+	if (network_reactor_add(reactor, listen_sockfd, POLLIN, callback, callback_data) == -1) {
+		close(listen_sockfd);
+		return -1;
+	}
+	return listen_sockfd;
+}
+
+int network_reactor_add(struct network_reactor *reactor, int sockfd, short events, network_reactor_callback callback, void *callback_data)
+{
+	if (sockfd < 0 || network_reactor_find(reactor, sockfd) != NULL) return -1;
+
+	/* Expand the list of socket indices to fit the given socket, doubling its size */
+	const size_t socket_index = (size_t)sockfd;
+	if (socket_index >= reactor->socket_indices_count) {
+		size_t new_socket_indices_count = reactor->socket_indices_count ? reactor->socket_indices_count : 16;
+		while (new_socket_indices_count <= socket_index) new_socket_indices_count *= 2;
+
+		size_t *new_socket_indices = realloc(reactor->socket_indices, sizeof *new_socket_indices * new_socket_indices_count);
+		if (new_socket_indices == NULL) return -1;
+		memset(new_socket_indices + reactor->socket_indices_count, 0, sizeof *new_socket_indices * (new_socket_indices_count - reactor->socket_indices_count));
+		reactor->socket_indices = new_socket_indices;
+		reactor->socket_indices_count = new_socket_indices_count;
+	}
+
+	/* Double the size of both lists once they are full. The handlers are expanded first, as they are only used up to the count. */
+	if (reactor->poll_sockfds_count >= reactor->poll_sockfds_alloc_count) {
+		const size_t new_alloc_count = reactor->poll_sockfds_alloc_count * 2;
+		struct network_reactor_handler *new_handlers = realloc(reactor->handlers, sizeof *new_handlers * new_alloc_count);
+		if (new_handlers == NULL) return -1;
+		reactor->handlers = new_handlers;
+
+		struct pollfd *new_poll_sockfds = realloc(reactor->poll_sockfds, sizeof *new_poll_sockfds * new_alloc_count);
+		if (new_poll_sockfds == NULL) return -1;
+		reactor->poll_sockfds = new_poll_sockfds;
+		reactor->poll_sockfds_alloc_count = new_alloc_count;
+	}
+
+	/* New sockets start off without events, so they are not handled until the next round */
+	const size_t new_index = reactor->poll_sockfds_count++;
+	reactor->poll_sockfds[new_index].fd = sockfd;
+	reactor->poll_sockfds[new_index].events = events;
+	reactor->poll_sockfds[new_index].revents = 0;
+	reactor->handlers[new_index].callback = callback;
+	reactor->handlers[new_index].callback_data = callback_data;
+	reactor->handlers[new_index].is_pending = 0;
+	reactor->socket_indices[socket_index] = new_index + 1;
+	return 0;
+}
+
+int network_reactor_remove(struct network_reactor *reactor, int sockfd)
+{
+	if (network_reactor_find(reactor, sockfd) == NULL) return -1;
+	const size_t removed_index = reactor->socket_indices[sockfd] - 1;
+	reactor->socket_indices[sockfd] = 0;
+	if (reactor->handlers[removed_index].is_pending) --reactor->pending_count;
+
+	/* The last socket takes the place of the removed one */
+	const size_t last_index = --reactor->poll_sockfds_count;
+	if (removed_index != last_index) {
+		reactor->poll_sockfds[removed_index] = reactor->poll_sockfds[last_index];
+		reactor->handlers[removed_index] = reactor->handlers[last_index];
+		reactor->socket_indices[reactor->poll_sockfds[removed_index].fd] = removed_index + 1;
+	}
+
+	/* The socket now at the index being handled still needs to be handled, and the round ends early if the list got shorter */
+	if (reactor->is_dispatching) {
+		if (removed_index == reactor->dispatch_index) reactor->is_dispatched_removed = 1;
+		if (reactor->dispatch_end > reactor->poll_sockfds_count) reactor->dispatch_end = reactor->poll_sockfds_count;
+	}
+
+	/*
+	   Shrink both lists (by half) if they are much larger than the number of sockets. This is not done excessively, as
+	   reallocating costs more than the few bytes saved. A list that fails to shrink is simply kept at its size, which
+	   still fits the new count.
+	*/
+	const size_t shrunk_alloc_count = reactor->poll_sockfds_alloc_count / 2;
+	if (reactor->poll_sockfds_count < shrunk_alloc_count && shrunk_alloc_count >= 4) {
+		struct pollfd *new_poll_sockfds = realloc(reactor->poll_sockfds, sizeof *new_poll_sockfds * shrunk_alloc_count);
+		if (new_poll_sockfds != NULL) reactor->poll_sockfds = new_poll_sockfds;
+		struct network_reactor_handler *new_handlers = realloc(reactor->handlers, sizeof *new_handlers * shrunk_alloc_count);
+		if (new_handlers != NULL) reactor->handlers = new_handlers;
+		if (new_poll_sockfds != NULL || new_handlers != NULL) reactor->poll_sockfds_alloc_count = shrunk_alloc_count;
+	}
+	return 0;
+}
+
+struct pollfd *network_reactor_find(struct network_reactor *reactor, int sockfd)
+{
+	if (sockfd < 0 || (size_t)sockfd >= reactor->socket_indices_count || reactor->socket_indices[sockfd] == 0) return NULL;
+	return reactor->poll_sockfds + reactor->socket_indices[sockfd] - 1;
+}
+
+void network_reactor_set_pending(struct network_reactor *reactor, int sockfd, int is_pending)
+{
+	if (network_reactor_find(reactor, sockfd) == NULL) return;
+	struct network_reactor_handler *handler = reactor->handlers + reactor->socket_indices[sockfd] - 1;
+
+	is_pending = is_pending != 0;
+	if (is_pending == handler->is_pending) return;
+	handler->is_pending = is_pending;
+	if (is_pending) ++reactor->pending_count;
+	else --reactor->pending_count;
+}
+
+
+int network_reactor_add_timer(
+	struct network_reactor *reactor,
+	uint64_t interval_nanoseconds,
+	network_reactor_timer_callback callback,
+	void *callback_data
+) {
+	if (reactor->timers_count >= reactor->timers_alloc_count) {
+		const size_t new_alloc_count = reactor->timers_alloc_count ? reactor->timers_alloc_count * 2 : 4;
+		struct network_reactor_timer *new_timers = realloc(reactor->timers, sizeof *new_timers * new_alloc_count);
+		if (new_timers == NULL) return -1;
+		reactor->timers = new_timers;
+		reactor->timers_alloc_count = new_alloc_count;
+	}
+
+	struct network_reactor_timer *new_timer = reactor->timers + reactor->timers_count;
+	new_timer->callback = callback;
+	new_timer->callback_data = callback_data;
+	new_timer->interval_nanoseconds = interval_nanoseconds;
+	new_timer->deadline_nanoseconds = interval_nanoseconds != 0 ? network_reactor_time() + interval_nanoseconds : 0;
+	return (int)reactor->timers_count++;
+}
+
+void network_reactor_set_timer(struct network_reactor *reactor, int timer_id, uint64_t deadline_nanoseconds)
+{
+	if (timer_id < 0 || (size_t)timer_id >= reactor->timers_count) return;
+	reactor->timers[timer_id].deadline_nanoseconds = deadline_nanoseconds;
+}
+
+uint64_t network_reactor_get_timer(const struct network_reactor *reactor, int timer_id)
+{
+	if (timer_id < 0 || (size_t)timer_id >= reactor->timers_count) return 0;
+	return reactor->timers[timer_id].deadline_nanoseconds;
+}
+
+
+int network_reactor_run_once(struct network_reactor *reactor, int maximum_wait_milliseconds)
+{
+	/*
+	   Pending sockets are handled straight away, and otherwise the wait ends in time for the earliest timer.
+	   The clock is only read once per round, after waiting, so the wait is measured from the time of the previous round.
+	   Timers are then only late by as long as the callbacks of the previous round took, which are kept short.
+	*/
+	int poll_timeout = reactor->pending_count != 0 ? 0 : maximum_wait_milliseconds;
+	const uint64_t wait_start_time = reactor->current_time_nanoseconds != 0 ? reactor->current_time_nanoseconds : network_reactor_time();
+	for (size_t i = 0; i < reactor->timers_count && poll_timeout != 0; ++i) {
+		const uint64_t deadline_nanoseconds = reactor->timers[i].deadline_nanoseconds;
+		if (deadline_nanoseconds == 0) continue;
+
+		const uint64_t timer_wait_milliseconds = deadline_nanoseconds > wait_start_time ?
+			(deadline_nanoseconds - wait_start_time + 999999ULL) / 1000000ULL : 0;
+		if (poll_timeout < 0 || timer_wait_milliseconds < (uint64_t)poll_timeout) {
+			poll_timeout = timer_wait_milliseconds < (uint64_t)INT32_MAX ? (int)timer_wait_milliseconds : INT32_MAX;
+		}
+	}
+
+	const int poll_events_recieved = poll(reactor->poll_sockfds, (nfds_t)reactor->poll_sockfds_count, poll_timeout);
+	if (poll_events_recieved == -1) return -1;
+
+	/* Timers are handled first, seeing the events of this round without any of them having been handled yet.
+	   Indices are used as a callback can add timers, which can move the list. */
+	const uint64_t current_time = reactor->current_time_nanoseconds = network_reactor_time();
+	for (size_t i = 0; i < reactor->timers_count; ++i) {
+		struct network_reactor_timer *timer = reactor->timers + i;
+		if (timer->deadline_nanoseconds == 0 || timer->deadline_nanoseconds > current_time) continue;
+
+		/* A repeating timer that fell behind is not called again for every interval it missed */
+		if (timer->interval_nanoseconds == 0) timer->deadline_nanoseconds = 0;
+		else if ((timer->deadline_nanoseconds += timer->interval_nanoseconds) <= current_time) {
+			timer->deadline_nanoseconds = current_time + timer->interval_nanoseconds;
+		}
+		if (timer->callback != NULL) timer->callback(reactor, timer->callback_data);
+	}
+
+	/* Indices are used as the list can be moved by a callback, with removals moving the index being handled as needed */
+	reactor->is_dispatching = 1;
+	reactor->dispatch_end = reactor->poll_sockfds_count;
+	for (reactor->dispatch_index = 0; reactor->dispatch_index < reactor->dispatch_end; ) {
+		struct pollfd *current_poll_sockfd = reactor->poll_sockfds + reactor->dispatch_index;
+		const struct network_reactor_handler *current_handler = reactor->handlers + reactor->dispatch_index;
+
+		if ((current_poll_sockfd->revents != 0 || current_handler->is_pending) && current_handler->callback != NULL) {
+			reactor->is_dispatched_removed = 0;
+			current_handler->callback(reactor, current_poll_sockfd, current_handler->callback_data);
+			if (reactor->is_dispatched_removed) continue; /* Another socket took this one's place, which is handled next */
+		}
+		++reactor->dispatch_index;
+	}
+	reactor->is_dispatching = 0;
+
+	return poll_events_recieved;
+}
+
+void network_reactor_run(struct network_reactor *reactor)
+{
+	reactor->is_running = 1;
+	while (reactor->is_running) {
+		if (network_reactor_run_once(reactor, -1) == -1 && errno != EINTR) {
+			check_error(-1, "(Reactor) Error encountered whilst polling", 0);
+			break;
+		}
+	}
+	reactor->is_running = 0;
+}
+
+void network_reactor_stop(struct network_reactor *reactor)
+{
+	reactor->is_running = 0;
+}
+
+uint64_t network_reactor_time(void)
+{
+	struct timespec current_time;
+	clock_gettime(CLOCK_MONOTONIC, &current_time);
+	return (uint64_t)current_time.tv_sec * 1000000000ULL + (uint64_t)current_time.tv_nsec;
+}
+
+uint64_t network_reactor_now(const struct network_reactor *reactor)
+{
+	return reactor->current_time_nanoseconds;
+}
+
+#ifdef __cplusplus
+}
+#endif
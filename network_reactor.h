@@ -0,0 +1,140 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#pragma once
+#ifndef NETWORK_DEMO_REACTOR_H
+#define NETWORK_DEMO_REACTOR_H
+
+#include <poll.h>
+#include <signal.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+   A reactor waits for events on any number of sockets (or other file descriptors) at once, and hands each event to the
+   callback its socket was registered with. Timers are waited for alongside them, calling their own callback once their
+   time has come. Each round of a reactor waits for events with a single 'poll' call, calls the callbacks of any timers
+   that are due, then calls the callback of each socket that had events, in the order they are listed.
+
+   The poll requests of the registered sockets are kept in a single list that is given straight to 'poll', and callbacks
+   are given the request of their socket, so the events listened for can be changed through it at any time. Any bits of
+   'events' that 'poll' ignores are left as they are, so they can hold data of the socket's owner.
+   Sockets are removed by moving the last one in the list into their place. Removing sockets (including the one being
+   handled) and adding new ones is allowed from any callback: new sockets are first handled in the next round, and a
+   socket moved back over ones that were already handled only has its events handled in the next round (as 'poll'
+   gives any events still present again).
+
+   A socket can also be marked as pending, which has its callback called every round without waiting for any events
+   until it is unmarked, such as whilst it has recieved data left over to be handled.
+*/
+
+struct network_reactor;
+
+/* Called with the poll request of a socket that had events (given in its 'revents' field) or is pending.
+   The request is only valid until any socket is added to or removed from the reactor. */
+typedef void (*network_reactor_callback)(struct network_reactor *reactor, struct pollfd *event_poll_sockfd, void *callback_data);
+/* Called once the time of a timer has come. */
+typedef void (*network_reactor_timer_callback)(struct network_reactor *reactor, void *callback_data);
+
+
+/* ---- Structs ---- */
+
+/* Callback of a registered socket, stored at the same index as its poll request. */
+struct network_reactor_handler {
+	network_reactor_callback callback;
+	void *callback_data;
+	int is_pending; /* Non-zero if the callback is called every round, even without any events */
+};
+
+/* A timer that calls its callback at a given time, and again after every interval if it repeats. */
+struct network_reactor_timer {
+	network_reactor_timer_callback callback; /* Callback of the timer, or NULL if the timer only wakes the reactor up */
+	void *callback_data;
+	uint64_t interval_nanoseconds; /* Time between calls of a repeating timer, or 0 if it is only called once each time it is set */
+	uint64_t deadline_nanoseconds; /* Time of the next call on the monotonic clock, or 0 if the timer is not set */
+};
+
+/* Sockets and timers waited for together, with the callbacks handling them. */
+struct network_reactor {
+	struct pollfd *poll_sockfds; /* Poll requests of every registered socket, given straight to 'poll' */
+	struct network_reactor_handler *handlers; /* Callbacks of every registered socket, in the same order */
+	size_t poll_sockfds_count, poll_sockfds_alloc_count;
+
+	size_t *socket_indices; /* One more than the index of each registered socket (or 0 if not registered), indexed by socket */
+	size_t socket_indices_count;
+
+	struct network_reactor_timer *timers;
+	size_t timers_count, timers_alloc_count;
+
+	size_t pending_count; /* Number of pending sockets, which have the reactor not wait for events at all */
+	uint64_t current_time_nanoseconds; /* Time of the current round, read once after waiting rather than by every callback */
+
+	int is_dispatching; /* Non-zero whilst socket callbacks are being called, which removals then account for */
+	size_t dispatch_index, dispatch_end; /* Index of the socket being handled and the number of sockets handled this round */
+	int is_dispatched_removed; /* Non-zero if the socket being handled was removed, so a different one is now at its index */
+
+	volatile sig_atomic_t is_running; /* Non-zero whilst 'network_reactor_run' is running */
+};
+
+
+/* ---- Function declarations ---- */
+
+/* Prepares the given reactor, with no sockets or timers. Returns 0 on success and -1 on allocation failure. */
+int network_reactor_init(struct network_reactor *reactor);
+/* Frees the memory used by the given reactor. Registered sockets are not closed. */
+void network_reactor_free(struct network_reactor *reactor);
+
+/* Opens a socket listening for connections on the given port and registers it, calling the given callback whenever
+   a connection can be accepted. Returns the listening socket, or -1 on failure. */
+int network_reactor_listen(struct network_reactor *reactor, const char *port, network_reactor_callback callback, void *callback_data);
+/* Registers the given socket, calling the given callback whenever any of the given events occur on it.
+   Returns 0 on success and -1 on allocation failure or if the socket is already registered. */
+int network_reactor_add(struct network_reactor *reactor, int sockfd, short events, network_reactor_callback callback, void *callback_data);
+/* Stops listening for events on the given socket, without closing it. Returns 0 on success and -1 if the socket is not registered. */
+int network_reactor_remove(struct network_reactor *reactor, int sockfd);
+/* Returns the poll request of the given socket, which is valid until any socket is added or removed, or NULL if it is not registered. */
+struct pollfd *network_reactor_find(struct network_reactor *reactor, int sockfd);
+/* Marks or unmarks the given socket as pending, having its callback called every round without waiting for events. */
+void network_reactor_set_pending(struct network_reactor *reactor, int sockfd, int is_pending);
+
+/* Adds a timer calling the given callback (or only waking the reactor up if it is NULL). A timer given an interval is called
+   after every interval from now on, and a timer without one (0) is only called once each time it is set with 'network_reactor_set_timer'.
+   Returns the ID of the timer on success and -1 on allocation failure. */
+int network_reactor_add_timer(
+	struct network_reactor *reactor,
+	uint64_t interval_nanoseconds,
+	network_reactor_timer_callback callback,
+	void *callback_data
+);
+/* Sets the time the given timer is next called at on the monotonic clock (as given by 'network_reactor_time'), or stops it if 0. */
+void network_reactor_set_timer(struct network_reactor *reactor, int timer_id, uint64_t deadline_nanoseconds);
+/* Returns the time the given timer is next called at, or 0 if it is not set. */
+uint64_t network_reactor_get_timer(const struct network_reactor *reactor, int timer_id);
+
+/* Runs a single round of the reactor, waiting for up to the given number of milliseconds (or without a limit if negative)
+   for events, and handling any events and timers that are due. Returns the number of sockets with events and -1 on error,
+   including if the wait was interrupted by a signal. */
+int network_reactor_run_once(struct network_reactor *reactor, int maximum_wait_milliseconds);
+/* Runs rounds of the reactor until it is stopped with 'network_reactor_stop'. */
+void network_reactor_run(struct network_reactor *reactor);
+/* Stops the given reactor once its current round ends, or straight away if it is waiting and a signal interrupts it. */
+void network_reactor_stop(struct network_reactor *reactor);
+
+/* Returns the current time of the monotonic clock in nanoseconds, which timers are given in. */
+uint64_t network_reactor_time(void);
+/* Returns the time of the current round of the given reactor (read once after it last finished waiting), which is
+   cheaper than reading the clock in every callback. Returns 0 before the first round. */
+uint64_t network_reactor_now(const struct network_reactor *reactor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NETWORK_DEMO_REACTOR_H */
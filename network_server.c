@@ -0,0 +1,2539 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#define _GNU_SOURCE /* Needed for relaying transfers with 'splice' */
+
+#include <sys/eventfd.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+
+#include <strings.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "network_shared.h"
+#include "network_reactor.h"
+#include "network_server.h"
+#include "server_topics.h"
+#include "server_federation.h"
+#include "server_placement.h"
+#include "server_outbound.h"
+#include "server_relay.h"
+#include "server_snapshot.h"
+#include "server_session.h"
+#include "server_mailbox.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Bytes of messages each client may have handled per round of the main loop, with any unused amount carried over to the
+   next round whilst the client still has messages waiting (deficit round-robin). A larger quantum gives each client longer
+   turns, whilst a smaller one interleaves clients sending large messages more finely. */
+#define SERVER_READ_QUANTUM_BYTES 0x2000
+/* Minimum number of clients a message has to be sent to at once for it to be paced, if pacing is enabled */
+#define SERVER_PACING_MINIMUM_RECIPIENTS 32
+/* Bytes waiting to be sent to any recipient of a streamed message above which the sender's next chunk is held back.
+   Chunks of a stream are never dropped, so this bounds how much of a stream can pile up for a slow recipient instead. */
+#define SERVER_STREAM_MAXIMUM_QUEUED_BYTES 0x100000
+/* Bytes waiting to be echoed back to a client above which it is not read from, when only echoing messages */
+#define SERVER_ECHO_MAXIMUM_QUEUED_BYTES 0x100000
+/* Time between 'pulse' checks of connected clients, and between attempts to link with nodes that are not linked with */
+#define SERVER_PULSE_CHECK_INTERVAL_NANOSECONDS 30000000000ULL
+#define SERVER_FEDERATION_LINK_INTERVAL_NANOSECONDS 5000000000ULL
+/* Time from a change to the saved state until a snapshot of it is taken, which bounds how much a crash can lose, and
+   between checks of whether a snapshot being taken has finished */
+#define SERVER_SNAPSHOT_INTERVAL_NANOSECONDS 5000000000ULL
+#define SERVER_SNAPSHOT_CHECK_INTERVAL_NANOSECONDS 50000000ULL
+/* Time after starting for which subscriptions loaded from a snapshot are kept for their clients to identify themselves again */
+#define SERVER_SNAPSHOT_CLAIM_PERIOD_NANOSECONDS 600000000000ULL
+/* Time for which each session token given to a client can be used to resume its session */
+#define SERVER_SESSION_TOKEN_LIFETIME_SECONDS 3600
+
+
+/* ---- Structs ---- */
+
+/* Data to send to the 'interaction' function. */
+struct server_interact_data {
+	int server_sockfd; /* Server socket or file descriptor */
+	char *interact_message; /* The interaction message or 0-index terminator for a kick message. */
+	int interact_target; /* The target of the interaction or 0 for all clients. */
+	size_t interact_message_bytes; /* The size in bytes of the actual message */
+};
+
+
+/* Data kept for each connected client or link, indexed by the client's socket. */
+struct server_client_data {
+	char *client_identity; /* Identity given by the client to be placed by, or NULL if none was given */
+	struct session_patterns *session_patterns; /* Subscriptions in the client's session token, or NULL if it has no session */
+	int is_session_token_outdated; /* Non-zero if the client is sent a new session token after this round */
+	uint64_t session_token_renewal_time; /* Time on the reactor's clock the client's session token is renewed at, before it expires */
+	struct outbound_queue client_outbound_queue; /* Messages waiting to be sent to the client */
+
+	struct network_message_reader client_message_reader; /* Data recieved from the client that has not been handled yet */
+	size_t read_deficit_bytes; /* Bytes of messages the client may still have handled, carried over between rounds */
+	int is_read_backlogged; /* Non-zero if complete messages are waiting to be handled in the next round */
+
+	int *stream_recipient_sockfds; /* Recipients of the message the client is streaming, chosen by its first chunk */
+	size_t stream_recipients_count;
+	int is_stream_open; /* Non-zero whilst the client is streaming a message in chunks */
+	int is_stream_published; /* Non-zero if the message being streamed is a topic message rather than one to be printed */
+	int is_stream_stalled; /* Non-zero whilst the next chunk of the stream waits for its recipients to catch up */
+
+	struct client_relay *outgoing_relay; /* Relay of a file sent by the client, which is not read from otherwise until it ends */
+	struct client_relay *incoming_relay; /* Relay of a file sent to the client, which holds back its other messages once started */
+	int is_relay_paused; /* Non-zero whilst the client is not listened to for reads, as its relay has no space */
+
+	int is_kicked; /* Non-zero if the client is closed once its kick notice was sent, not being read from until then */
+};
+
+
+/* ---- Globals ---- */
+
+/* The current state of the server:
+   0: Inactive, not running  ----  1: Active, running main loop  ----  2: Interaction data ready */
+static volatile sig_atomic_t server_state = 0;
+/* Held whilst the server state leaves 'interaction data ready', which the interactive thread waits for with the condition
+   rather than checking the state repeatedly. */
+static pthread_mutex_t server_state_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t server_state_condition = PTHREAD_COND_INITIALIZER;
+/* Non-zero if the server was asked to stop whilst executing interactive input, which it does once the input was executed. */
+static volatile sig_atomic_t server_is_stop_pending = 0;
+
+/* Reactor waiting for events on the server socket, every client and link, and the server's timers. */
+static struct network_reactor server_reactor;
+/* Event written to wake the reactor up when the server state is changed from outside of it (by a signal or another thread),
+   as the reactor otherwise only wakes up for events and timers. */
+static int server_wake_fd = -1;
+/* Timers of the 'pulse' check, which only runs whilst anything is connected, and of opening links to other nodes,
+   which only runs whilst any node is not linked with. Either is -1 if the server does not use it. */
+static int server_pulse_timer_id = -1, server_federation_timer_id = -1;
+
+/* Topic subscriptions of all connected clients, used to route published messages. */
+static struct topic_trie server_topic_subscriptions;
+
+/* File the subscriptions of identified clients are saved to, or NULL if they are not saved. */
+static const char *server_snapshot_path = NULL;
+/* Timer taking snapshots once the saved state changed, and checking on the snapshot being taken, or -1 if not saving. */
+static int server_snapshot_timer_id = -1;
+/* Process writing the snapshot being taken, or -1 if none is. */
+static pid_t server_snapshot_pid = -1;
+/* Non-zero if the saved state changed since the last snapshot was taken. */
+static int server_is_snapshot_outdated = 0;
+/* Subscriptions loaded from the snapshot when starting, given back to each client once it identifies itself. */
+static struct server_snapshot server_restored_snapshot;
+/* Time until which the loaded subscriptions not given back yet are kept in new snapshots. */
+static uint64_t server_snapshot_claim_deadline = 0;
+
+/* Key the session tokens given to clients are authenticated with, being random unless read from a key file. */
+static unsigned char server_session_key[SESSION_KEY_BYTES];
+static int server_is_session_key_set = 0;
+
+/* Mailboxes of identities that are not connected, or NULL if direct messages are not kept for them. */
+static const char *server_mailbox_directory_path = NULL;
+static struct mailbox_store server_mailboxes;
+
+/* Other server processes this server is linked with, if any were given. */
+static struct server_federation server_federation_links;
+
+/* Consistent-hash ring of every node of the federation, used to find the node owning a client's identity. */
+static struct placement_ring server_placement_ring;
+
+/* Data of each client, indexed by socket. Expanded as needed to fit the highest socket. */
+static struct server_client_data *server_clients_data;
+static size_t server_clients_data_count;
+/* Number of connected clients and links, which are the sockets of the reactor handled by the client event handler. */
+static size_t server_connections_count = 0;
+/* Number of clients streaming a message, and of those whose next chunk is held back until their recipients catch up. */
+static size_t server_open_streams_count = 0, server_stalled_streams_count = 0;
+/* Number of files being relayed between clients. */
+static size_t server_open_relays_count = 0;
+
+/* Period of time over which a message sent to many clients at once is spread out, or 0 to send it to all of them straight away.
+   Sending to every client at once sends a large burst of packets, which network equipment may not have room for. */
+static uint64_t server_broadcast_pacing_nanoseconds = 0;
+
+/* What is done with recieved messages. The echo and discard modes skip everything besides reading and sending messages
+   (including printing, commands and pulse checks), to measure the cost of the server's own handling against them. */
+static enum server_serving_mode server_serving_mode = SERVER_FULL_MODE;
+
+/* Handler called for client events, or NULL to print chat messages instead. */
+static server_event_handler server_client_event_handler = NULL;
+static void *server_client_event_handler_data = NULL;
+
+
+/* ---- Function declarations ---- */
+
+/* Executes command given from interaction mode. Returns 0 on completion and -1 if the server closed. */
+static int handle_interaction_result(struct server_interact_data *interact_data);
+
+/* Send a 'pulse' message to all connected clients to get a response from them to be captured by their
+   corresponding poll request in the main server loop. Called by the server's pulse timer. */
+static void check_clients_pulse(struct network_reactor *reactor, void *timer_data);
+/* Starts the given timer of the server with the given interval if it is stopped, leaving it as it is otherwise. */
+static void start_server_timer(int timer_id, uint64_t interval_nanoseconds);
+/* Wakes the reactor up from another thread or a signal handler, so that a change of the server state is seen straight away. */
+static void wake_server(void);
+/* Clears the wake event once the reactor has woken up for it. */
+static void handle_wake_event(struct network_reactor *reactor, struct pollfd *wake_poll_sockfd, void *event_data);
+
+/* Accepts a new client once the server socket has a connection waiting, denying it if the given client limit was reached. */
+static void handle_server_event(struct network_reactor *reactor, struct pollfd *server_poll_sockfd, void *maximum_requests);
+/* Handles the events of a client or link, as well as any messages left over from the previous round. */
+static void handle_client_event(struct network_reactor *reactor, struct pollfd *client_poll_sockfd, void *event_data);
+
+/* Accept a new client and add them to the reactor.
+   If deny_connection is set, the client's socket is immediately closed and not added. */
+static void accept_new_client(int server_sockfd, int deny_connection);
+/* Reads any data sent from a client socket and handles the complete messages recieved, up to the client's share of this round.
+   Messages that do not fit in the client's share are left for later rounds, as is any data still in the socket until then.
+   If the client disconnected instead, it will remove them from the reactor. */
+static void handle_client_request(struct pollfd *client_sockfd);
+/* Handles every complete message recieved from a client in the echo or discard serving modes, sending them all
+   straight back to the client when echoing. */
+static void handle_client_benchmark_messages(int client_sockfd, struct server_client_data *client_data);
+
+/* Checks a message recieved from a client (rather than through a link from another node) for control characters. Messages starting
+   with a control character clients never send are refused, and any other control characters are replaced with spaces, so that they
+   cannot reach other clients as control messages. Returns 0 if the message is kept and -1 if it is refused. */
+static int filter_client_control_characters(char *client_message, size_t client_message_bytes);
+/* Executes a topic command sent by a client, being '/sub <pattern>', '/unsub <pattern>' or '/pub <topic> <message>'.
+   The message buffer may be modified. Returns 0 if the message was not a topic command and 1 otherwise. */
+static int handle_client_topic_command(int client_sockfd, char *client_message);
+/* Sends the given message to every client subscribed to a pattern matching the given topic.
+   Returns the number of subscribers the message was sent to or -1 if the topic is invalid. */
+static int publish_topic_message(const char *topic_name, const char *topic_message, size_t topic_message_bytes);
+
+/* Executes a state command sent by a client, being '/state <key> <value>', which sends the new value to every other client.
+   Only the latest value of each key is sent to clients that are slow to recieve messages.
+   Returns 0 if the message was not a state command and 1 otherwise. */
+static int handle_client_state_command(int client_sockfd, const char *client_message);
+/* Executes a direct message command sent by a client, being '/dm <identity> <message>', which sends the message to the client
+   with the identity, or stores it in the identity's mailbox if no such client is connected.
+   Returns 0 if the message was not a direct message command and 1 otherwise. */
+static int handle_client_direct_message(int client_sockfd, const char *client_message);
+/* Sends the given client every message waiting in the mailbox of its identity, all at once. */
+static void deliver_client_mailbox(int client_sockfd, const char *client_identity);
+/* Returns the socket of a client identified with the given identity, or -1 if there is none. */
+static int find_identity_client(const char *client_identity);
+
+/* Handles a chunk of a message streamed by a client. The first chunk decides where the message goes: to the subscribers of the topic
+   if it starts with '/pub <topic> ', and otherwise only printed like any other message. Each chunk is relayed to the recipients as
+   soon as it is recieved, so messages of any size can be sent without being held whole by the server.
+   The message buffer may be modified. Returns 0 if the message was not a stream chunk and 1 otherwise. */
+static int handle_client_stream_chunk(int client_sockfd, char *chunk_message);
+/* Returns non-zero if any recipient of the given client's stream has too many bytes waiting to be sent to be given another chunk. */
+static int is_client_stream_stalled(const struct server_client_data *client_data);
+/* Lets clients whose streams were held back continue once their recipients have caught up. */
+static void resume_stalled_streams(void);
+/* Sends the given chunk data to every recipient of the given client's stream, preceded by the given control character and
+   the client's socket as the ID of the stream. */
+static void relay_client_stream_chunk(int client_sockfd, char chunk_control_character, const char *chunk_data, size_t chunk_data_bytes);
+/* Closes the stream of the given client. The recipients of an interrupted stream, such as when its sender disconnected,
+   are sent an empty final chunk so that they do not wait for the rest of it. */
+static void close_client_stream(int client_sockfd, int is_interrupted);
+/* Removes the given socket from the recipients of every open stream, such as when it disconnects. */
+static void remove_stream_recipient(int recipient_sockfd);
+
+/* Handles a transfer message from a client, opening a relay of the file that follows it to the client given in it.
+   A file sent to a client that cannot recieve it is still read, but discarded, as the sender does not know to stop.
+   Returns 0 if the message was not a transfer message and 1 otherwise. */
+static int handle_client_transfer(int client_sockfd, const char *client_message);
+/* Moves bytes of the file sent by the given client into its relay, starting with any recieved along with earlier messages.
+   Returns the number of bytes moved, or -1 if the client disconnected or its connection failed. */
+static ssize_t fill_client_relay(int client_sockfd);
+/* Sends bytes of the file relayed to the given client, finishing the relay once all of it was sent. */
+static void drain_client_relay(int client_sockfd);
+/* Closes the given relay and reports its throughput, letting both of its clients continue as normal. */
+static void finish_client_relay(struct client_relay *relay);
+
+/* Handles a message recieved through a federation link, being a hello, broadcast or publish message from another node.
+   Returns 0 if the message was not a federation message and 1 otherwise. */
+static int handle_federation_message(int link_sockfd, char *link_message, size_t link_message_bytes);
+/* Opens a link to every node in the federation that is not currently linked with, adding them to the reactor.
+   Called by the server's federation timer. */
+static void open_federation_links(struct network_reactor *reactor, void *timer_data);
+
+/* Handles an identity message from a client, accepting the client if this node owns the identity and redirecting the client
+   to the owning node otherwise. Returns 0 if the message was not an identity message and 1 otherwise. */
+static int handle_client_identity(int client_sockfd, const char *client_message);
+/* Handles a session message from an identified client, resuming the session in the token it presents (if valid) by
+   subscribing the client to the patterns in it. Returns 0 if the message was not a session message and 1 otherwise. */
+static int handle_client_session(int client_sockfd, const char *client_message);
+/* Subscribes the given client to the given pattern, keeping it in the client's session. Returns the result of 'topic_trie_subscribe'. */
+static int add_client_subscription(int client_sockfd, const char *topic_pattern);
+/* Unsubscribes the given client from the given pattern, removing it from the client's session. Returns the result of 'topic_trie_unsubscribe'. */
+static int remove_client_subscription(int client_sockfd, const char *topic_pattern);
+/* Sends the given client a new session token holding its identity and subscriptions. */
+static void send_client_session_token(int client_sockfd);
+/* Reads the session key from the given file, creating the file with a random key if it does not exist.
+   Returns 0 on success and -1 on failure. */
+static int load_session_key(const char *key_path);
+
+/* Returns the index of the federation node the client with the given identity is placed on. This is the node owning the
+   identity, unless that node is not linked with, in which case the client is kept on this node until it is. */
+static size_t find_identity_owner(const char *client_identity);
+/* Sends every client whose identity is now owned by another node a redirect to that node, such as after a node joined. */
+static void rebalance_federation_clients(void);
+/* Sends a redirect message to the given client with the address of the node to connect to instead. */
+static void send_client_redirect(int client_sockfd, const char *node_address);
+
+/* Loads the snapshot of the saved state left by a previous run of the server, if any, to give clients their subscriptions back. */
+static void load_server_snapshot(void);
+/* Takes a snapshot of the saved state if it changed, by forking a process writing a copy of it (shared with the server until
+   either changes it) so that the server does not wait for it to be written. Also checks on the snapshot being taken, if any.
+   Called by the server's snapshot timer. */
+static void take_server_snapshot(struct network_reactor *reactor, void *timer_data);
+/* Adds the subscriptions of every identified client and those loaded from the previous snapshot not given back yet to the given
+   snapshot being written. */
+static void add_server_snapshot_records(struct snapshot_writer *writer);
+/* Adds a subscription of an identified client to the snapshot being written, being called for every subscription of the server. */
+static void add_snapshot_subscription(const char *topic_pattern, int subscriber_sockfd, void *snapshot_writer);
+/* Marks the saved state (the subscriptions of identified clients) as changed by the given client, for a snapshot to be taken of it.
+   Nothing is marked for clients that are not identified, as their subscriptions are not saved. */
+static void mark_server_snapshot_outdated(int client_sockfd);
+/* Subscribes the given client to the patterns saved with its identity in the loaded snapshot, if any.
+   Returns the number of subscriptions given back. */
+static int restore_client_subscriptions(int client_sockfd, const char *client_identity);
+
+/* Returns the data of the given client socket, expanding the client data list to fit it if needed.
+   Returns NULL if an error occurs whilst expanding the list. */
+static struct server_client_data *get_client_data(int client_sockfd);
+
+/* Queues a copy of the given message to be sent to a client (or link) in the given lane, sending it straight away if nothing
+   else is waiting to be sent. Returns 0 on success and -1 on failure. */
+static int queue_client_message(int client_sockfd, enum outbound_lane message_lane, const char *message, size_t message_bytes);
+/* Queues the given shared payload to be sent to a client in the given lane, without copying it, in the same way as 'queue_client_message'. */
+static int queue_client_payload(int client_sockfd, enum outbound_lane message_lane, struct outbound_payload *payload);
+/* Queues the given shared payload in the same way as 'queue_client_payload', but only to be sent from the given release time
+   (or straight away if it is 0), as given by 'find_broadcast_release_time'. */
+static int queue_client_paced_payload(
+	int client_sockfd,
+	enum outbound_lane message_lane,
+	struct outbound_payload *payload,
+	uint64_t release_time_nanoseconds
+);
+/* Returns the release time of a message sent to many clients at once for the recipient with the given index, spreading the recipients
+   evenly over the pacing period from the given time the message was sent. Returns 0 (no release time) if pacing is disabled or there
+   are too few recipients for it. */
+static uint64_t find_broadcast_release_time(uint64_t broadcast_time_nanoseconds, size_t recipient_index, size_t recipients_count);
+/* Sends as many messages waiting to be sent to the given client as possible without blocking, discarding them if the connection failed. */
+static void flush_client_messages(int client_sockfd);
+/* Listens for writes on every client with messages ready to be sent and stops listening on the others.
+   Links to other nodes that are still connecting are always listened to for writes. Clients sending a file are only
+   listened to for reads whilst its relay has space, and clients recieving one are listened to for writes whilst it has data.
+   Returns the earliest release time of any messages that are not ready yet, or 0 if there are none. */
+static uint64_t update_poll_write_events(void);
+/* Sends the given message to every node linked with, preceded by the given control character.
+   Returns the number of nodes the message was forwarded to. */
+static size_t forward_federation_message(char message_control_character, const char *forwarded_message, size_t forwarded_message_bytes);
+
+/* Finishes connecting the given link to another node, removing it from the reactor if the connection failed. */
+static void complete_federation_link(struct pollfd *link_poll_sockfd);
+
+/* Marks whether the given client has messages waiting to be handled in the next round, which is then started without waiting for new events. */
+static void set_client_read_backlogged(int client_sockfd, int is_read_backlogged);
+/* Adds the given client socket to the reactor with the given events, with the 'pulse' counter at its maximum.
+   Returns 0 on success and -1 if the reactor could not be expanded to fit it. */
+static int add_client_socket(int new_client_sockfd, short listened_events);
+/* Returns non-zero if the poll request at the given index of the reactor is that of a client or link, rather than
+   the server socket or a socket added by an embedding program. */
+static int is_client_poll_request(size_t poll_index);
+/* Removes the given client (or link) from the reactor, ending anything it was part of, and closes its socket. */
+static void remove_client(int client_sockfd);
+/* Sends the kick notice (and an empty session token) to the given client ahead of anything else waiting for it, and closes it
+   once they were sent, rather than throwing them away with its other messages. Returns non-zero if it was closed straight away. */
+static int kick_client(int client_sockfd);
+
+
+/* ---- Function definitions ---- */
+
+
+int configure_server(const struct server_options *options)
+{
+	/* Linked servers exchange messages of their own, which the echo and discard modes would not understand */
+	if (options->serving_mode != SERVER_FULL_MODE && options->federation_nodes_list != NULL) {
+		fprintf(stderr, "Servers only echoing or discarding messages cannot be linked with other servers.\n");
+		return -1;
+	}
+	if (options->serving_mode != SERVER_FULL_MODE && options->snapshot_path != NULL) {
+		fprintf(stderr, "Servers only echoing or discarding messages have no subscriptions to save.\n");
+		return -1;
+	}
+	if (options->serving_mode != SERVER_FULL_MODE && options->mailbox_directory_path != NULL) {
+		fprintf(stderr, "Servers only echoing or discarding messages have no direct messages to keep.\n");
+		return -1;
+	}
+
+	/* Parse the addresses of other servers to link with, if given */
+	federation_free(&server_federation_links);
+	if (federation_init(&server_federation_links, options->federation_nodes_list) == -1) {
+		fprintf(stderr, "Invalid nodes list given.\n");
+		return -1;
+	}
+
+	server_broadcast_pacing_nanoseconds = options->broadcast_pacing_nanoseconds;
+	server_serving_mode = options->serving_mode;
+	server_snapshot_path = options->snapshot_path;
+	server_mailbox_directory_path = options->mailbox_directory_path;
+
+	/* Servers sharing a key file resume each other's sessions, including after restarting */
+	if (options->session_key_path != NULL && load_session_key(options->session_key_path) == -1) {
+		fprintf(stderr, "Failed to read or create session key file '%s'.\n", options->session_key_path);
+		return -1;
+	}
+	return 0;
+}
+
+void set_server_event_handler(server_event_handler handler, void *handler_data)
+{
+	server_client_event_handler = handler;
+	server_client_event_handler_data = handler_data;
+}
+
+struct network_reactor *get_server_reactor(void)
+{
+	return &server_reactor;
+}
+
+int init_server(char *server_port)
+{
+	/* There isn't a way to recover from failing to listen on the given port, so exit the program instead */
+	const int server_sockfd = open_listening_socket(server_port);
+	if (server_sockfd == -1) exit(EXIT_FAILURE);
+
+	printf("(Main) Server started at port %s.\n", server_port);
+	return server_sockfd;
+}
+
+void begin_serving(int server_sockfd, long maximum_requests, long is_interactive)
+{
+	/* Check if the given server socket is valid */
+	if (fcntl(server_sockfd, F_GETFD) == -1) {
+		fprintf(stderr, "(Init) The given server socket is invalid. Make sure you have called 'init_server' first.\n");
+		return;
+	};
+
+	server_state = 1; /* Server is now active */
+
+	/* The reactor may already have been prepared by an embedding program adding sockets of its own to it */
+	if (server_reactor.poll_sockfds == NULL) {
+		check_error(network_reactor_init(&server_reactor), "(Main) Allocation failed for poll requests list", 1);
+	}
+	outbound_use_cached_time(&server_reactor.current_time_nanoseconds); /* Read the clock once per round */
+	check_error(network_reactor_add(
+		&server_reactor,
+		server_sockfd,
+		POLLIN, /* Listening for available reads (in this case, it means an incoming connection) */
+		handle_server_event,
+		&maximum_requests
+	), "(Main) Allocation failed for poll requests list", 1);
+
+	/* Other threads and signals change the server state, which the loop would otherwise only see once an event arrives */
+	server_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	check_error(server_wake_fd, "(Main) Failed to create wake event", 1);
+	check_error(network_reactor_add(
+		&server_reactor,
+		server_wake_fd,
+		POLLIN,
+		handle_wake_event,
+		NULL
+	), "(Main) Allocation failed for poll requests list", 1);
+
+	/* Without a key file, sessions can only be resumed until the server stops */
+	if (!server_is_session_key_set) {
+		const ssize_t random_bytes = getrandom(server_session_key, sizeof server_session_key, 0);
+		check_error(random_bytes == (ssize_t)sizeof server_session_key ? 0 : -1, "(Main) Failed to create session key", 1);
+		server_is_session_key_set = 1;
+	}
+
+	/* Create the (initially empty) topic subscriptions trie */
+	check_error(topic_trie_init(&server_topic_subscriptions), "(Main) Allocation failed for topic subscriptions", 1);
+
+	/* Subscriptions saved by a previous run are given back to their clients as they identify themselves again,
+	   with snapshots only being taken once anything changed */
+	if (server_mailbox_directory_path != NULL) {
+		const uint64_t load_start_time = network_reactor_time();
+		check_error(mailbox_store_open(&server_mailboxes, server_mailbox_directory_path), "(Main) Failed to open mailboxes", 1);
+		printf(
+			"(Mailbox) Loaded %d mailbox(es) in %.3f ms\n",
+			(int)server_mailboxes.mailboxes_count,
+			(double)(network_reactor_time() - load_start_time) / 1e6
+		);
+	}
+	if (server_snapshot_path != NULL) {
+		load_server_snapshot();
+		server_snapshot_timer_id = network_reactor_add_timer(&server_reactor, 0, take_server_snapshot, NULL);
+		check_error(server_snapshot_timer_id, "(Main) Allocation failed for snapshot timer", 1);
+	}
+
+	/*
+	   Timers for the 'pulse' check and for opening links to other nodes that are not linked with (such as after the other
+	   node restarted). Paced messages are not waited for by polling, so a further timer wakes the server up in time to
+	   send the next one, being set before every round. Nothing else wakes the server up, so an idle server sleeps until
+	   a connection or signal arrives: the first two timers stop themselves once there is nothing left for them to do.
+	*/
+	if (server_serving_mode == SERVER_FULL_MODE) {
+		server_pulse_timer_id = network_reactor_add_timer(
+			&server_reactor,
+			SERVER_PULSE_CHECK_INTERVAL_NANOSECONDS,
+			check_clients_pulse,
+			NULL
+		);
+		check_error(server_pulse_timer_id, "(Main) Allocation failed for pulse timer", 1);
+	}
+	if (server_federation_links.nodes_count > 1) {
+		server_federation_timer_id = network_reactor_add_timer(
+			&server_reactor,
+			SERVER_FEDERATION_LINK_INTERVAL_NANOSECONDS,
+			open_federation_links,
+			NULL
+		);
+		check_error(server_federation_timer_id, "(Main) Allocation failed for federation timer", 1);
+	}
+	const int release_timer_id = network_reactor_add_timer(&server_reactor, 0, NULL, NULL);
+	check_error(release_timer_id, "(Main) Allocation failed for release timer", 1);
+
+	/* Start linking with other nodes straight away */
+	open_federation_links(&server_reactor, NULL);
+
+	struct server_interact_data interactive_mode_data;
+
+	/* Initiate interactive mode if specified on a seperate thread. */
+	if (is_interactive) {
+		interactive_mode_data.server_sockfd = server_sockfd;
+		pthread_t interactive_mode_thread;
+		pthread_create(&interactive_mode_thread, NULL, begin_interaction, &interactive_mode_data);
+	}
+
+	do {
+		/* Wait for any specified events on all sockets, including writes for clients with queued messages, and handle them.
+		   Clients with messages left over from the previous round are handled straight away, so only check for events then. */
+		if (server_stalled_streams_count != 0) resume_stalled_streams();
+		network_reactor_set_timer(&server_reactor, release_timer_id, update_poll_write_events());
+		if (network_reactor_run_once(&server_reactor, -1) == -1 && errno != EINTR) {
+			check_error(-1, "(Main) Error encountered whilst polling", 0);
+		}
+
+		/* Handle interaction result inputted by user in interactive mode, then let the interactive thread take more input.
+		   A stop asked for in the meantime is applied now, including one that arrives whilst the state is being reset. */
+		if (server_state == 2) {
+			const int interaction_result = handle_interaction_result(&interactive_mode_data);
+			pthread_mutex_lock(&server_state_mutex);
+			server_state = interaction_result == -1 ? 0 : 1;
+			if (server_is_stop_pending) server_state = 0;
+			pthread_cond_signal(&server_state_condition);
+			pthread_mutex_unlock(&server_state_mutex);
+		}
+	} while (server_state);
+
+	printf("\n(Main) Closing server...\n");
+
+	/* Save the state once more before the clients are disconnected, so that they get it back when the server is started again */
+	if (server_snapshot_timer_id != -1) {
+		if (server_snapshot_pid != -1) waitpid(server_snapshot_pid, NULL, 0);
+		check_error(snapshot_write_file(server_snapshot_path, add_server_snapshot_records), "(Snapshot) Failed to write snapshot", 0);
+		snapshot_free(&server_restored_snapshot);
+		server_snapshot_pid = server_snapshot_timer_id = -1;
+	}
+
+	/* Close all sockets of the server and free allocated memory, leaving any sockets added by an embedding program open */
+	for (size_t i = 0; i < server_reactor.poll_sockfds_count; ++i) {
+		if (is_client_poll_request(i) || server_reactor.poll_sockfds[i].fd == server_sockfd) close(server_reactor.poll_sockfds[i].fd);
+	}
+	network_reactor_free(&server_reactor);
+	close(server_wake_fd);
+	server_wake_fd = server_pulse_timer_id = server_federation_timer_id = -1;
+	outbound_use_cached_time(NULL);
+	topic_trie_free(&server_topic_subscriptions);
+	federation_free(&server_federation_links);
+	placement_ring_free(&server_placement_ring);
+	if (server_mailbox_directory_path != NULL) mailbox_store_close(&server_mailboxes);
+
+	for (size_t i = 0; i < server_clients_data_count; ++i) {
+		free(server_clients_data[i].client_identity);
+		free(server_clients_data[i].session_patterns);
+		free(server_clients_data[i].client_message_reader.reader_buffer);
+		free(server_clients_data[i].stream_recipient_sockfds);
+		if (server_clients_data[i].outgoing_relay != NULL) relay_close(server_clients_data[i].outgoing_relay);
+		free(server_clients_data[i].outgoing_relay); /* Also the incoming relay of its recipient */
+		outbound_queue_clear(&server_clients_data[i].client_outbound_queue);
+	}
+	free(server_clients_data);
+}
+
+
+void *begin_interaction(void *v_interact_data)
+{
+	struct server_interact_data *interact_data = (struct server_interact_data*)v_interact_data;
+
+	/* The message is moved past the target of each input, so every input is read from the start of the buffer */
+	const size_t interact_message_size = 0xFFFF;
+	char *interact_message_buffer = calloc(sizeof(char), interact_message_size);
+	if (check_error_null(
+		interact_message_buffer,
+		"(Interactive) Failed to allocate message buffer", 0
+	) == -1) return NULL;
+
+	const char all_interact_message[] = "all";
+	const char kick_interact_message[] = "kick";
+	const char exit_interact_message[] = "exit";
+	const char stopint_interact_message[] = "stopint";
+
+	printf("(Interactive) Format: \"<id> <message>\"\n");
+	printf("(Interactive) 'ID' can be 'all' to specify all connected clients, 'Message' can be 'kick' to disconnect the target client(s).\n");
+	printf("(Interactive) 'stopint' exits interactive mode and 'exit' stops the server.\n");
+
+	do {
+		/* Attempt to get input from stdin */
+		interact_data->interact_message = interact_message_buffer;
+		size_t input_message_length = get_stdin_input(interact_data->interact_message, interact_message_size);
+		if (input_message_length == 0 && feof(stdin)) {
+			printf("(Interactive) Input has ended, so the server will no longer accept input.\n");
+			break;
+		}
+		if (check_error((int)(input_message_length - 1), "(Interactive) Failed to get input message", 0) == -1) continue;
+
+		/* Determine 'target' of input */
+		size_t input_space_index = 0;
+		while (interact_data->interact_message[input_space_index] > ' ') ++input_space_index;
+		if (input_space_index == 0) goto warn_invalid_input;
+
+		/* Check for 'all' target, otherwise get the client ID by converting to a number. */
+		interact_data->interact_target = -1; /* Will remain -1 if an invalid target is specified */
+		if (strstr(
+			interact_data->interact_message,
+			all_interact_message
+		) != NULL) interact_data->interact_target = 0;
+		else {
+			const long input_target_client = strtol(interact_data->interact_message, NULL, 10);
+			if (input_target_client != 0) interact_data->interact_target = (int)input_target_client;
+		}
+
+		/* Check for server exit message */
+		if (strstr(
+			interact_data->interact_message,
+			exit_interact_message
+		) != NULL) {
+			server_state = 0; /* Server has ended */
+			wake_server();
+			break;
+		}
+		/* Check for interactive mode exit message */
+		else if (strstr(
+			interact_data->interact_message,
+			stopint_interact_message
+		) != NULL) {
+			printf("(Interactive) The server will no longer accept input.\n");
+			break;
+		}
+		/* Could not determine target AND string was not a specific command */
+		else if (interact_data->interact_target == -1) goto warn_invalid_input;
+
+		/* Determine if input is a kick command or a message to send to the client(s) */
+		interact_data->interact_message += input_space_index + 1;
+		if (strcasecmp(
+			interact_data->interact_message,
+			kick_interact_message
+		) == 0) *interact_data->interact_message = '\0';
+		else interact_data->interact_message_bytes = strlen(interact_data->interact_message) + 1;
+
+		/* Set server as ready to execute given input, and wait for execution to finish */
+		pthread_mutex_lock(&server_state_mutex);
+		server_state = 2;
+		wake_server();
+		while (server_state == 2) pthread_cond_wait(&server_state_condition, &server_state_mutex);
+		pthread_mutex_unlock(&server_state_mutex);
+		continue;
+	warn_invalid_input:
+		printf("(Interactive) Invalid input.\n");
+		continue;
+	} while (server_state);
+
+	/* Free memory allocated by message string */
+	free(interact_message_buffer);
+	return NULL;
+}
+
+int handle_interaction_result(struct server_interact_data *interact_data)
+{
+	const int is_single_client = interact_data->interact_target != 0;
+	const int is_kick_command = *interact_data->interact_message == '\0';
+
+	int affected_clients_count = 0;
+
+	/* A message to all clients is only stored once, being shared by the queues of every client */
+	struct outbound_payload *interact_payload = NULL;
+	if (!is_kick_command && (interact_payload = outbound_payload_copy(
+		interact_data->interact_message,
+		interact_data->interact_message_bytes
+	)) == NULL) {
+		printf("(Interactive) Failed to allocate message.\n");
+		return 0;
+	}
+
+	/* Messages to all clients are paced if there are enough clients, which only leaves links to other nodes uncounted */
+	const uint64_t interact_time_nanoseconds = outbound_current_time();
+	const size_t interact_recipients_count = is_single_client ? 1 : server_connections_count;
+
+	/* Indices are used as the poll requests list can be moved when a client is kicked */
+	for (size_t current_poll_index = 0;
+	     current_poll_index < server_reactor.poll_sockfds_count;
+	     ++current_poll_index
+	) {
+		if (server_state == 0) {
+			/* Server has ended, stop execution */
+			if (interact_payload != NULL) outbound_payload_release(interact_payload);
+			return -1;
+		}
+		if (!is_client_poll_request(current_poll_index)) continue; /* Avoid the server's own poll request */
+		struct pollfd *current_poll_sockfd = server_reactor.poll_sockfds + current_poll_index;
+
+		/* Only operate on a specific clients if specified (target of 0 means all) */
+		if (interact_data->interact_target != 0 &&
+		    interact_data->interact_target != current_poll_sockfd->fd
+		) continue;
+		/* Links to other nodes are not clients */
+		if (federation_is_link(&server_federation_links, current_poll_sockfd->fd)) continue;
+
+		/* A kick command is specifed with a NULL message */
+		if (is_kick_command) {
+			const int original_sockfd = current_poll_sockfd->fd;
+
+			/* Clients already kicked are only waiting for their notice to be sent */
+			if ((size_t)original_sockfd < server_clients_data_count && server_clients_data[original_sockfd].is_kicked) continue;
+
+			/* Current index now points to a different client due to removal, avoiding skipping */
+			if (kick_client(original_sockfd)) --current_poll_index;
+			++affected_clients_count;
+
+			if (is_single_client) {
+				printf("(Interactive) Kicked client %d.\n", original_sockfd);
+				return 0;
+			}
+		}
+		/* Send message to target client(s) */
+		else if (check_error(queue_client_paced_payload(
+			current_poll_sockfd->fd,
+			OUTBOUND_BULK_LANE,
+			interact_payload,
+			find_broadcast_release_time(interact_time_nanoseconds, (size_t)affected_clients_count, interact_recipients_count)
+		), "(Interactive) Failed to send message to target client", 0) != -1) {
+			++affected_clients_count;
+			if (is_single_client) {
+				printf("(Interactive) Sent message to client %d.\n", current_poll_sockfd->fd);
+				break;
+			}
+		} else if (is_single_client) {
+			/* An error occurred whilst sending a message to a single client, return normally. */
+			outbound_payload_release(interact_payload);
+			return 0;
+		}
+	}
+
+	if (interact_payload != NULL) {
+		/* Messages to all clients also go to the clients of other nodes, which is only sent once to each node */
+		if (!is_single_client) {
+			const size_t forwarded_nodes_count = forward_federation_message(
+				FEDERATION_BROADCAST_MESSAGE,
+				interact_data->interact_message,
+				interact_data->interact_message_bytes
+			);
+			printf("(Interactive) Sent message to %d client(s) and %d other node(s).\n", affected_clients_count, (int)forwarded_nodes_count);
+		}
+		else if (affected_clients_count == 0) printf("(Interactive) Client %d does not exist.\n", interact_data->interact_target);
+
+		outbound_payload_release(interact_payload);
+		return 0;
+	}
+
+	/* In the case of a specific client, it returns on completion, so reaching here */
+	if (is_single_client) printf("(Interactive) Client %d does not exist.\n", interact_data->interact_target);
+	/* Result messages for operating on all clients */
+	else printf("(Interactive) Kicked %d client(s).\n", affected_clients_count);
+
+	return 0;
+}
+
+
+void check_clients_pulse(struct network_reactor *reactor, void *timer_data)
+{
+	/*
+	   This should be run occassionally to check for any 'dead' sockets where
+	   the client disconnected but no message reached the server. A message
+	   is sent to each client to warrant an eventual response from them.
+
+	   If a client takes too long to respond to any of the repeated 'pulse' messages,
+	   it can safely be assumed that the client has disconnected through unexpected
+	   means, so they are removed from the reactor.
+	*/
+	(void)timer_data; /* Avoid unused parameter warning */
+
+	/* Nothing to check, so stop until the next client connects rather than waking up for nothing */
+	if (server_connections_count == 0) {
+		network_reactor_set_timer(reactor, server_pulse_timer_id, 0);
+		return;
+	}
+	const uint64_t current_time_nanoseconds = network_reactor_now(reactor);
+
+	/* Indices are used as the poll requests list can be moved when a client is removed */
+	for (size_t current_poll_index = 0; current_poll_index < reactor->poll_sockfds_count; ++current_poll_index) {
+		/* Server could be stopped at any moment, so this needs to be checked every iteration. */
+		if (server_state == 0) return;
+		if (!is_client_poll_request(current_poll_index)) continue; /* Avoid the server's own poll request */
+		struct pollfd *current_poll_sockfd = reactor->poll_sockfds + current_poll_index;
+
+		/* If a read event is available for this client, ignore this pulse check
+		   as it could either mean a response or a disconnect event. */
+		if (current_poll_sockfd->revents & POLLIN) continue;
+
+		/* Clients whose stream is held back or who are sending a file are not read from, so their responses could not be seen,
+		   and clients recieving a file are not sent pulses until it ends. Kicked clients are still counted down. */
+		const size_t client_data_index = (size_t)current_poll_sockfd->fd;
+		if (client_data_index < server_clients_data_count &&
+		    !server_clients_data[client_data_index].is_kicked &&
+		    (server_clients_data[client_data_index].is_stream_stalled ||
+		     server_clients_data[client_data_index].outgoing_relay != NULL ||
+		     server_clients_data[client_data_index].incoming_relay != NULL)
+		) continue;
+
+		/* Session tokens are renewed once half their lifetime has passed, so that clients staying connected always hold a valid one */
+		if (client_data_index < server_clients_data_count &&
+		    server_clients_data[client_data_index].session_patterns != NULL &&
+		    current_time_nanoseconds >= server_clients_data[client_data_index].session_token_renewal_time
+		) send_client_session_token(current_poll_sockfd->fd);
+
+		/* 
+		   To track the client's pulse without having to store another array (since the 'pollfd'
+		   objects list must be seperate), we can make use of the 'error' bits "which are always
+		   implicitly polled for", and therefore have no effect in the 'events' field.
+		*/
+		int client_current_pulse = (current_poll_sockfd->events >> 3) & 3;
+
+		/*
+		   Subtract from the pulse counter, deleting the client if it has 'died' (pulse < 1).
+		   The index should not change next iteration as the same index now refers to a
+		   different client (the order of previous clients is not affected).
+		*/
+		if (--client_current_pulse <= 0) {
+			printf("(Main) Disconnecting client %d: Not responding to pulse checks\n", current_poll_sockfd->fd);
+			remove_client(current_poll_sockfd->fd);
+			--current_poll_index; /* Decrement to operate on new client at the same index due to removal */
+			continue; /* Client no longer exists, move on to new client at the same index */
+		}
+
+		/* Decrement client pulse by clearing the bits and storing the new value */
+		current_poll_sockfd->events &= ~(3 << 3);
+		current_poll_sockfd->events |= (short)(client_current_pulse << 3);
+
+		/* Links to other nodes are checked by those nodes, which send their own pulses through them instead.
+		   Kicked clients are not sent any, only being removed by the check above if their notice is never sent. */
+		if (federation_find_outbound_link(&server_federation_links, current_poll_sockfd->fd) != NULL ||
+		    (client_data_index < server_clients_data_count && server_clients_data[client_data_index].is_kicked)
+		) continue;
+
+		/* Attempt to send the 'pulse' message to the client, ahead of any chat messages waiting to be sent to it */
+		check_error(queue_client_message(
+			current_poll_sockfd->fd,
+			OUTBOUND_CONTROL_LANE,
+			&network_global_pulse_message,
+			network_global_pulse_bytes
+		), "(Main) Failed to send pulse to client", 0);
+	}
+}
+
+
+void handle_server_event(struct network_reactor *reactor, struct pollfd *server_poll_sockfd, void *maximum_requests)
+{
+	(void)reactor; /* Avoid unused parameter warning */
+
+	/* If the server socket is ready to read, a new connection is available.
+	   The new client socket is immediately closed if the server reached the client limit. */
+	if ((server_poll_sockfd->revents & POLLIN) == 0) return;
+	const long maximum_clients = *(const long*)maximum_requests;
+	accept_new_client(
+		server_poll_sockfd->fd,
+		(maximum_clients > 0) && (server_connections_count >= (size_t)maximum_clients)
+	);
+}
+
+void handle_client_event(struct network_reactor *reactor, struct pollfd *client_poll_sockfd, void *event_data)
+{
+	(void)reactor; /* Avoid unused parameter warnings */
+	(void)event_data;
+	if (server_state == 0) return; /* Check if server closed whilst handling clients */
+
+	/* Links to other nodes that are still connecting finish connecting once they become writable or fail */
+	const struct federation_node *linked_node = federation_find_outbound_link(&server_federation_links, client_poll_sockfd->fd);
+	if (linked_node != NULL && !linked_node->outbound_connected) {
+		if (client_poll_sockfd->revents & (POLLOUT | POLLERR | POLLHUP)) complete_federation_link(client_poll_sockfd);
+		return;
+	}
+
+	/* Continue sending queued messages once there is space for them, before any reads that could remove the client */
+	if (client_poll_sockfd->revents & POLLOUT) flush_client_messages(client_poll_sockfd->fd);
+
+	/* A kicked client is closed once its notice was sent (or it disconnected), without reading anything else from it */
+	const size_t client_data_index = (size_t)client_poll_sockfd->fd;
+	if (client_data_index < server_clients_data_count && server_clients_data[client_data_index].is_kicked) {
+		if ((client_poll_sockfd->revents & (POLLHUP | POLLERR)) ||
+		    outbound_queue_is_control_sent(&server_clients_data[client_data_index].client_outbound_queue)
+		) remove_client(client_poll_sockfd->fd);
+		return;
+	}
+
+	/* Check for valid events or messages left over from the previous round */
+	if ((client_poll_sockfd->revents & (POLLIN | POLLHUP)) ||
+	    (client_data_index < server_clients_data_count && server_clients_data[client_data_index].is_read_backlogged)
+	) handle_client_request(client_poll_sockfd);
+}
+
+
+void accept_new_client(int server_sockfd, int deny_connection)
+{
+	struct sockaddr_in client_address;
+	struct sockaddr *client_address_ptr = (struct sockaddr*)&client_address;
+	socklen_t sockaddr_in_bytes = sizeof client_address;
+
+	/* Accept a valid connection from a new client */
+	int new_client_sockfd;
+	if (check_error(new_client_sockfd = accept(
+		server_sockfd,
+		client_address_ptr,
+		&sockaddr_in_bytes
+	), "(Main) Connection accept failed", 0) == -1) return;
+
+	/* Check if the server wants to deny this request for any reason, usually due to client limit. */
+	if (deny_connection) {
+		close(new_client_sockfd);
+		printf("(Main) Failed to connect client: Reached client limit\n");
+		return;
+	}
+	
+	/*
+	   Limit how much unsent data the socket itself holds, so that messages to a slow client wait in its outbound queue
+	   instead, where their delay is measured and controlled. The socket would otherwise take in several megabytes,
+	   hiding seconds of delay from the queue. This is not required, so continue if it is unsupported.
+	*/
+	const int unsent_bytes_limit = 0x4000;
+	setsockopt(new_client_sockfd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &unsent_bytes_limit, (socklen_t)(sizeof unsent_bytes_limit));
+
+	/* Add the new client to the reactor, listening for reads */
+	if (add_client_socket(new_client_sockfd, POLLIN) == -1) {
+		/* Error occurred whilst expanding the reactor to fit a new request; cannot accommodate the new client */
+		close(new_client_sockfd);
+		printf("(Main) Failed to connect client: Data allocation error\n");
+		return;
+	}
+
+	/* Get the client's IP address string from the given address object for printing.
+	   Use fallback instead if conversion failed. 
+	*/
+	char client_ip_buffer[INET_ADDRSTRLEN];
+	if (check_error_null(inet_ntop(
+		client_address.sin_family,
+		&client_address.sin_addr,
+		client_ip_buffer,
+		(socklen_t)(sizeof client_ip_buffer)
+	), "Failed to convert client address", 0)) {
+		const char client_fallback_ip_buffer[] = "Unknown";
+		memcpy(client_ip_buffer, client_fallback_ip_buffer, sizeof client_fallback_ip_buffer);
+	};
+
+	printf("(Main) Connected with client '%s' (socket ID %d)\n", client_ip_buffer, new_client_sockfd);
+	if (server_client_event_handler != NULL) {
+		server_client_event_handler(SERVER_CLIENT_CONNECTED_EVENT, new_client_sockfd, NULL, 0, server_client_event_handler_data);
+	}
+}
+
+void handle_client_request(struct pollfd *client_sockfd)
+{
+	struct server_client_data *client_data = get_client_data(client_sockfd->fd);
+	if (check_error_null(client_data, "(Main) Failed to allocate client data", 0) == -1) return;
+
+	/* The raw bytes of a file being sent are moved straight into its relay rather than being read as messages */
+	if (client_data->outgoing_relay != NULL) {
+		client_sockfd->revents = 0;
+		const ssize_t relayed_bytes = fill_client_relay(client_sockfd->fd);
+		if (relayed_bytes == -1) goto delete_client_request;
+		if (relayed_bytes > 0) client_sockfd->events |= (3 << 3); /* Reset 'pulse' counter */
+		return;
+	}
+
+	/*
+	   Only read more data once every message recieved before has been handled. A client sending more than its share
+	   is then held back by its own socket, rather than its messages piling up in the server. Any available data is
+	   read at once without waiting for a terminator, as the rest of a message is simply read in a later round.
+	*/
+	if (!client_data->is_read_backlogged && !client_data->is_stream_stalled && (client_sockfd->revents & (POLLIN | POLLHUP))) {
+		const ssize_t total_bytes_recieved = read_network_messages(&client_data->client_message_reader, client_sockfd->fd, MSG_DONTWAIT);
+		if (total_bytes_recieved == 0) goto delete_client_request; /* Disconnected */
+		if (total_bytes_recieved == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+			check_error(-1, "(Main) Failed to recieve client data", 0);
+			goto delete_client_request;
+		}
+
+		/* Reset 'pulse' counter of client as the client is still connected, stored as 2 bits in the 'events' field
+		(specifically where error bits are set) for reasons explained in the 'pulse check' function. */
+		if (total_bytes_recieved > 0) client_sockfd->events |= (3 << 3);
+	}
+	client_sockfd->revents = 0; /* Reset 'recieved' event bitmask */
+
+	if (server_serving_mode != SERVER_FULL_MODE) {
+		handle_client_benchmark_messages(client_sockfd->fd, client_data);
+		return;
+	}
+
+	/*
+	   Deficit round-robin: each round, the client is given another quantum of bytes to spend on handling its messages.
+	   A message is only handled if the client has enough left for it, otherwise it waits for the next round with the
+	   unused amount carried over, so clients sending more or larger messages cannot take more than their share.
+	*/
+	client_data->read_deficit_bytes += SERVER_READ_QUANTUM_BYTES;
+
+	char *client_message;
+	size_t client_message_bytes;
+	int is_stream_stalled = 0;
+	while ((client_message = find_network_message(&client_data->client_message_reader, &client_message_bytes)) != NULL) {
+		if (client_message_bytes > client_data->read_deficit_bytes) break;
+
+		/* Chunks are never dropped, so the rest of a stream waits (along with the client) until its recipients catch up */
+		if (client_data->stream_recipients_count != 0 && is_stream_chunk(client_message) && is_client_stream_stalled(client_data)) {
+			is_stream_stalled = 1;
+			break;
+		}
+		client_data->read_deficit_bytes -= client_message_bytes;
+		client_data->client_message_reader.buffer_start += client_message_bytes;
+		if (!federation_is_inbound_link(&server_federation_links, client_sockfd->fd) &&
+		    filter_client_control_characters(client_message, client_message_bytes) == -1
+		) continue;
+
+		if (*client_message == network_global_pulse_message) {
+			/* Pulses through a link to another node are checks from that node rather than responses, so reply to them */
+			if (federation_find_outbound_link(&server_federation_links, client_sockfd->fd) != NULL) {
+				check_error(queue_client_message(
+					client_sockfd->fd,
+					OUTBOUND_CONTROL_LANE,
+					&network_global_pulse_null_response,
+					network_global_pulse_bytes
+				), "(Federation) Failed to reply to pulse from node", 0);
+			}
+		}
+		else if (handle_client_stream_chunk(client_sockfd->fd, client_message) == 0 &&
+		handle_client_transfer(client_sockfd->fd, client_message) == 0 &&
+		handle_federation_message(client_sockfd->fd, client_message, client_message_bytes) == 0 &&
+		handle_client_identity(client_sockfd->fd, client_message) == 0 &&
+		handle_client_session(client_sockfd->fd, client_message) == 0 &&
+		handle_client_topic_command(client_sockfd->fd, client_message) == 0 &&
+		handle_client_state_command(client_sockfd->fd, client_message) == 0 &&
+		handle_client_direct_message(client_sockfd->fd, client_message) == 0) {
+			/* Chat messages go to the event handler instead of being printed, if one is set */
+			if (server_client_event_handler == NULL) printf("(Client %d message) %s\n", client_sockfd->fd, client_message);
+			else server_client_event_handler(
+				SERVER_CLIENT_MESSAGE_EVENT,
+				client_sockfd->fd,
+				client_message,
+				client_message_bytes,
+				server_client_event_handler_data
+			);
+		}
+
+		/* Sending to other clients can expand (and move) the client data list, so get this client's data again */
+		client_data = server_clients_data + client_sockfd->fd;
+
+		/* Everything recieved after a transfer message is part of the file until the relay has taken all of it */
+		if (client_data->outgoing_relay != NULL) {
+			client_message = NULL;
+			break;
+		}
+	}
+
+	/* A held back client is not read from at all until its stream continues, which is then handled as a backlog */
+	if (is_stream_stalled != client_data->is_stream_stalled) {
+		if (is_stream_stalled) {
+			++server_stalled_streams_count;
+			client_sockfd->events &= ~POLLIN;
+		} else {
+			--server_stalled_streams_count;
+			client_sockfd->events |= POLLIN;
+		}
+		client_data->is_stream_stalled = is_stream_stalled;
+	}
+
+	/* Changes to the client's session are only sent once per round, however many subscriptions it changed */
+	if (client_data->is_session_token_outdated) send_client_session_token(client_sockfd->fd);
+
+	/* A client with nothing left to handle does not keep its unused share, as is done in deficit round-robin */
+	const int is_read_backlogged = client_message != NULL && !is_stream_stalled;
+	if (!is_read_backlogged) client_data->read_deficit_bytes = 0;
+	set_client_read_backlogged(client_sockfd->fd, is_read_backlogged);
+	return; /* Don't remove client, only return from function */
+
+delete_client_request:
+	/* Remove client from the reactor */
+	printf("(Main) Disconnected client %d: External disconnection\n", client_sockfd->fd);
+	remove_client(client_sockfd->fd);
+}
+
+void handle_client_benchmark_messages(int client_sockfd, struct server_client_data *client_data)
+{
+	/* Messages are handled all at once rather than in shares, as handling each one costs next to nothing */
+	struct network_message_reader *client_message_reader = &client_data->client_message_reader;
+	const char *first_message = client_message_reader->reader_buffer + client_message_reader->buffer_start;
+	size_t client_message_bytes;
+	while (find_network_message(client_message_reader, &client_message_bytes) != NULL) {
+		client_message_reader->buffer_start += client_message_bytes;
+	}
+
+	/* The messages follow each other in the reader's buffer, so they are all echoed together as a single message.
+	   Echoes are streamed back, as they cannot be dropped without the sender losing count of its messages. */
+	const size_t handled_bytes = (size_t)(client_message_reader->reader_buffer + client_message_reader->buffer_start - first_message);
+	if (server_serving_mode == SERVER_ECHO_MODE && handled_bytes != 0) {
+		check_error(
+			queue_client_message(client_sockfd, OUTBOUND_STREAM_LANE, first_message, handled_bytes),
+			"(Main) Failed to echo client messages", 0
+		);
+	}
+}
+
+
+int filter_client_control_characters(char *client_message, size_t client_message_bytes)
+{
+	const char leading_character = *client_message;
+	if ((unsigned char)leading_character < ' ' &&
+	    leading_character != network_global_pulse_message &&
+	    leading_character != network_global_identity_message &&
+	    leading_character != network_global_session_message &&
+	    leading_character != network_global_transfer_message &&
+	    leading_character != FEDERATION_HELLO_MESSAGE &&
+	    !is_stream_chunk(client_message)
+	) return -1;
+
+	/* The last byte is the message's terminator, and a pulse has nothing after its control character */
+	for (size_t i = 1; i + 1 < client_message_bytes; ++i) {
+		if ((unsigned char)client_message[i] < ' ' && client_message[i] != '\t') client_message[i] = ' ';
+	}
+	return 0;
+}
+
+int handle_client_topic_command(int client_sockfd, char *client_message)
+{
+	const char subscribe_command[] = "/sub ";
+	const char unsubscribe_command[] = "/unsub ";
+	const char publish_command[] = "/pub ";
+
+	char command_reply[TOPIC_MAXIMUM_LENGTH + 64];
+	int command_result;
+
+	/* Subscribe or unsubscribe from the pattern given after the command */
+	if (strncmp(client_message, subscribe_command, sizeof subscribe_command - 1) == 0) {
+		const char *topic_pattern = client_message + sizeof subscribe_command - 1;
+		command_result = add_client_subscription(client_sockfd, topic_pattern);
+		if (command_result == -1) snprintf(command_reply, sizeof command_reply, "Invalid topic pattern.");
+		else snprintf(command_reply, sizeof command_reply, "%s '%s'.", command_result ? "Subscribed to" : "Already subscribed to", topic_pattern);
+	}
+	else if (strncmp(client_message, unsubscribe_command, sizeof unsubscribe_command - 1) == 0) {
+		const char *topic_pattern = client_message + sizeof unsubscribe_command - 1;
+		command_result = remove_client_subscription(client_sockfd, topic_pattern);
+		if (command_result == -1) snprintf(command_reply, sizeof command_reply, "Invalid topic pattern.");
+		else snprintf(command_reply, sizeof command_reply, "%s '%s'.", command_result ? "Unsubscribed from" : "Not subscribed to", topic_pattern);
+	}
+	else if (strncmp(client_message, publish_command, sizeof publish_command - 1) == 0) {
+		/* Split the topic name from the message that follows it */
+		char *topic_name_start = client_message + sizeof publish_command - 1;
+		const char *topic_name_end = strchr(topic_name_start, ' ');
+		const size_t topic_name_length = topic_name_end != NULL ? (size_t)(topic_name_end - topic_name_start) : 0;
+		if (topic_name_length == 0 || topic_name_length > TOPIC_MAXIMUM_LENGTH || topic_name_end[1] == '\0') {
+			snprintf(command_reply, sizeof command_reply, "Usage: /pub <topic> <message>");
+			goto send_command_reply;
+		}
+
+		char topic_name[TOPIC_MAXIMUM_LENGTH + 1];
+		memcpy(topic_name, topic_name_start, topic_name_length);
+		topic_name[topic_name_length] = '\0';
+
+		/*
+		   Subscribers recieve '[<topic>] <message>', which is made in place by moving the topic name back
+		   over the '/pub' prefix to fit the brackets. The space after the topic name is left untouched.
+		*/
+		char *published_message = topic_name_start - 2;
+		*published_message = '[';
+		memmove(published_message + 1, topic_name_start, topic_name_length);
+		published_message[topic_name_length + 1] = ']';
+
+		command_result = publish_topic_message(topic_name, published_message, strlen(published_message) + 1);
+		if (command_result == -1) {
+			snprintf(command_reply, sizeof command_reply, "Invalid topic name.");
+			goto send_command_reply;
+		}
+
+		/* Other nodes send the message to their own subscribers */
+		const size_t forwarded_nodes_count = forward_federation_message(
+			FEDERATION_PUBLISH_MESSAGE,
+			published_message,
+			strlen(published_message) + 1
+		);
+
+		printf("(Client %d) Published to '%s' (%d subscriber(s))\n", client_sockfd, topic_name, command_result);
+		snprintf(
+			command_reply,
+			sizeof command_reply,
+			"Published to %d subscriber(s) and %d other node(s).",
+			command_result,
+			(int)forwarded_nodes_count
+		);
+	}
+	else return 0; /* Not a topic command */
+
+send_command_reply:
+	check_error(queue_client_message(
+		client_sockfd,
+		OUTBOUND_CONTROL_LANE,
+		command_reply,
+		strlen(command_reply) + 1
+	), "(Main) Failed to send command reply to client", 0);
+	return 1;
+}
+
+int publish_topic_message(const char *topic_name, const char *topic_message, size_t topic_message_bytes)
+{
+	const int *subscriber_sockfds;
+	size_t subscribers_count;
+	if (topic_trie_match(&server_topic_subscriptions, topic_name, &subscriber_sockfds, &subscribers_count) == -1) return -1;
+	if (subscribers_count == 0) return 0;
+
+	/* Every subscriber shares the same copy of the message */
+	struct outbound_payload *topic_payload = outbound_payload_copy(topic_message, topic_message_bytes);
+	if (check_error_null(topic_payload, "(Main) Failed to allocate topic message", 0) == -1) return 0;
+
+	const uint64_t publish_time_nanoseconds = outbound_current_time();
+	for (size_t i = 0; i < subscribers_count; ++i) {
+		check_error(queue_client_paced_payload(
+			subscriber_sockfds[i],
+			OUTBOUND_BULK_LANE,
+			topic_payload,
+			find_broadcast_release_time(publish_time_nanoseconds, i, subscribers_count)
+		), "(Main) Failed to send topic message to subscriber", 0);
+	}
+
+	outbound_payload_release(topic_payload);
+
+	return (int)subscribers_count;
+}
+
+int handle_client_state_command(int client_sockfd, const char *client_message)
+{
+	const char state_command[] = "/state ";
+	if (strncmp(client_message, state_command, sizeof state_command - 1) != 0) return 0;
+
+	/* Split the key from the value that follows it */
+	const char *state_key = client_message + sizeof state_command - 1;
+	const char *state_key_end = strchr(state_key, ' ');
+	const size_t state_key_length = state_key_end != NULL ? (size_t)(state_key_end - state_key) : 0;
+	if (state_key_length == 0 || state_key_length > TOPIC_MAXIMUM_LENGTH) {
+		const char usage_reply[] = "Usage: /state <key> <value>";
+		check_error(
+			queue_client_message(client_sockfd, OUTBOUND_CONTROL_LANE, usage_reply, sizeof usage_reply),
+			"(Main) Failed to send command reply to client", 0
+		);
+		return 1;
+	}
+
+	/* Each client has its own value for each key, so a newer value only replaces an older one from the same client */
+	char conflation_key[TOPIC_MAXIMUM_LENGTH + 16];
+	snprintf(conflation_key, sizeof conflation_key, "%d:%.*s", client_sockfd, (int)state_key_length, state_key);
+
+	char state_message[NETWORK_MAXIMUM_MESSAGE_BYTES];
+	const int state_message_length = snprintf(
+		state_message,
+		sizeof state_message,
+		"(State) Client %d %.*s: %s",
+		client_sockfd,
+		(int)state_key_length,
+		state_key,
+		state_key_end + 1
+	);
+	if (state_message_length < 0) return 1;
+	const size_t state_message_bytes = (size_t)state_message_length < sizeof state_message ? (size_t)state_message_length + 1 : sizeof state_message;
+
+	struct outbound_payload *state_payload = outbound_payload_copy_conflatable(state_message, state_message_bytes, conflation_key);
+	if (check_error_null(state_payload, "(Main) Failed to allocate state message", 0) == -1) return 1;
+
+	/* Send the new value to every other client, skipping the server and any links */
+	for (size_t i = 0; i < server_reactor.poll_sockfds_count; ++i) {
+		const int recipient_sockfd = server_reactor.poll_sockfds[i].fd;
+		if (!is_client_poll_request(i) || recipient_sockfd == client_sockfd || federation_is_link(&server_federation_links, recipient_sockfd)) continue;
+		check_error(
+			queue_client_payload(recipient_sockfd, OUTBOUND_BULK_LANE, state_payload),
+			"(Main) Failed to send state message to client", 0
+		);
+	}
+
+	outbound_payload_release(state_payload);
+	return 1;
+}
+
+int handle_client_direct_message(int client_sockfd, const char *client_message)
+{
+	const char direct_message_command[] = "/dm ";
+	if (strncmp(client_message, direct_message_command, sizeof direct_message_command - 1) != 0) return 0;
+
+	/* Split the identity from the message that follows it */
+	const char *recipient_identity = client_message + sizeof direct_message_command - 1;
+	const char *recipient_identity_end = strchr(recipient_identity, ' ');
+	const size_t recipient_identity_length = recipient_identity_end != NULL ? (size_t)(recipient_identity_end - recipient_identity) : 0;
+	char command_reply[NETWORK_IDENTITY_MAXIMUM_LENGTH + 64];
+	if (recipient_identity_length == 0 || recipient_identity_length > NETWORK_IDENTITY_MAXIMUM_LENGTH || recipient_identity_end[1] == '\0') {
+		snprintf(command_reply, sizeof command_reply, "Usage: /dm <identity> <message>");
+		goto send_command_reply;
+	}
+	char recipient_identity_copy[NETWORK_IDENTITY_MAXIMUM_LENGTH + 1];
+	memcpy(recipient_identity_copy, recipient_identity, recipient_identity_length);
+	recipient_identity_copy[recipient_identity_length] = '\0';
+
+	/* Clients are only found on the node owning their identity, which is also the only node keeping their mailbox */
+	const size_t owner_node_index = find_identity_owner(recipient_identity_copy);
+	if (owner_node_index != 0 && owner_node_index != PLACEMENT_NO_OWNER) {
+		snprintf(command_reply, sizeof command_reply, "'%s' is placed on another server.", recipient_identity_copy);
+		goto send_command_reply;
+	}
+
+	/* The message is stored as it is shown to its recipient, so that delivering it later is only a copy */
+	const char *sender_identity = server_clients_data[client_sockfd].client_identity;
+	char direct_message[NETWORK_MAXIMUM_MESSAGE_BYTES];
+	const int direct_message_length = sender_identity != NULL ?
+		snprintf(direct_message, sizeof direct_message, "(Direct) %.*s: %s", NETWORK_IDENTITY_MAXIMUM_LENGTH, sender_identity, recipient_identity_end + 1) :
+		snprintf(direct_message, sizeof direct_message, "(Direct) Client %d: %s", client_sockfd, recipient_identity_end + 1);
+	if (direct_message_length < 0) return 1;
+	const size_t direct_message_bytes = (size_t)direct_message_length < sizeof direct_message ? (size_t)direct_message_length + 1 : sizeof direct_message;
+
+	/* Direct messages use the stream lane whether sent now or from a mailbox, as neither is ever dropped */
+	const int recipient_sockfd = find_identity_client(recipient_identity_copy);
+	if (recipient_sockfd != -1) {
+		check_error(
+			queue_client_message(recipient_sockfd, OUTBOUND_STREAM_LANE, direct_message, direct_message_bytes),
+			"(Main) Failed to send direct message to client", 0
+		);
+		snprintf(command_reply, sizeof command_reply, "Sent to '%s'.", recipient_identity_copy);
+	}
+	else if (server_mailbox_directory_path == NULL) {
+		snprintf(command_reply, sizeof command_reply, "'%s' is not connected.", recipient_identity_copy);
+	}
+	else if (check_error(
+		mailbox_store_append(&server_mailboxes, recipient_identity_copy, direct_message, direct_message_bytes, (uint32_t)time(NULL)),
+		"(Mailbox) Failed to store direct message", 0
+	) == -1) {
+		snprintf(command_reply, sizeof command_reply, "Failed to store message for '%s'.", recipient_identity_copy);
+	}
+	else snprintf(command_reply, sizeof command_reply, "Stored for '%s' until they connect.", recipient_identity_copy);
+
+send_command_reply:
+	check_error(
+		queue_client_message(client_sockfd, OUTBOUND_CONTROL_LANE, command_reply, strlen(command_reply) + 1),
+		"(Main) Failed to send command reply to client", 0
+	);
+	return 1;
+}
+
+void deliver_client_mailbox(int client_sockfd, const char *client_identity)
+{
+	const uint32_t current_seconds = (uint32_t)time(NULL);
+	size_t delivered_count;
+	const size_t delivered_bytes = mailbox_store_count_bytes(&server_mailboxes, client_identity, current_seconds, &delivered_count);
+	if (delivered_count == 0) return;
+
+	/* Every message is copied into a single payload, which is sent in as few writes as the socket allows.
+	   The stream lane is used as the messages are never dropped once taken from the mailbox. */
+	struct outbound_payload *mailbox_payload = outbound_payload_create(delivered_bytes);
+	if (check_error_null(mailbox_payload, "(Mailbox) Failed to allocate delivered messages", 0) == -1) return;
+	if (check_error(
+		mailbox_store_deliver(&server_mailboxes, client_identity, current_seconds, mailbox_payload->payload_data),
+		"(Mailbox) Failed to clear delivered mailbox", 0
+	) == -1) {
+		outbound_payload_release(mailbox_payload);
+		return;
+	}
+
+	printf("(Mailbox) Delivered %d message(s) (%d bytes) to client %d\n", (int)delivered_count, (int)delivered_bytes, client_sockfd);
+	check_error(
+		queue_client_payload(client_sockfd, OUTBOUND_STREAM_LANE, mailbox_payload),
+		"(Mailbox) Failed to send delivered messages", 0
+	);
+	outbound_payload_release(mailbox_payload);
+}
+
+int find_identity_client(const char *client_identity)
+{
+	for (size_t i = 0; i < server_reactor.poll_sockfds_count; ++i) {
+		const int client_sockfd = server_reactor.poll_sockfds[i].fd;
+		if (!is_client_poll_request(i) || (size_t)client_sockfd >= server_clients_data_count) continue;
+		const char *found_identity = server_clients_data[client_sockfd].client_identity;
+		if (found_identity != NULL && strcmp(found_identity, client_identity) == 0) return client_sockfd;
+	}
+	return -1;
+}
+
+
+int handle_client_stream_chunk(int client_sockfd, char *chunk_message)
+{
+	if (!is_stream_chunk(chunk_message)) return 0;
+
+	const char chunk_control_character = *chunk_message;
+	long stream_id;
+	char *chunk_data = split_stream_chunk(chunk_message, &stream_id);
+	if (chunk_data == NULL) return 1; /* Malformed chunks are ignored */
+
+	struct server_client_data *client_data = server_clients_data + client_sockfd;
+	if (!client_data->is_stream_open) {
+		client_data->is_stream_open = 1;
+		++server_open_streams_count;
+
+		const char publish_command[] = "/pub ";
+		char *topic_name_start = chunk_data + sizeof publish_command - 1;
+		const char *topic_name_end;
+		size_t topic_name_length;
+		if (strncmp(chunk_data, publish_command, sizeof publish_command - 1) != 0 ||
+		    (topic_name_end = strchr(topic_name_start, ' ')) == NULL ||
+		    (topic_name_length = (size_t)(topic_name_end - topic_name_start)) == 0 ||
+		    topic_name_length > TOPIC_MAXIMUM_LENGTH
+		) printf("(Client %d streamed message) %s\n", client_sockfd, chunk_data);
+		else {
+			char topic_name[TOPIC_MAXIMUM_LENGTH + 1];
+			memcpy(topic_name, topic_name_start, topic_name_length);
+			topic_name[topic_name_length] = '\0';
+
+			/* The subscribers are fixed for the whole stream, so that none of them recieve only part of it */
+			const int *subscriber_sockfds;
+			size_t subscribers_count;
+			if (topic_trie_match(&server_topic_subscriptions, topic_name, &subscriber_sockfds, &subscribers_count) == 0 &&
+			    subscribers_count != 0
+			) {
+				client_data->stream_recipient_sockfds = malloc(sizeof *subscriber_sockfds * subscribers_count);
+				if (check_error_null(client_data->stream_recipient_sockfds, "(Main) Failed to allocate stream recipients", 0) != -1) {
+					memcpy(client_data->stream_recipient_sockfds, subscriber_sockfds, sizeof *subscriber_sockfds * subscribers_count);
+					client_data->stream_recipients_count = subscribers_count;
+				}
+			}
+			client_data->is_stream_published = 1;
+
+			/* Subscribers recieve '[<topic>] <message>' as with other topic messages, made in place in the same way */
+			chunk_data = topic_name_start - 2;
+			*chunk_data = '[';
+			memmove(chunk_data + 1, topic_name_start, topic_name_length);
+			chunk_data[topic_name_length + 1] = ']';
+
+			printf("(Client %d) Streaming to '%s' (%d subscriber(s))\n", client_sockfd, topic_name, (int)client_data->stream_recipients_count);
+		}
+	}
+	else if (!client_data->is_stream_published) printf("(Client %d streamed message, continued) %s\n", client_sockfd, chunk_data);
+
+	relay_client_stream_chunk(client_sockfd, chunk_control_character, chunk_data, strlen(chunk_data));
+	if (chunk_control_character != network_global_stream_end_message) return 1;
+
+	/* Relaying can expand (and move) the client data list, so get this client's data again */
+	client_data = server_clients_data + client_sockfd;
+	if (client_data->is_stream_published) {
+		char stream_reply[64];
+		snprintf(stream_reply, sizeof stream_reply, "Streamed to %d subscriber(s).", (int)client_data->stream_recipients_count);
+		check_error(queue_client_message(
+			client_sockfd,
+			OUTBOUND_CONTROL_LANE,
+			stream_reply,
+			strlen(stream_reply) + 1
+		), "(Main) Failed to send command reply to client", 0);
+	}
+	close_client_stream(client_sockfd, 0);
+	return 1;
+}
+
+int is_client_stream_stalled(const struct server_client_data *client_data)
+{
+	for (size_t i = 0; i < client_data->stream_recipients_count; ++i) {
+		const size_t recipient_data_index = (size_t)client_data->stream_recipient_sockfds[i];
+		if (recipient_data_index < server_clients_data_count &&
+		    server_clients_data[recipient_data_index].client_outbound_queue.queued_bytes > SERVER_STREAM_MAXIMUM_QUEUED_BYTES
+		) return 1;
+	}
+	return 0;
+}
+
+void resume_stalled_streams(void)
+{
+	/* The held back chunk is handled as a message left over from the previous round, which also starts reading again */
+	for (size_t i = 0; i < server_clients_data_count; ++i) {
+		struct server_client_data *client_data = server_clients_data + i;
+		if (!client_data->is_stream_stalled || client_data->is_read_backlogged || is_client_stream_stalled(client_data)) continue;
+		set_client_read_backlogged((int)i, 1);
+	}
+}
+
+void relay_client_stream_chunk(int client_sockfd, char chunk_control_character, const char *chunk_data, size_t chunk_data_bytes)
+{
+	/* Copy the recipients, as sending can move the client data list */
+	const int *recipient_sockfds = server_clients_data[client_sockfd].stream_recipient_sockfds;
+	const size_t recipients_count = server_clients_data[client_sockfd].stream_recipients_count;
+	if (recipients_count == 0) return;
+
+	/* Every recipient shares the same copy of the chunk, being '<control><stream ID>:<data>' */
+	char chunk_header[32];
+	const int chunk_header_length = snprintf(chunk_header, sizeof chunk_header, "%c%d:", chunk_control_character, client_sockfd);
+	struct outbound_payload *chunk_payload = outbound_payload_create((size_t)chunk_header_length + chunk_data_bytes + 1);
+	if (check_error_null(chunk_payload, "(Main) Failed to allocate stream chunk", 0) == -1) return;
+	memcpy(chunk_payload->payload_data, chunk_header, (size_t)chunk_header_length);
+	memcpy(chunk_payload->payload_data + chunk_header_length, chunk_data, chunk_data_bytes);
+	chunk_payload->payload_data[(size_t)chunk_header_length + chunk_data_bytes] = '\0';
+
+	for (size_t i = 0; i < recipients_count; ++i) {
+		check_error(queue_client_payload(
+			recipient_sockfds[i],
+			OUTBOUND_STREAM_LANE,
+			chunk_payload
+		), "(Main) Failed to send stream chunk to client", 0);
+	}
+
+	outbound_payload_release(chunk_payload);
+}
+
+void close_client_stream(int client_sockfd, int is_interrupted)
+{
+	if (is_interrupted) relay_client_stream_chunk(client_sockfd, network_global_stream_end_message, "", 0);
+
+	struct server_client_data *client_data = server_clients_data + client_sockfd;
+	free(client_data->stream_recipient_sockfds);
+	client_data->stream_recipient_sockfds = NULL;
+	client_data->stream_recipients_count = 0;
+	client_data->is_stream_open = 0;
+	client_data->is_stream_published = 0;
+	--server_open_streams_count;
+}
+
+void remove_stream_recipient(int recipient_sockfd)
+{
+	for (size_t i = 0; i < server_clients_data_count; ++i) {
+		struct server_client_data *client_data = server_clients_data + i;
+		for (size_t j = 0; j < client_data->stream_recipients_count; ++j) {
+			if (client_data->stream_recipient_sockfds[j] != recipient_sockfd) continue;
+			client_data->stream_recipient_sockfds[j] = client_data->stream_recipient_sockfds[--client_data->stream_recipients_count];
+			break;
+		}
+	}
+}
+
+int handle_client_transfer(int client_sockfd, const char *client_message)
+{
+	if (*client_message != network_global_transfer_message) return 0;
+
+	long target_client_id;
+	unsigned long long transfer_bytes;
+	const char *file_name = split_transfer_message((char*)client_message, &target_client_id, &transfer_bytes);
+	char transfer_reply[128];
+	if (file_name == NULL) {
+		snprintf(transfer_reply, sizeof transfer_reply, "Invalid transfer message.");
+		goto send_transfer_reply;
+	}
+
+	/* Files can only be sent to other connected clients (not links) that are not already recieving one */
+	int target_sockfd = -1;
+	for (size_t i = 0; i < server_reactor.poll_sockfds_count; ++i) {
+		if (is_client_poll_request(i) && server_reactor.poll_sockfds[i].fd == target_client_id) target_sockfd = server_reactor.poll_sockfds[i].fd;
+	}
+	if (target_sockfd == -1 || target_sockfd == client_sockfd || federation_is_link(&server_federation_links, target_sockfd)) {
+		snprintf(transfer_reply, sizeof transfer_reply, "Client %ld is not connected, so the file will be discarded.", target_client_id);
+		target_sockfd = -1;
+	}
+	else if ((size_t)target_sockfd < server_clients_data_count && server_clients_data[target_sockfd].incoming_relay != NULL) {
+		snprintf(transfer_reply, sizeof transfer_reply, "Client %d is already recieving a file, so the file will be discarded.", target_sockfd);
+		target_sockfd = -1;
+	}
+	else snprintf(transfer_reply, sizeof transfer_reply, "Sending %llu bytes to client %d.", transfer_bytes, target_sockfd);
+
+	struct client_relay *transfer_relay = malloc(sizeof *transfer_relay);
+	if (check_error_null(transfer_relay, "(Main) Failed to allocate transfer relay", 0) == -1) return 1;
+
+	/* The recipient is told who the file is from, followed by the file itself */
+	char transfer_header[320];
+	snprintf(
+		transfer_header,
+		sizeof transfer_header,
+		"%c%d:%llu:%.255s",
+		network_global_transfer_message,
+		client_sockfd,
+		transfer_bytes,
+		file_name
+	);
+	if (check_error(relay_open(
+		transfer_relay,
+		client_sockfd,
+		target_sockfd,
+		transfer_bytes,
+		transfer_header,
+		strlen(transfer_header) + 1
+	), "(Main) Failed to open transfer relay", 0) == -1) {
+		/* The file still has to be read, so discard it instead */
+		target_sockfd = -1;
+		relay_open(transfer_relay, client_sockfd, target_sockfd, transfer_bytes, transfer_header, 0);
+		snprintf(transfer_reply, sizeof transfer_reply, "Failed to relay the file, so it will be discarded.");
+	}
+	transfer_relay->start_time_nanoseconds = outbound_current_time();
+
+	/* Getting the recipient's data can expand (and move) the client data list, so it is done first */
+	if (target_sockfd != -1) get_client_data(target_sockfd)->incoming_relay = transfer_relay;
+	server_clients_data[client_sockfd].outgoing_relay = transfer_relay;
+	++server_open_relays_count;
+
+	printf("(Client %d) Sending '%s' (%llu bytes) to client %ld\n", client_sockfd, file_name, transfer_bytes, target_client_id);
+	check_error(queue_client_message(
+		client_sockfd,
+		OUTBOUND_CONTROL_LANE,
+		transfer_reply,
+		strlen(transfer_reply) + 1
+	), "(Main) Failed to send command reply to client", 0);
+
+	/* Part of the file may have been recieved along with the transfer message */
+	fill_client_relay(client_sockfd);
+	return 1;
+
+send_transfer_reply:
+	check_error(queue_client_message(
+		client_sockfd,
+		OUTBOUND_CONTROL_LANE,
+		transfer_reply,
+		strlen(transfer_reply) + 1
+	), "(Main) Failed to send command reply to client", 0);
+	return 1;
+}
+
+ssize_t fill_client_relay(int client_sockfd)
+{
+	struct server_client_data *client_data = server_clients_data + client_sockfd;
+	struct client_relay *outgoing_relay = client_data->outgoing_relay;
+	struct network_message_reader *client_message_reader = &client_data->client_message_reader;
+	ssize_t total_relayed_bytes = 0;
+
+	/* Bytes left over from reading earlier messages are part of the file, being sent before anything else */
+	set_client_read_backlogged(client_sockfd, 0);
+	if (client_message_reader->buffer_start != client_message_reader->buffer_end) {
+		const ssize_t buffered_relayed_bytes = relay_fill_buffered(
+			outgoing_relay,
+			client_message_reader->reader_buffer + client_message_reader->buffer_start,
+			client_message_reader->buffer_end - client_message_reader->buffer_start
+		);
+		if (check_error((int)buffered_relayed_bytes, "(Main) Failed to relay transfer from client", 0) == -1) return -1;
+		client_message_reader->buffer_start += (size_t)buffered_relayed_bytes;
+		total_relayed_bytes += buffered_relayed_bytes;
+	}
+
+	/* The rest is moved from the client's socket until either the relay is full or the socket has nothing left */
+	while (client_message_reader->buffer_start == client_message_reader->buffer_end && relay_is_accepting(outgoing_relay)) {
+		const ssize_t relayed_bytes = relay_fill(outgoing_relay);
+		if (relayed_bytes == 0) return -1; /* Disconnected */
+		if (relayed_bytes == -1) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+			if (errno == EINTR) continue;
+			check_error(-1, "(Main) Failed to relay transfer from client", 0);
+			return -1;
+		}
+		total_relayed_bytes += relayed_bytes;
+	}
+
+	/* Send the new bytes to the recipient straight away, or end a discarded transfer once all of it was read */
+	if (outgoing_relay->target_sockfd != -1) flush_client_messages(outgoing_relay->target_sockfd);
+	else if (relay_is_complete(outgoing_relay)) finish_client_relay(outgoing_relay);
+	return total_relayed_bytes;
+}
+
+void drain_client_relay(int client_sockfd)
+{
+	struct client_relay *incoming_relay = server_clients_data[client_sockfd].incoming_relay;
+
+	for (;;) {
+		const ssize_t relayed_bytes = relay_drain(incoming_relay);
+		if (relayed_bytes > 0 || (relayed_bytes == -1 && errno == EINTR)) continue;
+
+		/* The recipient is removed once its disconnect is read, so the rest of the file only needs to be discarded here */
+		if (relayed_bytes == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+			check_error(-1, "(Main) Failed to relay transfer to client", 0);
+			server_clients_data[client_sockfd].incoming_relay = NULL;
+			relay_close(incoming_relay);
+			incoming_relay->target_sockfd = -1;
+		}
+		break;
+	}
+
+	if (relay_is_complete(incoming_relay)) finish_client_relay(incoming_relay);
+}
+
+void finish_client_relay(struct client_relay *relay)
+{
+	const int source_sockfd = relay->source_sockfd, target_sockfd = relay->target_sockfd;
+	const double relay_seconds = (double)(outbound_current_time() - relay->start_time_nanoseconds) / 1e9;
+	char relay_reply[128];
+
+	if (target_sockfd != -1) {
+		const double relay_mebibytes_per_second = relay_seconds > 0.0 ? (double)relay->total_bytes / 1048576.0 / relay_seconds : 0.0;
+		printf(
+			"(Main) Relayed %llu bytes from client %d to client %d in %.3f seconds (%.2f MiB/s)\n",
+			(unsigned long long)relay->total_bytes,
+			source_sockfd,
+			target_sockfd,
+			relay_seconds,
+			relay_mebibytes_per_second
+		);
+		snprintf(
+			relay_reply,
+			sizeof relay_reply,
+			"Sent %llu bytes to client %d (%.2f MiB/s).",
+			(unsigned long long)relay->total_bytes,
+			target_sockfd,
+			relay_mebibytes_per_second
+		);
+		server_clients_data[target_sockfd].incoming_relay = NULL;
+	} else {
+		printf("(Main) Discarded %llu bytes of a transfer from client %d\n", (unsigned long long)relay->total_bytes, source_sockfd);
+		snprintf(relay_reply, sizeof relay_reply, "Failed to send %llu bytes.", (unsigned long long)relay->total_bytes);
+	}
+
+	struct server_client_data *source_data = server_clients_data + source_sockfd;
+	source_data->outgoing_relay = NULL;
+	--server_open_relays_count;
+	relay_close(relay);
+	free(relay);
+
+	/* Messages recieved from the sender after the file are handled from the next round */
+	if (source_data->client_message_reader.buffer_start != source_data->client_message_reader.buffer_end) {
+		set_client_read_backlogged(source_sockfd, 1);
+	}
+
+	check_error(queue_client_message(
+		source_sockfd,
+		OUTBOUND_CONTROL_LANE,
+		relay_reply,
+		strlen(relay_reply) + 1
+	), "(Main) Failed to send transfer reply to client", 0);
+
+	/* Send the messages held back from the recipient whilst it was sent the file */
+	if (target_sockfd != -1) flush_client_messages(target_sockfd);
+}
+
+int handle_federation_message(int link_sockfd, char *link_message, size_t link_message_bytes)
+{
+	const char message_control_character = *link_message;
+	if (message_control_character != FEDERATION_HELLO_MESSAGE &&
+	    message_control_character != FEDERATION_BROADCAST_MESSAGE &&
+	    message_control_character != FEDERATION_PUBLISH_MESSAGE
+	) return 0;
+
+	/* A hello message marks the sender as another node rather than a client, if it is one of the listed nodes */
+	if (message_control_character == FEDERATION_HELLO_MESSAGE) {
+		if (federation_add_inbound_link(&server_federation_links, link_sockfd, link_message + 1) == -1) {
+			fprintf(stderr, "(Federation) Refused link from socket ID %d claiming to be node '%s'\n", link_sockfd, link_message + 1);
+		}
+		else printf("(Federation) Node '%s' linked with this node (socket ID %d)\n", link_message + 1, link_sockfd);
+		return 1;
+	}
+
+	/* Forwarded messages are only accepted through links from other nodes, and are ignored from clients */
+	if (!federation_is_inbound_link(&server_federation_links, link_sockfd)) return 1;
+	++link_message; /* Skip the control character */
+	--link_message_bytes;
+
+	if (message_control_character == FEDERATION_BROADCAST_MESSAGE) {
+		/* Send the message to every client of this node, skipping the server and any links */
+		struct outbound_payload *broadcast_payload = outbound_payload_copy(link_message, link_message_bytes);
+		if (check_error_null(broadcast_payload, "(Federation) Failed to allocate forwarded message", 0) == -1) return 1;
+
+		const uint64_t broadcast_time_nanoseconds = outbound_current_time();
+		size_t recipient_index = 0;
+		for (size_t i = 0; i < server_reactor.poll_sockfds_count; ++i) {
+			if (!is_client_poll_request(i) || federation_is_link(&server_federation_links, server_reactor.poll_sockfds[i].fd)) continue;
+			check_error(queue_client_paced_payload(
+				server_reactor.poll_sockfds[i].fd,
+				OUTBOUND_BULK_LANE,
+				broadcast_payload,
+				find_broadcast_release_time(broadcast_time_nanoseconds, recipient_index++, server_connections_count)
+			), "(Federation) Failed to send forwarded message to client", 0);
+		}
+
+		outbound_payload_release(broadcast_payload);
+		return 1;
+	}
+
+	/* Published messages are given as '[<topic>] <message>', so the topic needs to be seperated for matching */
+	const char *topic_name_end = strchr(link_message, ']');
+	const size_t topic_name_length = topic_name_end != NULL ? (size_t)(topic_name_end - link_message - 1) : 0;
+	if (*link_message != '[' || topic_name_length == 0 || topic_name_length > TOPIC_MAXIMUM_LENGTH) return 1;
+
+	char topic_name[TOPIC_MAXIMUM_LENGTH + 1];
+	memcpy(topic_name, link_message + 1, topic_name_length);
+	topic_name[topic_name_length] = '\0';
+
+	publish_topic_message(topic_name, link_message, link_message_bytes);
+	return 1;
+}
+
+void open_federation_links(struct network_reactor *reactor, void *timer_data)
+{
+	(void)reactor; /* Avoid unused parameter warnings */
+	(void)timer_data;
+
+	/* The first node is this one, which is never linked with */
+	for (size_t i = 1; i < server_federation_links.nodes_count; ++i) {
+		struct federation_node *node = server_federation_links.nodes + i;
+		if (node->outbound_sockfd != -1) continue;
+		if (federation_open_link(node) == -1) continue;
+
+		/* Wait for the connection to complete, which is signalled by the socket becoming writable */
+		if (add_client_socket(node->outbound_sockfd, POLLOUT) == -1) {
+			close(node->outbound_sockfd);
+			federation_remove_link(&server_federation_links, node->outbound_sockfd);
+		}
+	}
+
+	/* Stop trying until a link is lost, which starts the timer again */
+	for (size_t i = 1; i < server_federation_links.nodes_count; ++i) {
+		if (server_federation_links.nodes[i].outbound_sockfd == -1) return;
+	}
+	network_reactor_set_timer(reactor, server_federation_timer_id, 0);
+}
+
+void complete_federation_link(struct pollfd *link_poll_sockfd)
+{
+	struct federation_node *linked_node = federation_find_outbound_link(&server_federation_links, link_poll_sockfd->fd);
+	if (linked_node != NULL && federation_complete_link(&server_federation_links, linked_node) == 0) {
+		printf("(Federation) Linked with node '%s' (socket ID %d)\n", linked_node->node_address, link_poll_sockfd->fd);
+		link_poll_sockfd->events = POLLIN | (3 << 3); /* Now listening for reads, as with clients */
+		link_poll_sockfd->revents = 0;
+
+		/* The joining node takes over some identities, so move their clients to it */
+		rebalance_federation_clients();
+		return;
+	}
+
+	/* The node could not be reached, so try again later */
+	remove_client(link_poll_sockfd->fd);
+}
+
+
+int handle_client_identity(int client_sockfd, const char *client_message)
+{
+	if (*client_message != network_global_identity_message) return 0;
+	const char *client_identity = client_message + 1;
+
+	/* Keep the identity to check the client's placement again whenever nodes join */
+	struct server_client_data *client_data = get_client_data(client_sockfd);
+	if (check_error_null(client_data, "(Main) Failed to store client identity", 0) == -1) return 1;
+	free(client_data->client_identity);
+	if ((client_data->client_identity = strdup(client_identity)) == NULL) return 1;
+
+	/* Redirect the client if another node owns its identity */
+	const size_t owner_node_index = find_identity_owner(client_identity);
+	if (owner_node_index != 0 && owner_node_index != PLACEMENT_NO_OWNER) {
+		const char *owner_node_address = server_federation_links.nodes[owner_node_index].node_address;
+		printf("(Federation) Redirecting client %d ('%s') to node '%s'\n", client_sockfd, client_identity, owner_node_address);
+		send_client_redirect(client_sockfd, owner_node_address);
+		return 1;
+	}
+
+	/* Accept the client by sending its identity back */
+	printf("(Main) Client %d identified as '%s'\n", client_sockfd, client_identity);
+	check_error(queue_client_message(
+		client_sockfd,
+		OUTBOUND_CONTROL_LANE,
+		client_message,
+		strlen(client_message) + 1
+	), "(Main) Failed to accept client identity", 0);
+
+	/* Identified clients are given session tokens to resume their sessions with, which only hold identities up to the maximum length */
+	if (strlen(client_identity) > NETWORK_IDENTITY_MAXIMUM_LENGTH) {
+		free(client_data->session_patterns);
+		client_data->session_patterns = NULL;
+	} else if (client_data->session_patterns == NULL) {
+		client_data->session_patterns = calloc(1, sizeof *client_data->session_patterns);
+		check_error_null(client_data->session_patterns, "(Main) Failed to allocate client session", 0);
+	}
+	client_data->is_session_token_outdated = client_data->session_patterns != NULL;
+
+	/* Give back any subscriptions the client had before the server was restarted */
+	const int restored_count = restore_client_subscriptions(client_sockfd, client_identity);
+	if (restored_count != 0) {
+		char restored_reply[64];
+		snprintf(restored_reply, sizeof restored_reply, "Restored %d subscription(s).", restored_count);
+		printf("(Snapshot) Restored %d subscription(s) of client %d\n", restored_count, client_sockfd);
+		check_error(
+			queue_client_message(client_sockfd, OUTBOUND_CONTROL_LANE, restored_reply, strlen(restored_reply) + 1),
+			"(Main) Failed to send command reply to client", 0
+		);
+	}
+	mark_server_snapshot_outdated(client_sockfd);
+
+	/* Direct messages sent whilst the client was away follow the replies above */
+	if (server_mailbox_directory_path != NULL) deliver_client_mailbox(client_sockfd, client_identity);
+	return 1;
+}
+
+int handle_client_session(int client_sockfd, const char *client_message)
+{
+	if (*client_message != network_global_session_message) return 0;
+
+	/* Sessions are only resumed by the node owning the identity, once the client was accepted with that identity */
+	const struct server_client_data *client_data = get_client_data(client_sockfd);
+	if (client_data == NULL || client_data->session_patterns == NULL) return 1;
+
+	char token_identity[NETWORK_IDENTITY_MAXIMUM_LENGTH + 1];
+	struct session_patterns token_patterns;
+	const char *session_reply = "Session token rejected.";
+	char resumed_reply[64];
+	if (session_token_decode(client_message + 1, server_session_key, (uint64_t)time(NULL), token_identity, &token_patterns) == 0 &&
+	    strcmp(token_identity, client_data->client_identity) == 0
+	) {
+		/* Subscribe the client to every pattern it had, with the session token being sent again afterwards */
+		int resumed_count = 0;
+		size_t pattern_offset = 0;
+		const char *topic_pattern;
+		while ((topic_pattern = session_patterns_next(&token_patterns, &pattern_offset)) != NULL) {
+			if (add_client_subscription(client_sockfd, topic_pattern) == 1) ++resumed_count;
+		}
+		snprintf(resumed_reply, sizeof resumed_reply, "Resumed session with %d subscription(s).", resumed_count);
+		printf("(Main) Resumed session of client %d with %d subscription(s)\n", client_sockfd, resumed_count);
+		session_reply = resumed_reply;
+	}
+
+	check_error(
+		queue_client_message(client_sockfd, OUTBOUND_CONTROL_LANE, session_reply, strlen(session_reply) + 1),
+		"(Main) Failed to send command reply to client", 0
+	);
+	return 1;
+}
+
+size_t find_identity_owner(const char *client_identity)
+{
+	/* This node always owns every identity when it is not in a federation */
+	if (server_federation_links.nodes_count < 2) return 0;
+
+	/* The ring holds every configured node whether it is linked with or not, so that every node finds the same owner.
+	   Building it from only the linked nodes would let two nodes with different links each send a client to the other. */
+	if (server_placement_ring.points_count == 0) {
+		for (size_t i = 0; i < server_federation_links.nodes_count; ++i) {
+			if (check_error(
+				placement_ring_add_node(&server_placement_ring, server_federation_links.nodes[i].node_address, i),
+				"(Federation) Failed to add node to placement ring", 0
+			) == -1) {
+				placement_ring_clear(&server_placement_ring);
+				return 0;
+			}
+		}
+		placement_ring_sort(&server_placement_ring);
+	}
+
+	/* Clients owned by a node that is down are kept here rather than sent to it, and are moved once it is linked with.
+	   The owner itself never redirects them, so clients are only ever sent straight to their owner. */
+	const size_t owner_node_index = placement_ring_find_owner(&server_placement_ring, client_identity);
+	if (owner_node_index == PLACEMENT_NO_OWNER || !server_federation_links.nodes[owner_node_index].outbound_connected) return 0;
+	return owner_node_index;
+}
+
+void rebalance_federation_clients(void)
+{
+	size_t redirected_clients_count = 0;
+
+	for (size_t i = 0; i < server_reactor.poll_sockfds_count; ++i) {
+		const int client_sockfd = server_reactor.poll_sockfds[i].fd;
+		if (!is_client_poll_request(i) || (size_t)client_sockfd >= server_clients_data_count) continue;
+
+		const char *client_identity = server_clients_data[client_sockfd].client_identity;
+		if (client_identity == NULL) continue;
+
+		const size_t owner_node_index = find_identity_owner(client_identity);
+		if (owner_node_index == 0 || owner_node_index == PLACEMENT_NO_OWNER) continue;
+
+		send_client_redirect(client_sockfd, server_federation_links.nodes[owner_node_index].node_address);
+		++redirected_clients_count;
+	}
+
+	if (redirected_clients_count != 0) printf("(Federation) Redirected %d client(s) to other nodes\n", (int)redirected_clients_count);
+}
+
+void send_client_redirect(int client_sockfd, const char *node_address)
+{
+	/* The client disconnects itself once it has recieved the redirect */
+	const size_t node_address_bytes = strlen(node_address) + 1;
+	struct outbound_payload *redirect_payload = outbound_payload_create(sizeof network_global_redirect_message + node_address_bytes);
+	if (check_error_null(redirect_payload, "(Federation) Failed to redirect client", 0) == -1) return;
+
+	redirect_payload->payload_data[0] = network_global_redirect_message;
+	memcpy(redirect_payload->payload_data + 1, node_address, node_address_bytes);
+	check_error(
+		queue_client_payload(client_sockfd, OUTBOUND_CONTROL_LANE, redirect_payload),
+		"(Federation) Failed to redirect client", 0
+	);
+	outbound_payload_release(redirect_payload);
+}
+
+void load_server_snapshot(void)
+{
+	const uint64_t load_start_time = network_reactor_time();
+	const int load_result = snapshot_load(&server_restored_snapshot, server_snapshot_path);
+	if (load_result == 0) return; /* Nothing was saved yet */
+	if (load_result == -1) {
+		fprintf(stderr, "(Snapshot) Ignoring invalid or unreadable snapshot '%s'.\n", server_snapshot_path);
+		return;
+	}
+
+	server_snapshot_claim_deadline = load_start_time + SERVER_SNAPSHOT_CLAIM_PERIOD_NANOSECONDS;
+	printf(
+		"(Snapshot) Loaded %d subscription(s) from '%s' in %.3f ms\n",
+		(int)server_restored_snapshot.records_count,
+		server_snapshot_path,
+		(double)(network_reactor_time() - load_start_time) / 1e6
+	);
+}
+
+void take_server_snapshot(struct network_reactor *reactor, void *timer_data)
+{
+	(void)timer_data; /* Hide unused argument warning */
+
+	/* Only one snapshot is taken at a time, with changes made meanwhile being saved by the next one */
+	if (server_snapshot_pid != -1) {
+		int snapshot_status;
+		const pid_t waited_pid = waitpid(server_snapshot_pid, &snapshot_status, WNOHANG);
+		if (waited_pid == 0) {
+			network_reactor_set_timer(reactor, server_snapshot_timer_id, network_reactor_now(reactor) + SERVER_SNAPSHOT_CHECK_INTERVAL_NANOSECONDS);
+			return;
+		}
+		if (waited_pid == -1 || !WIFEXITED(snapshot_status) || WEXITSTATUS(snapshot_status) != EXIT_SUCCESS) {
+			fprintf(stderr, "(Snapshot) Failed to write snapshot '%s'.\n", server_snapshot_path);
+		}
+		server_snapshot_pid = -1;
+		if (server_is_snapshot_outdated) {
+			network_reactor_set_timer(reactor, server_snapshot_timer_id, network_reactor_now(reactor) + SERVER_SNAPSHOT_INTERVAL_NANOSECONDS);
+		}
+		return;
+	}
+	if (!server_is_snapshot_outdated) return;
+
+	/* Subscriptions not given back in time are dropped, as their clients are unlikely to return */
+	if (server_restored_snapshot.records != NULL && network_reactor_now(reactor) >= server_snapshot_claim_deadline) {
+		snapshot_free(&server_restored_snapshot);
+	}
+
+	/* The process only reads its copy of the state and writes the file, leaving everything else to the server */
+	const pid_t snapshot_pid = fork();
+	if (snapshot_pid == 0) _exit(snapshot_write_file(server_snapshot_path, add_server_snapshot_records) == -1 ? EXIT_FAILURE : EXIT_SUCCESS);
+	if (check_error(snapshot_pid, "(Snapshot) Failed to start taking snapshot", 0) == -1) {
+		network_reactor_set_timer(reactor, server_snapshot_timer_id, network_reactor_now(reactor) + SERVER_SNAPSHOT_INTERVAL_NANOSECONDS);
+		return;
+	}
+
+	server_snapshot_pid = snapshot_pid;
+	server_is_snapshot_outdated = 0;
+	network_reactor_set_timer(reactor, server_snapshot_timer_id, network_reactor_now(reactor) + SERVER_SNAPSHOT_CHECK_INTERVAL_NANOSECONDS);
+}
+
+void add_server_snapshot_records(struct snapshot_writer *writer)
+{
+	topic_trie_for_each_subscription(&server_topic_subscriptions, add_snapshot_subscription, writer);
+
+	for (size_t i = 0; i < server_restored_snapshot.records_count; ++i) {
+		const struct snapshot_record *record = server_restored_snapshot.records + i;
+		if (!record->is_claimed) snapshot_writer_add(writer, record->client_identity, record->topic_pattern);
+	}
+}
+
+void add_snapshot_subscription(const char *topic_pattern, int subscriber_sockfd, void *snapshot_writer)
+{
+	/* Only identified clients can be given their subscriptions back */
+	if ((size_t)subscriber_sockfd >= server_clients_data_count) return;
+	const char *client_identity = server_clients_data[subscriber_sockfd].client_identity;
+	if (client_identity != NULL) snapshot_writer_add(snapshot_writer, client_identity, topic_pattern);
+}
+
+void mark_server_snapshot_outdated(int client_sockfd)
+{
+	if (server_snapshot_timer_id == -1 ||
+	    (size_t)client_sockfd >= server_clients_data_count ||
+	    server_clients_data[client_sockfd].client_identity == NULL
+	) return;
+	server_is_snapshot_outdated = 1;
+	start_server_timer(server_snapshot_timer_id, SERVER_SNAPSHOT_INTERVAL_NANOSECONDS);
+}
+
+int restore_client_subscriptions(int client_sockfd, const char *client_identity)
+{
+	int restored_count = 0;
+	for (size_t i = snapshot_find_identity(&server_restored_snapshot, client_identity);
+	     i < server_restored_snapshot.records_count && strcmp(server_restored_snapshot.records[i].client_identity, client_identity) == 0;
+	     ++i
+	) {
+		/* Each saved subscription is only given back once, to the first client identifying itself with the identity */
+		struct snapshot_record *record = server_restored_snapshot.records + i;
+		if (record->is_claimed) continue;
+		record->is_claimed = 1;
+		if (add_client_subscription(client_sockfd, record->topic_pattern) == 1) ++restored_count;
+	}
+	return restored_count;
+}
+
+int add_client_subscription(int client_sockfd, const char *topic_pattern)
+{
+	const int subscribe_result = topic_trie_subscribe(&server_topic_subscriptions, topic_pattern, client_sockfd);
+	if (subscribe_result != 1) return subscribe_result;
+
+	/* Subscriptions that do not fit in the session token are kept, but are not resumed */
+	struct session_patterns *client_patterns = server_clients_data[client_sockfd].session_patterns;
+	if (client_patterns != NULL && session_patterns_add(client_patterns, topic_pattern) == 0) {
+		server_clients_data[client_sockfd].is_session_token_outdated = 1;
+	}
+	mark_server_snapshot_outdated(client_sockfd);
+	return subscribe_result;
+}
+
+int remove_client_subscription(int client_sockfd, const char *topic_pattern)
+{
+	const int unsubscribe_result = topic_trie_unsubscribe(&server_topic_subscriptions, topic_pattern, client_sockfd);
+	if (unsubscribe_result != 1) return unsubscribe_result;
+
+	struct session_patterns *client_patterns = server_clients_data[client_sockfd].session_patterns;
+	if (client_patterns != NULL) {
+		session_patterns_remove(client_patterns, topic_pattern);
+		server_clients_data[client_sockfd].is_session_token_outdated = 1;
+	}
+	mark_server_snapshot_outdated(client_sockfd);
+	return unsubscribe_result;
+}
+
+void send_client_session_token(int client_sockfd)
+{
+	struct server_client_data *client_data = server_clients_data + client_sockfd;
+	client_data->is_session_token_outdated = 0;
+	if (client_data->session_patterns == NULL) return;
+	client_data->session_token_renewal_time = network_reactor_now(&server_reactor) + SERVER_SESSION_TOKEN_LIFETIME_SECONDS / 2 * 1000000000ULL;
+
+	/* The token follows the session message character, as the client keeps it to present after reconnecting.
+	   Its expiry is in wall-clock time rather than the reactor's, as it is checked by other servers and after restarts. */
+	char session_message[1 + SESSION_TOKEN_MAXIMUM_TEXT_BYTES];
+	session_message[0] = network_global_session_message;
+	const size_t token_bytes = session_token_encode(
+		session_message + 1,
+		server_session_key,
+		client_data->client_identity,
+		client_data->session_patterns,
+		(uint64_t)time(NULL) + SERVER_SESSION_TOKEN_LIFETIME_SECONDS
+	);
+	check_error(
+		queue_client_message(client_sockfd, OUTBOUND_CONTROL_LANE, session_message, 1 + token_bytes),
+		"(Main) Failed to send session token to client", 0
+	);
+}
+
+int load_session_key(const char *key_path)
+{
+	/* Create the file with a random key if there is none, which fails if another server creates it first */
+	int key_fd = open(key_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	if (key_fd != -1) {
+		const int is_written =
+			getrandom(server_session_key, sizeof server_session_key, 0) == (ssize_t)sizeof server_session_key &&
+			write(key_fd, server_session_key, sizeof server_session_key) == (ssize_t)sizeof server_session_key;
+		close(key_fd);
+		if (!is_written) {
+			unlink(key_path);
+			return -1;
+		}
+		server_is_session_key_set = 1;
+		return 0;
+	}
+	if (errno != EEXIST) return -1;
+
+	key_fd = open(key_path, O_RDONLY | O_CLOEXEC);
+	if (key_fd == -1) return -1;
+	const ssize_t read_bytes = read(key_fd, server_session_key, sizeof server_session_key);
+	close(key_fd);
+	if (read_bytes != (ssize_t)sizeof server_session_key) return -1;
+	server_is_session_key_set = 1;
+	return 0;
+}
+
+struct server_client_data *get_client_data(int client_sockfd)
+{
+	const size_t client_data_index = (size_t)client_sockfd;
+
+	/* Expand the list to fit the given socket, doubling its size as done with the poll requests list */
+	if (client_data_index >= server_clients_data_count) {
+		size_t new_clients_data_count = server_clients_data_count ? server_clients_data_count : 16;
+		while (new_clients_data_count <= client_data_index) new_clients_data_count *= 2;
+
+		void *new_clients_data = realloc(server_clients_data, sizeof *server_clients_data * new_clients_data_count);
+		if (new_clients_data == NULL) return NULL;
+		server_clients_data = new_clients_data;
+
+		/* New client data starts off empty */
+		memset(server_clients_data + server_clients_data_count, 0, sizeof *server_clients_data * (new_clients_data_count - server_clients_data_count));
+		server_clients_data_count = new_clients_data_count;
+	}
+
+	return server_clients_data + client_data_index;
+}
+
+int queue_client_message(int client_sockfd, enum outbound_lane message_lane, const char *message, size_t message_bytes)
+{
+	struct outbound_payload *message_payload = outbound_payload_copy(message, message_bytes);
+	if (message_payload == NULL) return -1;
+
+	const int queue_result = queue_client_payload(client_sockfd, message_lane, message_payload);
+	outbound_payload_release(message_payload); /* The queue now holds its own reference */
+	return queue_result;
+}
+
+int queue_client_payload(int client_sockfd, enum outbound_lane message_lane, struct outbound_payload *payload)
+{
+	return queue_client_paced_payload(client_sockfd, message_lane, payload, 0);
+}
+
+int queue_client_paced_payload(
+	int client_sockfd,
+	enum outbound_lane message_lane,
+	struct outbound_payload *payload,
+	uint64_t release_time_nanoseconds
+) {
+	struct server_client_data *client_data = get_client_data(client_sockfd);
+	if (client_data == NULL) return -1;
+	if (client_data->is_kicked) return 0; /* Nothing is sent after the kick notice */
+
+	/*
+	   A client with messages already waiting is sent them once it is writable, which is listened for before polling.
+	   Messages that waited too long are dropped here as well, as a client that stopped reading is never flushed.
+	*/
+	const int was_queue_empty = outbound_queue_is_empty(&client_data->client_outbound_queue);
+	if (!was_queue_empty) outbound_queue_control_delay(&client_data->client_outbound_queue);
+	if (outbound_queue_push(&client_data->client_outbound_queue, message_lane, payload, release_time_nanoseconds) == -1) return -1;
+	if (was_queue_empty) flush_client_messages(client_sockfd);
+	return 0;
+}
+
+uint64_t find_broadcast_release_time(uint64_t broadcast_time_nanoseconds, size_t recipient_index, size_t recipients_count)
+{
+	if (server_broadcast_pacing_nanoseconds == 0 || recipients_count < SERVER_PACING_MINIMUM_RECIPIENTS) return 0;
+	return broadcast_time_nanoseconds + server_broadcast_pacing_nanoseconds * recipient_index / recipients_count;
+}
+
+
+void flush_client_messages(int client_sockfd)
+{
+	if ((size_t)client_sockfd >= server_clients_data_count) return;
+	struct outbound_queue *client_queue = &server_clients_data[client_sockfd].client_outbound_queue;
+	struct client_relay *incoming_relay = server_clients_data[client_sockfd].incoming_relay;
+
+	/* Messages sent to a client are held back from when a file starts being relayed to it until the whole file was sent */
+	if (incoming_relay == NULL || !incoming_relay->is_target_started) {
+		/* The client is removed once its disconnect is read, so its messages only need to be discarded here */
+		if (check_error(
+			outbound_queue_flush(client_queue, client_sockfd),
+			"(Main) Failed to send queued messages to client", 0
+		) == -1) outbound_queue_clear(client_queue);
+
+		/* The file is only started once every message queued before it was sent */
+		if (incoming_relay == NULL || !outbound_queue_is_empty(client_queue)) return;
+		incoming_relay->is_target_started = 1;
+	}
+
+	drain_client_relay(client_sockfd);
+}
+
+uint64_t update_poll_write_events(void)
+{
+	const uint64_t current_time_nanoseconds = outbound_current_time();
+	uint64_t next_release_time_nanoseconds = 0;
+
+	for (size_t i = 0; i < server_reactor.poll_sockfds_count; ++i) {
+		if (!is_client_poll_request(i)) continue;
+		struct pollfd *current_poll_sockfd = server_reactor.poll_sockfds + i;
+		const size_t client_data_index = (size_t)current_poll_sockfd->fd;
+
+		struct server_client_data *client_data = client_data_index < server_clients_data_count ? server_clients_data + client_data_index : NULL;
+		const struct client_relay *incoming_relay = client_data != NULL ? client_data->incoming_relay : NULL;
+
+		/* Messages waiting for their release time are not ready, so the socket being writable is not useful until then.
+		   Messages to a client a file has started being relayed to are not sent at all until the file was sent. */
+		const uint64_t client_release_time = client_data != NULL && (incoming_relay == NULL || !incoming_relay->is_target_started) ?
+			outbound_queue_next_release_time(&client_data->client_outbound_queue) : 0;
+		if (client_release_time > current_time_nanoseconds &&
+		    (next_release_time_nanoseconds == 0 || client_release_time < next_release_time_nanoseconds)
+		) next_release_time_nanoseconds = client_release_time;
+
+		/* A relayed file can be sent once it has data and nothing is queued before it */
+		const int is_relay_ready = incoming_relay != NULL && incoming_relay->pipe_bytes != 0 && client_release_time == 0;
+
+		if ((client_release_time != 0 && client_release_time <= current_time_nanoseconds) || is_relay_ready) {
+			current_poll_sockfd->events |= POLLOUT;
+		}
+		else if (current_poll_sockfd->events & POLLOUT) {
+			/* Connecting links have nothing queued, but still wait to become writable */
+			const struct federation_node *linked_node = federation_find_outbound_link(&server_federation_links, current_poll_sockfd->fd);
+			if (linked_node == NULL || linked_node->outbound_connected) current_poll_sockfd->events &= ~POLLOUT;
+		}
+
+		if (client_data == NULL) continue;
+
+		/* A kicked client is only waited on to send its notice, being closed as soon as it is writable after that */
+		if (client_data->is_kicked) {
+			current_poll_sockfd->events = (short)((current_poll_sockfd->events & ~POLLIN) | POLLOUT);
+			continue;
+		}
+
+		/* An echoing server stops reading from a client whilst too many of its messages are still waiting to be sent back */
+		if (server_serving_mode == SERVER_ECHO_MODE) {
+			if (client_data->client_outbound_queue.queued_bytes < SERVER_ECHO_MAXIMUM_QUEUED_BYTES) current_poll_sockfd->events |= POLLIN;
+			else current_poll_sockfd->events &= ~POLLIN;
+			continue;
+		}
+
+		/* A client sending a file is only read from whilst its relay has space, starting with anything already recieved */
+		if (client_data->outgoing_relay != NULL) {
+			const int is_relay_accepting = relay_is_accepting(client_data->outgoing_relay);
+			if (is_relay_accepting) current_poll_sockfd->events |= POLLIN;
+			else current_poll_sockfd->events &= ~POLLIN;
+			client_data->is_relay_paused = !is_relay_accepting;
+
+			const struct network_message_reader *client_message_reader = &client_data->client_message_reader;
+			if (is_relay_accepting && client_message_reader->buffer_start != client_message_reader->buffer_end) {
+				set_client_read_backlogged(current_poll_sockfd->fd, 1);
+			}
+		}
+		else if (client_data->is_relay_paused) {
+			current_poll_sockfd->events |= POLLIN;
+			client_data->is_relay_paused = 0;
+		}
+	}
+
+	return next_release_time_nanoseconds;
+}
+
+size_t forward_federation_message(char message_control_character, const char *forwarded_message, size_t forwarded_message_bytes)
+{
+	size_t forwarded_nodes_count = 0;
+
+	/* The control character and message are stored together once, being shared by the queues of every link */
+	struct outbound_payload *forwarded_payload = outbound_payload_create(sizeof message_control_character + forwarded_message_bytes);
+	if (check_error_null(forwarded_payload, "(Federation) Failed to allocate forwarded message", 0) == -1) return 0;
+	forwarded_payload->payload_data[0] = message_control_character;
+	memcpy(forwarded_payload->payload_data + 1, forwarded_message, forwarded_message_bytes);
+
+	for (size_t i = 1; i < server_federation_links.nodes_count; ++i) {
+		const struct federation_node *node = server_federation_links.nodes + i;
+		if (!node->outbound_connected) continue;
+		if (check_error(
+			queue_client_payload(node->outbound_sockfd, OUTBOUND_BULK_LANE, forwarded_payload),
+			"(Federation) Failed to forward message to node", 0
+		) != -1) ++forwarded_nodes_count;
+	}
+
+	outbound_payload_release(forwarded_payload);
+	return forwarded_nodes_count;
+}
+
+
+void set_client_read_backlogged(int client_sockfd, int is_read_backlogged)
+{
+	struct server_client_data *client_data = server_clients_data + client_sockfd;
+	client_data->is_read_backlogged = is_read_backlogged;
+
+	/* The reactor calls the client's handler every round whilst it is pending, without waiting for new events */
+	network_reactor_set_pending(&server_reactor, client_sockfd, is_read_backlogged);
+}
+
+int add_client_socket(int new_client_sockfd, short listened_events)
+{
+	/*
+	   The client is added with their 'pulse' counter at the maximum, stored as 2 bits representing
+	   the 'error' bits as explained in the 'pulse check' function, which the reactor leaves as they are.
+	*/
+	if (check_error(network_reactor_add(
+		&server_reactor,
+		new_client_sockfd,
+		(short)(listened_events | (3 << 3)),
+		handle_client_event,
+		NULL
+	), "(Main) Failed to expand poll requests list", 0) == -1) return -1;
+
+	++server_connections_count;
+	start_server_timer(server_pulse_timer_id, SERVER_PULSE_CHECK_INTERVAL_NANOSECONDS);
+	return 0;
+}
+
+int is_client_poll_request(size_t poll_index)
+{
+	return server_reactor.handlers[poll_index].callback == handle_client_event;
+}
+
+void remove_client(int client_sockfd)
+{
+	/* Only clients accepted by this server were reported as connected, rather than links opened by it */
+	const int is_reported_client = federation_find_outbound_link(&server_federation_links, client_sockfd) == NULL;
+
+	/* Remove any topic subscriptions or links and attempt to close the given socket to disable further interactions */
+	mark_server_snapshot_outdated(client_sockfd);
+	topic_trie_remove_subscriber(&server_topic_subscriptions, client_sockfd);
+	federation_remove_link(&server_federation_links, client_sockfd);
+	network_reactor_remove(&server_reactor, client_sockfd);
+	--server_connections_count;
+	close(client_sockfd);
+	if (!is_reported_client) start_server_timer(server_federation_timer_id, SERVER_FEDERATION_LINK_INTERVAL_NANOSECONDS);
+
+	/* Streams are closed first, as ending them sends to other clients, which can move the client data list */
+	if ((size_t)client_sockfd < server_clients_data_count &&
+	    server_clients_data[client_sockfd].is_stream_open
+	) close_client_stream(client_sockfd, 1);
+	if (server_open_streams_count != 0) remove_stream_recipient(client_sockfd);
+
+	/* The relays of the client are ended in the same way, as finishing them sends to the client at the other end */
+	if ((size_t)client_sockfd < server_clients_data_count) {
+		struct server_client_data *client_data = server_clients_data + client_sockfd;
+		struct client_relay *outgoing_relay = client_data->outgoing_relay, *incoming_relay = client_data->incoming_relay;
+		client_data->outgoing_relay = client_data->incoming_relay = NULL;
+
+		/* A recipient that was already sent part of the file cannot tell where it ends, so it is disconnected as well */
+		if (outgoing_relay != NULL) {
+			if (outgoing_relay->target_sockfd != -1) {
+				server_clients_data[outgoing_relay->target_sockfd].incoming_relay = NULL;
+				if (outgoing_relay->is_target_started) {
+					printf("(Main) Disconnecting client %d: Interrupted file transfer\n", outgoing_relay->target_sockfd);
+					shutdown(outgoing_relay->target_sockfd, SHUT_RDWR);
+				}
+			}
+			--server_open_relays_count;
+			relay_close(outgoing_relay);
+			free(outgoing_relay);
+		}
+
+		/* The sender is still read from until the whole file was recieved, which is then discarded */
+		if (incoming_relay != NULL) {
+			relay_close(incoming_relay);
+			incoming_relay->target_sockfd = -1;
+			if (relay_is_complete(incoming_relay)) finish_client_relay(incoming_relay);
+		}
+	}
+
+	/* Clear any data kept for the client, as the socket may be reused by a new client */
+	if ((size_t)client_sockfd < server_clients_data_count) {
+		struct server_client_data *client_data = server_clients_data + client_sockfd;
+		free(client_data->client_identity);
+		free(client_data->session_patterns);
+		free(client_data->client_message_reader.reader_buffer);
+		if (client_data->client_outbound_queue.dropped_messages_count != 0) {
+			printf(
+				"(Main) Dropped %d delayed message(s) (%d bytes) to client %d\n",
+				(int)client_data->client_outbound_queue.dropped_messages_count,
+				(int)client_data->client_outbound_queue.dropped_bytes,
+				client_sockfd
+			);
+		}
+		if (client_data->client_outbound_queue.conflated_messages_count != 0) {
+			printf(
+				"(Main) Replaced %d outdated state message(s) to client %d\n",
+				(int)client_data->client_outbound_queue.conflated_messages_count,
+				client_sockfd
+			);
+		}
+		outbound_queue_clear(&client_data->client_outbound_queue);
+		if (client_data->is_stream_stalled) --server_stalled_streams_count;
+		memset(client_data, 0, sizeof *client_data);
+	}
+
+	if (is_reported_client && server_client_event_handler != NULL) {
+		server_client_event_handler(SERVER_CLIENT_DISCONNECTED_EVENT, client_sockfd, NULL, 0, server_client_event_handler_data);
+	}
+}
+
+int kick_client(int client_sockfd)
+{
+	struct server_client_data *client_data = get_client_data(client_sockfd);
+
+	/* A client part way through being sent a file cannot be sent anything else until it ends, so it is closed straight away */
+	if (client_data == NULL || (client_data->incoming_relay != NULL && client_data->incoming_relay->is_target_started)) {
+		remove_client(client_sockfd);
+		return 1;
+	}
+
+	/* The notice is the last thing the client is sent, so any other messages still waiting for it are thrown away
+	   (apart from one already partially sent, which has to be finished first). An empty session token ends the client's
+	   session, so that it does not resume it. */
+	const char kick_notice_message[] = "You have been kicked.";
+	const char empty_session_message[2] = { network_global_session_message, '\0' };
+	outbound_queue_clear_lane(&client_data->client_outbound_queue, OUTBOUND_BULK_LANE);
+	outbound_queue_clear_lane(&client_data->client_outbound_queue, OUTBOUND_STREAM_LANE);
+	queue_client_message(client_sockfd, OUTBOUND_CONTROL_LANE, empty_session_message, sizeof empty_session_message);
+	queue_client_message(client_sockfd, OUTBOUND_CONTROL_LANE, kick_notice_message, sizeof kick_notice_message);
+	client_data->is_kicked = 1;
+	free(client_data->session_patterns);
+	client_data->session_patterns = NULL;
+	client_data->is_session_token_outdated = 0;
+	if (client_data->is_read_backlogged) set_client_read_backlogged(client_sockfd, 0);
+
+	/* Sent straight away if there is space for it, otherwise the client is closed once it becomes writable and the notice is sent */
+	flush_client_messages(client_sockfd);
+	if (outbound_queue_is_control_sent(&client_data->client_outbound_queue)) {
+		remove_client(client_sockfd);
+		return 1;
+	}
+
+	struct pollfd *client_poll_sockfd = network_reactor_find(&server_reactor, client_sockfd);
+	if (client_poll_sockfd != NULL) client_poll_sockfd->events = (short)((client_poll_sockfd->events & ~POLLIN) | POLLOUT);
+	return 0;
+}
+
+
+void stop_server(void)
+{
+	/* Interactive input being executed is finished first, with the server stopping straight after */
+	if (server_state == 2) {
+		server_is_stop_pending = 1;
+		return;
+	}
+	server_state = 0; /* Stop the server as soon as possible. */
+	wake_server();
+}
+
+void start_server_timer(int timer_id, uint64_t interval_nanoseconds)
+{
+	if (timer_id == -1 || network_reactor_get_timer(&server_reactor, timer_id) != 0) return;
+	network_reactor_set_timer(&server_reactor, timer_id, network_reactor_now(&server_reactor) + interval_nanoseconds);
+}
+
+void wake_server(void)
+{
+	/* Only 'write' is used, so this is safe to call from a signal handler */
+	const uint64_t wake_count = 1;
+	if (server_wake_fd != -1 && write(server_wake_fd, &wake_count, sizeof wake_count) == -1) return;
+}
+
+void handle_wake_event(struct network_reactor *reactor, struct pollfd *wake_poll_sockfd, void *event_data)
+{
+	(void)reactor; /* Avoid unused parameter warnings */
+	(void)event_data;
+
+	/* The loop checks the server state after every round, so there is nothing to do but clear the event */
+	uint64_t wake_count;
+	if (read(wake_poll_sockfd->fd, &wake_count, sizeof wake_count) == -1) return;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
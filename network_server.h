@@ -0,0 +1,86 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#pragma once
+#ifndef NETWORK_DEMO_SERVER_H
+#define NETWORK_DEMO_SERVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "network_reactor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+   The chat server, run on a reactor. A program embedding it configures it, opens its listening socket with 'init_server'
+   and runs it with 'begin_serving', which only returns once the server was stopped. Its own sockets and timers can be
+   added to the server's reactor beforehand (or from any of its callbacks) to be handled in the same loop as the clients.
+*/
+
+
+/* ---- Structs ---- */
+
+/* What the server does with the messages it recieves. */
+enum server_serving_mode {
+	SERVER_FULL_MODE, /* Handle every message as normal */
+	SERVER_ECHO_MODE, /* Send every message straight back to its sender, and nothing else */
+	SERVER_DISCARD_MODE /* Drop every message without doing anything with it */
+};
+
+/* Settings of the server, given before it is started. */
+struct server_options {
+	const char *federation_nodes_list; /* Comma-seperated '<host>:<port>' addresses of all servers to link with, starting with this one, or NULL */
+	uint64_t broadcast_pacing_nanoseconds; /* Period over which messages sent to many clients at once are spread out, or 0 */
+	enum server_serving_mode serving_mode;
+	const char *snapshot_path; /* File the subscriptions of identified clients are saved to and restored from, or NULL */
+	const char *session_key_path; /* File the key authenticating session tokens is read from (created if missing), or NULL for a random key */
+	const char *mailbox_directory_path; /* Directory direct messages to identities that are not connected are kept in, or NULL */
+};
+
+/* Events of clients reported to the event handler of the server, if one is set. */
+enum server_event_type {
+	SERVER_CLIENT_CONNECTED_EVENT,
+	SERVER_CLIENT_DISCONNECTED_EVENT,
+	SERVER_CLIENT_MESSAGE_EVENT /* A chat message that is not a command, given with the event */
+};
+
+/* Called for every client event, with the ID of the client and the message of a message event (or NULL with 0 bytes otherwise). */
+typedef void (*server_event_handler)(
+	enum server_event_type event_type,
+	int client_id,
+	const char *message,
+	size_t message_bytes,
+	void *handler_data
+);
+
+
+/* ---- Function declarations ---- */
+
+/* Applies the given settings to the server, which must be done before it is started.
+   Prints the reason and returns -1 if the settings are invalid, and returns 0 otherwise. */
+int configure_server(const struct server_options *options);
+/* Sets the handler called for client events, replacing the printing of chat messages, or removes it if NULL. */
+void set_server_event_handler(server_event_handler handler, void *handler_data);
+/* Returns the reactor the server runs on, for adding sockets and timers handled alongside the clients. */
+struct network_reactor *get_server_reactor(void);
+
+/* Initializes the server in the given port, returning the newly opened server socket/file descriptor. */
+int init_server(char *server_port);
+/* Begins the main loop for listening and responding to clients. The server must be initialized beforehand. */
+void begin_serving(int server_sockfd, long maximum_requests, long is_interactive);
+/* Allows interacting with clients through input. Input format: '<ID/all> <Message/kick>' */
+void *begin_interaction(void *v_interact_data);
+/* Stops the server as soon as possible, or once interactive input being executed has finished.
+   Safe to call from a signal handler. */
+void stop_server(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NETWORK_DEMO_SERVER_H */
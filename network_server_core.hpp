@@ -0,0 +1,942 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#pragma once
+#ifndef NETWORK_DEMO_SERVER_CORE_HPP
+#define NETWORK_DEMO_SERVER_CORE_HPP
+
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/io_uring.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "network_shared.h"
+#include "network_reactor.h"
+#include "network_codec.hpp"
+
+/*
+   The core of a server (accepting clients, reading their frames, answering them and checking they are still alive) as a
+   template, specialised at compile time on:
+	- An I/O backend, waiting for sockets to be ready: 'poll_backend', 'epoll_backend' or 'uring_backend' (io_uring).
+	- A framing policy, finding frames in recieved data: 'text_framing' (terminated messages, as the chat server uses)
+	  or 'binary_framing' (the frames of 'network_codec.hpp').
+	- A liveness policy, finding clients that are gone: 'pulse_liveness' (pulse checks sent by the server, as the chat
+	  server does) or 'keepalive_liveness' (TCP keepalive, left to the kernel).
+	- A handler, given every frame that is not a pulse, such as 'echo_handler' or 'discard_handler'. A handler can also
+	  have 'on_open' and 'on_close' called with each client that connects and disconnects, 'on_wake' called whenever
+	  the socket given to 'set_wake_socket' is readable and 'on_round' called after every round of the loop, all of
+	  which are only called if the handler has them.
+
+   Each choice is made by the type rather than a flag, so the compiler only builds the code of the chosen policies into
+   the loop, with every call to them inlined. The 'runtime_*' policies instead choose between the others with a switch on
+   every call, as a server configured by its arguments would, to measure what the specialisation saves.
+
+	network::core::server_core<network::core::epoll_backend, network::core::text_framing,
+		network::core::pulse_liveness, network::core::echo_handler> echo_server;
+	if (echo_server.listen("5000") == -1) return EXIT_FAILURE;
+	echo_server.run();
+*/
+
+namespace network::core {
+
+/* A frame found in the data recieved from a client. */
+struct core_frame {
+	size_t frame_bytes; /* Bytes of the whole frame in the recieved data */
+	uint8_t message_id;
+	std::string_view payload; /* Data of the frame, being valid until the handler returns */
+};
+
+/* A client taken out of a core between its frames, with the data recieved and waiting to be sent, to be served by
+   another core (such as one on another thread). */
+struct core_detached_connection {
+	int client_sockfd = -1;
+	uint8_t missed_pulses_count = 0;
+	struct network_message_reader reader = {}; /* Holds at most the start of a frame */
+	char *outbound_buffer = nullptr;
+	size_t outbound_start = 0, outbound_end = 0, outbound_alloc_count = 0;
+
+	/* Disconnects the client, for when it is not given to another core. */
+	void close_connection() noexcept
+	{
+		if (client_sockfd != -1) close(client_sockfd);
+		std::free(reader.reader_buffer);
+		std::free(outbound_buffer);
+		*this = core_detached_connection();
+	}
+};
+
+
+/* ---- I/O backends ---- */
+
+/*
+   Every backend reports each ready socket to the function given to 'wait' as '(sockfd, is_readable, is_writable, is_closed)'.
+   Sockets may be added, changed and removed whilst their events are being reported, and those of a removed socket are
+   not reported afterwards.
+*/
+
+/* Waits with 'poll', giving every socket to the kernel on every wait. */
+class poll_backend {
+public:
+	int init() noexcept { return 0; }
+	void free() noexcept
+	{
+		poll_sockfds.clear();
+		socket_indices.clear();
+	}
+
+	int add(int sockfd, bool is_write_wanted)
+	{
+		if ((size_t)sockfd >= socket_indices.size()) socket_indices.resize((size_t)sockfd + 1, 0);
+		if (socket_indices[(size_t)sockfd] != 0) return -1;
+		poll_sockfds.push_back({ sockfd, get_events(is_write_wanted), 0 });
+		socket_indices[(size_t)sockfd] = poll_sockfds.size();
+		return 0;
+	}
+	int modify(int sockfd, bool is_write_wanted) noexcept
+	{
+		if ((size_t)sockfd >= socket_indices.size() || socket_indices[(size_t)sockfd] == 0) return -1;
+		poll_sockfds[socket_indices[(size_t)sockfd] - 1].events = get_events(is_write_wanted);
+		return 0;
+	}
+	int remove(int sockfd) noexcept
+	{
+		if ((size_t)sockfd >= socket_indices.size() || socket_indices[(size_t)sockfd] == 0) return -1;
+		const size_t removed_index = socket_indices[(size_t)sockfd] - 1;
+		socket_indices[(size_t)sockfd] = 0;
+
+		/* The last socket takes the place of the removed one. Sockets are reported from the end of the list, so the
+		   moved socket was either already reported or is the removed one, and is not reported again. */
+		if (removed_index != poll_sockfds.size() - 1) {
+			poll_sockfds[removed_index] = poll_sockfds.back();
+			poll_sockfds[removed_index].revents = 0;
+			socket_indices[(size_t)poll_sockfds[removed_index].fd] = removed_index + 1;
+		}
+		poll_sockfds.pop_back();
+		return 0;
+	}
+
+	template<typename F>
+	int wait(int timeout_milliseconds, F &&on_event)
+	{
+		const int poll_events_recieved = poll(poll_sockfds.data(), (nfds_t)poll_sockfds.size(), timeout_milliseconds);
+		if (poll_events_recieved <= 0) return poll_events_recieved;
+
+		for (size_t i = poll_sockfds.size(); i-- > 0; ) {
+			if (i >= poll_sockfds.size()) continue; /* Several sockets were removed whilst reporting the last one */
+			const struct pollfd ready_poll_sockfd = poll_sockfds[i];
+			if (ready_poll_sockfd.revents == 0) continue;
+			on_event(ready_poll_sockfd.fd, (ready_poll_sockfd.revents & POLLIN) != 0, (ready_poll_sockfd.revents & POLLOUT) != 0,
+				(ready_poll_sockfd.revents & (POLLHUP | POLLERR | POLLNVAL)) != 0);
+		}
+		return poll_events_recieved;
+	}
+
+private:
+	static short get_events(bool is_write_wanted) noexcept { return (short)(POLLIN | (is_write_wanted ? POLLOUT : 0)); }
+
+	std::vector<struct pollfd> poll_sockfds;
+	std::vector<size_t> socket_indices; /* Index of each socket in the list plus one, or 0 if it was not added */
+};
+
+/* Waits with 'epoll', only being given the sockets that are ready. */
+class epoll_backend {
+public:
+	int init() noexcept { return epoll_fd = epoll_create1(EPOLL_CLOEXEC); }
+	void free() noexcept
+	{
+		if (epoll_fd != -1) close(epoll_fd);
+		epoll_fd = -1;
+	}
+
+	int add(int sockfd, bool is_write_wanted) noexcept { return control(EPOLL_CTL_ADD, sockfd, is_write_wanted); }
+	int modify(int sockfd, bool is_write_wanted) noexcept { return control(EPOLL_CTL_MOD, sockfd, is_write_wanted); }
+	int remove(int sockfd) noexcept
+	{
+		if ((size_t)sockfd < removed_sockfds.size()) removed_sockfds[(size_t)sockfd] = 1;
+		return epoll_ctl(epoll_fd, EPOLL_CTL_DEL, sockfd, nullptr);
+	}
+
+	template<typename F>
+	int wait(int timeout_milliseconds, F &&on_event)
+	{
+		const int ready_events_count = epoll_wait(epoll_fd, ready_events, EPOLL_MAXIMUM_EVENTS, timeout_milliseconds);
+		if (ready_events_count <= 0) return ready_events_count;
+
+		/* Sockets removed whilst reporting are remembered so that their own events later in the list are skipped */
+		for (int i = 0; i < ready_events_count; ++i) {
+			const size_t ready_sockfd = (size_t)ready_events[i].data.fd;
+			if (ready_sockfd >= removed_sockfds.size()) removed_sockfds.resize(ready_sockfd + 1, 0);
+			removed_sockfds[ready_sockfd] = 0;
+		}
+		for (int i = 0; i < ready_events_count; ++i) {
+			const struct epoll_event ready_event = ready_events[i];
+			if (removed_sockfds[(size_t)ready_event.data.fd]) continue;
+			on_event(ready_event.data.fd, (ready_event.events & EPOLLIN) != 0, (ready_event.events & EPOLLOUT) != 0,
+				(ready_event.events & (EPOLLHUP | EPOLLERR)) != 0);
+		}
+		return ready_events_count;
+	}
+
+private:
+	static constexpr int EPOLL_MAXIMUM_EVENTS = 256;
+
+	int control(int operation, int sockfd, bool is_write_wanted) noexcept
+	{
+		struct epoll_event socket_event;
+		std::memset(&socket_event, 0, sizeof socket_event);
+		socket_event.events = EPOLLIN | (is_write_wanted ? (uint32_t)EPOLLOUT : 0);
+		socket_event.data.fd = sockfd;
+		return epoll_ctl(epoll_fd, operation, sockfd, &socket_event);
+	}
+
+	int epoll_fd = -1;
+	struct epoll_event ready_events[EPOLL_MAXIMUM_EVENTS];
+	std::vector<unsigned char> removed_sockfds;
+};
+
+/*
+   Waits with io_uring, keeping a poll request queued in the kernel for every socket, which is queued again after it
+   completes. Requests are submitted and completions collected with a single system call per wait. The rings are used
+   through the raw system calls, as the library wrapping them is not always installed.
+*/
+class uring_backend {
+public:
+	int init() noexcept
+	{
+		struct io_uring_params ring_params;
+		std::memset(&ring_params, 0, sizeof ring_params);
+		if ((ring_fd = (int)syscall(__NR_io_uring_setup, URING_RING_ENTRIES, &ring_params)) == -1) return -1;
+		if ((ring_params.features & IORING_FEAT_EXT_ARG) == 0) {
+			free();
+			errno = ENOSYS;
+			return -1;
+		}
+
+		/* Both rings can share one mapping if the kernel allows, which is then large enough for either */
+		size_t submit_ring_bytes = ring_params.sq_off.array + ring_params.sq_entries * sizeof(unsigned);
+		size_t complete_ring_bytes = ring_params.cq_off.cqes + ring_params.cq_entries * sizeof(struct io_uring_cqe);
+		const bool is_single_mapping = (ring_params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (is_single_mapping) submit_ring_bytes = complete_ring_bytes = std::max(submit_ring_bytes, complete_ring_bytes);
+
+		submit_ring = map_ring(submit_ring_bytes, IORING_OFF_SQ_RING);
+		complete_ring = is_single_mapping ? submit_ring : map_ring(complete_ring_bytes, IORING_OFF_CQ_RING);
+		submit_entries = static_cast<struct io_uring_sqe*>(map_ring(ring_params.sq_entries * sizeof(struct io_uring_sqe), IORING_OFF_SQES));
+		submit_ring_mapped_bytes = submit_ring_bytes;
+		complete_ring_mapped_bytes = is_single_mapping ? 0 : complete_ring_bytes;
+		submit_entries_mapped_bytes = ring_params.sq_entries * sizeof(struct io_uring_sqe);
+		if (submit_ring == nullptr || complete_ring == nullptr || submit_entries == nullptr) {
+			free();
+			return -1;
+		}
+
+		char *const submit_ring_start = static_cast<char*>(submit_ring), *const complete_ring_start = static_cast<char*>(complete_ring);
+		submit_head = reinterpret_cast<unsigned*>(submit_ring_start + ring_params.sq_off.head);
+		submit_tail = reinterpret_cast<unsigned*>(submit_ring_start + ring_params.sq_off.tail);
+		submit_array = reinterpret_cast<unsigned*>(submit_ring_start + ring_params.sq_off.array);
+		submit_mask = *reinterpret_cast<unsigned*>(submit_ring_start + ring_params.sq_off.ring_mask);
+		submit_entries_count = ring_params.sq_entries;
+		complete_head = reinterpret_cast<unsigned*>(complete_ring_start + ring_params.cq_off.head);
+		complete_tail = reinterpret_cast<unsigned*>(complete_ring_start + ring_params.cq_off.tail);
+		complete_mask = *reinterpret_cast<unsigned*>(complete_ring_start + ring_params.cq_off.ring_mask);
+		complete_entries = reinterpret_cast<struct io_uring_cqe*>(complete_ring_start + ring_params.cq_off.cqes);
+		return 0;
+	}
+	void free() noexcept
+	{
+		if (submit_entries != nullptr) munmap(submit_entries, submit_entries_mapped_bytes);
+		if (complete_ring != nullptr && complete_ring != submit_ring) munmap(complete_ring, complete_ring_mapped_bytes);
+		if (submit_ring != nullptr) munmap(submit_ring, submit_ring_mapped_bytes);
+		if (ring_fd != -1) close(ring_fd);
+		submit_entries = nullptr;
+		submit_ring = complete_ring = nullptr;
+		ring_fd = -1;
+	}
+
+	int add(int sockfd, bool is_write_wanted)
+	{
+		if ((size_t)sockfd >= registrations.size()) registrations.resize((size_t)sockfd + 1);
+		uring_registration &registration = registrations[(size_t)sockfd];
+		if (registration.is_added) return -1;
+		registration.is_added = true;
+		registration.is_write_wanted = is_write_wanted;
+		++registration.generation;
+		return queue_poll(sockfd);
+	}
+	int modify(int sockfd, bool is_write_wanted) noexcept
+	{
+		if ((size_t)sockfd >= registrations.size() || !registrations[(size_t)sockfd].is_added) return -1;
+		uring_registration &registration = registrations[(size_t)sockfd];
+		if (registration.is_write_wanted == is_write_wanted) return 0;
+		registration.is_write_wanted = is_write_wanted;
+
+		/* A queued request is replaced, whilst one being reported is queued again with the new events afterwards */
+		if (!registration.is_queued) return 0;
+		cancel_poll(sockfd);
+		return queue_poll(sockfd);
+	}
+	int remove(int sockfd) noexcept
+	{
+		if ((size_t)sockfd >= registrations.size() || !registrations[(size_t)sockfd].is_added) return -1;
+		if (registrations[(size_t)sockfd].is_queued) cancel_poll(sockfd);
+		registrations[(size_t)sockfd].is_added = false;
+		++registrations[(size_t)sockfd].generation;
+		return 0;
+	}
+
+	template<typename F>
+	int wait(int timeout_milliseconds, F &&on_event)
+	{
+		struct __kernel_timespec wait_timeout = { timeout_milliseconds / 1000, (long long)(timeout_milliseconds % 1000) * 1000000LL };
+		struct io_uring_getevents_arg wait_arguments;
+		std::memset(&wait_arguments, 0, sizeof wait_arguments);
+		wait_arguments.sigmask_sz = _NSIG / 8;
+		wait_arguments.ts = timeout_milliseconds < 0 ? 0 : (uint64_t)(uintptr_t)&wait_timeout;
+
+		/* Nothing is waited for if completions are already waiting to be collected */
+		const unsigned minimum_completions = __atomic_load_n(complete_tail, __ATOMIC_ACQUIRE) != *complete_head ? 0 : 1;
+		if (syscall(__NR_io_uring_enter, ring_fd, get_unsubmitted_count(), minimum_completions,
+		            IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &wait_arguments, sizeof wait_arguments) == -1 &&
+		    errno != ETIME
+		) return -1;
+
+		int reported_events_count = 0;
+		for (unsigned head = *complete_head; head != __atomic_load_n(complete_tail, __ATOMIC_ACQUIRE); ) {
+			const struct io_uring_cqe completion = complete_entries[head & complete_mask];
+			__atomic_store_n(complete_head, ++head, __ATOMIC_RELEASE);
+
+			/* Completions of cancelled requests, or of sockets removed or changed since, are ignored */
+			const int ready_sockfd = (int)(completion.user_data & 0xFFFFFFFFu);
+			if (completion.user_data == URING_CANCEL_USER_DATA || (size_t)ready_sockfd >= registrations.size()) continue;
+			uring_registration &registration = registrations[(size_t)ready_sockfd];
+			if (!registration.is_added || (uint32_t)(completion.user_data >> 32) != registration.generation) continue;
+
+			registration.is_queued = false;
+			const unsigned ready_events = completion.res < 0 ? (unsigned)POLLERR : (unsigned)completion.res;
+			on_event(ready_sockfd, (ready_events & POLLIN) != 0, (ready_events & POLLOUT) != 0, (ready_events & (POLLHUP | POLLERR | POLLNVAL)) != 0);
+			++reported_events_count;
+
+			/* The request is only queued again if the socket was not removed whilst it was reported */
+			uring_registration &reported_registration = registrations[(size_t)ready_sockfd];
+			if (reported_registration.is_added && !reported_registration.is_queued) queue_poll(ready_sockfd);
+		}
+		return reported_events_count;
+	}
+
+private:
+	static constexpr unsigned URING_RING_ENTRIES = 4096;
+	static constexpr uint64_t URING_CANCEL_USER_DATA = UINT64_MAX;
+
+	/* State of a socket's poll request. The generation is part of each request, so that stale completions can be told apart. */
+	struct uring_registration {
+		bool is_added = false, is_queued = false, is_write_wanted = false;
+		uint32_t generation = 0;
+	};
+
+	void *map_ring(size_t ring_bytes, off_t ring_offset) noexcept
+	{
+		void *ring = mmap(nullptr, ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, ring_offset);
+		return ring != MAP_FAILED ? ring : nullptr;
+	}
+
+	unsigned get_unsubmitted_count() const noexcept { return submit_tail_local - __atomic_load_n(submit_head, __ATOMIC_ACQUIRE); }
+
+	/* Returns the next free request, submitting those already queued if the ring is full */
+	struct io_uring_sqe *get_submit_entry() noexcept
+	{
+		if (get_unsubmitted_count() >= submit_entries_count) syscall(__NR_io_uring_enter, ring_fd, get_unsubmitted_count(), 0, 0, nullptr, 0);
+		struct io_uring_sqe *submit_entry = submit_entries + (submit_tail_local & submit_mask);
+		std::memset(submit_entry, 0, sizeof *submit_entry);
+		return submit_entry;
+	}
+	void push_submit_entry() noexcept
+	{
+		submit_array[submit_tail_local & submit_mask] = submit_tail_local & submit_mask;
+		__atomic_store_n(submit_tail, ++submit_tail_local, __ATOMIC_RELEASE);
+	}
+
+	int queue_poll(int sockfd) noexcept
+	{
+		uring_registration &registration = registrations[(size_t)sockfd];
+		struct io_uring_sqe *submit_entry = get_submit_entry();
+		submit_entry->opcode = IORING_OP_POLL_ADD;
+		submit_entry->fd = sockfd;
+		submit_entry->poll32_events = POLLIN | (registration.is_write_wanted ? (unsigned)POLLOUT : 0);
+		submit_entry->user_data = ((uint64_t)registration.generation << 32) | (uint32_t)sockfd;
+		push_submit_entry();
+		registration.is_queued = true;
+		return 0;
+	}
+	void cancel_poll(int sockfd) noexcept
+	{
+		uring_registration &registration = registrations[(size_t)sockfd];
+		struct io_uring_sqe *submit_entry = get_submit_entry();
+		submit_entry->opcode = IORING_OP_POLL_REMOVE;
+		submit_entry->fd = -1;
+		submit_entry->addr = ((uint64_t)registration.generation << 32) | (uint32_t)sockfd;
+		submit_entry->user_data = URING_CANCEL_USER_DATA;
+		push_submit_entry();
+		registration.is_queued = false;
+		++registration.generation;
+	}
+
+	int ring_fd = -1;
+	void *submit_ring = nullptr, *complete_ring = nullptr;
+	size_t submit_ring_mapped_bytes = 0, complete_ring_mapped_bytes = 0, submit_entries_mapped_bytes = 0;
+	struct io_uring_sqe *submit_entries = nullptr;
+	unsigned *submit_head = nullptr, *submit_tail = nullptr, *submit_array = nullptr;
+	unsigned submit_mask = 0, submit_entries_count = 0, submit_tail_local = 0;
+	unsigned *complete_head = nullptr, *complete_tail = nullptr;
+	unsigned complete_mask = 0;
+	struct io_uring_cqe *complete_entries = nullptr;
+	std::vector<uring_registration> registrations; /* Indexed by socket */
+};
+
+
+/* ---- Framing policies ---- */
+
+/* Messages ended by a terminator or new line, with pulses being a single character, as used by the chat server. */
+struct text_framing {
+	static constexpr uint8_t pulse_message_id = 3;
+
+	static bool find_frame(struct network_message_reader *reader, core_frame &frame) noexcept
+	{
+		size_t message_bytes;
+		char *message = find_network_message(reader, &message_bytes);
+		if (message == nullptr) return false;
+		frame.frame_bytes = message_bytes;
+		frame.message_id = *message == network_global_pulse_message ? pulse_message_id : 0;
+		frame.payload = std::string_view(message, message_bytes - (frame.message_id == pulse_message_id ? 0 : 1));
+		return true;
+	}
+	static size_t get_frame_bytes(uint8_t message_id, std::string_view payload) noexcept
+	{
+		return message_id == pulse_message_id ? network_global_pulse_bytes : payload.size() + 1;
+	}
+	static char *encode_frame(uint8_t message_id, std::string_view payload, char *target_buffer) noexcept
+	{
+		if (message_id == pulse_message_id) {
+			*target_buffer = network_global_pulse_message;
+			return target_buffer + network_global_pulse_bytes;
+		}
+		std::memcpy(target_buffer, payload.data(), payload.size());
+		target_buffer[payload.size()] = '\0';
+		return target_buffer + payload.size() + 1;
+	}
+};
+
+/* Frames of 'network_codec.hpp', with pulses being frames with their own ID and nothing after the header. Frames must
+   fit in the recieve buffer, so their payload can be at most a few bytes short of the most a header can give. */
+struct binary_framing {
+	static constexpr uint8_t pulse_message_id = 3;
+
+	static bool find_frame(struct network_message_reader *reader, core_frame &frame) noexcept
+	{
+		codec::frame_header header;
+		const char *buffered_data = reader->reader_buffer + reader->buffer_start;
+		if ((frame.frame_bytes = codec::find_frame(buffered_data, reader->buffer_end - reader->buffer_start, header)) == 0) return false;
+		frame.message_id = header.message_id;
+		frame.payload = std::string_view(buffered_data + codec::frame_header_bytes, header.payload_bytes);
+		return true;
+	}
+	static size_t get_frame_bytes(uint8_t, std::string_view payload) noexcept { return codec::frame_header_bytes + payload.size(); }
+	static char *encode_frame(uint8_t message_id, std::string_view payload, char *target_buffer) noexcept
+	{
+		target_buffer = codec::fixed<uint8_t>::encode(message_id, target_buffer);
+		target_buffer = codec::fixed<uint16_t>::encode(static_cast<uint16_t>(payload.size()), target_buffer);
+		std::memcpy(target_buffer, payload.data(), payload.size());
+		return target_buffer + payload.size();
+	}
+};
+
+
+/* ---- Liveness policies ---- */
+
+/* The server sends a pulse to every client every 30 seconds, disconnecting those that sent nothing back for two pulses. */
+struct pulse_liveness {
+	static constexpr bool is_pulsed() noexcept { return true; }
+	static constexpr uint64_t pulse_interval_nanoseconds = 30000000000ULL;
+	static constexpr uint8_t maximum_missed_pulses = 2;
+	static void configure_socket(int) noexcept {}
+};
+
+/* The kernel checks idle connections with TCP keepalive, reporting those that stopped answering as errors. */
+struct keepalive_liveness {
+	static constexpr bool is_pulsed() noexcept { return false; }
+	static constexpr uint64_t pulse_interval_nanoseconds = 0;
+	static constexpr uint8_t maximum_missed_pulses = 0;
+	static void configure_socket(int client_sockfd) noexcept
+	{
+		/* Checked after 30 idle seconds, then every 10 seconds until two checks go unanswered, as pulses would be */
+		const int is_enabled = 1, idle_seconds = 30, check_interval_seconds = 10, maximum_checks = 2;
+		setsockopt(client_sockfd, SOL_SOCKET, SO_KEEPALIVE, &is_enabled, sizeof is_enabled);
+		setsockopt(client_sockfd, IPPROTO_TCP, TCP_KEEPIDLE, &idle_seconds, sizeof idle_seconds);
+		setsockopt(client_sockfd, IPPROTO_TCP, TCP_KEEPINTVL, &check_interval_seconds, sizeof check_interval_seconds);
+		setsockopt(client_sockfd, IPPROTO_TCP, TCP_KEEPCNT, &maximum_checks, sizeof maximum_checks);
+	}
+};
+
+
+/* ---- Handlers ---- */
+
+/* Sends every frame straight back to its sender. */
+struct echo_handler {
+	template<typename C>
+	void on_frame(C &core, int client_sockfd, const core_frame &frame) { core.send_frame(client_sockfd, frame.message_id, frame.payload); }
+};
+
+/* Sends every frame to every connected client, including its sender. */
+struct broadcast_handler {
+	template<typename C>
+	void on_frame(C &core, int, const core_frame &frame) { core.broadcast_frame(frame.message_id, frame.payload); }
+};
+
+/* Drops every frame without doing anything with it. */
+struct discard_handler {
+	template<typename C>
+	void on_frame(C&, int, const core_frame&) noexcept {}
+};
+
+
+/* ---- Runtime-configured policies ---- */
+
+/* The policies chosen by the 'runtime_*' policies, being set before the server is created. */
+enum class io_backend_type { poll, epoll, uring };
+enum class framing_type { text, binary };
+enum class liveness_type { pulse, keepalive };
+enum class handler_type { echo, broadcast, discard };
+
+struct runtime_settings {
+	static inline io_backend_type io_backend = io_backend_type::poll;
+	static inline framing_type framing = framing_type::text;
+	static inline liveness_type liveness = liveness_type::pulse;
+	static inline handler_type handler = handler_type::echo;
+};
+
+/* Chooses between every backend on each call. */
+class runtime_backend {
+public:
+	int init() noexcept { return dispatch([](auto &backend) { return backend.init(); }); }
+	void free() noexcept
+	{
+		poll_io_backend.free();
+		epoll_io_backend.free();
+		uring_io_backend.free();
+	}
+	int add(int sockfd, bool is_write_wanted) { return dispatch([&](auto &backend) { return backend.add(sockfd, is_write_wanted); }); }
+	int modify(int sockfd, bool is_write_wanted) { return dispatch([&](auto &backend) { return backend.modify(sockfd, is_write_wanted); }); }
+	int remove(int sockfd) { return dispatch([&](auto &backend) { return backend.remove(sockfd); }); }
+	template<typename F>
+	int wait(int timeout_milliseconds, F &&on_event) { return dispatch([&](auto &backend) { return backend.wait(timeout_milliseconds, on_event); }); }
+
+private:
+	template<typename F>
+	int dispatch(F &&backend_call)
+	{
+		switch (runtime_settings::io_backend) {
+			case io_backend_type::epoll: return backend_call(epoll_io_backend);
+			case io_backend_type::uring: return backend_call(uring_io_backend);
+			default: return backend_call(poll_io_backend);
+		}
+	}
+
+	poll_backend poll_io_backend;
+	epoll_backend epoll_io_backend;
+	uring_backend uring_io_backend;
+};
+
+/* Chooses between the text and binary framing on each call. */
+struct runtime_framing {
+	static constexpr uint8_t pulse_message_id = 3;
+	static_assert(text_framing::pulse_message_id == pulse_message_id && binary_framing::pulse_message_id == pulse_message_id);
+
+	static bool find_frame(struct network_message_reader *reader, core_frame &frame) noexcept
+	{
+		return runtime_settings::framing == framing_type::binary ? binary_framing::find_frame(reader, frame) : text_framing::find_frame(reader, frame);
+	}
+	static size_t get_frame_bytes(uint8_t message_id, std::string_view payload) noexcept
+	{
+		return runtime_settings::framing == framing_type::binary ?
+			binary_framing::get_frame_bytes(message_id, payload) : text_framing::get_frame_bytes(message_id, payload);
+	}
+	static char *encode_frame(uint8_t message_id, std::string_view payload, char *target_buffer) noexcept
+	{
+		return runtime_settings::framing == framing_type::binary ?
+			binary_framing::encode_frame(message_id, payload, target_buffer) : text_framing::encode_frame(message_id, payload, target_buffer);
+	}
+};
+
+/* Chooses between pulses and keepalive for each check. */
+struct runtime_liveness {
+	static bool is_pulsed() noexcept { return runtime_settings::liveness == liveness_type::pulse; }
+	static constexpr uint64_t pulse_interval_nanoseconds = pulse_liveness::pulse_interval_nanoseconds;
+	static constexpr uint8_t maximum_missed_pulses = pulse_liveness::maximum_missed_pulses;
+	static void configure_socket(int client_sockfd) noexcept
+	{
+		if (!is_pulsed()) keepalive_liveness::configure_socket(client_sockfd);
+	}
+};
+
+/* Chooses between echoing and discarding for each frame. */
+struct runtime_handler {
+	template<typename C>
+	void on_frame(C &core, int client_sockfd, const core_frame &frame)
+	{
+		if (runtime_settings::handler == handler_type::echo) echo_handler().on_frame(core, client_sockfd, frame);
+		else if (runtime_settings::handler == handler_type::broadcast) broadcast_handler().on_frame(core, client_sockfd, frame);
+	}
+};
+
+
+/* ---- Server core ---- */
+
+template<typename B, typename F, typename L, typename H>
+class server_core {
+public:
+	/* Most bytes waiting to be sent to a client before it is disconnected for falling behind */
+	static constexpr size_t maximum_outbound_bytes = 0x400000;
+
+	explicit server_core(H handler = H()) : frame_handler(std::move(handler))
+	{
+		check_error(io_backend.init(), "(Core) Failed to initialize I/O backend", 1);
+	}
+	server_core(const server_core&) = delete;
+	server_core &operator=(const server_core&) = delete;
+	~server_core()
+	{
+		for (size_t i = 0; i < connections.size(); ++i) {
+			if (connections[i].is_open) close_connection((int)i);
+		}
+		if (listen_sockfd != -1) close(listen_sockfd);
+		io_backend.free();
+	}
+
+	/* Opens the listening socket on the given port, returning it or -1 on failure. A shared port can be listened on by
+	   several cores at once (such as one for each thread), with the kernel spreading new clients between them. */
+	int listen(const char *listen_port, bool is_port_shared = false)
+	{
+		if ((listen_sockfd = is_port_shared ? open_shared_listening_socket(listen_port) : open_listening_socket(listen_port)) == -1) return -1;
+		fcntl(listen_sockfd, F_SETFL, fcntl(listen_sockfd, F_GETFL) | O_NONBLOCK);
+		if (check_error(io_backend.add(listen_sockfd, false), "(Core) Failed to add listening socket", 0) == -1) {
+			close(listen_sockfd);
+			return listen_sockfd = -1;
+		}
+		return listen_sockfd;
+	}
+
+	/* Has the handler's 'on_wake' called whenever the given socket is readable, such as an 'eventfd' written to by other
+	   threads to hand work to this core. The handler has to clear the socket's events. */
+	int set_wake_socket(int wake_sockfd)
+	{
+		if (check_error(io_backend.add(wake_sockfd, false), "(Core) Failed to add wake socket", 0) == -1) return -1;
+		this->wake_sockfd = wake_sockfd;
+		return 0;
+	}
+
+	/* Serves clients until 'stop' is called. */
+	void run()
+	{
+		uint64_t next_pulse_time = network_reactor_time() + L::pulse_interval_nanoseconds;
+		while (!is_stopped.load(std::memory_order_relaxed)) {
+			/* The wait is kept short so that a stop request is not missed for long */
+			int wait_milliseconds = 200;
+			if (L::is_pulsed()) {
+				const uint64_t current_time = network_reactor_time();
+				const uint64_t pulse_wait_milliseconds = next_pulse_time > current_time ? (next_pulse_time - current_time) / 1000000ULL : 0;
+				if (pulse_wait_milliseconds < (uint64_t)wait_milliseconds) wait_milliseconds = (int)pulse_wait_milliseconds;
+			}
+
+			if (io_backend.wait(wait_milliseconds, [this](int sockfd, bool is_readable, bool is_writable, bool is_closed) {
+				handle_event(sockfd, is_readable, is_writable, is_closed);
+			}) == -1 && errno != EINTR) {
+				check_error(-1, "(Core) Error encountered whilst waiting for events", 0);
+				break;
+			}
+
+			if (L::is_pulsed() && network_reactor_time() >= next_pulse_time) {
+				check_clients_pulse();
+				next_pulse_time = network_reactor_time() + L::pulse_interval_nanoseconds;
+			}
+			if constexpr (requires { frame_handler.on_round(*this); }) frame_handler.on_round(*this);
+		}
+	}
+
+	/* Has 'run' return as soon as possible, or straight away if called before it. Safe to call from a signal handler or
+	   another thread, though the core only notices it once it wakes up (which writing to the wake socket does). */
+	void stop() noexcept { is_stopped.store(true, std::memory_order_relaxed); }
+
+	/* Sends a frame to the given client, which is sent once the frame being handled (if any) is done with.
+	   Returns 0 on success and -1 if the client was disconnected. */
+	int send_frame(int client_sockfd, uint8_t message_id, std::string_view payload)
+	{
+		if ((size_t)client_sockfd >= connections.size() || !connections[(size_t)client_sockfd].is_open) return -1;
+		core_connection &connection = connections[(size_t)client_sockfd];
+
+		/* Sent data is removed from the start of the buffer once more than half of it was sent */
+		const size_t frame_bytes = F::get_frame_bytes(message_id, payload);
+		if (connection.outbound_start > connection.outbound_alloc_count / 2) {
+			connection.outbound_end -= connection.outbound_start;
+			std::memmove(connection.outbound_buffer, connection.outbound_buffer + connection.outbound_start, connection.outbound_end);
+			connection.outbound_start = 0;
+		}
+		if (connection.outbound_end + frame_bytes > connection.outbound_alloc_count) {
+			if (connection.outbound_end - connection.outbound_start + frame_bytes > maximum_outbound_bytes) {
+				close_connection(client_sockfd);
+				return -1;
+			}
+			size_t new_alloc_count = connection.outbound_alloc_count ? connection.outbound_alloc_count * 2 : 256;
+			while (new_alloc_count < connection.outbound_end + frame_bytes) new_alloc_count *= 2;
+			char *new_outbound_buffer = static_cast<char*>(std::realloc(connection.outbound_buffer, new_alloc_count));
+			if (check_error_null(new_outbound_buffer, "(Core) Failed to expand outbound buffer", 0) == -1) {
+				close_connection(client_sockfd);
+				return -1;
+			}
+			connection.outbound_buffer = new_outbound_buffer;
+			connection.outbound_alloc_count = new_alloc_count;
+		}
+		F::encode_frame(message_id, payload, connection.outbound_buffer + connection.outbound_end);
+		connection.outbound_end += frame_bytes;
+
+		/* Frames sent whilst handling a client's frames are sent together once they were all handled */
+		if (client_sockfd == handled_sockfd) return 0;
+		return flush_connection(client_sockfd);
+	}
+
+	/* Sends a frame to every connected client, as 'send_frame' does. */
+	void broadcast_frame(uint8_t message_id, std::string_view payload)
+	{
+		for (size_t i = 0; i < connections.size(); ++i) {
+			if (connections[i].is_open) send_frame((int)i, message_id, payload);
+		}
+	}
+
+	/* Serves a client accepted elsewhere (such as by another thread), which has to be non-blocking.
+	   Returns 0 on success and -1 on failure, leaving the socket to the caller to close. */
+	int add_connection(int client_sockfd)
+	{
+		if ((size_t)client_sockfd >= connections.size()) connections.resize((size_t)client_sockfd + 1);
+		if (connections[(size_t)client_sockfd].is_open || io_backend.add(client_sockfd, false) == -1) return -1;
+		L::configure_socket(client_sockfd);
+		connections[(size_t)client_sockfd].is_open = true;
+		++connections_count;
+		if constexpr (requires { frame_handler.on_open(*this, client_sockfd); }) frame_handler.on_open(*this, client_sockfd);
+		return 0;
+	}
+
+	/* Takes the given client out of the core without disconnecting it, along with its buffers, for another core to serve
+	   with 'attach_connection'. Neither of the handler's 'on_close' and 'on_open' are called, as the client stays
+	   connected. Returns 0 on success and -1 if it is not connected or its frames are being handled. */
+	int detach_connection(int client_sockfd, core_detached_connection &detached)
+	{
+		if (!is_connection_open(client_sockfd) || client_sockfd == handled_sockfd) return -1;
+		core_connection &connection = connections[(size_t)client_sockfd];
+		io_backend.remove(client_sockfd);
+		detached.client_sockfd = client_sockfd;
+		detached.missed_pulses_count = connection.missed_pulses_count;
+		detached.reader = connection.reader;
+		detached.outbound_buffer = connection.outbound_buffer;
+		detached.outbound_start = connection.outbound_start;
+		detached.outbound_end = connection.outbound_end;
+		detached.outbound_alloc_count = connection.outbound_alloc_count;
+		connection = core_connection();
+		--connections_count;
+		return 0;
+	}
+
+	/* Serves a client detached from another core, taking its buffers and sending what was waiting to be sent.
+	   Returns 0 on success and -1 on failure, leaving the client to the caller to close. A client that cannot be sent to
+	   is disconnected as it would be by 'send_frame'. */
+	int attach_connection(core_detached_connection &detached)
+	{
+		const int client_sockfd = detached.client_sockfd;
+		if ((size_t)client_sockfd >= connections.size()) connections.resize((size_t)client_sockfd + 1);
+		if (connections[(size_t)client_sockfd].is_open || io_backend.add(client_sockfd, false) == -1) return -1;
+
+		core_connection &connection = connections[(size_t)client_sockfd];
+		connection.is_open = true;
+		connection.missed_pulses_count = detached.missed_pulses_count;
+		connection.reader = detached.reader;
+		connection.outbound_buffer = detached.outbound_buffer;
+		connection.outbound_start = detached.outbound_start;
+		connection.outbound_end = detached.outbound_end;
+		connection.outbound_alloc_count = detached.outbound_alloc_count;
+		detached = core_detached_connection();
+		++connections_count;
+		flush_connection(client_sockfd);
+		return 0;
+	}
+
+	/* Disconnects the given client. */
+	void close_connection(int client_sockfd)
+	{
+		if ((size_t)client_sockfd >= connections.size() || !connections[(size_t)client_sockfd].is_open) return;
+		if constexpr (requires { frame_handler.on_close(*this, client_sockfd); }) frame_handler.on_close(*this, client_sockfd);
+		core_connection &connection = connections[(size_t)client_sockfd];
+		io_backend.remove(client_sockfd);
+		close(client_sockfd);
+		std::free(connection.reader.reader_buffer);
+		std::free(connection.outbound_buffer);
+		connection = core_connection();
+		--connections_count;
+	}
+
+	/* Returns true if the given client is connected to this core. */
+	bool is_connection_open(int client_sockfd) const noexcept
+	{
+		return (size_t)client_sockfd < connections.size() && connections[(size_t)client_sockfd].is_open;
+	}
+	/* Returns the number of connected clients. */
+	size_t get_connections_count() const noexcept { return connections_count; }
+	/* Returns the number of bytes recieved from every client since the core was created. */
+	uint64_t get_recieved_bytes_count() const noexcept { return recieved_bytes_count; }
+	/* Returns the handler given the frames of clients. */
+	H &get_handler() noexcept { return frame_handler; }
+
+private:
+	struct core_connection {
+		bool is_open = false, is_write_wanted = false;
+		uint8_t missed_pulses_count = 0;
+		struct network_message_reader reader = {};
+		char *outbound_buffer = nullptr; /* Data waiting to be sent, being from the start to the end index */
+		size_t outbound_start = 0, outbound_end = 0, outbound_alloc_count = 0;
+	};
+
+	void handle_event(int sockfd, bool is_readable, bool is_writable, bool is_closed)
+	{
+		if (sockfd == listen_sockfd) {
+			accept_connections();
+			return;
+		}
+		if (sockfd == wake_sockfd) {
+			if constexpr (requires { frame_handler.on_wake(*this); }) frame_handler.on_wake(*this);
+			return;
+		}
+		if ((size_t)sockfd >= connections.size() || !connections[(size_t)sockfd].is_open) return;
+		if (is_writable && flush_connection(sockfd) == -1) return;
+		if (is_readable || is_closed) read_connection(sockfd);
+	}
+
+	void accept_connections()
+	{
+		/* Only some clients are accepted at once so that connected clients are not kept waiting */
+		for (int i = 0; i < 64; ++i) {
+			const int client_sockfd = accept4(listen_sockfd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+			if (client_sockfd == -1) return;
+			if (add_connection(client_sockfd) == -1) close(client_sockfd);
+		}
+	}
+
+	void read_connection(int client_sockfd)
+	{
+		core_connection *connection = &connections[(size_t)client_sockfd];
+		const ssize_t total_bytes_recieved = read_network_messages(&connection->reader, client_sockfd, MSG_DONTWAIT);
+		if (total_bytes_recieved == 0 || (total_bytes_recieved == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+			close_connection(client_sockfd);
+			return;
+		}
+		if (total_bytes_recieved > 0) {
+			recieved_bytes_count += (uint64_t)total_bytes_recieved;
+			if (L::is_pulsed()) connection->missed_pulses_count = 0;
+		}
+
+		/* Each frame is removed before it is handled, as the handler could disconnect the client */
+		handled_sockfd = client_sockfd;
+		core_frame frame;
+		while (F::find_frame(&connection->reader, frame)) {
+			connection->reader.buffer_start += frame.frame_bytes;
+			if (frame.message_id == F::pulse_message_id) continue; /* Only shows the client is still connected */
+
+			frame_handler.on_frame(*this, client_sockfd, frame);
+			if (!connections[(size_t)client_sockfd].is_open) {
+				handled_sockfd = -1;
+				return;
+			}
+			connection = &connections[(size_t)client_sockfd];
+		}
+		handled_sockfd = -1;
+
+		/* A full buffer without a complete frame holds a frame too large to ever be recieved */
+		if (connection->reader.buffer_start == 0 && connection->reader.buffer_end >= NETWORK_MAXIMUM_MESSAGE_BYTES) {
+			close_connection(client_sockfd);
+			return;
+		}
+		flush_connection(client_sockfd);
+	}
+
+	/* Sends as much waiting data as possible, waiting to send the rest once the client can take more.
+	   Returns 0 on success and -1 if the client was disconnected. */
+	int flush_connection(int client_sockfd)
+	{
+		core_connection &connection = connections[(size_t)client_sockfd];
+		while (connection.outbound_start < connection.outbound_end) {
+			const ssize_t total_bytes_sent = send(
+				client_sockfd,
+				connection.outbound_buffer + connection.outbound_start,
+				connection.outbound_end - connection.outbound_start,
+				MSG_DONTWAIT | MSG_NOSIGNAL
+			);
+			if (total_bytes_sent == -1) {
+				if (errno == EINTR) continue;
+				if (errno != EAGAIN && errno != EWOULDBLOCK) {
+					close_connection(client_sockfd);
+					return -1;
+				}
+				break;
+			}
+			connection.outbound_start += (size_t)total_bytes_sent;
+		}
+
+		const bool is_write_wanted = connection.outbound_start < connection.outbound_end;
+		if (!is_write_wanted) connection.outbound_start = connection.outbound_end = 0;
+		if (is_write_wanted != connection.is_write_wanted) {
+			connection.is_write_wanted = is_write_wanted;
+			io_backend.modify(client_sockfd, is_write_wanted);
+		}
+		return 0;
+	}
+
+	/* Disconnects clients that missed too many pulses, and sends the next pulse to the rest */
+	void check_clients_pulse()
+	{
+		for (size_t i = 0; i < connections.size(); ++i) {
+			if (!connections[i].is_open) continue;
+			if (connections[i].missed_pulses_count >= L::maximum_missed_pulses) close_connection((int)i);
+			else {
+				++connections[i].missed_pulses_count;
+				send_frame((int)i, F::pulse_message_id, std::string_view());
+			}
+		}
+	}
+
+	B io_backend;
+	H frame_handler;
+	int listen_sockfd = -1, wake_sockfd = -1, handled_sockfd = -1; /* Client whose frames are being handled, if any */
+	std::vector<core_connection> connections; /* Indexed by socket */
+	size_t connections_count = 0;
+	uint64_t recieved_bytes_count = 0;
+	std::atomic<bool> is_stopped = false;
+};
+
+} /* namespace network::core */
+
+#endif /* NETWORK_DEMO_SERVER_CORE_HPP */
@@ -0,0 +1,947 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#pragma once
+#ifndef NETWORK_DEMO_SERVER_GROUP_HPP
+#define NETWORK_DEMO_SERVER_GROUP_HPP
+
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "network_shared.h"
+#include "network_epoch.hpp"
+#include "network_mesh.hpp"
+#include "network_server_core.hpp"
+
+/*
+   Several server cores with the same policies, each run on a thread of its own (a shard) and listening on the same port,
+   with the kernel spreading new clients between them:
+
+	network::core::server_group<network::core::epoll_backend, network::core::text_framing,
+		network::core::pulse_liveness, network::core::broadcast_handler> chat_group(4);
+	if (chat_group.listen("5000") == -1) return EXIT_FAILURE;
+	chat_group.run();
+
+   The handler of each shard is given the shard rather than its core, whose 'send_frame' and 'close_connection' take any
+   client of the group and whose 'broadcast_frame' sends to every client of the group. Frames for clients on other shards
+   are handed to those shards through a mesh of rings between every pair of shards (see 'network_mesh.hpp'), which the
+   shards send on their own threads. Each shard makes what it handed over visible once per round, waking each shard it
+   handed anything to at most once. Threads other than the shards share one more node of the mesh, taking a lock.
+
+   Each shard publishes the sorted list of its clients after every round in which it changed. Any thread can read the
+   lists without taking a lock (see 'network_epoch.hpp'), such as to find the shard a client is on or to count every
+   client, whilst lists replaced in the meantime are only freed once nothing is reading them. A client that just
+   disconnected can still be listed until its shard's next round, and frames handed over for it are then dropped.
+
+   Clients are spread between the shards by the kernel hashing their addresses, which is uneven when many clients share
+   an address (such as from behind NAT). The group can instead listen with a thread of its own that accepts every client
+   and hands each to the shard with the least load, as published by the shards after every round in which it changed:
+	chat_group.listen("5000", network::core::connection_balance::least_recieved_bytes);
+
+   A client can also be moved to another shard whilst connected, once the shards' numbers of clients differ by more than
+   a threshold given to 'set_rebalance_threshold' (checked by each shard once a second) or when asked to with
+   'migrate_connection'. The client is moved between its frames, with its buffers, in steps that keep every message from
+   each thread to it in order and sent once:
+	1. Its shard takes it out of its core and hands it to the new shard, handing on anything sent to it afterwards.
+	2. The new shard lists it, holding anything sent to it by others, and tells the previous shard.
+	3. The previous shard unlists it and asks every other shard to acknowledge, which they do once they can no longer
+	   send to it through the previous shard. Threads outside the group are known to once the previous shard takes the
+	   lock they share.
+	4. The previous shard then seals the client, giving the broadcasts from each thread it already sent or handed on,
+	   and the new shard serves it, sending what it held besides broadcasts that were already sent.
+   A client being moved is briefly listed by both shards, and only one shard moves clients at a time.
+*/
+
+namespace network::core {
+
+/* How new clients are spread between the shards of a group. */
+enum class connection_balance {
+	reuseport, /* Each shard listens on the port, with the kernel choosing the shard by the client's address */
+	least_connections, /* An acceptor thread chooses the shard with the fewest clients */
+	least_recieved_bytes /* An acceptor thread chooses the shard that recieved the least data recently */
+};
+
+template<typename B, typename F, typename L, typename H>
+class server_group {
+	/* Kinds of work handed to a shard by other threads */
+	enum class posted_message_type : uint32_t {
+		frame, broadcast, close, adopt,
+		migrate_request, migrate, listed, fence, fence_acknowledged, sealed /* Steps of moving a client between shards */
+	};
+
+public:
+	class shard;
+
+	explicit server_group(size_t shards_count, const H &handler = H()) : shard_mesh(shards_count + 1)
+	{
+		for (size_t i = 0; i < shards_count; ++i) shards.push_back(std::make_unique<shard>(*this, i, handler));
+	}
+	server_group(const server_group&) = delete;
+	server_group &operator=(const server_group&) = delete;
+	~server_group()
+	{
+		if (acceptor_sockfd != -1) close(acceptor_sockfd);
+		if (acceptor_wake_fd != -1) close(acceptor_wake_fd);
+	}
+
+	/* Listens on the given port, either with every shard listening on it or with a socket of the acceptor thread, as
+	   given by the balance. Returns 0 on success and -1 on failure. */
+	int listen(const char *listen_port, connection_balance balance = connection_balance::reuseport)
+	{
+		if (balance == connection_balance::reuseport) {
+			for (std::unique_ptr<shard> &group_shard : shards) {
+				if (group_shard->core.listen(listen_port, true) == -1) return -1;
+			}
+			return 0;
+		}
+
+		if ((acceptor_sockfd = open_listening_socket(listen_port)) == -1) return -1;
+		fcntl(acceptor_sockfd, F_SETFL, fcntl(acceptor_sockfd, F_GETFL) | O_NONBLOCK);
+		if (check_error(acceptor_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), "(Group) Failed to create acceptor doorbell", 0) == -1) {
+			close(acceptor_sockfd);
+			return acceptor_sockfd = -1;
+		}
+		acceptor_balance = balance;
+		return 0;
+	}
+
+	/* Runs every shard on a thread of its own (and the acceptor on another, if listening with one) until 'stop' is called. */
+	void run()
+	{
+		std::vector<std::thread> group_threads;
+		for (std::unique_ptr<shard> &group_shard : shards) group_threads.emplace_back([&group_shard] { group_shard->run(); });
+		if (acceptor_sockfd != -1) group_threads.emplace_back([this] { run_acceptor(); });
+		for (std::thread &group_thread : group_threads) group_thread.join();
+	}
+
+	/* Has every shard stop as soon as possible. Safe to call from a signal handler or any thread. */
+	void stop() noexcept
+	{
+		for (std::unique_ptr<shard> &group_shard : shards) group_shard->stop();
+		is_acceptor_stopped.store(true, std::memory_order_relaxed);
+		if (acceptor_wake_fd != -1) {
+			const uint64_t doorbell_count = 1;
+			if (write(acceptor_wake_fd, &doorbell_count, sizeof doorbell_count) == -1) return;
+		}
+	}
+
+	/* The following can be called from any thread, including those of the shards. */
+
+	/* Returns the number of shards in the group. */
+	size_t get_shards_count() const noexcept { return shards.size(); }
+
+	/* Returns the number of clients connected to every shard, as last published by each shard. */
+	size_t get_connections_count()
+	{
+		epoch_guard guard(directory_domain);
+		size_t connections_count = 0;
+		for (const std::unique_ptr<shard> &group_shard : shards) {
+			if (const std::vector<int> *shard_sockfds = group_shard->directory.read()) connections_count += shard_sockfds->size();
+		}
+		return connections_count;
+	}
+
+	/* Calls the given function with the index of the shard and the socket of every client connected to the group. */
+	template<typename C>
+	void for_each_connection(C &&on_connection)
+	{
+		epoch_guard guard(directory_domain);
+		for (size_t i = 0; i < shards.size(); ++i) {
+			const std::vector<int> *shard_sockfds = shards[i]->directory.read();
+			if (shard_sockfds == nullptr) continue;
+			for (const int client_sockfd : *shard_sockfds) on_connection(i, client_sockfd);
+		}
+	}
+
+	/* Returns the index of the shard the given client is connected to, or -1 if it is not connected. */
+	int find_connection_shard(int client_sockfd)
+	{
+		epoch_guard guard(directory_domain);
+		return find_listed_shard(client_sockfd);
+	}
+
+	/* Has the shard of the given client send it a frame, returning 0 on success and -1 if it is not connected. */
+	int send_frame(int client_sockfd, uint8_t message_id, std::string_view payload)
+	{
+		return post_external(posted_message_type::frame, client_sockfd, message_id, payload);
+	}
+
+	/* Has every shard send a frame to all of its clients. */
+	void broadcast_frame(uint8_t message_id, std::string_view payload)
+	{
+		std::lock_guard<std::mutex> external_lock(external_mutex);
+		const uint32_t broadcast_sequence = ++external_broadcast_sequence;
+		for (size_t i = 0; i < shards.size(); ++i) {
+			shard_mesh.send(shards.size(), i, (uint32_t)posted_message_type::broadcast, (int32_t)broadcast_sequence, message_id, payload);
+		}
+		flush_external_messages();
+	}
+
+	/* Has the shard of the given client disconnect it, returning 0 on success and -1 if it is not connected. */
+	int close_connection(int client_sockfd)
+	{
+		return post_external(posted_message_type::close, client_sockfd, 0, std::string_view());
+	}
+
+	/* Has the shard of the given client move it to the given shard, returning 0 on success and -1 if it is not connected
+	   or there is no such shard. A client already being moved is left where it is going. */
+	int migrate_connection(int client_sockfd, size_t to_shard_index)
+	{
+		if (to_shard_index >= shards.size()) return -1;
+		return post_external(posted_message_type::migrate_request, client_sockfd, (uint32_t)to_shard_index, std::string_view());
+	}
+
+	/* Has shards move clients to the shard with the fewest clients whenever they have more than the given number of
+	   clients more than it, or never if 0 (as by default). */
+	void set_rebalance_threshold(size_t connections_difference) noexcept
+	{
+		rebalance_threshold.store(connections_difference, std::memory_order_relaxed);
+	}
+
+	/* A core of the group with the thread running it, given to its handler as the core the frames were recieved on. */
+	class shard {
+	public:
+		shard(server_group &owner_group, size_t shard_index, const H &handler) :
+			owner_group(owner_group), shard_index(shard_index), frame_handler(handler), core(shard_handler{ this })
+		{
+			/* Each shard reads the directory with a slot of its own, rather than claiming one every time */
+			if ((reader_id = owner_group.directory_domain.register_reader()) == -1) {
+				std::fprintf(stderr, "(Group) Too many shards, at most %zu can be run.\n", epoch_domain::maximum_readers);
+				std::exit(EXIT_FAILURE);
+			}
+			check_error(core.set_wake_socket(owner_group.shard_mesh.get_doorbell_socket(shard_index)), "(Group) Failed to add doorbell", 1);
+			recieved_broadcast_sequences.assign(owner_group.shard_mesh.get_nodes_count(), 0);
+		}
+		shard(const shard&) = delete;
+		shard &operator=(const shard&) = delete;
+		~shard()
+		{
+			for (incoming_migration &migration : incoming_migrations) migration.connection.close_connection();
+			owner_group.directory_domain.unregister_reader(reader_id);
+		}
+
+		/* Returns the index of the shard in its group. */
+		size_t get_shard_index() const noexcept { return shard_index; }
+		/* Returns the group the shard is part of. */
+		server_group &get_group() noexcept { return owner_group; }
+		/* Returns the handler given the frames of the shard's clients. */
+		H &get_handler() noexcept { return frame_handler; }
+
+		/* Sends a frame to any client of the group, straight away if it is connected to this shard and otherwise by its
+		   own shard. Returns 0 on success and -1 if the client is not connected or was disconnected. */
+		int send_frame(int client_sockfd, uint8_t message_id, std::string_view payload)
+		{
+			if (core.is_connection_open(client_sockfd)) return core.send_frame(client_sockfd, message_id, payload);
+			if (is_connection_migrating(client_sockfd)) {
+				deliver_frame(shard_index, client_sockfd, message_id, payload);
+				return 0;
+			}
+
+			epoch_guard guard(owner_group.directory_domain, reader_id);
+			const int client_shard_index = owner_group.find_listed_shard(client_sockfd);
+			if (client_shard_index == -1 || (size_t)client_shard_index == shard_index) return -1;
+			post((size_t)client_shard_index, posted_message_type::frame, client_sockfd, message_id, payload);
+			return 0;
+		}
+
+		/* Sends a frame to every client of the group, with each shard sending it to its own clients. */
+		void broadcast_frame(uint8_t message_id, std::string_view payload)
+		{
+			recieved_broadcast_sequences[shard_index] = ++broadcast_sequence;
+			core.broadcast_frame(message_id, payload);
+			for (incoming_migration &migration : incoming_migrations) {
+				migration.held_messages.push_back({ posted_message_type::broadcast, message_id, shard_index, broadcast_sequence, std::string(payload) });
+			}
+			for (size_t i = 0; i < owner_group.shards.size(); ++i) {
+				if (i != shard_index) post(i, posted_message_type::broadcast, (int32_t)broadcast_sequence, message_id, payload);
+			}
+		}
+
+		/* Disconnects any client of the group. */
+		void close_connection(int client_sockfd)
+		{
+			if (core.is_connection_open(client_sockfd)) {
+				core.close_connection(client_sockfd);
+				return;
+			}
+			if (is_connection_migrating(client_sockfd)) {
+				deliver_close(shard_index, client_sockfd);
+				return;
+			}
+
+			epoch_guard guard(owner_group.directory_domain, reader_id);
+			const int client_shard_index = owner_group.find_listed_shard(client_sockfd);
+			if (client_shard_index != -1 && (size_t)client_shard_index != shard_index) {
+				post((size_t)client_shard_index, posted_message_type::close, client_sockfd, 0, std::string_view());
+			}
+		}
+
+		/* Moves any client of the group to the given shard once the current round ends, as the group's
+		   'migrate_connection' does. Returns 0 on success and -1 if it is not connected or there is no such shard. */
+		int migrate_connection(int client_sockfd, size_t to_shard_index)
+		{
+			if (to_shard_index >= owner_group.shards.size()) return -1;
+			if (core.is_connection_open(client_sockfd)) {
+				if (to_shard_index != shard_index) requested_migrations.push_back({ client_sockfd, to_shard_index });
+				return 0;
+			}
+			if (is_connection_migrating(client_sockfd)) return 0;
+
+			epoch_guard guard(owner_group.directory_domain, reader_id);
+			const int client_shard_index = owner_group.find_listed_shard(client_sockfd);
+			if (client_shard_index == -1 || (size_t)client_shard_index == shard_index) return -1;
+			post((size_t)client_shard_index, posted_message_type::migrate_request, client_sockfd, (uint32_t)to_shard_index, std::string_view());
+			return 0;
+		}
+
+		/* Returns the number of clients connected to every shard of the group. */
+		size_t get_connections_count()
+		{
+			epoch_guard guard(owner_group.directory_domain, reader_id);
+			size_t connections_count = 0;
+			for (const std::unique_ptr<shard> &group_shard : owner_group.shards) {
+				if (const std::vector<int> *shard_sockfds = group_shard->directory.read()) connections_count += shard_sockfds->size();
+			}
+			return connections_count;
+		}
+
+	private:
+		friend class server_group;
+
+		/* Given to the core, handing its frames and events to the shard */
+		struct shard_handler {
+			shard *owner_shard;
+
+			template<typename C>
+			void on_frame(C&, int client_sockfd, const core_frame &frame) { owner_shard->frame_handler.on_frame(*owner_shard, client_sockfd, frame); }
+			template<typename C>
+			void on_open(C&, int client_sockfd) { owner_shard->add_directory_entry(client_sockfd); }
+			template<typename C>
+			void on_close(C&, int client_sockfd) { owner_shard->remove_directory_entry(client_sockfd); }
+			template<typename C>
+			void on_wake(C&) { owner_shard->handle_posted_messages(); }
+			template<typename C>
+			void on_round(C&)
+			{
+				owner_shard->check_rebalance();
+				owner_shard->start_requested_migrations();
+				owner_shard->publish_directory();
+				owner_shard->fence_unlisted_migrations();
+				owner_shard->acknowledge_external_fences();
+				owner_shard->publish_load();
+				owner_shard->owner_group.shard_mesh.flush(owner_shard->shard_index);
+			}
+		};
+
+		/* A message for a client being moved to this shard, held until it is served here */
+		struct held_message {
+			posted_message_type message_type; /* Frames, broadcasts and disconnects */
+			uint8_t message_id;
+			size_t from_node;
+			uint32_t broadcast_sequence;
+			std::string payload;
+		};
+
+		/* A client being moved to another shard, to which anything sent to it is handed on until it is sealed */
+		struct outgoing_migration {
+			int client_sockfd;
+			size_t to_shard_index;
+			bool is_unlisted, is_fenced; /* Unlisted by this shard, and every other shard asked to acknowledge since */
+			bool is_external_sequence_known; /* Last broadcast of other threads known, though not yet handed on */
+			std::vector<unsigned char> acknowledged_nodes;
+			std::vector<uint32_t> acknowledged_broadcast_sequences; /* Last broadcast of each node sent or handed on */
+		};
+
+		/* A client being moved to this shard, whose messages are held until its previous shard sealed it. Those handed
+		   on by the previous shard were sent to it beforehand, so are sent first. */
+		struct incoming_migration {
+			int client_sockfd;
+			size_t from_shard_index;
+			core_detached_connection connection;
+			bool is_sealed;
+			std::vector<uint32_t> acknowledged_broadcast_sequences;
+			std::vector<held_message> forwarded_messages, held_messages;
+		};
+
+		/* Load of the shard read by the acceptor, on a cache line of its own as it is written every round it changes */
+		struct alignas(64) shard_load {
+			std::atomic<size_t> connections_count{ 0 };
+			std::atomic<uint64_t> recieved_bytes_count{ 0 };
+			std::atomic<size_t> adopted_count{ 0 }; /* Clients handed over by the acceptor so far */
+		};
+
+		void run()
+		{
+			publish_directory();
+			core.run();
+		}
+
+		/* Safe to call from a signal handler, as waking the shard only writes to its doorbell */
+		void stop() noexcept
+		{
+			core.stop();
+			owner_group.shard_mesh.wake(shard_index);
+		}
+
+		/* Hands work to another shard, which it recieves once this shard's round ends */
+		void post(size_t to_shard_index, posted_message_type message_type, int client_sockfd, uint32_t message_argument, std::string_view payload)
+		{
+			owner_group.shard_mesh.send(shard_index, to_shard_index, (uint32_t)message_type, client_sockfd, message_argument, payload);
+		}
+
+		void handle_posted_messages()
+		{
+			owner_group.shard_mesh.recieve(shard_index, [this](size_t from_node, const mesh_message &message) {
+				const int client_sockfd = message.message_target;
+				const uint8_t message_id = (uint8_t)message.message_argument;
+				switch ((posted_message_type)message.message_type) {
+					case posted_message_type::frame: deliver_frame(from_node, client_sockfd, message_id, message.message_data); break;
+					case posted_message_type::broadcast: deliver_broadcast(from_node, (uint32_t)client_sockfd, message_id, message.message_data); break;
+					case posted_message_type::close: deliver_close(from_node, client_sockfd); break;
+					case posted_message_type::adopt:
+						if (core.add_connection(client_sockfd) == -1) close(client_sockfd);
+						++adopted_count;
+						break;
+					case posted_message_type::migrate_request:
+						if (core.is_connection_open(client_sockfd) && message.message_argument != shard_index) {
+							requested_migrations.push_back({ client_sockfd, message.message_argument });
+						}
+						break;
+					case posted_message_type::migrate: adopt_migration(from_node, message.message_data); break;
+					case posted_message_type::listed: fence_migration(client_sockfd); break;
+					case posted_message_type::fence:
+						post(from_node, posted_message_type::fence_acknowledged, client_sockfd, broadcast_sequence, std::string_view());
+						break;
+					case posted_message_type::fence_acknowledged: acknowledge_migration(client_sockfd, from_node, message.message_argument); break;
+					case posted_message_type::sealed: seal_migration(client_sockfd, message.message_data); break;
+				}
+			});
+			release_migrations();
+		}
+
+		/* Sends a frame from the given node to a client of this shard, or one being moved to or from it */
+		void deliver_frame(size_t from_node, int client_sockfd, uint8_t message_id, std::string_view payload)
+		{
+			if (core.is_connection_open(client_sockfd)) core.send_frame(client_sockfd, message_id, payload);
+			else if (incoming_migration *migration = find_incoming_migration(client_sockfd)) {
+				(from_node == migration->from_shard_index ? migration->forwarded_messages : migration->held_messages)
+					.push_back({ posted_message_type::frame, message_id, from_node, 0, std::string(payload) });
+			}
+			else if (outgoing_migration *migration = find_outgoing_migration(client_sockfd)) {
+				post(migration->to_shard_index, posted_message_type::frame, client_sockfd, message_id, payload);
+			}
+		}
+
+		void deliver_close(size_t from_node, int client_sockfd)
+		{
+			if (core.is_connection_open(client_sockfd)) core.close_connection(client_sockfd);
+			else if (incoming_migration *migration = find_incoming_migration(client_sockfd)) {
+				(from_node == migration->from_shard_index ? migration->forwarded_messages : migration->held_messages)
+					.push_back({ posted_message_type::close, 0, from_node, 0, std::string() });
+			}
+			else if (outgoing_migration *migration = find_outgoing_migration(client_sockfd)) {
+				post(migration->to_shard_index, posted_message_type::close, client_sockfd, 0, std::string_view());
+			}
+		}
+
+		/* Broadcasts are numbered by the node sending them, so that a client being moved is sent each one once: the
+		   previous shard sends those sent before each node acknowledged the move, and this shard the rest. */
+		void deliver_broadcast(size_t from_node, uint32_t broadcast_sequence, uint8_t message_id, std::string_view payload)
+		{
+			recieved_broadcast_sequences[from_node] = broadcast_sequence;
+			core.broadcast_frame(message_id, payload);
+			for (incoming_migration &migration : incoming_migrations) {
+				if (from_node == migration.from_shard_index) {
+					migration.forwarded_messages.push_back({ posted_message_type::frame, message_id, from_node, 0, std::string(payload) });
+				}
+				else migration.held_messages.push_back({ posted_message_type::broadcast, message_id, from_node, broadcast_sequence, std::string(payload) });
+			}
+			for (const outgoing_migration &migration : outgoing_migrations) {
+				const bool is_sequence_known = migration.acknowledged_nodes[from_node] ||
+					(from_node == owner_group.shards.size() && migration.is_external_sequence_known);
+				if (!is_sequence_known || is_sequence_reached(migration.acknowledged_broadcast_sequences[from_node], broadcast_sequence)) {
+					post(migration.to_shard_index, posted_message_type::frame, migration.client_sockfd, message_id, payload);
+				}
+			}
+		}
+
+		bool is_connection_migrating(int client_sockfd) noexcept
+		{
+			return find_incoming_migration(client_sockfd) != nullptr || find_outgoing_migration(client_sockfd) != nullptr;
+		}
+		incoming_migration *find_incoming_migration(int client_sockfd) noexcept
+		{
+			for (incoming_migration &migration : incoming_migrations) {
+				if (migration.client_sockfd == client_sockfd) return &migration;
+			}
+			return nullptr;
+		}
+		outgoing_migration *find_outgoing_migration(int client_sockfd) noexcept
+		{
+			for (outgoing_migration &migration : outgoing_migrations) {
+				if (migration.client_sockfd == client_sockfd) return &migration;
+			}
+			return nullptr;
+		}
+
+		/* Once a second, moves up to half the difference in clients to the shard with the fewest, if it exceeds the
+		   group's threshold and no clients are still being moved from this shard */
+		void check_rebalance()
+		{
+			const size_t rebalance_threshold = owner_group.rebalance_threshold.load(std::memory_order_relaxed);
+			if (rebalance_threshold == 0 || !outgoing_migrations.empty() || !requested_migrations.empty()) return;
+			const uint64_t current_time = network_reactor_time();
+			if (current_time < next_rebalance_time) return;
+			next_rebalance_time = current_time + 1000000000ULL;
+
+			size_t least_loaded_shard_index = shard_index, least_connections_count = core.get_connections_count();
+			for (size_t i = 0; i < owner_group.shards.size(); ++i) {
+				const size_t connections_count = owner_group.shards[i]->load.connections_count.load(std::memory_order_relaxed);
+				if (i != shard_index && connections_count < least_connections_count) {
+					least_loaded_shard_index = i;
+					least_connections_count = connections_count;
+				}
+			}
+			if (core.get_connections_count() <= least_connections_count + rebalance_threshold) return;
+
+			const size_t moved_count = std::min<size_t>((core.get_connections_count() - least_connections_count) / 2, 64);
+			for (size_t i = 0; i < open_sockfds.size() && requested_migrations.size() < moved_count; ++i) {
+				if (core.is_connection_open(open_sockfds[i])) requested_migrations.push_back({ open_sockfds[i], least_loaded_shard_index });
+			}
+		}
+
+		/* Step 1: takes each client asked to be moved out of the core, between its frames as every frame recieved this
+		   round was handled, and hands it to its new shard */
+		void start_requested_migrations()
+		{
+			/* Only one shard moves clients at a time, until its moves are sealed, as a client being moved could
+			   otherwise send to one that is being moved too through a shard its new shard has not yet been fenced by.
+			   Clients asked to be moved meanwhile are moved once this shard gets its turn. */
+			if (requested_migrations.empty()) return;
+			bool is_moving = false;
+			if (outgoing_migrations.empty() && !owner_group.is_migration_running.compare_exchange_strong(is_moving, true, std::memory_order_acquire)) return;
+
+			for (const std::pair<int, size_t> &requested_migration : requested_migrations) {
+				const int client_sockfd = requested_migration.first;
+				core_detached_connection *detached_connection = new core_detached_connection();
+				if (core.detach_connection(client_sockfd, *detached_connection) == -1) {
+					delete detached_connection;
+					continue;
+				}
+
+				/* This shard's own broadcasts before now were sent to it, and later ones reach the new shard after it */
+				const size_t nodes_count = owner_group.shard_mesh.get_nodes_count();
+				outgoing_migration migration = { client_sockfd, requested_migration.second, false, false, false,
+					std::vector<unsigned char>(nodes_count, 0), std::vector<uint32_t>(nodes_count, 0) };
+				migration.acknowledged_nodes[shard_index] = 1;
+				migration.acknowledged_broadcast_sequences[shard_index] = broadcast_sequence;
+				outgoing_migrations.push_back(std::move(migration));
+
+				/* Only the address of the connection is handed over, the shards sharing the process */
+				post(requested_migration.second, posted_message_type::migrate, client_sockfd, 0,
+					std::string_view(reinterpret_cast<const char*>(&detached_connection), sizeof detached_connection));
+			}
+			requested_migrations.clear();
+			if (outgoing_migrations.empty()) owner_group.is_migration_running.store(false, std::memory_order_release);
+		}
+
+		/* Step 2: lists a client handed over by another shard, holding its messages, and tells the previous shard */
+		void adopt_migration(size_t from_node, std::string_view migration_data)
+		{
+			core_detached_connection *detached_connection;
+			std::memcpy(&detached_connection, migration_data.data(), sizeof detached_connection);
+			const int client_sockfd = detached_connection->client_sockfd;
+			incoming_migrations.push_back({ client_sockfd, from_node, *detached_connection, false, {}, {}, {} });
+			delete detached_connection;
+
+			add_directory_entry(client_sockfd);
+			post(from_node, posted_message_type::listed, client_sockfd, 0, std::string_view());
+		}
+
+		/* Step 3: unlists a client once its new shard lists it */
+		void fence_migration(int client_sockfd)
+		{
+			outgoing_migration *migration = find_outgoing_migration(client_sockfd);
+			if (migration == nullptr) return;
+			remove_directory_entry(client_sockfd);
+			migration->is_unlisted = true;
+		}
+
+		/* Asks every other shard to acknowledge the clients unlisted since, only once the directory without them was
+		   published so that shards acknowledging can no longer find them on this shard */
+		void fence_unlisted_migrations()
+		{
+			for (outgoing_migration &migration : outgoing_migrations) {
+				if (!migration.is_unlisted || migration.is_fenced) continue;
+				migration.is_fenced = true;
+				for (size_t i = 0; i < owner_group.shards.size(); ++i) {
+					if (i != shard_index) post(i, posted_message_type::fence, migration.client_sockfd, 0, std::string_view());
+				}
+			}
+		}
+
+		/* Other shards acknowledge once they recieve the request, after which they find the client on its new shard */
+		void acknowledge_migration(int client_sockfd, size_t from_node, uint32_t broadcast_sequence)
+		{
+			outgoing_migration *migration = find_outgoing_migration(client_sockfd);
+			if (migration == nullptr) return;
+			migration->acknowledged_nodes[from_node] = 1;
+			migration->acknowledged_broadcast_sequences[from_node] = broadcast_sequence;
+			seal_acknowledged_migrations();
+		}
+
+		/* Threads outside the group find the shard of a client and hand it messages whilst holding their shared lock, so
+		   once the unlisted directory was published, taking the lock means every message they sent through this shard
+		   is in its rings. Those are then handed on, including the broadcasts up to the last one sent before the lock
+		   was taken. The lock is only tried, as they may be waiting for this shard to make space in the rings. */
+		void acknowledge_external_fences()
+		{
+			const size_t external_node = owner_group.shards.size();
+			std::vector<int> acknowledged_sockfds;
+			for (outgoing_migration &migration : outgoing_migrations) {
+				if (!migration.is_fenced || migration.is_external_sequence_known) continue;
+				std::unique_lock<std::mutex> external_lock(owner_group.external_mutex, std::try_to_lock);
+				if (!external_lock.owns_lock()) {
+					owner_group.shard_mesh.wake(shard_index);
+					break;
+				}
+				migration.is_external_sequence_known = true;
+				migration.acknowledged_broadcast_sequences[external_node] = owner_group.external_broadcast_sequence;
+				acknowledged_sockfds.push_back(migration.client_sockfd);
+			}
+			if (acknowledged_sockfds.empty()) return;
+
+			/* Only acknowledged once handed on, so that the clients are not sealed before then by other acknowledgements
+			   recieved meanwhile. Clients unlisted meanwhile are published and fenced as they would have been this round. */
+			handle_posted_messages();
+			for (const int client_sockfd : acknowledged_sockfds) {
+				if (outgoing_migration *migration = find_outgoing_migration(client_sockfd)) migration->acknowledged_nodes[external_node] = 1;
+			}
+			seal_acknowledged_migrations();
+			publish_directory();
+			fence_unlisted_migrations();
+		}
+
+		/* Step 4: seals each client every node acknowledged, giving its new shard the broadcasts already sent to it */
+		void seal_acknowledged_migrations()
+		{
+			for (size_t i = 0; i < outgoing_migrations.size(); ) {
+				const outgoing_migration &migration = outgoing_migrations[i];
+				if (std::find(migration.acknowledged_nodes.begin(), migration.acknowledged_nodes.end(), 0) != migration.acknowledged_nodes.end()) {
+					++i;
+					continue;
+				}
+				post(migration.to_shard_index, posted_message_type::sealed, migration.client_sockfd, 0, std::string_view(
+					reinterpret_cast<const char*>(migration.acknowledged_broadcast_sequences.data()),
+					migration.acknowledged_broadcast_sequences.size() * sizeof(uint32_t)
+				));
+				outgoing_migrations.erase(outgoing_migrations.begin() + (std::ptrdiff_t)i);
+				if (outgoing_migrations.empty()) owner_group.is_migration_running.store(false, std::memory_order_release);
+			}
+		}
+
+		void seal_migration(int client_sockfd, std::string_view sealed_data)
+		{
+			incoming_migration *migration = find_incoming_migration(client_sockfd);
+			if (migration == nullptr) return;
+			migration->acknowledged_broadcast_sequences.resize(sealed_data.size() / sizeof(uint32_t));
+			std::memcpy(migration->acknowledged_broadcast_sequences.data(), sealed_data.data(), sealed_data.size());
+			migration->is_sealed = true;
+		}
+
+		/* Serves each sealed client once every broadcast the previous shard accounted for arrived here too, so that any
+		   copies still on their way are not sent again. */
+		void release_migrations()
+		{
+			for (size_t i = 0; i < incoming_migrations.size(); ) {
+				incoming_migration &migration = incoming_migrations[i];
+				bool is_releasable = migration.is_sealed;
+				for (size_t j = 0; is_releasable && j < migration.acknowledged_broadcast_sequences.size(); ++j) {
+					if (j != shard_index && !is_sequence_reached(recieved_broadcast_sequences[j], migration.acknowledged_broadcast_sequences[j])) is_releasable = false;
+				}
+				if (!is_releasable) {
+					++i;
+					continue;
+				}
+
+				incoming_migration released_migration = std::move(migration);
+				incoming_migrations.erase(incoming_migrations.begin() + (std::ptrdiff_t)i);
+				const int client_sockfd = released_migration.client_sockfd;
+				if (core.attach_connection(released_migration.connection) == -1) {
+					remove_directory_entry(client_sockfd);
+					released_migration.connection.close_connection();
+					continue;
+				}
+
+				for (const held_message &message : released_migration.forwarded_messages) {
+					if (send_held_message(client_sockfd, message) == -1) break;
+				}
+				for (const held_message &message : released_migration.held_messages) {
+					if (message.message_type == posted_message_type::broadcast && is_sequence_reached(
+						released_migration.acknowledged_broadcast_sequences[message.from_node], message.broadcast_sequence
+					)) continue;
+					if (send_held_message(client_sockfd, message) == -1) break;
+				}
+			}
+		}
+
+		/* Returns -1 once the client was disconnected */
+		int send_held_message(int client_sockfd, const held_message &message)
+		{
+			if (message.message_type != posted_message_type::close) return core.send_frame(client_sockfd, message.message_id, message.payload);
+			core.close_connection(client_sockfd);
+			return -1;
+		}
+
+		/* Compares broadcast numbers, which are allowed to wrap around */
+		static bool is_sequence_reached(uint32_t sequence, uint32_t target_sequence) noexcept
+		{
+			return (int32_t)(sequence - target_sequence) >= 0;
+		}
+
+		void add_directory_entry(int client_sockfd)
+		{
+			if ((size_t)client_sockfd >= directory_indices.size()) directory_indices.resize((size_t)client_sockfd + 1, 0);
+			open_sockfds.push_back(client_sockfd);
+			directory_indices[(size_t)client_sockfd] = open_sockfds.size();
+			is_directory_changed = true;
+		}
+
+		void remove_directory_entry(int client_sockfd)
+		{
+			if ((size_t)client_sockfd >= directory_indices.size() || directory_indices[(size_t)client_sockfd] == 0) return;
+			const size_t removed_index = directory_indices[(size_t)client_sockfd] - 1;
+			directory_indices[(size_t)client_sockfd] = 0;
+			if (removed_index != open_sockfds.size() - 1) {
+				open_sockfds[removed_index] = open_sockfds.back();
+				directory_indices[(size_t)open_sockfds[removed_index]] = removed_index + 1;
+			}
+			open_sockfds.pop_back();
+			is_directory_changed = true;
+		}
+
+		/* Publishes the shard's clients if they changed since they were last published, and frees old lists nothing reads */
+		void publish_directory()
+		{
+			if (is_directory_changed || directory.read() == nullptr) {
+				std::vector<int> *sorted_sockfds = new std::vector<int>(open_sockfds);
+				std::sort(sorted_sockfds->begin(), sorted_sockfds->end());
+				directory.publish(owner_group.directory_domain, retired_directories, sorted_sockfds);
+				is_directory_changed = false;
+			}
+			retired_directories.reclaim(owner_group.directory_domain);
+		}
+
+		/* Only stores what changed, so that the acceptor's copy of the cache line stays valid whilst the shard is idle */
+		void publish_load() noexcept
+		{
+			const size_t connections_count = core.get_connections_count();
+			const uint64_t recieved_bytes_count = core.get_recieved_bytes_count();
+			if (connections_count != published_connections_count) {
+				load.connections_count.store(published_connections_count = connections_count, std::memory_order_relaxed);
+			}
+			if (recieved_bytes_count != published_recieved_bytes_count) {
+				load.recieved_bytes_count.store(published_recieved_bytes_count = recieved_bytes_count, std::memory_order_relaxed);
+			}
+			if (adopted_count != published_adopted_count) {
+				load.adopted_count.store(published_adopted_count = adopted_count, std::memory_order_relaxed);
+			}
+		}
+
+		server_group &owner_group;
+		const size_t shard_index;
+		int reader_id = -1;
+
+		shard_load load;
+		size_t adopted_count = 0, published_connections_count = 0, published_adopted_count = 0;
+		uint64_t published_recieved_bytes_count = 0;
+
+		/* Clients being moved, and those to move at the end of the round with their new shards */
+		std::vector<outgoing_migration> outgoing_migrations;
+		std::vector<incoming_migration> incoming_migrations;
+		std::vector<std::pair<int, size_t>> requested_migrations;
+		uint64_t next_rebalance_time = 0;
+
+		/* Number of the last broadcast sent by this shard, and recieved from each node */
+		uint32_t broadcast_sequence = 0;
+		std::vector<uint32_t> recieved_broadcast_sequences;
+
+		/* Clients of the shard, with the index of each in the list plus one (or 0 if not connected) by socket */
+		std::vector<int> open_sockfds;
+		std::vector<size_t> directory_indices;
+		bool is_directory_changed = false;
+		epoch_published<std::vector<int>> directory;
+		epoch_retire_list retired_directories;
+
+		H frame_handler;
+		server_core<B, F, L, shard_handler> core; /* Destroyed first, whilst the rest is still there for its handler */
+	};
+
+private:
+	/* Returns the shard listing the given client, or -1 if none. Only called whilst reading the directory. */
+	int find_listed_shard(int client_sockfd) const noexcept
+	{
+		for (size_t i = 0; i < shards.size(); ++i) {
+			const std::vector<int> *shard_sockfds = shards[i]->directory.read();
+			if (shard_sockfds != nullptr && std::binary_search(shard_sockfds->begin(), shard_sockfds->end(), client_sockfd)) return (int)i;
+		}
+		return -1;
+	}
+
+	/* What the acceptor knows of a shard's load besides what the shard published */
+	struct acceptor_estimate {
+		size_t handed_count = 0; /* Clients handed to the shard, some of which it may not have adopted yet */
+		size_t window_handed_count = 0, previous_window_handed_count = 0;
+		uint64_t window_start_bytes = 0, previous_window_start_bytes = 0;
+		size_t connections_count = 0; /* Estimated whilst choosing a shard */
+		uint64_t recent_bytes_count = 0;
+	};
+
+	/* Accepts clients until the group is stopped, handing each to the least loaded shard */
+	void run_acceptor()
+	{
+		std::vector<acceptor_estimate> estimates(shards.size());
+		uint64_t window_start_time = network_reactor_time();
+		struct pollfd acceptor_polls[2] = { { acceptor_sockfd, POLLIN, 0 }, { acceptor_wake_fd, POLLIN, 0 } };
+
+		while (!is_acceptor_stopped.load(std::memory_order_relaxed)) {
+			if (poll(acceptor_polls, 2, -1) == -1) {
+				if (errno == EINTR) continue;
+				check_error(-1, "(Group) Error encountered whilst waiting for clients", 0);
+				break;
+			}
+			if ((acceptor_polls[0].revents & POLLIN) == 0) continue;
+
+			/* Recently recieved data is measured over the last one to two seconds, from when the previous window started */
+			const uint64_t current_time = network_reactor_time();
+			if (current_time - window_start_time >= 1000000000ULL) {
+				for (size_t i = 0; i < shards.size(); ++i) {
+					estimates[i].previous_window_start_bytes = estimates[i].window_start_bytes;
+					estimates[i].window_start_bytes = shards[i]->load.recieved_bytes_count.load(std::memory_order_relaxed);
+					estimates[i].previous_window_handed_count = estimates[i].window_handed_count;
+					estimates[i].window_handed_count = 0;
+				}
+				window_start_time = current_time;
+			}
+
+			/* Every waiting client is accepted, being handed over with one lock and at most one doorbell for each shard */
+			std::lock_guard<std::mutex> external_lock(external_mutex);
+			for (;;) {
+				const int client_sockfd = accept4(acceptor_sockfd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+				if (client_sockfd == -1) {
+					if (errno == EINTR || errno == ECONNABORTED) continue;
+					if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+
+					/* Clients waiting whilst no more sockets can be opened are left waiting a moment, rather than
+					   waking up straight away to fail again */
+					check_error(-1, "(Group) Failed to accept client", 0);
+					if (errno == EMFILE || errno == ENFILE) usleep(100000);
+					break;
+				}
+
+				const size_t chosen_shard_index = find_least_loaded_shard(estimates);
+				shard_mesh.send(shards.size(), chosen_shard_index, (uint32_t)posted_message_type::adopt, client_sockfd, 0, std::string_view());
+				++estimates[chosen_shard_index].handed_count;
+				++estimates[chosen_shard_index].window_handed_count;
+			}
+			flush_external_messages();
+		}
+	}
+
+	/* Returns the shard with the fewest clients, counting those handed to it that it did not adopt yet. When balancing by
+	   recieved data, the shard that recieved the least recently is chosen instead, with each client handed to a shard
+	   during that time counted as the average data recieved for each client so that new clients are not all given to
+	   the same shard before they send anything. */
+	size_t find_least_loaded_shard(std::vector<acceptor_estimate> &estimates) const noexcept
+	{
+		size_t total_connections_count = 0;
+		uint64_t total_recent_bytes_count = 0;
+		for (size_t i = 0; i < shards.size(); ++i) {
+			const typename shard::shard_load &load = shards[i]->load;
+			acceptor_estimate &estimate = estimates[i];
+			estimate.connections_count = load.connections_count.load(std::memory_order_relaxed) + estimate.handed_count -
+				std::min(estimate.handed_count, load.adopted_count.load(std::memory_order_relaxed));
+			estimate.recent_bytes_count = load.recieved_bytes_count.load(std::memory_order_relaxed) - estimate.previous_window_start_bytes;
+			total_connections_count += estimate.connections_count;
+			total_recent_bytes_count += estimate.recent_bytes_count;
+		}
+
+		const uint64_t average_bytes_count = total_connections_count != 0 ? total_recent_bytes_count / total_connections_count : 0;
+		size_t chosen_shard_index = 0;
+		uint64_t chosen_bytes_count = UINT64_MAX;
+		for (size_t i = 0; i < shards.size(); ++i) {
+			uint64_t shard_bytes_count = 0;
+			if (acceptor_balance == connection_balance::least_recieved_bytes) {
+				const size_t recently_handed_count = estimates[i].window_handed_count + estimates[i].previous_window_handed_count;
+				shard_bytes_count = estimates[i].recent_bytes_count + recently_handed_count * average_bytes_count;
+			}
+			if (shard_bytes_count < chosen_bytes_count ||
+			    (shard_bytes_count == chosen_bytes_count && estimates[i].connections_count < estimates[chosen_shard_index].connections_count)
+			) {
+				chosen_shard_index = i;
+				chosen_bytes_count = shard_bytes_count;
+			}
+		}
+		return chosen_shard_index;
+	}
+
+	/* Hands work for a client to its shard from a thread outside the group, returning 0 on success and -1 if it is not
+	   connected. Its shard is found whilst holding the lock, which shards moving a client rely on. */
+	int post_external(posted_message_type message_type, int client_sockfd, uint32_t message_argument, std::string_view payload)
+	{
+		std::lock_guard<std::mutex> external_lock(external_mutex);
+		int client_shard_index;
+		{
+			epoch_guard guard(directory_domain);
+			if ((client_shard_index = find_listed_shard(client_sockfd)) == -1) return -1;
+		}
+		shard_mesh.send(shards.size(), (size_t)client_shard_index, (uint32_t)message_type, client_sockfd, message_argument, payload);
+		flush_external_messages();
+		return 0;
+	}
+
+	/* Makes the messages of other threads visible, waiting for space if the rings are full, as they have no round to retry in */
+	void flush_external_messages()
+	{
+		while (shard_mesh.flush(shards.size()) != 0) sched_yield();
+	}
+
+	/* Both outlive the shards, which are destroyed first */
+	epoch_domain directory_domain;
+	message_mesh shard_mesh; /* Has a node for each shard, followed by one shared by every other thread */
+	std::mutex external_mutex;
+	uint32_t external_broadcast_sequence = 0; /* Number of the last broadcast from other threads, only used with the lock */
+	std::atomic<size_t> rebalance_threshold = 0;
+	std::atomic<bool> is_migration_running = false; /* Whether a shard is moving clients, which only one does at a time */
+	std::vector<std::unique_ptr<shard>> shards;
+
+	int acceptor_sockfd = -1, acceptor_wake_fd = -1;
+	connection_balance acceptor_balance = connection_balance::reuseport;
+	std::atomic<bool> is_acceptor_stopped = false;
+};
+
+} /* namespace network::core */
+
+#endif /* NETWORK_DEMO_SERVER_GROUP_HPP */
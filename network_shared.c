@@ -0,0 +1,380 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#include <netdb.h>
+
+#include "network_shared.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Control characters of the messages sent between clients and servers, described where they are declared */
+char network_global_pulse_message = '\3';
+char network_global_pulse_null_response = '\3';
+const size_t network_global_pulse_bytes = sizeof network_global_pulse_message;
+char network_global_identity_message = '\1';
+char network_global_redirect_message = '\2';
+char network_global_session_message = '\17';
+char network_global_stream_chunk_message = '\7';
+char network_global_stream_end_message = '\10';
+char network_global_transfer_message = '\16';
+
+
+/* ---- Function declarations ---- */
+
+/* Opens a socket listening on the given port for 'open_listening_socket', letting other sockets listen on it as well if shared. */
+static int open_port_listening_socket(const char *listen_port, int is_port_shared);
+
+
+/*  ---- Function definitions ---- */
+
+
+ssize_t recieve_bytes(int target_sockfd, char *target_buffer, size_t max_operation_bytes)
+{
+	size_t total_bytes_operated = 0;
+	ssize_t recent_bytes_operated = 0;
+
+	do {
+		const size_t next_operation_size = max_operation_bytes - total_bytes_operated;
+		char *next_buffer_operation = target_buffer + total_bytes_operated;
+		recent_bytes_operated = recv(target_sockfd, next_buffer_operation, next_operation_size, 0);
+
+		if (recent_bytes_operated == 0) return 0; /* Disconnected */
+		if (recent_bytes_operated == -1) return -1; /* Recieve error */
+		if ((total_bytes_operated += (size_t)recent_bytes_operated) >= max_operation_bytes) goto place_null_terminator_return; /* Maximum buffer size reached */
+
+		char last_operated_char = target_buffer[total_bytes_operated - 1];
+		/* End of buffer reached */
+		if (last_operated_char == '\0' || last_operated_char == network_global_pulse_message) goto no_place_terminator_return;
+		else if (last_operated_char == '\n') goto place_null_terminator_return;
+	} while (1);
+
+
+place_null_terminator_return:
+	/* Place null terminator at the end of the buffer */
+	target_buffer[total_bytes_operated - 1] = '\0';
+no_place_terminator_return:
+	/* Return the total number of bytes operated on */
+	return (ssize_t)total_bytes_operated;
+}
+
+
+ssize_t send_bytes(int target_sockfd, const char *target_buffer, size_t max_operation_bytes)
+{
+	size_t total_bytes_operated = 0;
+	ssize_t recent_bytes_operated = 0;
+
+	do {
+		const size_t next_operation_size = max_operation_bytes - total_bytes_operated;
+		const char *next_buffer_operation = target_buffer + total_bytes_operated;
+		recent_bytes_operated = send(target_sockfd, next_buffer_operation, next_operation_size, 0);
+
+		if (recent_bytes_operated < 1) return -1; /* Send error */
+		if ((total_bytes_operated += (size_t)recent_bytes_operated) >= max_operation_bytes) break; /* Maximum buffer size reached */
+
+		const char last_operated_char = target_buffer[total_bytes_operated - 1];
+		if (last_operated_char == '\0' || last_operated_char == '\n') break; /* End of buffer reached */
+	} while (1);
+
+	/* Return the total number of bytes operated on */
+	return (ssize_t)total_bytes_operated;
+}
+
+
+int init_zerocopy_reader(struct network_zerocopy_reader *reader, int target_sockfd, size_t region_bytes)
+{
+	memset(reader, 0, sizeof *reader);
+	const long page_bytes = sysconf(_SC_PAGESIZE);
+	reader->page_bytes = page_bytes > 0 ? (size_t)page_bytes : 0x1000;
+	reader->region_bytes = region_bytes - region_bytes % reader->page_bytes;
+
+	reader->copy_buffer_bytes = 0x10000;
+	if ((reader->copy_buffer = malloc(reader->copy_buffer_bytes)) == NULL) return -1;
+
+	/* The socket itself is mapped, which only reserves the region for the recieved pages to be placed in */
+	if (reader->region_bytes != 0) {
+		reader->mapped_region = mmap(NULL, reader->region_bytes, PROT_READ, MAP_SHARED, target_sockfd, 0);
+		if (reader->mapped_region == MAP_FAILED) reader->mapped_region = NULL;
+	}
+	return 0;
+}
+
+
+void free_zerocopy_reader(struct network_zerocopy_reader *reader)
+{
+	if (reader->mapped_region != NULL) munmap(reader->mapped_region, reader->region_bytes);
+	free(reader->copy_buffer);
+	memset(reader, 0, sizeof *reader);
+}
+
+
+ssize_t recieve_zerocopy_bytes(struct network_zerocopy_reader *reader, int target_sockfd, size_t max_recieve_bytes, const char **recieved_data)
+{
+	/* Release the pages given by the previous call now, rather than the kernel doing so before mapping new ones */
+	if (reader->mapped_bytes != 0) {
+		madvise(reader->mapped_region, reader->mapped_bytes, MADV_DONTNEED);
+		reader->mapped_bytes = 0;
+	}
+
+	size_t copied_bytes = max_recieve_bytes < reader->copy_buffer_bytes ? max_recieve_bytes : reader->copy_buffer_bytes;
+	while (reader->mapped_region != NULL && max_recieve_bytes >= reader->page_bytes) {
+		struct tcp_zerocopy_receive zerocopy_request;
+		socklen_t zerocopy_request_bytes = sizeof zerocopy_request;
+		memset(&zerocopy_request, 0, sizeof zerocopy_request);
+		zerocopy_request.address = (uint64_t)(uintptr_t)reader->mapped_region;
+		zerocopy_request.length = (uint32_t)(max_recieve_bytes < reader->region_bytes ? max_recieve_bytes : reader->region_bytes);
+		zerocopy_request.length -= zerocopy_request.length % (uint32_t)reader->page_bytes;
+
+		if (getsockopt(target_sockfd, IPPROTO_TCP, TCP_ZEROCOPY_RECEIVE, &zerocopy_request, &zerocopy_request_bytes) == -1) {
+			if (errno == EINTR) continue;
+
+			/* Not supported for this socket, so only copy from now on */
+			munmap(reader->mapped_region, reader->region_bytes);
+			reader->mapped_region = NULL;
+			break;
+		}
+
+		if (zerocopy_request.length != 0) {
+			reader->mapped_bytes = zerocopy_request.length;
+			reader->mapped_bytes_total += zerocopy_request.length;
+			*recieved_data = reader->mapped_region;
+			return (ssize_t)zerocopy_request.length;
+		}
+
+		/* Data that cannot be mapped has to be copied before any more can be mapped */
+		if (zerocopy_request.recv_skip_hint != 0) {
+			if (zerocopy_request.recv_skip_hint < copied_bytes) copied_bytes = zerocopy_request.recv_skip_hint;
+			break;
+		}
+
+		/* Nothing has been recieved yet, so wait for it rather than copying whatever arrives first */
+		struct pollfd recieve_poll_request = { target_sockfd, POLLIN, 0 };
+		if (poll(&recieve_poll_request, 1, -1) == -1 && errno != EINTR) return -1;
+		if (recieve_poll_request.revents & (POLLHUP | POLLERR)) break; /* Let 'recv' give the disconnect or error */
+	}
+
+	const ssize_t total_bytes_recieved = recv(target_sockfd, reader->copy_buffer, copied_bytes, 0);
+	if (total_bytes_recieved > 0) reader->copied_bytes_total += (unsigned long long)total_bytes_recieved;
+	*recieved_data = reader->copy_buffer;
+	return total_bytes_recieved;
+}
+
+
+ssize_t read_network_messages(struct network_message_reader *reader, int target_sockfd, int recieve_flags)
+{
+	/* Move any partial message left over to the start of the buffer to make room after it */
+	if (reader->buffer_start != 0) {
+		reader->buffer_end -= reader->buffer_start;
+		memmove(reader->reader_buffer, reader->reader_buffer + reader->buffer_start, reader->buffer_end);
+		reader->buffer_start = 0;
+	}
+
+	/* Expand the buffer (doubling its size) if it is full */
+	if (reader->buffer_end >= reader->buffer_alloc_count) {
+		size_t new_alloc_count = reader->buffer_alloc_count ? reader->buffer_alloc_count * 2 : 256;
+		if (new_alloc_count > NETWORK_MAXIMUM_MESSAGE_BYTES) new_alloc_count = NETWORK_MAXIMUM_MESSAGE_BYTES;
+
+		void *new_reader_buffer = realloc(reader->reader_buffer, new_alloc_count);
+		if (new_reader_buffer == NULL) return -1;
+		reader->reader_buffer = new_reader_buffer;
+		reader->buffer_alloc_count = new_alloc_count;
+	}
+
+	const ssize_t total_bytes_recieved = recv(
+		target_sockfd,
+		reader->reader_buffer + reader->buffer_end,
+		reader->buffer_alloc_count - reader->buffer_end,
+		recieve_flags
+	);
+	if (total_bytes_recieved > 0) reader->buffer_end += (size_t)total_bytes_recieved;
+	return total_bytes_recieved;
+}
+
+
+char *find_network_message(struct network_message_reader *reader, size_t *message_bytes)
+{
+	/* The rest of a message that was too long is skipped up to its terminator, so that none of it is taken as a message
+	   (which could start with any control character) */
+	if (reader->is_discarding) {
+		const char *discarded_data = reader->reader_buffer + reader->buffer_start;
+		const size_t discarded_bytes = reader->buffer_end - reader->buffer_start;
+		size_t i = 0;
+		while (i < discarded_bytes && discarded_data[i] != '\0' && discarded_data[i] != '\n') ++i;
+		if (i == discarded_bytes) {
+			reader->buffer_start = reader->buffer_end;
+			return NULL;
+		}
+		reader->buffer_start += i + 1;
+		reader->is_discarding = 0;
+	}
+
+	char *next_message = reader->reader_buffer + reader->buffer_start;
+	const size_t buffered_bytes = reader->buffer_end - reader->buffer_start;
+	if (buffered_bytes == 0) return NULL;
+
+	/* Pulses are a single character without a terminator */
+	if (*next_message == network_global_pulse_message) {
+		*message_bytes = 1;
+		return next_message;
+	}
+
+	/* Messages end at a terminator or new line, which is replaced with a terminator */
+	for (size_t i = 0; i < buffered_bytes; ++i) {
+		if (next_message[i] != '\0' && next_message[i] != '\n') continue;
+		next_message[i] = '\0';
+		*message_bytes = i + 1;
+		return next_message;
+	}
+
+	/* A message filling the whole buffer without ending is too long, so it is discarded along with the rest of it */
+	if (reader->buffer_start == 0 && buffered_bytes >= NETWORK_MAXIMUM_MESSAGE_BYTES) {
+		reader->buffer_start = reader->buffer_end;
+		reader->is_discarding = 1;
+	}
+
+	return NULL; /* The rest of the message has not been recieved yet */
+}
+
+
+int is_stream_chunk(const char *chunk_message)
+{
+	return *chunk_message == network_global_stream_chunk_message || *chunk_message == network_global_stream_end_message;
+}
+
+
+char *split_stream_chunk(char *chunk_message, long *stream_id)
+{
+	char *stream_id_end;
+	*stream_id = strtol(chunk_message + 1, &stream_id_end, 10);
+	if (stream_id_end == chunk_message + 1 || *stream_id_end != ':') return NULL;
+	return stream_id_end + 1;
+}
+
+
+char *split_transfer_message(char *transfer_message, long *client_id, unsigned long long *transfer_bytes)
+{
+	if (*transfer_message != network_global_transfer_message) return NULL;
+
+	char *client_id_end, *transfer_bytes_end;
+	*client_id = strtol(transfer_message + 1, &client_id_end, 10);
+	if (client_id_end == transfer_message + 1 || *client_id_end != ':') return NULL;
+	*transfer_bytes = strtoull(client_id_end + 1, &transfer_bytes_end, 10);
+	if (transfer_bytes_end == client_id_end + 1 || *transfer_bytes_end != ':') return NULL;
+	return transfer_bytes_end + 1;
+}
+
+
+size_t get_stdin_input(char *input_buffer, size_t max_input_size)
+{
+	if (fgets(input_buffer, (int)max_input_size, stdin) == NULL) return 0;
+	size_t input_message_len = strlen(input_buffer);
+
+	/* The newline is replaced by the terminator, which is already after the last character of a line that was cut off */
+	if (input_message_len != 0 && input_buffer[input_message_len - 1] == '\n') input_buffer[input_message_len - 1] = '\0';
+	else ++input_message_len;
+	return input_message_len;
+}
+
+
+int check_error(int func_result, const char *onerror_message, int _exit)
+{
+	/* Check if the given function failed */
+	if (func_result == -1) {
+		perror(onerror_message);
+		if (_exit) exit(EXIT_FAILURE);
+	}
+
+	/* Return normal result */
+	return func_result;
+}
+
+
+int check_error_null(const void *func_result, const char *onerror_message, int _exit)
+{
+	return check_error(-(func_result == NULL), onerror_message, _exit);
+}
+
+
+void *get_ipvx_address(struct sockaddr *in_socket_address)
+{
+	if (in_socket_address->sa_family == AF_INET) return &(((struct sockaddr_in*)in_socket_address)->sin_addr);
+	return &(((struct sockaddr_in6*)in_socket_address)->sin6_addr);
+}
+
+int open_listening_socket(const char *listen_port)
+{
+	return open_port_listening_socket(listen_port, 0);
+}
+
+int open_shared_listening_socket(const char *listen_port)
+{
+	return open_port_listening_socket(listen_port, 1);
+}
+
+int open_port_listening_socket(const char *listen_port, int is_port_shared)
+{
+	/* Get linked list of local device's address information */
+	struct addrinfo address_info_hints, *listen_address_info;
+	memset(&address_info_hints, 0, sizeof address_info_hints);
+	address_info_hints.ai_family = PF_UNSPEC;
+	address_info_hints.ai_socktype = SOCK_STREAM;
+	address_info_hints.ai_flags = AI_PASSIVE;
+
+	const int address_info_result = getaddrinfo(NULL, listen_port, &address_info_hints, &listen_address_info);
+	if (address_info_result != 0) {
+		fprintf(stderr, "(Init) Failed to get address info: %s\n", gai_strerror(address_info_result));
+		return -1;
+	}
+
+	/* Create the socket for listening to connections */
+	const int listen_sockfd = socket(
+		listen_address_info->ai_family,
+		listen_address_info->ai_socktype,
+		listen_address_info->ai_protocol
+	);
+	if (check_error(listen_sockfd, "(Init) Failed to create listening socket", 0) == -1) {
+		freeaddrinfo(listen_address_info);
+		return -1;
+	}
+
+	/* Allow reusing a port to avoid getting "address already in use" errors when restarting a server */
+	const int allow_port_reuse = 1;
+	check_error(setsockopt(
+		listen_sockfd,
+		SOL_SOCKET,
+		SO_REUSEADDR,
+		&allow_port_reuse,
+		(socklen_t)(sizeof allow_port_reuse)
+	), "(Init) Port reuse option failed", 0);
+	if (is_port_shared) {
+		check_error(setsockopt(
+			listen_sockfd,
+			SOL_SOCKET,
+			SO_REUSEPORT,
+			&allow_port_reuse,
+			(socklen_t)(sizeof allow_port_reuse)
+		), "(Init) Port sharing option failed", 0);
+	}
+
+	/* Bind the address to the socket and prepare to queue connections */
+	const int bind_result = check_error(bind(
+		listen_sockfd,
+		listen_address_info->ai_addr,
+		listen_address_info->ai_addrlen
+	), "(Init) Bind failed to given port", 0);
+	freeaddrinfo(listen_address_info); /* Free memory allocated for the 'address info' object */
+
+	if (bind_result == -1 || check_error(listen(listen_sockfd, 20), "(Init) Listen failed", 0) == -1) {
+		close(listen_sockfd);
+		return -1;
+	}
+	return listen_sockfd;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
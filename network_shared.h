@@ -7,107 +7,130 @@
 #ifndef NETWORK_DEMO_SHARED_H
 #define NETWORK_DEMO_SHARED_H
 
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <unistd.h>
+#include <errno.h>
+
+#include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-char network_global_pulse_message = '\3';
-char network_global_pulse_null_response = '\3';
-const size_t network_global_pulse_bytes = sizeof network_global_pulse_message;
-
-/* ---- Helper functions for client and server ---- */
+extern char network_global_pulse_message;
+extern char network_global_pulse_null_response;
+extern const size_t network_global_pulse_bytes;
+
+/* Sent by a client with its identity to be placed on the server owning it, and sent back by that server to accept it */
+extern char network_global_identity_message;
+/* Sent by a server with the '<host>:<port>' address of the server a client should connect to instead */
+extern char network_global_redirect_message;
+/* Sent by a server with the token of a client's session (or nothing, ending the session), and sent back by the client
+   after identifying itself again to resume that session */
+extern char network_global_session_message;
+
+/* Maximum size of a single message. Longer messages are discarded whole (up to their terminator) unless they are streamed in chunks,
+   so that no part of one is taken as a message of its own. */
+#define NETWORK_MAXIMUM_MESSAGE_BYTES 0xFFFF
+/* Maximum length of an identity that sessions can be resumed with and direct messages can be sent to */
+#define NETWORK_IDENTITY_MAXIMUM_LENGTH 255
+/* Maximum size of the data in each chunk of a streamed message */
+#define NETWORK_STREAM_CHUNK_BYTES 0x4000
 
-/* Repeatedly recieves a limited amount data from the target socket/file descriptor until there is none left.
-   Returns recieved bytes on success, 0 on disconnect and -1 on error. */
-static ssize_t recieve_bytes(int target_sockfd, char *target_buffer, size_t max_operation_bytes) {
-	size_t total_bytes_operated = 0;
-	ssize_t recent_bytes_operated = 0;
-
-	do {
-		const size_t next_operation_size = max_operation_bytes - total_bytes_operated;
-		char *next_buffer_operation = target_buffer + total_bytes_operated;
-		recent_bytes_operated = recv(target_sockfd, next_buffer_operation, next_operation_size, 0);
+/*
+   Messages too long to be sent at once are streamed as a sequence of chunks, each being a message of its own
+   in the form '<control character><stream ID>:<data>'. Every chunk except the last starts with the chunk
+   character, flagging that the message continues in the next chunk, and the last chunk with the end character.
+   The stream ID tells apart chunks of different streams that are recieved at the same time, which is the
+   sending client's ID for streams from the server and 0 for streams from a client (which only send one at a time).
+*/
+extern char network_global_stream_chunk_message;
+extern char network_global_stream_end_message;
 
-		if (recent_bytes_operated == 0) return 0; /* Disconnected */
-		if (recent_bytes_operated == -1) return -1; /* Recieve error */
-		if ((total_bytes_operated += (size_t)recent_bytes_operated) >= max_operation_bytes) goto place_null_terminator_return; /* Maximum buffer size reached */
+/*
+   Files are sent to another client as a transfer message in the form '<control character><client ID>:<bytes>:<file name>',
+   followed straight away by the given number of raw bytes of the file (which are not messages of their own).
+   The client ID is that of the recipient when sent to the server and that of the sender when recieved from it.
+*/
+extern char network_global_transfer_message;
 
-		char last_operated_char = target_buffer[total_bytes_operated - 1];
-		/* End of buffer reached */
-		if (last_operated_char == '\0' || last_operated_char == network_global_pulse_message) goto no_place_terminator_return;
-		else if (last_operated_char == '\n') goto place_null_terminator_return;
-	} while (1);
+/* Data recieved from a socket that has not been handled yet, split into messages as they are completed. */
+struct network_message_reader {
+	char *reader_buffer; /* Unhandled data, being from the start to the end index */
+	size_t buffer_start, buffer_end, buffer_alloc_count;
+	int is_discarding; /* Non-zero whilst the rest of a message that was too long is skipped, up to its terminator */
+};
 
+/*
+   Bulk data (such as a recieved file) can be recieved without copying it, by mapping the pages holding it in the socket's
+   recieve queue straight into memory with TCP_ZEROCOPY_RECEIVE. Only whole, page-aligned pages can be mapped, so any data
+   that is not (such as the end of a transfer or data the kernel did not store in whole pages) is still copied with 'recv'.
+   Mapping pages has a cost of its own, so this is only worth it for large amounts of data.
+*/
+struct network_zerocopy_reader {
+	void *mapped_region; /* Memory the recieved pages are mapped into, or NULL if zero-copy recieving is not available */
+	size_t region_bytes, mapped_bytes; /* Size of the region and of the pages currently mapped at its start */
+	size_t page_bytes;
+	char *copy_buffer; /* Buffer for data that cannot be mapped */
+	size_t copy_buffer_bytes;
+	unsigned long long mapped_bytes_total, copied_bytes_total; /* Bytes recieved by mapping and by copying */
+};
 
-place_null_terminator_return:
-	/* Place null terminator at the end of the buffer */
-	target_buffer[total_bytes_operated - 1] = '\0';
-no_place_terminator_return:
-	/* Return the total number of bytes operated on */
-	return (ssize_t)total_bytes_operated;
-}
+/* ---- Helper functions for client and server ---- */
 
+/* Repeatedly recieves a limited amount data from the target socket/file descriptor until there is none left.
+   Returns recieved bytes on success, 0 on disconnect and -1 on error. */
+ssize_t recieve_bytes(int target_sockfd, char *target_buffer, size_t max_operation_bytes);
 /* Repeatedly sends a limited amount data to the target socket/file descriptor until there is none left from the given buffer.
    Returns sent bytes on success and -1 on error. */
-static ssize_t send_bytes(int target_sockfd, const char *target_buffer, size_t max_operation_bytes)
-{
-	size_t total_bytes_operated = 0;
-	ssize_t recent_bytes_operated = 0;
-
-	do {
-		const size_t next_operation_size = max_operation_bytes - total_bytes_operated;
-		const char *next_buffer_operation = target_buffer + total_bytes_operated;
-		recent_bytes_operated = send(target_sockfd, next_buffer_operation, next_operation_size, 0);
-
-		if (recent_bytes_operated < 1) return -1; /* Send error */
-		if ((total_bytes_operated += (size_t)recent_bytes_operated) >= max_operation_bytes) break; /* Maximum buffer size reached */
-
-		const char last_operated_char = target_buffer[total_bytes_operated - 1];
-		if (last_operated_char == '\0' || last_operated_char == '\n') break; /* End of buffer reached */
-	} while (1);
-
-	/* Return the total number of bytes operated on */
-	return (ssize_t)total_bytes_operated;
-}
-
-/* Get null-terminated input from stdin. Returns 0 on error and the length of the input otherwise */
-size_t get_stdin_input(char *input_buffer, size_t max_input_size)
-{
-	if (fgets(input_buffer, (int)max_input_size, stdin) == NULL) return 0;
-	size_t input_message_len = strlen(input_buffer);
-	if (input_message_len > max_input_size) input_message_len = max_input_size;
-	input_buffer[input_message_len - 1] = '\0';
-	return input_message_len;
-}
-
+ssize_t send_bytes(int target_sockfd, const char *target_buffer, size_t max_operation_bytes);
+/* Prepares the given reader for recieving from the given socket, mapping up to the given number of bytes at once.
+   Falls back to only copying if the socket cannot be mapped. Returns 0 on success and -1 if an allocation failed. */
+int init_zerocopy_reader(struct network_zerocopy_reader *reader, int target_sockfd, size_t region_bytes);
+/* Frees the memory used by the given reader. */
+void free_zerocopy_reader(struct network_zerocopy_reader *reader);
+/* Waits for and recieves up to the given number of bytes from the socket, giving a pointer to them through 'recieved_data'.
+   The data is only valid until the next call. Returns the number of bytes recieved, 0 on disconnect and -1 on error. */
+ssize_t recieve_zerocopy_bytes(struct network_zerocopy_reader *reader, int target_sockfd, size_t max_recieve_bytes, const char **recieved_data);
+/* Reads the data available from the given socket into the reader's buffer, expanding it if needed up to the maximum message size.
+   Returns the number of bytes read, 0 on disconnect and -1 on error. Should only be called once 'find_network_message' returned NULL. */
+ssize_t read_network_messages(struct network_message_reader *reader, int target_sockfd, int recieve_flags);
+/* Returns the next complete message in the reader's buffer, terminating it in place, or NULL if there is none yet.
+   The size of the message including its terminator is given through 'message_bytes'. The message is not removed from the
+   buffer, which is done by adding its size to the buffer's start index once it has been handled. A message longer than
+   'NETWORK_MAXIMUM_MESSAGE_BYTES' is never returned, being removed from the buffer as it is recieved instead. */
+char *find_network_message(struct network_message_reader *reader, size_t *message_bytes);
+/* Returns non-zero if the given message is a chunk of a streamed message. */
+int is_stream_chunk(const char *chunk_message);
+/* Returns the data of the given streamed message chunk, giving the ID of the stream it belongs to through 'stream_id'.
+   Returns NULL if the chunk is invalid. */
+char *split_stream_chunk(char *chunk_message, long *stream_id);
+/* Returns the file name of the given transfer message, giving the client ID and number of bytes to follow through the given pointers.
+   Returns NULL if the message is not a valid transfer message. */
+char *split_transfer_message(char *transfer_message, long *client_id, unsigned long long *transfer_bytes);
+/* Get null-terminated input from stdin. Returns 0 on error and the length of the input (including the terminator) otherwise.
+   A line too long for the buffer is cut off, returning the size of the buffer, and the rest is given by the next calls. */
+size_t get_stdin_input(char *input_buffer, size_t max_input_size);
 /* Prints the given error message if the result of a function was equal to -1 (an error occurred) and the errno description.
    Exits the program if '_exit' evaluates to true and returns the given result otherwise. */
-int check_error(int func_result, const char *onerror_message, int _exit)
-{
-	/* Check if the given function failed */
-	if (func_result == -1) {
-		perror(onerror_message);
-		if (_exit) exit(EXIT_FAILURE);
-	}
-
-	/* Return normal result */
-	return func_result;
-}
+int check_error(int func_result, const char *onerror_message, int _exit);
 /* Same as 'check_error(...)' but for functions where a null pointer is passed rather than -1 on failure. */
-int check_error_null(const void *func_result, const char *onerror_message, int _exit)
-{
-	return check_error(-(func_result == NULL), onerror_message, _exit);
-}
+int check_error_null(const void *func_result, const char *onerror_message, int _exit);
 /* Returns either the IPv4 or IPv6 address of the given socket address depending on the set socket family. */
-void *get_ipvx_address(struct sockaddr *in_socket_address)
-{
-	if (in_socket_address->sa_family == AF_INET) return &(((struct sockaddr_in*)in_socket_address)->sin_addr);
-	return &(((struct sockaddr_in6*)in_socket_address)->sin6_addr);
-}
+void *get_ipvx_address(struct sockaddr *in_socket_address);
+/* Opens a socket listening for connections on the given port of any local address, allowing the port to be reused straight away.
+   Returns the listening socket on success and -1 on failure. */
+int open_listening_socket(const char *listen_port);
+/* Same as 'open_listening_socket', but other sockets can listen on the same port at once (each opened with this function),
+   with the kernel spreading new connections between them. */
+int open_shared_listening_socket(const char *listen_port);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,321 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#pragma once
+#ifndef NETWORK_DEMO_SERVER_FEDERATION_H
+#define NETWORK_DEMO_SERVER_FEDERATION_H
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "network_shared.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+   Several server processes can form a federation, where each node opens a persistent link to every
+   other node listed in its nodes list. A node only ever sends through the links it opened and only
+   ever recieves through the links opened by others, so a message is forwarded once per node and is
+   never forwarded again by the nodes recieving it (every node is directly linked to every other node).
+
+   Messages sent through links use the same delimiters as client messages, but start with one
+   of the control characters below. Anyone can connect and send these, so a hello is only accepted
+   if it names another node in the nodes list and the link comes from an address of that node's host.
+*/
+
+/* First message sent through a new link, followed by the address of the node that opened it */
+#define FEDERATION_HELLO_MESSAGE '\4'
+/* Message to be sent to every client of the recieving node */
+#define FEDERATION_BROADCAST_MESSAGE '\5'
+/* Topic message ('[<topic>] <message>') to be sent to the matching subscribers of the recieving node */
+#define FEDERATION_PUBLISH_MESSAGE '\6'
+
+/* Seperator between entries in the nodes list */
+#define FEDERATION_NODES_LIST_SEPERATOR ','
+
+
+/* ---- Structs ---- */
+
+/* A node in the federation along with the link this node opened to it. */
+struct federation_node {
+	const char *node_address; /* Address of the node as given in the nodes list ('<host>:<port>') */
+	char node_host[NI_MAXHOST]; /* Host part of the address used for connecting */
+	char node_port[NI_MAXSERV]; /* Port part of the address used for connecting */
+	int outbound_sockfd; /* Socket of the link to this node or -1 if there is no link */
+	int outbound_connected; /* Non-zero once the link has connected and the hello message was sent */
+};
+
+/* All nodes of the federation and the links between them. */
+struct server_federation {
+	char *nodes_list; /* Copy of the nodes list, which the node addresses point into */
+	struct federation_node *nodes; /* Every node of the federation, with this node being the first */
+	size_t nodes_count;
+
+	int *inbound_sockfds; /* Sockets of the links other nodes opened to this node */
+	size_t inbound_count, inbound_alloc_count;
+};
+
+
+/* ---- Function declarations ---- */
+
+/* Initializes the federation from the given comma-seperated list of '<host>:<port>' addresses, where the first entry
+   is the address other nodes and clients know this node by. A NULL list creates a federation with no other nodes.
+   Returns 0 on success and -1 if the list is invalid or an allocation failed. */
+static int federation_init(struct server_federation *federation, const char *nodes_list);
+/* Frees memory allocated for the given federation. Links are not closed, as they are owned by the poll requests list. */
+static void federation_free(struct server_federation *federation);
+
+/* Starts connecting to the given node without blocking, returning the socket of the new link or -1 on failure.
+   The socket becomes writable once the connection has completed, after which 'federation_complete_link' should be called. */
+static int federation_open_link(struct federation_node *node);
+/* Checks if the connection of a link opened with 'federation_open_link' succeeded and sends the hello message through it.
+   Returns 0 on success and -1 if the link failed, in which case it should be closed. */
+static int federation_complete_link(struct server_federation *federation, struct federation_node *node);
+
+/* Returns the node the given socket is an outbound link to or NULL if it is not an outbound link. */
+static struct federation_node *federation_find_outbound_link(struct server_federation *federation, int link_sockfd);
+/* Returns non-zero if the given socket is a link opened by another node. */
+static int federation_is_inbound_link(const struct server_federation *federation, int link_sockfd);
+/* Returns non-zero if the given socket is a link between this node and another node in either direction. */
+static int federation_is_link(struct server_federation *federation, int link_sockfd);
+/* Marks the given socket as a link opened by the node with the given address (from its hello message). Returns 0 on success
+   and -1 if the address is not of another node in the nodes list, the socket is not connected from that node's host
+   or an allocation failed. */
+static int federation_add_inbound_link(struct server_federation *federation, int link_sockfd, const char *node_address);
+/* Forgets the given socket if it is a link, such as when it is closed. Outbound links are opened again later. */
+static void federation_remove_link(struct server_federation *federation, int link_sockfd);
+
+
+
+/* ---- Function definitions ---- */
+
+
+int federation_init(struct server_federation *federation, const char *nodes_list)
+{
+	memset(federation, 0, sizeof *federation);
+	if (nodes_list == NULL) return 0;
+
+	if ((federation->nodes_list = strdup(nodes_list)) == NULL) return -1;
+
+	/* Count the entries to allocate all nodes at once */
+	size_t nodes_count = 1;
+	for (const char *list_iterator = nodes_list; *list_iterator; ++list_iterator) {
+		if (*list_iterator == FEDERATION_NODES_LIST_SEPERATOR) ++nodes_count;
+	}
+	if ((federation->nodes = calloc(nodes_count, sizeof *federation->nodes)) == NULL) goto invalid_nodes_list;
+
+	/* Split each entry in place and seperate the host and port of each address for connecting */
+	char *current_entry = federation->nodes_list;
+	for (size_t i = 0; i < nodes_count; ++i) {
+		char *entry_end = strchr(current_entry, FEDERATION_NODES_LIST_SEPERATOR);
+		if (entry_end != NULL) *entry_end = '\0';
+
+		char *port_seperator = strrchr(current_entry, ':');
+		if (port_seperator == NULL ||
+		    port_seperator == current_entry ||
+		    port_seperator[1] == '\0' ||
+		    (size_t)(port_seperator - current_entry) >= sizeof federation->nodes[i].node_host ||
+		    strlen(port_seperator + 1) >= sizeof federation->nodes[i].node_port
+		) {
+			fprintf(stderr, "(Federation) Invalid node address '%s', expected '<host>:<port>'.\n", current_entry);
+			goto invalid_nodes_list;
+		}
+
+		struct federation_node *node = federation->nodes + i;
+		node->node_address = current_entry;
+		memcpy(node->node_host, current_entry, (size_t)(port_seperator - current_entry));
+		strcpy(node->node_port, port_seperator + 1);
+		node->outbound_sockfd = -1;
+
+		if (entry_end != NULL) current_entry = entry_end + 1;
+	}
+
+	federation->nodes_count = nodes_count;
+	return 0;
+
+invalid_nodes_list:
+	federation_free(federation);
+	return -1;
+}
+
+void federation_free(struct server_federation *federation)
+{
+	free(federation->nodes);
+	free(federation->nodes_list);
+	free(federation->inbound_sockfds);
+	memset(federation, 0, sizeof *federation);
+}
+
+int federation_open_link(struct federation_node *node)
+{
+	struct addrinfo address_info_hints, *node_address_info;
+	memset(&address_info_hints, 0, sizeof address_info_hints);
+	address_info_hints.ai_family = AF_UNSPEC;
+	address_info_hints.ai_socktype = SOCK_STREAM;
+
+	if (getaddrinfo(node->node_host, node->node_port, &address_info_hints, &node_address_info) != 0) return -1;
+
+	/* Only the first address is tried, as other addresses will be tried on later attempts anyway */
+	int link_sockfd = socket(node_address_info->ai_family, node_address_info->ai_socktype, node_address_info->ai_protocol);
+	if (link_sockfd == -1) goto free_address_info;
+
+	/* Connect without blocking so that an unreachable node does not stall the server */
+	if (fcntl(link_sockfd, F_SETFL, fcntl(link_sockfd, F_GETFL) | O_NONBLOCK) == -1 ||
+	    (connect(link_sockfd, node_address_info->ai_addr, node_address_info->ai_addrlen) == -1 && errno != EINPROGRESS)
+	) {
+		close(link_sockfd);
+		link_sockfd = -1;
+	}
+
+free_address_info:
+	freeaddrinfo(node_address_info);
+	return node->outbound_sockfd = link_sockfd;
+}
+
+int federation_complete_link(struct server_federation *federation, struct federation_node *node)
+{
+	/* The result of the connection is given through the socket's pending error */
+	int connect_error = 0;
+	socklen_t connect_error_bytes = sizeof connect_error;
+	if (getsockopt(node->outbound_sockfd, SOL_SOCKET, SO_ERROR, &connect_error, &connect_error_bytes) == -1 ||
+	    connect_error != 0
+	) return -1;
+
+	/* Messages through links are sent in the same (blocking) way as to clients */
+	if (fcntl(node->outbound_sockfd, F_SETFL, fcntl(node->outbound_sockfd, F_GETFL) & ~O_NONBLOCK) == -1) return -1;
+
+	/* Identify this link as being from another node rather than a client */
+	const char *self_address = federation->nodes[0].node_address;
+	const char hello_control_character = FEDERATION_HELLO_MESSAGE;
+	struct iovec hello_message_parts[2] = {
+		{ (void*)&hello_control_character, sizeof hello_control_character },
+		{ (void*)self_address, strlen(self_address) + 1 }
+	};
+	if (writev(node->outbound_sockfd, hello_message_parts, 2) == -1) return -1;
+
+	node->outbound_connected = 1;
+	return 0;
+}
+
+struct federation_node *federation_find_outbound_link(struct server_federation *federation, int link_sockfd)
+{
+	/* This node (the first) never has a link to itself */
+	for (size_t i = 1; i < federation->nodes_count; ++i) {
+		if (federation->nodes[i].outbound_sockfd == link_sockfd) return federation->nodes + i;
+	}
+	return NULL;
+}
+
+int federation_is_inbound_link(const struct server_federation *federation, int link_sockfd)
+{
+	for (size_t i = 0; i < federation->inbound_count; ++i) {
+		if (federation->inbound_sockfds[i] == link_sockfd) return 1;
+	}
+	return 0;
+}
+
+int federation_is_link(struct server_federation *federation, int link_sockfd)
+{
+	return federation_is_inbound_link(federation, link_sockfd) || federation_find_outbound_link(federation, link_sockfd) != NULL;
+}
+
+/* Gives the IPv4 or IPv6 address bytes of the given socket address, with IPv4 addresses mapped into IPv6 given as IPv4.
+   Returns the number of address bytes, or 0 if the address is of another family. */
+static size_t federation_address_bytes(const struct sockaddr *socket_address, const unsigned char **address_bytes)
+{
+	if (socket_address->sa_family == AF_INET) {
+		*address_bytes = (const unsigned char*)&((const struct sockaddr_in*)socket_address)->sin_addr;
+		return 4;
+	}
+	if (socket_address->sa_family != AF_INET6) return 0;
+
+	*address_bytes = (const unsigned char*)&((const struct sockaddr_in6*)socket_address)->sin6_addr;
+	const unsigned char mapped_prefix[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF };
+	if (memcmp(*address_bytes, mapped_prefix, sizeof mapped_prefix) != 0) return 16;
+	*address_bytes += sizeof mapped_prefix;
+	return 4;
+}
+
+/* Returns non-zero if the given socket is connected from any address of the given node's host */
+static int federation_is_node_peer(const struct federation_node *node, int link_sockfd)
+{
+	struct sockaddr_storage peer_address;
+	socklen_t peer_address_bytes = sizeof peer_address;
+	if (getpeername(link_sockfd, (struct sockaddr*)&peer_address, &peer_address_bytes) == -1) return 0;
+	const unsigned char *peer_bytes;
+	const size_t peer_bytes_count = federation_address_bytes((const struct sockaddr*)&peer_address, &peer_bytes);
+	if (peer_bytes_count == 0) return 0;
+
+	struct addrinfo address_info_hints, *node_address_list;
+	memset(&address_info_hints, 0, sizeof address_info_hints);
+	address_info_hints.ai_family = AF_UNSPEC;
+	address_info_hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(node->node_host, NULL, &address_info_hints, &node_address_list) != 0) return 0;
+
+	int is_node_peer = 0;
+	for (const struct addrinfo *address_iterator = node_address_list; address_iterator != NULL; address_iterator = address_iterator->ai_next) {
+		const unsigned char *node_bytes;
+		const size_t node_bytes_count = federation_address_bytes(address_iterator->ai_addr, &node_bytes);
+		if (node_bytes_count == peer_bytes_count && memcmp(node_bytes, peer_bytes, peer_bytes_count) == 0) {
+			is_node_peer = 1;
+			break;
+		}
+	}
+	freeaddrinfo(node_address_list);
+	return is_node_peer;
+}
+
+int federation_add_inbound_link(struct server_federation *federation, int link_sockfd, const char *node_address)
+{
+	if (federation_is_inbound_link(federation, link_sockfd)) return 0;
+
+	/* Only other nodes in the nodes list can link, which a server started without one has none of */
+	size_t node_index = 1;
+	while (node_index < federation->nodes_count && strcmp(federation->nodes[node_index].node_address, node_address) != 0) ++node_index;
+	if (node_index >= federation->nodes_count || !federation_is_node_peer(federation->nodes + node_index, link_sockfd)) return -1;
+
+	if (federation->inbound_count >= federation->inbound_alloc_count) {
+		const size_t new_alloc_count = federation->inbound_alloc_count ? federation->inbound_alloc_count * 2 : 4;
+		void *new_inbound_sockfds = realloc(federation->inbound_sockfds, sizeof *federation->inbound_sockfds * new_alloc_count);
+		if (new_inbound_sockfds == NULL) return -1;
+		federation->inbound_sockfds = new_inbound_sockfds;
+		federation->inbound_alloc_count = new_alloc_count;
+	}
+
+	federation->inbound_sockfds[federation->inbound_count++] = link_sockfd;
+	return 0;
+}
+
+void federation_remove_link(struct server_federation *federation, int link_sockfd)
+{
+	struct federation_node *outbound_node = federation_find_outbound_link(federation, link_sockfd);
+	if (outbound_node != NULL) {
+		outbound_node->outbound_sockfd = -1;
+		outbound_node->outbound_connected = 0;
+		return;
+	}
+
+	for (size_t i = 0; i < federation->inbound_count; ++i) {
+		if (federation->inbound_sockfds[i] != link_sockfd) continue;
+		federation->inbound_sockfds[i] = federation->inbound_sockfds[--federation->inbound_count];
+		return;
+	}
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NETWORK_DEMO_SERVER_FEDERATION_H */
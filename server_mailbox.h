@@ -0,0 +1,540 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#pragma once
+#ifndef NETWORK_DEMO_SERVER_MAILBOX_H
+#define NETWORK_DEMO_SERVER_MAILBOX_H
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+   Direct messages to an identity that is not connected are kept in its mailbox until a client identifies itself with
+   that identity. Messages are only ever appended to 'segment' files of a fixed size in the mailbox directory, and once a
+   segment is full the next one is started. Delivering a mailbox appends a record clearing it rather than changing any
+   earlier record, so the files are never rewritten: the oldest segment is deleted once none of its messages are waiting,
+   or (to bound the space used) when a new segment would go over the maximum number of segments.
+
+   Segments are kept mapped, with only a small entry for each waiting message held in memory: where its record is, its
+   size and when it was stored. Starting the server again maps the segments and replays their records in order, which
+   gives back the same mailboxes without allocating anything for each message. Each mailbox is bounded by a number of
+   messages and bytes, dropping its oldest messages to make room, and messages older than their lifetime are never sent.
+
+   Record layout: a 'mailbox_record_header', followed by the identity and (for message records) the message to deliver,
+   both null-terminated, padded to 8 bytes. A record of 0 bytes ends the records of a segment, as does a record whose
+   checksum does not match, such as one cut short when the machine stopped.
+*/
+
+/* Size of each segment file */
+#define MAILBOX_SEGMENT_BYTES 0x100000
+/* Maximum number of segment files, which bounds the space used by all mailboxes */
+#define MAILBOX_MAXIMUM_SEGMENTS 64
+/* Maximum number of messages and bytes waiting in a single mailbox */
+#define MAILBOX_MAXIMUM_MESSAGES 64
+#define MAILBOX_MAXIMUM_BYTES 0x40000
+/* Time for which a message is kept before being dropped */
+#define MAILBOX_MESSAGE_LIFETIME_SECONDS (7 * 24 * 60 * 60)
+
+
+/* ---- Structs ---- */
+
+/* Types of the records in a segment. */
+enum mailbox_record_type {
+	MAILBOX_MESSAGE_RECORD = 1, /* A message to the identity */
+	MAILBOX_CLEAR_RECORD = 2 /* Every earlier message to the identity was delivered */
+};
+
+/* Start of each record in a segment. */
+struct mailbox_record_header {
+	uint32_t record_bytes; /* Size of the whole record, including this header and its padding */
+	uint32_t record_checksum; /* Hash of the rest of the record after this field */
+	uint32_t record_type;
+	uint32_t stored_seconds; /* Time the record was appended, in seconds since 1970 */
+	uint32_t identity_bytes;
+	uint32_t message_bytes;
+};
+
+/* A segment file, mapped for as long as it is kept. */
+struct mailbox_segment {
+	uint32_t segment_number; /* Number in the file name, with later segments having higher numbers */
+	char *mapped_data;
+	size_t used_bytes; /* Bytes of records, after which the next record is appended */
+	size_t waiting_messages_count; /* Messages in the segment that are still in a mailbox */
+};
+
+/* Where a waiting message is stored. */
+struct mailbox_entry {
+	uint32_t segment_number;
+	uint32_t message_offset; /* Offset of the message itself within the segment */
+	uint32_t message_bytes;
+	uint32_t stored_seconds;
+};
+
+/* Messages waiting for an identity, oldest first. */
+struct mailbox {
+	char *client_identity;
+	struct mailbox_entry *entries;
+	uint32_t entries_count, entries_capacity;
+	size_t messages_bytes;
+};
+
+/* All mailboxes and the segments holding their messages. */
+struct mailbox_store {
+	char directory_path[PATH_MAX - 32];
+	struct mailbox_segment segments[MAILBOX_MAXIMUM_SEGMENTS]; /* Oldest first, with records appended to the last one */
+	size_t segments_count;
+	struct mailbox **mailboxes; /* Sorted by identity */
+	size_t mailboxes_count, mailboxes_capacity;
+};
+
+
+/* ---- Function declarations ---- */
+
+/* Opens the mailboxes in the given directory, creating it if it does not exist, and loads every message waiting in them.
+   Returns 0 on success and -1 on failure, leaving the store closed. */
+static int mailbox_store_open(struct mailbox_store *store, const char *directory_path);
+/* Unmaps every segment and frees the mailboxes, which are kept in their segment files. */
+static void mailbox_store_close(struct mailbox_store *store);
+
+/* Appends the given message (including its terminator) to the mailbox of the given identity, dropping the oldest messages
+   in the mailbox if it is full. Returns 0 on success and -1 if the message could not be stored. */
+static int mailbox_store_append(
+	struct mailbox_store *store,
+	const char *client_identity,
+	const char *message,
+	size_t message_bytes,
+	uint32_t current_seconds
+);
+/* Returns the total size of the messages waiting for the given identity that have not expired, giving their number. */
+static size_t mailbox_store_count_bytes(const struct mailbox_store *store, const char *client_identity, uint32_t current_seconds, size_t *messages_count);
+/* Copies the messages waiting for the given identity that have not expired one after another to the given buffer (of the size
+   given by 'mailbox_store_count_bytes'), and clears the mailbox. Returns 0 on success and -1 if the mailbox could not be cleared
+   in its segment, in which case the messages are still copied but also kept to be delivered again. */
+static int mailbox_store_deliver(struct mailbox_store *store, const char *client_identity, uint32_t current_seconds, char *messages_data);
+
+
+/* ---- Function definitions ---- */
+
+
+/* 32-bit FNV-1a hash of the given bytes, as the checksum of a record */
+static uint32_t mailbox_hash_bytes(const char *hashed_bytes, size_t hashed_bytes_count)
+{
+	uint32_t mailbox_hash = 0x811C9DC5U;
+	for (size_t i = 0; i < hashed_bytes_count; ++i) {
+		mailbox_hash ^= (unsigned char)hashed_bytes[i];
+		mailbox_hash *= 0x01000193U;
+	}
+	return mailbox_hash;
+}
+
+/* Writes the path of the segment with the given number to the given buffer of 'PATH_MAX' bytes */
+static void mailbox_segment_path(const struct mailbox_store *store, uint32_t segment_number, char *segment_path)
+{
+	snprintf(segment_path, PATH_MAX, "%s/segment.%u", store->directory_path, (unsigned)segment_number);
+}
+
+/* Returns the segment with the given number, or NULL if it was already deleted */
+static struct mailbox_segment *mailbox_find_segment(struct mailbox_store *store, uint32_t segment_number)
+{
+	for (size_t i = 0; i < store->segments_count; ++i) {
+		if (store->segments[i].segment_number == segment_number) return store->segments + i;
+	}
+	return NULL;
+}
+
+/* Returns the index of the given identity's mailbox, or the index it would be inserted at (with 'is_found' set to 0) */
+static size_t mailbox_find_index(const struct mailbox_store *store, const char *client_identity, int *is_found)
+{
+	size_t lower_index = 0, upper_index = store->mailboxes_count;
+	while (lower_index < upper_index) {
+		const size_t middle_index = lower_index + (upper_index - lower_index) / 2;
+		const int compare_result = strcmp(store->mailboxes[middle_index]->client_identity, client_identity);
+		if (compare_result == 0) {
+			*is_found = 1;
+			return middle_index;
+		}
+		if (compare_result < 0) lower_index = middle_index + 1;
+		else upper_index = middle_index;
+	}
+	*is_found = 0;
+	return lower_index;
+}
+
+/* Drops the given number of oldest messages from a mailbox, which then no longer keep their segments */
+static void mailbox_drop_oldest(struct mailbox_store *store, struct mailbox *mailbox, uint32_t dropped_count)
+{
+	for (uint32_t i = 0; i < dropped_count; ++i) {
+		const struct mailbox_entry *entry = mailbox->entries + i;
+		struct mailbox_segment *segment = mailbox_find_segment(store, entry->segment_number);
+		if (segment != NULL) --segment->waiting_messages_count;
+		mailbox->messages_bytes -= entry->message_bytes;
+	}
+	mailbox->entries_count -= dropped_count;
+	memmove(mailbox->entries, mailbox->entries + dropped_count, sizeof *mailbox->entries * mailbox->entries_count);
+}
+
+/* Frees the mailbox at the given index if it has no messages left */
+static void mailbox_remove_if_empty(struct mailbox_store *store, size_t mailbox_index)
+{
+	struct mailbox *mailbox = store->mailboxes[mailbox_index];
+	if (mailbox->entries_count != 0) return;
+	free(mailbox->client_identity);
+	free(mailbox->entries);
+	free(mailbox);
+	--store->mailboxes_count;
+	memmove(store->mailboxes + mailbox_index, store->mailboxes + mailbox_index + 1, sizeof *store->mailboxes * (store->mailboxes_count - mailbox_index));
+}
+
+/* Drops every message stored before the given time from every mailbox */
+static void mailbox_drop_expired(struct mailbox_store *store, uint32_t oldest_kept_seconds)
+{
+	for (size_t i = store->mailboxes_count; i-- > 0;) {
+		struct mailbox *mailbox = store->mailboxes[i];
+		uint32_t expired_count = 0;
+		while (expired_count < mailbox->entries_count && mailbox->entries[expired_count].stored_seconds < oldest_kept_seconds) ++expired_count;
+		mailbox_drop_oldest(store, mailbox, expired_count);
+		mailbox_remove_if_empty(store, i);
+	}
+}
+
+/* Deletes the oldest segments for as long as none of their messages are waiting, besides the one being appended to */
+static void mailbox_delete_unused_segments(struct mailbox_store *store)
+{
+	/* Only the oldest segments are deleted, as the clearing records in a segment are needed for as long as any earlier segment is kept */
+	size_t deleted_count = 0;
+	while (deleted_count + 1 < store->segments_count && store->segments[deleted_count].waiting_messages_count == 0) {
+		struct mailbox_segment *segment = store->segments + deleted_count++;
+		char segment_path[PATH_MAX];
+		mailbox_segment_path(store, segment->segment_number, segment_path);
+		munmap(segment->mapped_data, MAILBOX_SEGMENT_BYTES);
+		unlink(segment_path);
+	}
+	store->segments_count -= deleted_count;
+	memmove(store->segments, store->segments + deleted_count, sizeof *store->segments * store->segments_count);
+}
+
+/* Maps the segment file with the given number, creating it if it does not exist. Returns 0 on success and -1 on failure. */
+static int mailbox_map_segment(struct mailbox_store *store, uint32_t segment_number, struct mailbox_segment *segment)
+{
+	char segment_path[PATH_MAX];
+	mailbox_segment_path(store, segment_number, segment_path);
+	const int segment_fd = open(segment_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (segment_fd == -1) return -1;
+
+	/* New segments are sized in full straight away, with the unused bytes reading as the end of the records */
+	struct stat segment_stat;
+	if (fstat(segment_fd, &segment_stat) == -1 ||
+	    (segment_stat.st_size != MAILBOX_SEGMENT_BYTES && ftruncate(segment_fd, MAILBOX_SEGMENT_BYTES) == -1)
+	) {
+		close(segment_fd);
+		return -1;
+	}
+	segment->mapped_data = mmap(NULL, MAILBOX_SEGMENT_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, segment_fd, 0);
+	close(segment_fd);
+	if (segment->mapped_data == MAP_FAILED) return -1;
+
+	segment->segment_number = segment_number;
+	segment->used_bytes = 0;
+	segment->waiting_messages_count = 0;
+	return 0;
+}
+
+/* Starts a new segment to append records to, making room for it by dropping every message in the oldest segment if there
+   are too many segments. Returns 0 on success and -1 on failure. */
+static int mailbox_start_segment(struct mailbox_store *store, uint32_t current_seconds)
+{
+	/* Expired messages are only looked for here, as that is when their segments would next be deleted */
+	mailbox_drop_expired(store, current_seconds > MAILBOX_MESSAGE_LIFETIME_SECONDS ? current_seconds - MAILBOX_MESSAGE_LIFETIME_SECONDS : 0);
+	mailbox_delete_unused_segments(store);
+
+	if (store->segments_count == MAILBOX_MAXIMUM_SEGMENTS) {
+		const uint32_t oldest_segment_number = store->segments[0].segment_number;
+		for (size_t i = store->mailboxes_count; i-- > 0;) {
+			struct mailbox *mailbox = store->mailboxes[i];
+			uint32_t dropped_count = 0;
+			while (dropped_count < mailbox->entries_count && mailbox->entries[dropped_count].segment_number == oldest_segment_number) ++dropped_count;
+			mailbox_drop_oldest(store, mailbox, dropped_count);
+			mailbox_remove_if_empty(store, i);
+		}
+		mailbox_delete_unused_segments(store);
+	}
+
+	const uint32_t segment_number = store->segments_count != 0 ? store->segments[store->segments_count - 1].segment_number + 1 : 0;
+	if (mailbox_map_segment(store, segment_number, store->segments + store->segments_count) == -1) return -1;
+	++store->segments_count;
+	return 0;
+}
+
+/* Adds a message record to the mailbox of its identity, creating the mailbox if needed. Returns 0 on success and -1 on failure. */
+static int mailbox_add_entry(struct mailbox_store *store, const char *client_identity, const struct mailbox_entry *new_entry)
+{
+	int is_found;
+	const size_t mailbox_index = mailbox_find_index(store, client_identity, &is_found);
+	if (!is_found) {
+		if (store->mailboxes_count == store->mailboxes_capacity) {
+			const size_t new_capacity = store->mailboxes_capacity ? store->mailboxes_capacity * 2 : 16;
+			struct mailbox **new_mailboxes = realloc(store->mailboxes, sizeof *new_mailboxes * new_capacity);
+			if (new_mailboxes == NULL) return -1;
+			store->mailboxes = new_mailboxes;
+			store->mailboxes_capacity = new_capacity;
+		}
+
+		struct mailbox *new_mailbox = calloc(1, sizeof *new_mailbox);
+		if (new_mailbox == NULL) return -1;
+		if ((new_mailbox->client_identity = strdup(client_identity)) == NULL) {
+			free(new_mailbox);
+			return -1;
+		}
+		memmove(store->mailboxes + mailbox_index + 1, store->mailboxes + mailbox_index, sizeof *store->mailboxes * (store->mailboxes_count - mailbox_index));
+		store->mailboxes[mailbox_index] = new_mailbox;
+		++store->mailboxes_count;
+	}
+	struct mailbox *mailbox = store->mailboxes[mailbox_index];
+
+	/* Make room by dropping the oldest messages, as a mailbox is never let past its bounds */
+	uint32_t dropped_count = 0;
+	size_t remaining_bytes = mailbox->messages_bytes;
+	while (dropped_count < mailbox->entries_count &&
+	       (mailbox->entries_count - dropped_count >= MAILBOX_MAXIMUM_MESSAGES || remaining_bytes + new_entry->message_bytes > MAILBOX_MAXIMUM_BYTES)
+	) remaining_bytes -= mailbox->entries[dropped_count++].message_bytes;
+	mailbox_drop_oldest(store, mailbox, dropped_count);
+
+	/* Entries are grown by doubling up to the maximum number of messages, so loading does not allocate for each message */
+	if (mailbox->entries_count == mailbox->entries_capacity) {
+		const uint32_t new_capacity = mailbox->entries_capacity ? mailbox->entries_capacity * 2 : 4;
+		struct mailbox_entry *new_entries = realloc(mailbox->entries, sizeof *new_entries * new_capacity);
+		if (new_entries == NULL) {
+			mailbox_remove_if_empty(store, mailbox_index);
+			return -1;
+		}
+		mailbox->entries = new_entries;
+		mailbox->entries_capacity = new_capacity;
+	}
+	mailbox->entries[mailbox->entries_count++] = *new_entry;
+	mailbox->messages_bytes += new_entry->message_bytes;
+
+	struct mailbox_segment *segment = mailbox_find_segment(store, new_entry->segment_number);
+	if (segment != NULL) ++segment->waiting_messages_count;
+	return 0;
+}
+
+/* Drops every message waiting for the given identity */
+static void mailbox_clear_entries(struct mailbox_store *store, const char *client_identity)
+{
+	int is_found;
+	const size_t mailbox_index = mailbox_find_index(store, client_identity, &is_found);
+	if (!is_found) return;
+	mailbox_drop_oldest(store, store->mailboxes[mailbox_index], store->mailboxes[mailbox_index]->entries_count);
+	mailbox_remove_if_empty(store, mailbox_index);
+}
+
+/* Appends a record to the last segment, starting a new segment if it does not fit. Returns the offset of the record's message
+   within the segment on success and 0 on failure. */
+static size_t mailbox_append_record(
+	struct mailbox_store *store,
+	enum mailbox_record_type record_type,
+	const char *client_identity,
+	const char *message,
+	size_t message_bytes,
+	uint32_t current_seconds
+) {
+	const size_t identity_bytes = strlen(client_identity) + 1;
+	const size_t record_bytes = (sizeof(struct mailbox_record_header) + identity_bytes + message_bytes + 7) & ~(size_t)7;
+	if (record_bytes > MAILBOX_SEGMENT_BYTES) return 0;
+
+	if ((store->segments_count == 0 || store->segments[store->segments_count - 1].used_bytes + record_bytes > MAILBOX_SEGMENT_BYTES) &&
+	    mailbox_start_segment(store, current_seconds) == -1
+	) return 0;
+	struct mailbox_segment *segment = store->segments + store->segments_count - 1;
+
+	/* The record is written straight into the mapping, which the kernel writes back to the file even if the server crashes */
+	char *record_data = segment->mapped_data + segment->used_bytes;
+	struct mailbox_record_header header = {
+		(uint32_t)record_bytes, 0, (uint32_t)record_type, current_seconds, (uint32_t)identity_bytes, (uint32_t)message_bytes
+	};
+	const size_t message_offset = sizeof header + identity_bytes;
+	memcpy(record_data + sizeof header, client_identity, identity_bytes);
+	if (message_bytes != 0) memcpy(record_data + message_offset, message, message_bytes);
+	memset(record_data + message_offset + message_bytes, 0, record_bytes - message_offset - message_bytes);
+	memcpy(record_data, &header, sizeof header);
+	header.record_checksum = mailbox_hash_bytes(record_data + 8, record_bytes - 8);
+	memcpy(record_data + 4, &header.record_checksum, sizeof header.record_checksum);
+
+	segment->used_bytes += record_bytes;
+	return segment->used_bytes - record_bytes + message_offset;
+}
+
+/* Replays the records of the given segment into the mailboxes, finding where its records end. Returns 0 on success and -1 on failure. */
+static int mailbox_load_segment(struct mailbox_store *store, struct mailbox_segment *segment)
+{
+	while (segment->used_bytes + sizeof(struct mailbox_record_header) <= MAILBOX_SEGMENT_BYTES) {
+		const char *record_data = segment->mapped_data + segment->used_bytes;
+		struct mailbox_record_header header;
+		memcpy(&header, record_data, sizeof header);
+
+		/* Anything that is not a whole record ends the segment, and is written over by the next record appended */
+		if (header.record_bytes < sizeof header ||
+		    header.record_bytes > MAILBOX_SEGMENT_BYTES - segment->used_bytes ||
+		    (size_t)header.identity_bytes + header.message_bytes > header.record_bytes - sizeof header ||
+		    header.identity_bytes < 2 ||
+		    record_data[sizeof header + header.identity_bytes - 1] != '\0' ||
+		    header.record_checksum != mailbox_hash_bytes(record_data + 8, header.record_bytes - 8)
+		) break;
+
+		const char *client_identity = record_data + sizeof header;
+		if (header.record_type == MAILBOX_MESSAGE_RECORD) {
+			const struct mailbox_entry new_entry = {
+				segment->segment_number,
+				(uint32_t)(segment->used_bytes + sizeof header + header.identity_bytes),
+				header.message_bytes,
+				header.stored_seconds
+			};
+			if (mailbox_add_entry(store, client_identity, &new_entry) == -1) return -1;
+		}
+		else if (header.record_type == MAILBOX_CLEAR_RECORD) mailbox_clear_entries(store, client_identity);
+		segment->used_bytes += header.record_bytes;
+	}
+	return 0;
+}
+
+/* Comparison function for sorting segment numbers */
+static int mailbox_compare_numbers(const void *first_number, const void *second_number)
+{
+	const uint32_t first_value = *(const uint32_t*)first_number, second_value = *(const uint32_t*)second_number;
+	return (first_value > second_value) - (first_value < second_value);
+}
+
+
+int mailbox_store_open(struct mailbox_store *store, const char *directory_path)
+{
+	memset(store, 0, sizeof *store);
+	if (snprintf(store->directory_path, sizeof store->directory_path, "%s", directory_path) >= (int)sizeof store->directory_path) return -1;
+	if (mkdir(directory_path, 0700) == -1 && errno != EEXIST) return -1;
+
+	/* Find the numbers of every segment, to replay them in the order they were written */
+	DIR *mailbox_directory = opendir(directory_path);
+	if (mailbox_directory == NULL) return -1;
+	uint32_t segment_numbers[MAILBOX_MAXIMUM_SEGMENTS];
+	size_t segment_numbers_count = 0;
+	const struct dirent *directory_entry;
+	while ((directory_entry = readdir(mailbox_directory)) != NULL) {
+		unsigned segment_number;
+		char name_end;
+		if (sscanf(directory_entry->d_name, "segment.%u%c", &segment_number, &name_end) != 1) continue;
+		if (segment_numbers_count == MAILBOX_MAXIMUM_SEGMENTS) {
+			closedir(mailbox_directory);
+			return -1;
+		}
+		segment_numbers[segment_numbers_count++] = (uint32_t)segment_number;
+	}
+	closedir(mailbox_directory);
+	qsort(segment_numbers, segment_numbers_count, sizeof *segment_numbers, mailbox_compare_numbers);
+
+	for (size_t i = 0; i < segment_numbers_count; ++i) {
+		struct mailbox_segment *segment = store->segments + store->segments_count;
+		if (mailbox_map_segment(store, segment_numbers[i], segment) == -1) goto open_failed;
+		++store->segments_count;
+		if (mailbox_load_segment(store, segment) == -1) goto open_failed;
+	}
+	mailbox_delete_unused_segments(store);
+	return 0;
+
+open_failed:
+	mailbox_store_close(store);
+	return -1;
+}
+
+void mailbox_store_close(struct mailbox_store *store)
+{
+	for (size_t i = 0; i < store->segments_count; ++i) munmap(store->segments[i].mapped_data, MAILBOX_SEGMENT_BYTES);
+	for (size_t i = 0; i < store->mailboxes_count; ++i) {
+		free(store->mailboxes[i]->client_identity);
+		free(store->mailboxes[i]->entries);
+		free(store->mailboxes[i]);
+	}
+	free(store->mailboxes);
+	memset(store, 0, sizeof *store);
+}
+
+int mailbox_store_append(
+	struct mailbox_store *store,
+	const char *client_identity,
+	const char *message,
+	size_t message_bytes,
+	uint32_t current_seconds
+) {
+	if (message_bytes > MAILBOX_MAXIMUM_BYTES) return -1;
+	const size_t message_offset = mailbox_append_record(store, MAILBOX_MESSAGE_RECORD, client_identity, message, message_bytes, current_seconds);
+	if (message_offset == 0) return -1;
+
+	/* The record is already in its segment, so it is given back after a restart even if it cannot be added now */
+	const struct mailbox_entry new_entry = {
+		store->segments[store->segments_count - 1].segment_number,
+		(uint32_t)message_offset,
+		(uint32_t)message_bytes,
+		current_seconds
+	};
+	return mailbox_add_entry(store, client_identity, &new_entry);
+}
+
+size_t mailbox_store_count_bytes(const struct mailbox_store *store, const char *client_identity, uint32_t current_seconds, size_t *messages_count)
+{
+	*messages_count = 0;
+	int is_found;
+	const size_t mailbox_index = mailbox_find_index(store, client_identity, &is_found);
+	if (!is_found) return 0;
+
+	const struct mailbox *mailbox = store->mailboxes[mailbox_index];
+	size_t messages_bytes = 0;
+	for (uint32_t i = 0; i < mailbox->entries_count; ++i) {
+		if (mailbox->entries[i].stored_seconds + MAILBOX_MESSAGE_LIFETIME_SECONDS < current_seconds) continue;
+		messages_bytes += mailbox->entries[i].message_bytes;
+		++*messages_count;
+	}
+	return messages_bytes;
+}
+
+int mailbox_store_deliver(struct mailbox_store *store, const char *client_identity, uint32_t current_seconds, char *messages_data)
+{
+	int is_found;
+	const size_t mailbox_index = mailbox_find_index(store, client_identity, &is_found);
+	if (!is_found) return 0;
+
+	/* Messages are copied straight from the mapped segments, in the order they were stored */
+	const struct mailbox *mailbox = store->mailboxes[mailbox_index];
+	for (uint32_t i = 0; i < mailbox->entries_count; ++i) {
+		const struct mailbox_entry *entry = mailbox->entries + i;
+		if (entry->stored_seconds + MAILBOX_MESSAGE_LIFETIME_SECONDS < current_seconds) continue;
+		const struct mailbox_segment *segment = mailbox_find_segment(store, entry->segment_number);
+		memcpy(messages_data, segment->mapped_data + entry->message_offset, entry->message_bytes);
+		messages_data += entry->message_bytes;
+	}
+
+	/* Only drop the messages once it is recorded that they were delivered, so that they are not delivered again after a restart */
+	if (mailbox_append_record(store, MAILBOX_CLEAR_RECORD, client_identity, NULL, 0, current_seconds) == 0) return -1;
+	mailbox_clear_entries(store, client_identity);
+	mailbox_delete_unused_segments(store);
+	return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NETWORK_DEMO_SERVER_MAILBOX_H */
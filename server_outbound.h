@@ -0,0 +1,456 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#pragma once
+#ifndef NETWORK_DEMO_SERVER_OUTBOUND_H
+#define NETWORK_DEMO_SERVER_OUTBOUND_H
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <time.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+   Messages sent to a connection are queued in one of several 'lanes' and sent whenever the connection's
+   socket is writable. Control messages (pulses, command replies, redirects and kick notices) use their
+   own lane, which is always drained before the bulk lane holding chat messages, so they never wait
+   behind a backlog of chat messages for a slow connection. As messages cannot be interleaved, a message
+   that was only partially sent is always finished first, so control messages only jump ahead of bulk
+   messages at message boundaries.
+
+   The delay of the bulk lane is managed similarly to CoDel ('Controlled Delay'), using the time each message
+   has spent in the queue rather than its length. Short bursts are let through, but once the oldest bulk message
+   has waited longer than the target delay for a whole interval, the oldest bulk messages are dropped until the
+   delay is back under the target. Unlike CoDel, all late messages are dropped at once rather than one at a time,
+   as the clients sending them do not slow down on drops as TCP senders would. Control messages are never dropped.
+   This keeps the delay of chat messages to a slow client bounded, rather than having them pile up (or be cut off
+   at a fixed length that is either too small for bursts or too large to keep up with).
+
+   Payloads can also be given a conflation key, for messages where only the latest value matters (such as a
+   client's status). Queueing such a payload replaces the payload of a message with the same key that is still
+   waiting in the same lane, keeping its place in the queue, so a slow connection is only sent the latest value.
+
+   Messages can be given a release time, before which they are not sent, to pace messages sent to many connections
+   at once over a period of time. As each lane is sent in order, a message waiting for its release time also holds
+   back the messages queued after it in the same lane.
+
+   Chunks of messages streamed through the server use the last lane, drained after chat messages. They are never
+   dropped, as a stream missing a chunk is corrupt, so the sender of a stream is held back instead while any of its
+   recipients still has too many bytes waiting to be sent.
+*/
+
+/* Maximum number of messages written with a single 'sendmsg' call */
+#define OUTBOUND_MAXIMUM_BATCH_MESSAGES 64
+
+/* Delay of the oldest bulk message that is accepted for any amount of time */
+#define OUTBOUND_TARGET_DELAY_NANOSECONDS 50000000ULL
+/* Time the delay has to stay above the target before messages are dropped */
+#define OUTBOUND_DELAY_INTERVAL_NANOSECONDS 500000000ULL
+
+
+/* ---- Structs ---- */
+
+/* Lanes of an outbound queue, in the order they are drained. */
+enum outbound_lane {
+	OUTBOUND_CONTROL_LANE,
+	OUTBOUND_BULK_LANE,
+	OUTBOUND_STREAM_LANE,
+	OUTBOUND_LANES_COUNT
+};
+
+/* Contents of a message, shared by every queue it was sent to and freed once all of them have sent it. */
+struct outbound_payload {
+	size_t reference_count; /* Number of queued messages (and creators) still using this payload */
+	size_t payload_bytes;
+	size_t conflation_key_bytes; /* Size of the conflation key stored after the payload data, or 0 if not conflatable */
+	uint64_t conflation_key_hash; /* Hash of the conflation key, to quickly skip messages with different keys */
+	char payload_data[];
+};
+
+/* A message waiting in an outbound queue. */
+struct outbound_message {
+	struct outbound_message *next_message;
+	struct outbound_payload *payload;
+	uint64_t release_time_nanoseconds; /* Time the message can be sent from (when it was queued unless paced), for measuring how long it waited */
+};
+
+/* Messages waiting to be sent to a single connection. */
+struct outbound_queue {
+	struct outbound_message *lane_heads[OUTBOUND_LANES_COUNT]; /* First message of each lane, sent next */
+	struct outbound_message *lane_tails[OUTBOUND_LANES_COUNT]; /* Last message of each lane, where messages are added */
+
+	struct outbound_message *partial_message; /* Message only partially sent, which is finished before any other */
+	size_t partial_message_sent_bytes;
+
+	size_t queued_messages_count, queued_bytes; /* Totals of all lanes, including the partial message */
+
+	uint64_t delay_above_target_deadline; /* Time at which messages are dropped if the delay stays above the target, or 0 if below */
+
+	size_t dropped_messages_count, dropped_bytes; /* Totals of bulk messages dropped from this queue */
+	size_t conflatable_messages_count; /* Number of waiting messages with a conflation key, to skip searching when there are none */
+	size_t conflated_messages_count; /* Total messages replaced by a newer value before being sent */
+};
+
+
+/* ---- Function declarations ---- */
+
+/* Allocates a payload of the given size with a single reference held by the caller, to be filled in before queueing.
+   Returns NULL on allocation failure. */
+static struct outbound_payload *outbound_payload_create(size_t payload_bytes);
+/* Creates a payload holding a copy of the given bytes. Returns NULL on allocation failure. */
+static struct outbound_payload *outbound_payload_copy(const char *payload_data, size_t payload_bytes);
+/* Creates a payload holding a copy of the given bytes that replaces any waiting message with the same conflation key when queued.
+   Returns NULL on allocation failure. */
+static struct outbound_payload *outbound_payload_copy_conflatable(const char *payload_data, size_t payload_bytes, const char *conflation_key);
+/* Releases a reference to the given payload, freeing it if there are no references left. */
+static void outbound_payload_release(struct outbound_payload *payload);
+
+/* Adds the given payload to the end of a lane, taking a new reference to it, to be sent from the given release time (or straight away
+   if it is 0). A conflatable payload instead replaces the payload of a message with the same key waiting in the same lane, if there
+   is one, keeping its release time. Returns 0 on success and -1 on allocation failure. */
+static int outbound_queue_push(
+	struct outbound_queue *queue,
+	enum outbound_lane lane,
+	struct outbound_payload *payload,
+	uint64_t release_time_nanoseconds
+);
+/* Sends as many queued messages as possible to the given socket without blocking, with control messages first.
+   Returns 0 if the queue is now empty, 1 if messages remain (the socket is full) and -1 on error. */
+static int outbound_queue_flush(struct outbound_queue *queue, int target_sockfd);
+/* Drops the oldest bulk messages if they have waited too long, as explained above. This is done whenever the queue is flushed,
+   but should also be done when adding to a queue that already has messages waiting, as a stalled connection is never flushed.
+   Returns the number of messages dropped. */
+static size_t outbound_queue_control_delay(struct outbound_queue *queue);
+/* Returns the earliest time any waiting message can be sent at, which is in the past if messages can be sent now.
+   Returns 0 if there are no messages waiting. */
+static uint64_t outbound_queue_next_release_time(const struct outbound_queue *queue);
+/* Returns the current time of the monotonic clock in nanoseconds, which release times are given in. */
+static uint64_t outbound_current_time(void);
+/* Has 'outbound_current_time' return the time stored at the given address (such as the time of the current round of an
+   event loop) rather than reading the clock on every call, or read the clock again if NULL. The clock is still read
+   whilst the stored time is 0. */
+static void outbound_use_cached_time(const uint64_t *cached_time_nanoseconds);
+/* Returns non-zero if there are no messages waiting in the queue. */
+static int outbound_queue_is_empty(const struct outbound_queue *queue);
+/* Returns non-zero if every control message was sent, with no message left partially sent ahead of any other. */
+static int outbound_queue_is_control_sent(const struct outbound_queue *queue);
+/* Discards every message in the queue, keeping the totals of dropped and conflated messages. */
+static void outbound_queue_clear(struct outbound_queue *queue);
+/* Discards every message waiting in the given lane, other than one already partially sent. */
+static void outbound_queue_clear_lane(struct outbound_queue *queue, enum outbound_lane lane);
+
+
+/* ---- Function definitions ---- */
+
+
+struct outbound_payload *outbound_payload_create(size_t payload_bytes)
+{
+	struct outbound_payload *new_payload = malloc(sizeof *new_payload + payload_bytes);
+	if (new_payload == NULL) return NULL;
+	new_payload->reference_count = 1;
+	new_payload->payload_bytes = payload_bytes;
+	new_payload->conflation_key_bytes = 0;
+	new_payload->conflation_key_hash = 0;
+	return new_payload;
+}
+
+struct outbound_payload *outbound_payload_copy(const char *payload_data, size_t payload_bytes)
+{
+	struct outbound_payload *new_payload = outbound_payload_create(payload_bytes);
+	if (new_payload != NULL) memcpy(new_payload->payload_data, payload_data, payload_bytes);
+	return new_payload;
+}
+
+struct outbound_payload *outbound_payload_copy_conflatable(const char *payload_data, size_t payload_bytes, const char *conflation_key)
+{
+	/* The key is stored after the payload data in the same allocation */
+	const size_t conflation_key_bytes = strlen(conflation_key) + 1;
+	struct outbound_payload *new_payload = outbound_payload_create(payload_bytes + conflation_key_bytes);
+	if (new_payload == NULL) return NULL;
+
+	new_payload->payload_bytes = payload_bytes;
+	new_payload->conflation_key_bytes = conflation_key_bytes;
+	memcpy(new_payload->payload_data, payload_data, payload_bytes);
+	memcpy(new_payload->payload_data + payload_bytes, conflation_key, conflation_key_bytes);
+
+	/* 64-bit FNV-1a hash of the key */
+	uint64_t conflation_key_hash = 0xCBF29CE484222325ULL;
+	for (size_t i = 0; i < conflation_key_bytes; ++i) {
+		conflation_key_hash ^= (unsigned char)conflation_key[i];
+		conflation_key_hash *= 0x100000001B3ULL;
+	}
+	new_payload->conflation_key_hash = conflation_key_hash;
+	return new_payload;
+}
+
+void outbound_payload_release(struct outbound_payload *payload)
+{
+	if (--payload->reference_count == 0) free(payload);
+}
+
+/* Time used by 'outbound_current_time' instead of the clock, if set */
+static const uint64_t *outbound_cached_time_nanoseconds = NULL;
+
+uint64_t outbound_current_time(void)
+{
+	if (outbound_cached_time_nanoseconds != NULL && *outbound_cached_time_nanoseconds != 0) return *outbound_cached_time_nanoseconds;
+
+	struct timespec current_time;
+	clock_gettime(CLOCK_MONOTONIC, &current_time);
+	return (uint64_t)current_time.tv_sec * 1000000000ULL + (uint64_t)current_time.tv_nsec;
+}
+
+void outbound_use_cached_time(const uint64_t *cached_time_nanoseconds)
+{
+	outbound_cached_time_nanoseconds = cached_time_nanoseconds;
+}
+
+/* Frees the given queued message, releasing its payload. */
+static void outbound_message_free(struct outbound_queue *queue, struct outbound_message *message)
+{
+	--queue->queued_messages_count;
+	queue->queued_bytes -= message->payload->payload_bytes;
+	if (message->payload->conflation_key_bytes != 0) --queue->conflatable_messages_count;
+	outbound_payload_release(message->payload);
+	free(message);
+}
+
+/* Removes and returns the first message of the given lane. The lane must not be empty. */
+static struct outbound_message *outbound_queue_pop(struct outbound_queue *queue, enum outbound_lane lane)
+{
+	struct outbound_message *popped_message = queue->lane_heads[lane];
+	if ((queue->lane_heads[lane] = popped_message->next_message) == NULL) queue->lane_tails[lane] = NULL;
+	popped_message->next_message = NULL;
+	return popped_message;
+}
+
+
+/* Returns non-zero if the given payloads have the same conflation key. */
+static int outbound_payload_same_key(const struct outbound_payload *first_payload, const struct outbound_payload *second_payload)
+{
+	return first_payload->conflation_key_hash == second_payload->conflation_key_hash &&
+	       first_payload->conflation_key_bytes == second_payload->conflation_key_bytes &&
+	       memcmp(
+	           first_payload->payload_data + first_payload->payload_bytes,
+	           second_payload->payload_data + second_payload->payload_bytes,
+	           first_payload->conflation_key_bytes
+	       ) == 0;
+}
+
+int outbound_queue_push(
+	struct outbound_queue *queue,
+	enum outbound_lane lane,
+	struct outbound_payload *payload,
+	uint64_t release_time_nanoseconds
+) {
+	/*
+	   Replace the value of a waiting message with the same key, keeping its place and release time. A message that was
+	   partially sent is not in any lane, so it is never replaced (which would otherwise send a mix of both values).
+	*/
+	if (payload->conflation_key_bytes != 0 && queue->conflatable_messages_count != 0) {
+		for (struct outbound_message *current_message = queue->lane_heads[lane];
+		     current_message != NULL;
+		     current_message = current_message->next_message
+		) {
+			if (current_message->payload->conflation_key_bytes == 0 ||
+			    !outbound_payload_same_key(current_message->payload, payload)
+			) continue;
+
+			queue->queued_bytes += payload->payload_bytes - current_message->payload->payload_bytes;
+			outbound_payload_release(current_message->payload);
+			current_message->payload = payload;
+			++payload->reference_count;
+			++queue->conflated_messages_count;
+			return 0;
+		}
+	}
+
+	struct outbound_message *new_message = malloc(sizeof *new_message);
+	if (new_message == NULL) return -1;
+
+	new_message->next_message = NULL;
+	new_message->payload = payload;
+	new_message->release_time_nanoseconds = release_time_nanoseconds ? release_time_nanoseconds : outbound_current_time();
+	++payload->reference_count;
+
+	if (queue->lane_tails[lane] != NULL) queue->lane_tails[lane]->next_message = new_message;
+	else queue->lane_heads[lane] = new_message;
+	queue->lane_tails[lane] = new_message;
+
+	++queue->queued_messages_count;
+	queue->queued_bytes += payload->payload_bytes;
+	if (payload->conflation_key_bytes != 0) ++queue->conflatable_messages_count;
+	return 0;
+}
+
+int outbound_queue_flush(struct outbound_queue *queue, int target_sockfd)
+{
+	outbound_queue_control_delay(queue);
+	const uint64_t current_time_nanoseconds = outbound_current_time();
+
+	while (!outbound_queue_is_empty(queue)) {
+		/*
+		   Gather the messages in the order they should be sent: the rest of the partially sent message, then every lane
+		   in order of priority. All lanes are written in the same call, so control messages are sent along with bulk
+		   messages rather than taking an extra call (and wakeup of the connection) of their own.
+		   Each lane stops at the first message that has not been released yet.
+		*/
+		struct iovec batch_parts[OUTBOUND_MAXIMUM_BATCH_MESSAGES];
+		size_t batch_parts_count = 0, lane_batch_counts[OUTBOUND_LANES_COUNT] = { 0 };
+
+		if (queue->partial_message != NULL) {
+			batch_parts[0].iov_base = queue->partial_message->payload->payload_data + queue->partial_message_sent_bytes;
+			batch_parts[0].iov_len = queue->partial_message->payload->payload_bytes - queue->partial_message_sent_bytes;
+			batch_parts_count = 1;
+		}
+		for (int lane = 0; lane < OUTBOUND_LANES_COUNT; ++lane) {
+			for (const struct outbound_message *current_message = queue->lane_heads[lane];
+			     current_message != NULL &&
+			         current_message->release_time_nanoseconds <= current_time_nanoseconds &&
+			         batch_parts_count < OUTBOUND_MAXIMUM_BATCH_MESSAGES;
+			     current_message = current_message->next_message
+			) {
+				batch_parts[batch_parts_count].iov_base = current_message->payload->payload_data;
+				batch_parts[batch_parts_count++].iov_len = current_message->payload->payload_bytes;
+				++lane_batch_counts[lane];
+			}
+		}
+		if (batch_parts_count == 0) return 1; /* Every waiting message is waiting for its release time */
+
+		/* Send without blocking (the connection could be slow) or raising SIGPIPE (the connection could have closed) */
+		struct msghdr batch_header;
+		memset(&batch_header, 0, sizeof batch_header);
+		batch_header.msg_iov = batch_parts;
+		batch_header.msg_iovlen = batch_parts_count;
+
+		ssize_t batch_sent_bytes = sendmsg(target_sockfd, &batch_header, MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (batch_sent_bytes == -1) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) return 1; /* Socket is full, wait until it is writable */
+			if (errno == EINTR) continue;
+			return -1;
+		}
+		size_t remaining_sent_bytes = (size_t)batch_sent_bytes;
+
+		/* Free every message that was fully sent, in the same order as they were gathered */
+		if (queue->partial_message != NULL) {
+			const size_t partial_remaining_bytes = batch_parts[0].iov_len;
+			if (remaining_sent_bytes < partial_remaining_bytes) {
+				queue->partial_message_sent_bytes += remaining_sent_bytes;
+				return 1;
+			}
+			remaining_sent_bytes -= partial_remaining_bytes;
+			outbound_message_free(queue, queue->partial_message);
+			queue->partial_message = NULL;
+		}
+
+		for (int lane = 0; lane < OUTBOUND_LANES_COUNT; ++lane) {
+			for (size_t i = 0; i < lane_batch_counts[lane] && remaining_sent_bytes != 0; ++i) {
+				const size_t message_bytes = queue->lane_heads[lane]->payload->payload_bytes;
+				struct outbound_message *sent_message = outbound_queue_pop(queue, lane);
+
+				/* A message that was cut off has to be finished before any other message */
+				if (remaining_sent_bytes < message_bytes) {
+					queue->partial_message = sent_message;
+					queue->partial_message_sent_bytes = remaining_sent_bytes;
+					return 1;
+				}
+
+				remaining_sent_bytes -= message_bytes;
+				outbound_message_free(queue, sent_message);
+			}
+		}
+	}
+
+	return 0;
+}
+
+size_t outbound_queue_control_delay(struct outbound_queue *queue)
+{
+	const uint64_t current_time_nanoseconds = outbound_current_time();
+	const size_t previous_dropped_count = queue->dropped_messages_count;
+
+	/* The oldest message has the longest delay, so only it needs to be checked */
+	const struct outbound_message *oldest_message;
+	while ((oldest_message = queue->lane_heads[OUTBOUND_BULK_LANE]) != NULL &&
+	       current_time_nanoseconds >= oldest_message->release_time_nanoseconds &&
+	       current_time_nanoseconds - oldest_message->release_time_nanoseconds >= OUTBOUND_TARGET_DELAY_NANOSECONDS
+	) {
+		/* Give the delay an interval to fall back under the target before dropping anything */
+		if (queue->delay_above_target_deadline == 0) {
+			queue->delay_above_target_deadline = current_time_nanoseconds + OUTBOUND_DELAY_INTERVAL_NANOSECONDS;
+			return 0;
+		}
+		if (current_time_nanoseconds < queue->delay_above_target_deadline) return 0;
+
+		++queue->dropped_messages_count;
+		queue->dropped_bytes += oldest_message->payload->payload_bytes;
+		outbound_message_free(queue, outbound_queue_pop(queue, OUTBOUND_BULK_LANE));
+	}
+
+	/* The delay is under the target again, so the next time it goes above it is given another interval */
+	queue->delay_above_target_deadline = 0;
+	return queue->dropped_messages_count - previous_dropped_count;
+}
+
+uint64_t outbound_queue_next_release_time(const struct outbound_queue *queue)
+{
+	/* A partially sent message was already released, and each lane is sent in order so only the first message matters */
+	if (queue->partial_message != NULL) return queue->partial_message->release_time_nanoseconds;
+
+	uint64_t next_release_time_nanoseconds = 0;
+	for (int lane = 0; lane < OUTBOUND_LANES_COUNT; ++lane) {
+		const struct outbound_message *first_message = queue->lane_heads[lane];
+		if (first_message == NULL) continue;
+		if (next_release_time_nanoseconds == 0 || first_message->release_time_nanoseconds < next_release_time_nanoseconds) {
+			next_release_time_nanoseconds = first_message->release_time_nanoseconds;
+		}
+	}
+	return next_release_time_nanoseconds;
+}
+
+int outbound_queue_is_empty(const struct outbound_queue *queue)
+{
+	return queue->queued_messages_count == 0;
+}
+
+int outbound_queue_is_control_sent(const struct outbound_queue *queue)
+{
+	return queue->partial_message == NULL && queue->lane_heads[OUTBOUND_CONTROL_LANE] == NULL;
+}
+
+void outbound_queue_clear(struct outbound_queue *queue)
+{
+	if (queue->partial_message != NULL) outbound_message_free(queue, queue->partial_message);
+	for (int lane = 0; lane < OUTBOUND_LANES_COUNT; ++lane) {
+		while (queue->lane_heads[lane] != NULL) outbound_message_free(queue, outbound_queue_pop(queue, lane));
+	}
+
+	/* Totals of dropped messages are kept, as they are still reported once the connection is closed */
+	const size_t dropped_messages_count = queue->dropped_messages_count, dropped_bytes = queue->dropped_bytes;
+	const size_t conflated_messages_count = queue->conflated_messages_count;
+	memset(queue, 0, sizeof *queue);
+	queue->dropped_messages_count = dropped_messages_count;
+	queue->dropped_bytes = dropped_bytes;
+	queue->conflated_messages_count = conflated_messages_count;
+}
+
+void outbound_queue_clear_lane(struct outbound_queue *queue, enum outbound_lane lane)
+{
+	while (queue->lane_heads[lane] != NULL) outbound_message_free(queue, outbound_queue_pop(queue, lane));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NETWORK_DEMO_SERVER_OUTBOUND_H */
@@ -0,0 +1,154 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#pragma once
+#ifndef NETWORK_DEMO_SERVER_PLACEMENT_H
+#define NETWORK_DEMO_SERVER_PLACEMENT_H
+
+#include <netdb.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+   Clients are placed on the node that owns their identity, found with a consistent-hash ring.
+   Each node is given several points ('virtual nodes') on the ring and owns every key hashed
+   between the previous point and one of its own. When a node joins, it only takes over the keys
+   falling just before its own points, so only around 1/N of all clients need to move to it.
+*/
+
+/* Number of points each node is given on the ring. More points give a more even spread of keys. */
+#define PLACEMENT_VIRTUAL_NODES 64
+/* Returned when looking up an owner on a ring with no nodes */
+#define PLACEMENT_NO_OWNER ((size_t)-1)
+
+
+/* ---- Structs ---- */
+
+/* A single point on the ring, owned by the node with the given index. */
+struct placement_ring_point {
+	uint64_t point_hash;
+	size_t node_index;
+};
+
+/* Points of every node on the ring, sorted by hash once all nodes have been added. */
+struct placement_ring {
+	struct placement_ring_point *ring_points;
+	size_t points_count, points_alloc_count;
+};
+
+
+/* ---- Function declarations ---- */
+
+/* Removes all nodes from the ring, keeping allocated memory for the next nodes to be added. */
+static void placement_ring_clear(struct placement_ring *ring);
+/* Frees memory allocated for the ring. */
+static void placement_ring_free(struct placement_ring *ring);
+/* Adds the virtual nodes of the node with the given name and index to the ring. 'placement_ring_sort' needs to be
+   called after all nodes have been added before any lookups. Returns 0 on success and -1 on allocation failure. */
+static int placement_ring_add_node(struct placement_ring *ring, const char *node_name, size_t node_index);
+/* Sorts the points on the ring to allow looking up owners. */
+static void placement_ring_sort(struct placement_ring *ring);
+/* Returns the index of the node owning the given key or 'PLACEMENT_NO_OWNER' if the ring is empty. */
+static size_t placement_ring_find_owner(const struct placement_ring *ring, const char *placement_key);
+
+
+/* ---- Function definitions ---- */
+
+
+/* 64-bit FNV-1a hash of the given bytes followed by a final mix, as similar names ('node:5001#1', 'node:5001#2')
+   would otherwise land close to each other on the ring. */
+static uint64_t placement_hash_bytes(const char *hashed_bytes, size_t hashed_bytes_count)
+{
+	uint64_t placement_hash = 0xCBF29CE484222325ULL;
+	for (size_t i = 0; i < hashed_bytes_count; ++i) {
+		placement_hash ^= (unsigned char)hashed_bytes[i];
+		placement_hash *= 0x100000001B3ULL;
+	}
+
+	placement_hash ^= placement_hash >> 33;
+	placement_hash *= 0xFF51AFD7ED558CCDULL;
+	placement_hash ^= placement_hash >> 33;
+	placement_hash *= 0xC4CEB9FE1A85EC53ULL;
+	placement_hash ^= placement_hash >> 33;
+	return placement_hash;
+}
+
+/* Comparison function for sorting ring points by hash */
+static int placement_compare_points(const void *first_point, const void *second_point)
+{
+	const uint64_t first_hash = ((const struct placement_ring_point*)first_point)->point_hash;
+	const uint64_t second_hash = ((const struct placement_ring_point*)second_point)->point_hash;
+	return (first_hash > second_hash) - (first_hash < second_hash);
+}
+
+
+void placement_ring_clear(struct placement_ring *ring)
+{
+	ring->points_count = 0;
+}
+
+void placement_ring_free(struct placement_ring *ring)
+{
+	free(ring->ring_points);
+	memset(ring, 0, sizeof *ring);
+}
+
+int placement_ring_add_node(struct placement_ring *ring, const char *node_name, size_t node_index)
+{
+	if (ring->points_count + PLACEMENT_VIRTUAL_NODES > ring->points_alloc_count) {
+		const size_t new_alloc_count = (ring->points_alloc_count + PLACEMENT_VIRTUAL_NODES) * 2;
+		void *new_ring_points = realloc(ring->ring_points, sizeof *ring->ring_points * new_alloc_count);
+		if (new_ring_points == NULL) return -1;
+		ring->ring_points = new_ring_points;
+		ring->points_alloc_count = new_alloc_count;
+	}
+
+	/* Each virtual node is placed by hashing the node name along with the virtual node's number */
+	char point_name[NI_MAXHOST + NI_MAXSERV + 16];
+	for (int i = 0; i < PLACEMENT_VIRTUAL_NODES; ++i) {
+		const int point_name_length = snprintf(point_name, sizeof point_name, "%s#%d", node_name, i);
+		struct placement_ring_point *new_point = ring->ring_points + ring->points_count++;
+		new_point->point_hash = placement_hash_bytes(point_name, (size_t)point_name_length);
+		new_point->node_index = node_index;
+	}
+
+	return 0;
+}
+
+void placement_ring_sort(struct placement_ring *ring)
+{
+	qsort(ring->ring_points, ring->points_count, sizeof *ring->ring_points, placement_compare_points);
+}
+
+size_t placement_ring_find_owner(const struct placement_ring *ring, const char *placement_key)
+{
+	if (ring->points_count == 0) return PLACEMENT_NO_OWNER;
+	const uint64_t key_hash = placement_hash_bytes(placement_key, strlen(placement_key));
+
+	/* Binary search for the first point at or after the key's hash */
+	size_t lower_index = 0, upper_index = ring->points_count;
+	while (lower_index < upper_index) {
+		const size_t middle_index = lower_index + (upper_index - lower_index) / 2;
+		if (ring->ring_points[middle_index].point_hash < key_hash) lower_index = middle_index + 1;
+		else upper_index = middle_index;
+	}
+
+	/* Keys after the last point wrap around to the first point */
+	if (lower_index == ring->points_count) lower_index = 0;
+	return ring->ring_points[lower_index].node_index;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NETWORK_DEMO_SERVER_PLACEMENT_H */
@@ -0,0 +1,214 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#pragma once
+#ifndef NETWORK_DEMO_SERVER_RELAY_H
+#define NETWORK_DEMO_SERVER_RELAY_H
+
+/* 'splice' and 'F_SETPIPE_SZ' need '_GNU_SOURCE' to be defined before any system header is included */
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+   Files sent between clients are relayed through a pipe with 'splice', which moves the raw bytes from the sender's
+   socket into the pipe and from the pipe into the recipient's socket without ever copying them into the server.
+   The pipe is also the only buffer of the relay: the sender is only read from whilst the pipe has space, so a
+   transfer goes exactly as fast as the recipient recieves it and never takes up more memory than the pipe.
+
+   A relay whose recipient is gone (or was never valid) still has to read the rest of the transfer from the sender,
+   as the sender does not know to stop, so those bytes are read and discarded instead.
+*/
+
+/* Size the pipe of each relay is asked to be given, which limits how much of a transfer is moved at once */
+#define RELAY_PIPE_BYTES 0x100000
+
+
+/* ---- Structs ---- */
+
+/* A transfer of raw bytes from one socket to another through a pipe. */
+struct client_relay {
+	int source_sockfd; /* Socket the bytes are read from */
+	int target_sockfd; /* Socket the bytes are sent to, or -1 if they are being discarded */
+	int relay_pipe[2]; /* Read and write ends of the pipe holding the bytes between the two sockets */
+	size_t pipe_capacity_bytes, pipe_bytes; /* Size of the pipe and the bytes currently in it */
+	uint64_t remaining_source_bytes; /* Bytes still to be read from the source */
+	uint64_t total_bytes; /* Bytes being transferred, not including the transfer message sent before them */
+	uint64_t start_time_nanoseconds; /* Time the relay was opened, for measuring its throughput */
+	int is_target_started; /* Non-zero once the target's other messages were sent and the pipe started being sent to it */
+};
+
+
+/* ---- Function declarations ---- */
+
+/* Opens a relay of the given number of bytes from the source to the target socket, or discarding them if the target is -1.
+   The given header (the transfer message for the target) is sent to the target before the relayed bytes.
+   Returns 0 on success and -1 if the pipe could not be created. */
+static int relay_open(
+	struct client_relay *relay,
+	int source_sockfd,
+	int target_sockfd,
+	uint64_t total_bytes,
+	const char *header,
+	size_t header_bytes
+);
+/* Closes the pipe of the given relay. */
+static void relay_close(struct client_relay *relay);
+
+/* Moves bytes of the transfer that were already recieved into the given buffer into the relay, as much as fits in the pipe.
+   Returns the number of bytes taken and -1 on error. */
+static ssize_t relay_fill_buffered(struct client_relay *relay, const char *buffered_data, size_t buffered_bytes);
+/* Moves as many bytes of the transfer from the source socket into the relay as fit in the pipe without blocking.
+   Returns the number of bytes moved, 0 if the source disconnected and -1 on error (including if nothing could be moved). */
+static ssize_t relay_fill(struct client_relay *relay);
+/* Sends as many bytes in the pipe to the target socket as possible without blocking.
+   Returns the number of bytes sent and -1 on error (including if nothing could be sent). */
+static ssize_t relay_drain(struct client_relay *relay);
+
+/* Returns non-zero if the relay can take more bytes from the source. */
+static int relay_is_accepting(const struct client_relay *relay);
+/* Returns non-zero once every byte of the transfer has been read from the source and sent to the target. */
+static int relay_is_complete(const struct client_relay *relay);
+
+
+
+/* ---- Function definitions ---- */
+
+
+int relay_open(
+	struct client_relay *relay,
+	int source_sockfd,
+	int target_sockfd,
+	uint64_t total_bytes,
+	const char *header,
+	size_t header_bytes
+) {
+	memset(relay, 0, sizeof *relay);
+	relay->source_sockfd = source_sockfd;
+	relay->target_sockfd = target_sockfd;
+	relay->remaining_source_bytes = relay->total_bytes = total_bytes;
+	relay->relay_pipe[0] = relay->relay_pipe[1] = -1;
+
+	/*
+	   Neither end should ever block, as the server cannot wait on either socket. Splicing from a blocking socket waits
+	   for the whole amount asked for, so both sockets are made non-blocking (which does not affect the other ways they
+	   are used, as those never block either). They are left non-blocking, as either could still be in another relay.
+	*/
+	if (fcntl(source_sockfd, F_SETFL, fcntl(source_sockfd, F_GETFL) | O_NONBLOCK) == -1) return -1;
+	if (target_sockfd == -1) return 0; /* Discarded bytes do not need a pipe */
+	if (fcntl(target_sockfd, F_SETFL, fcntl(target_sockfd, F_GETFL) | O_NONBLOCK) == -1) return -1;
+	if (pipe2(relay->relay_pipe, O_NONBLOCK | O_CLOEXEC) == -1) return -1;
+
+	/* A larger pipe moves more of the transfer per call, but the default size still works if it cannot be given */
+	fcntl(relay->relay_pipe[1], F_SETPIPE_SZ, RELAY_PIPE_BYTES);
+	const int pipe_capacity_bytes = fcntl(relay->relay_pipe[1], F_GETPIPE_SZ);
+	relay->pipe_capacity_bytes = pipe_capacity_bytes > 0 ? (size_t)pipe_capacity_bytes : 0x10000;
+
+	/* The header is small enough to always fit in an empty pipe */
+	if (write(relay->relay_pipe[1], header, header_bytes) != (ssize_t)header_bytes) {
+		relay_close(relay);
+		return -1;
+	}
+	relay->pipe_bytes = header_bytes;
+	return 0;
+}
+
+void relay_close(struct client_relay *relay)
+{
+	if (relay->relay_pipe[0] != -1) close(relay->relay_pipe[0]);
+	if (relay->relay_pipe[1] != -1) close(relay->relay_pipe[1]);
+	relay->relay_pipe[0] = relay->relay_pipe[1] = -1;
+	relay->pipe_bytes = 0;
+}
+
+ssize_t relay_fill_buffered(struct client_relay *relay, const char *buffered_data, size_t buffered_bytes)
+{
+	if (buffered_bytes > relay->remaining_source_bytes) buffered_bytes = (size_t)relay->remaining_source_bytes;
+
+	ssize_t taken_bytes = (ssize_t)buffered_bytes;
+	if (relay->target_sockfd != -1) {
+		/* These bytes were read along with the transfer message, so they are the only ones copied rather than spliced */
+		if (buffered_bytes > relay->pipe_capacity_bytes - relay->pipe_bytes) buffered_bytes = relay->pipe_capacity_bytes - relay->pipe_bytes;
+		if (buffered_bytes == 0) return 0;
+		if ((taken_bytes = write(relay->relay_pipe[1], buffered_data, buffered_bytes)) == -1) return errno == EAGAIN ? 0 : -1;
+		relay->pipe_bytes += (size_t)taken_bytes;
+	}
+
+	relay->remaining_source_bytes -= (uint64_t)taken_bytes;
+	return taken_bytes;
+}
+
+ssize_t relay_fill(struct client_relay *relay)
+{
+	if (relay->remaining_source_bytes == 0) return -1;
+
+	ssize_t moved_bytes;
+	if (relay->target_sockfd == -1) {
+		char discarded_data[0x4000];
+		const size_t discarded_bytes = relay->remaining_source_bytes < sizeof discarded_data ?
+			(size_t)relay->remaining_source_bytes : sizeof discarded_data;
+		moved_bytes = recv(relay->source_sockfd, discarded_data, discarded_bytes, MSG_DONTWAIT);
+	} else {
+		size_t pipe_space_bytes = relay->pipe_capacity_bytes - relay->pipe_bytes;
+		if (pipe_space_bytes > relay->remaining_source_bytes) pipe_space_bytes = (size_t)relay->remaining_source_bytes;
+		if (pipe_space_bytes == 0) {
+			errno = EAGAIN;
+			return -1;
+		}
+
+		moved_bytes = splice(
+			relay->source_sockfd, NULL,
+			relay->relay_pipe[1], NULL,
+			pipe_space_bytes,
+			SPLICE_F_MOVE | SPLICE_F_NONBLOCK
+		);
+		if (moved_bytes > 0) relay->pipe_bytes += (size_t)moved_bytes;
+	}
+
+	if (moved_bytes > 0) relay->remaining_source_bytes -= (uint64_t)moved_bytes;
+	return moved_bytes;
+}
+
+ssize_t relay_drain(struct client_relay *relay)
+{
+	if (relay->pipe_bytes == 0) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	const ssize_t sent_bytes = splice(
+		relay->relay_pipe[0], NULL,
+		relay->target_sockfd, NULL,
+		relay->pipe_bytes,
+		SPLICE_F_MOVE | SPLICE_F_NONBLOCK
+	);
+	if (sent_bytes > 0) relay->pipe_bytes -= (size_t)sent_bytes;
+	return sent_bytes;
+}
+
+int relay_is_accepting(const struct client_relay *relay)
+{
+	return relay->remaining_source_bytes != 0 && (relay->target_sockfd == -1 || relay->pipe_bytes < relay->pipe_capacity_bytes);
+}
+
+int relay_is_complete(const struct client_relay *relay)
+{
+	return relay->remaining_source_bytes == 0 && relay->pipe_bytes == 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NETWORK_DEMO_SERVER_RELAY_H */
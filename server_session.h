@@ -0,0 +1,248 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#pragma once
+#ifndef NETWORK_DEMO_SERVER_SESSION_H
+#define NETWORK_DEMO_SERVER_SESSION_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "network_shared.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+   A session token holds everything needed to resume a client's session, being its identity and topic subscriptions,
+   along with the time it expires. The server gives each identified client a new token whenever its subscriptions
+   change, and keeps nothing about the client once it disconnects: a client reconnecting presents its last token,
+   which the server checks and takes the session from. Any server with the same key can resume the session.
+
+   Tokens are authenticated with SipHash-2-4 keyed with the server's key, so a client cannot make up or change a token
+   without the key, although it can read what is in it. A token is sent as text, with each byte as two hex digits:
+
+	<version (1 byte)> <expiry time (8 bytes, seconds since 1970)> <identity>\0 <pattern>\0 ... <MAC (8 bytes)>
+*/
+
+#define SESSION_KEY_BYTES 16
+#define SESSION_TOKEN_VERSION 1
+/* Bytes of subscription patterns a token can hold. Patterns that do not fit are not resumed. */
+#define SESSION_PATTERNS_MAXIMUM_BYTES 1024
+/* Size of a token as text, including its terminator, with the longest identity and all patterns */
+#define SESSION_TOKEN_MAXIMUM_TEXT_BYTES ((1 + 8 + NETWORK_IDENTITY_MAXIMUM_LENGTH + 1 + SESSION_PATTERNS_MAXIMUM_BYTES + 8) * 2 + 1)
+
+
+/* ---- Structs ---- */
+
+/* Subscription patterns of a session, one after another with their terminators. */
+struct session_patterns {
+	char pattern_bytes[SESSION_PATTERNS_MAXIMUM_BYTES];
+	size_t pattern_bytes_count;
+};
+
+
+/* ---- Function declarations ---- */
+
+/* Adds the given pattern to the patterns of a session. Returns 0 on success and -1 if it does not fit. */
+static int session_patterns_add(struct session_patterns *patterns, const char *topic_pattern);
+/* Removes the given pattern from the patterns of a session, if it has it. */
+static void session_patterns_remove(struct session_patterns *patterns, const char *topic_pattern);
+/* Returns the pattern at the given offset of the patterns of a session and moves the offset past it,
+   or returns NULL once every pattern was given. */
+static const char *session_patterns_next(const struct session_patterns *patterns, size_t *pattern_offset);
+
+/* Writes the token of a session with the given identity (of at most 'NETWORK_IDENTITY_MAXIMUM_LENGTH' characters) and patterns, expiring at the given
+   time, to the given buffer of 'SESSION_TOKEN_MAXIMUM_TEXT_BYTES'. Returns the size of the token text including its terminator. */
+static size_t session_token_encode(
+	char *token_text,
+	const unsigned char *session_key,
+	const char *client_identity,
+	const struct session_patterns *patterns,
+	uint64_t expiry_seconds
+);
+/* Checks the given token text against the key and the current time, giving its identity (through a buffer of 'NETWORK_IDENTITY_MAXIMUM_LENGTH' + 1 bytes)
+   and patterns. Returns 0 on success and -1 if the token is invalid, was changed or has expired. */
+static int session_token_decode(
+	const char *token_text,
+	const unsigned char *session_key,
+	uint64_t current_seconds,
+	char *client_identity,
+	struct session_patterns *patterns
+);
+
+
+/* ---- Function definitions ---- */
+
+
+/* Reads a little-endian 64-bit integer from the given bytes */
+static uint64_t session_read_u64(const unsigned char *read_bytes)
+{
+	uint64_t read_value = 0;
+	for (int i = 7; i >= 0; --i) read_value = (read_value << 8) | read_bytes[i];
+	return read_value;
+}
+
+/* Writes the given 64-bit integer to the given bytes as little-endian */
+static void session_write_u64(unsigned char *written_bytes, uint64_t written_value)
+{
+	for (int i = 0; i < 8; ++i) written_bytes[i] = (unsigned char)(written_value >> (8 * i));
+}
+
+#define SESSION_ROTATE_LEFT(value, bits) (((value) << (bits)) | ((value) >> (64 - (bits))))
+#define SESSION_SIP_ROUND(v0, v1, v2, v3) do { \
+		v0 += v1; v1 = SESSION_ROTATE_LEFT(v1, 13); v1 ^= v0; v0 = SESSION_ROTATE_LEFT(v0, 32); \
+		v2 += v3; v3 = SESSION_ROTATE_LEFT(v3, 16); v3 ^= v2; \
+		v0 += v3; v3 = SESSION_ROTATE_LEFT(v3, 21); v3 ^= v0; \
+		v2 += v1; v1 = SESSION_ROTATE_LEFT(v1, 17); v1 ^= v2; v2 = SESSION_ROTATE_LEFT(v2, 32); \
+	} while (0)
+
+/* SipHash-2-4 of the given bytes with the given 16-byte key, which is a MAC for short messages */
+static uint64_t session_siphash(const unsigned char *session_key, const unsigned char *hashed_bytes, size_t hashed_bytes_count)
+{
+	const uint64_t first_key = session_read_u64(session_key), second_key = session_read_u64(session_key + 8);
+	uint64_t v0 = 0x736F6D6570736575ULL ^ first_key, v1 = 0x646F72616E646F6DULL ^ second_key;
+	uint64_t v2 = 0x6C7967656E657261ULL ^ first_key, v3 = 0x7465646279746573ULL ^ second_key;
+
+	/* Whole words, then the remaining bytes with the length in the top byte of the last word */
+	const size_t whole_bytes_count = hashed_bytes_count - hashed_bytes_count % 8;
+	for (size_t i = 0; i < whole_bytes_count; i += 8) {
+		const uint64_t hashed_word = session_read_u64(hashed_bytes + i);
+		v3 ^= hashed_word;
+		SESSION_SIP_ROUND(v0, v1, v2, v3);
+		SESSION_SIP_ROUND(v0, v1, v2, v3);
+		v0 ^= hashed_word;
+	}
+	uint64_t last_word = (uint64_t)hashed_bytes_count << 56;
+	for (size_t i = whole_bytes_count; i < hashed_bytes_count; ++i) last_word |= (uint64_t)hashed_bytes[i] << (8 * (i - whole_bytes_count));
+	v3 ^= last_word;
+	SESSION_SIP_ROUND(v0, v1, v2, v3);
+	SESSION_SIP_ROUND(v0, v1, v2, v3);
+	v0 ^= last_word;
+
+	v2 ^= 0xFF;
+	for (int i = 0; i < 4; ++i) SESSION_SIP_ROUND(v0, v1, v2, v3);
+	return v0 ^ v1 ^ v2 ^ v3;
+}
+
+
+int session_patterns_add(struct session_patterns *patterns, const char *topic_pattern)
+{
+	const size_t pattern_bytes = strlen(topic_pattern) + 1;
+	if (pattern_bytes > SESSION_PATTERNS_MAXIMUM_BYTES - patterns->pattern_bytes_count) return -1;
+	memcpy(patterns->pattern_bytes + patterns->pattern_bytes_count, topic_pattern, pattern_bytes);
+	patterns->pattern_bytes_count += pattern_bytes;
+	return 0;
+}
+
+void session_patterns_remove(struct session_patterns *patterns, const char *topic_pattern)
+{
+	size_t pattern_offset = 0;
+	const char *current_pattern;
+	while ((current_pattern = session_patterns_next(patterns, &pattern_offset)) != NULL) {
+		if (strcmp(current_pattern, topic_pattern) != 0) continue;
+
+		/* Move the following patterns back over the removed one */
+		const size_t removed_offset = (size_t)(current_pattern - patterns->pattern_bytes);
+		memmove(
+			patterns->pattern_bytes + removed_offset,
+			patterns->pattern_bytes + pattern_offset,
+			patterns->pattern_bytes_count - pattern_offset
+		);
+		patterns->pattern_bytes_count -= pattern_offset - removed_offset;
+		return;
+	}
+}
+
+const char *session_patterns_next(const struct session_patterns *patterns, size_t *pattern_offset)
+{
+	if (*pattern_offset >= patterns->pattern_bytes_count) return NULL;
+	const char *next_pattern = patterns->pattern_bytes + *pattern_offset;
+	*pattern_offset += strlen(next_pattern) + 1;
+	return next_pattern;
+}
+
+size_t session_token_encode(
+	char *token_text,
+	const unsigned char *session_key,
+	const char *client_identity,
+	const struct session_patterns *patterns,
+	uint64_t expiry_seconds
+) {
+	unsigned char token_bytes[(SESSION_TOKEN_MAXIMUM_TEXT_BYTES - 1) / 2];
+	size_t token_length = 0;
+
+	token_bytes[token_length++] = SESSION_TOKEN_VERSION;
+	session_write_u64(token_bytes + token_length, expiry_seconds);
+	token_length += 8;
+	const size_t identity_bytes = strlen(client_identity) + 1;
+	memcpy(token_bytes + token_length, client_identity, identity_bytes);
+	token_length += identity_bytes;
+	memcpy(token_bytes + token_length, patterns->pattern_bytes, patterns->pattern_bytes_count);
+	token_length += patterns->pattern_bytes_count;
+	session_write_u64(token_bytes + token_length, session_siphash(session_key, token_bytes, token_length));
+	token_length += 8;
+
+	const char hex_digits[] = "0123456789abcdef";
+	for (size_t i = 0; i < token_length; ++i) {
+		token_text[i * 2] = hex_digits[token_bytes[i] >> 4];
+		token_text[i * 2 + 1] = hex_digits[token_bytes[i] & 0xF];
+	}
+	token_text[token_length * 2] = '\0';
+	return token_length * 2 + 1;
+}
+
+int session_token_decode(
+	const char *token_text,
+	const unsigned char *session_key,
+	uint64_t current_seconds,
+	char *client_identity,
+	struct session_patterns *patterns
+) {
+	/* The shortest token has a one-character identity and no patterns */
+	const size_t token_text_length = strlen(token_text);
+	if (token_text_length % 2 != 0 || token_text_length >= SESSION_TOKEN_MAXIMUM_TEXT_BYTES || token_text_length < (1 + 8 + 2 + 8) * 2) return -1;
+
+	unsigned char token_bytes[(SESSION_TOKEN_MAXIMUM_TEXT_BYTES - 1) / 2];
+	const size_t token_length = token_text_length / 2;
+	for (size_t i = 0; i < token_text_length; ++i) {
+		const char hex_digit = token_text[i];
+		unsigned char digit_value;
+		if (hex_digit >= '0' && hex_digit <= '9') digit_value = (unsigned char)(hex_digit - '0');
+		else if (hex_digit >= 'a' && hex_digit <= 'f') digit_value = (unsigned char)(hex_digit - 'a' + 10);
+		else return -1;
+		token_bytes[i / 2] = (unsigned char)(i % 2 == 0 ? digit_value << 4 : token_bytes[i / 2] | digit_value);
+	}
+
+	/* Nothing in the token is trusted before its MAC was checked, which is compared without stopping at the first difference */
+	const size_t signed_length = token_length - 8;
+	const uint64_t token_mac = session_read_u64(token_bytes + signed_length);
+	if ((token_mac ^ session_siphash(session_key, token_bytes, signed_length)) != 0) return -1;
+	if (token_bytes[0] != SESSION_TOKEN_VERSION || session_read_u64(token_bytes + 1) < current_seconds) return -1;
+
+	/* The identity and every pattern have to be non-empty and end within the token */
+	const unsigned char *identity_start = token_bytes + 9;
+	const unsigned char *identity_end = memchr(identity_start, '\0', signed_length - 9);
+	if (identity_end == NULL || identity_end == identity_start || identity_end - identity_start > NETWORK_IDENTITY_MAXIMUM_LENGTH) return -1;
+	memcpy(client_identity, identity_start, (size_t)(identity_end - identity_start) + 1);
+
+	const size_t patterns_offset = (size_t)(identity_end + 1 - token_bytes);
+	patterns->pattern_bytes_count = signed_length - patterns_offset;
+	if (patterns->pattern_bytes_count > SESSION_PATTERNS_MAXIMUM_BYTES) return -1;
+	memcpy(patterns->pattern_bytes, token_bytes + patterns_offset, patterns->pattern_bytes_count);
+	for (size_t i = 0; i < patterns->pattern_bytes_count; ++i) {
+		if (patterns->pattern_bytes[i] == '\0' && (i == 0 || patterns->pattern_bytes[i - 1] == '\0')) return -1;
+	}
+	if (patterns->pattern_bytes_count != 0 && patterns->pattern_bytes[patterns->pattern_bytes_count - 1] != '\0') return -1;
+	return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NETWORK_DEMO_SERVER_SESSION_H */
@@ -0,0 +1,269 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#pragma once
+#ifndef NETWORK_DEMO_SERVER_SNAPSHOT_H
+#define NETWORK_DEMO_SERVER_SNAPSHOT_H
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+   The subscriptions of identified clients are saved to a snapshot file, so that a server restarted after a crash can
+   give each client its subscriptions back as soon as it identifies itself again. A snapshot is written to a temporary
+   file through a shared mapping and then renamed over the previous one, so the file is always either the previous
+   snapshot or the new one in full, never one that was cut short by a crash.
+
+   A snapshot is loaded by mapping it and checking its header and checksum, with its records used straight from the
+   mapping: only a sorted index of them is allocated, so a large snapshot is ready in the time it takes to read it.
+
+   File layout: a 'snapshot_header', followed by the records, each being a client identity and one of its subscription
+   patterns, both null-terminated. The file is only meant to be read by the machine that wrote it.
+*/
+
+#define SNAPSHOT_FILE_MAGIC "NDSNAPS"
+#define SNAPSHOT_FORMAT_VERSION 1
+
+
+/* ---- Structs ---- */
+
+/* Start of a snapshot file, describing the records that follow it. */
+struct snapshot_header {
+	char file_magic[8]; /* 'SNAPSHOT_FILE_MAGIC', including its null terminator */
+	uint32_t format_version;
+	uint32_t header_bytes; /* Size of this header, so that files written with another layout are refused */
+	uint64_t records_count;
+	uint64_t records_bytes;
+	uint64_t records_checksum; /* Hash of all record bytes, checked before any record is used */
+};
+
+/* A subscription of a client identity loaded from a snapshot, pointing into the mapped file. */
+struct snapshot_record {
+	const char *client_identity;
+	const char *topic_pattern;
+	int is_claimed; /* Non-zero once given back to a client with the identity */
+};
+
+/* A loaded snapshot, with its records sorted by identity. */
+struct server_snapshot {
+	char *mapped_data;
+	size_t mapped_bytes;
+	struct snapshot_record *records;
+	size_t records_count;
+};
+
+/* Records being written to a snapshot. Records are first added without any data to count their bytes, and then added
+   again in the same order once the file was sized for them. */
+struct snapshot_writer {
+	char *records_data; /* Where the next record is written, or NULL whilst only counting */
+	size_t records_bytes;
+	uint64_t records_count;
+};
+
+
+/* ---- Function declarations ---- */
+
+/* Maps and checks the snapshot file at the given path, indexing its records. Returns 1 if the snapshot was loaded,
+   0 if there is no snapshot file and -1 if the file is invalid or an error occurred, leaving the snapshot empty. */
+static int snapshot_load(struct server_snapshot *snapshot, const char *snapshot_path);
+/* Unmaps the given snapshot and frees its index. */
+static void snapshot_free(struct server_snapshot *snapshot);
+/* Returns the index of the first record of the given identity, which the identity's other records follow,
+   or the number of records if the identity has none. */
+static size_t snapshot_find_identity(const struct server_snapshot *snapshot, const char *client_identity);
+
+/* Adds a subscription of the given client identity to the snapshot being written. */
+static void snapshot_writer_add(struct snapshot_writer *writer, const char *client_identity, const char *topic_pattern);
+/* Writes a snapshot of the records added by the given function (called twice, adding the same records each time) to the
+   given path, replacing any previous snapshot at once. Returns 0 on success and -1 on failure, leaving any previous snapshot. */
+static int snapshot_write_file(const char *snapshot_path, void (*add_records)(struct snapshot_writer *writer));
+
+
+/* ---- Function definitions ---- */
+
+
+/* 64-bit FNV-1a hash of the given bytes, as the snapshot's checksum */
+static uint64_t snapshot_hash_bytes(const char *hashed_bytes, size_t hashed_bytes_count)
+{
+	uint64_t snapshot_hash = 0xCBF29CE484222325ULL;
+	for (size_t i = 0; i < hashed_bytes_count; ++i) {
+		snapshot_hash ^= (unsigned char)hashed_bytes[i];
+		snapshot_hash *= 0x100000001B3ULL;
+	}
+	return snapshot_hash;
+}
+
+/* Comparison function for sorting records by identity */
+static int snapshot_compare_records(const void *first_record, const void *second_record)
+{
+	return strcmp(
+		((const struct snapshot_record*)first_record)->client_identity,
+		((const struct snapshot_record*)second_record)->client_identity
+	);
+}
+
+
+int snapshot_load(struct server_snapshot *snapshot, const char *snapshot_path)
+{
+	memset(snapshot, 0, sizeof *snapshot);
+
+	const int snapshot_fd = open(snapshot_path, O_RDONLY | O_CLOEXEC);
+	if (snapshot_fd == -1) return errno == ENOENT ? 0 : -1;
+
+	struct stat snapshot_stat;
+	if (fstat(snapshot_fd, &snapshot_stat) == -1 || (size_t)snapshot_stat.st_size < sizeof(struct snapshot_header)) {
+		close(snapshot_fd);
+		return -1;
+	}
+
+	/* The mapping stays valid once the file is closed, and is never written to */
+	snapshot->mapped_bytes = (size_t)snapshot_stat.st_size;
+	snapshot->mapped_data = mmap(NULL, snapshot->mapped_bytes, PROT_READ, MAP_PRIVATE, snapshot_fd, 0);
+	close(snapshot_fd);
+	if (snapshot->mapped_data == MAP_FAILED) {
+		snapshot->mapped_data = NULL;
+		return -1;
+	}
+
+	/* Check the header and the checksum of every record before trusting any of them */
+	struct snapshot_header header;
+	memcpy(&header, snapshot->mapped_data, sizeof header);
+	const char *records_data = snapshot->mapped_data + sizeof header;
+	if (memcmp(header.file_magic, SNAPSHOT_FILE_MAGIC, sizeof header.file_magic) != 0 ||
+	    header.format_version != SNAPSHOT_FORMAT_VERSION ||
+	    header.header_bytes != sizeof header ||
+	    header.records_bytes != snapshot->mapped_bytes - sizeof header ||
+	    header.records_count > header.records_bytes / 4 || /* Each record takes at least 4 bytes */
+	    header.records_checksum != snapshot_hash_bytes(records_data, (size_t)header.records_bytes)
+	) goto invalid_snapshot;
+
+	if (header.records_count != 0 &&
+	    (snapshot->records = malloc(sizeof *snapshot->records * (size_t)header.records_count)) == NULL
+	) goto invalid_snapshot;
+
+	/* Each record is two non-empty strings, which have to end within the records */
+	const char *records_end = records_data + header.records_bytes;
+	for (size_t i = 0; i < (size_t)header.records_count; ++i) {
+		struct snapshot_record *record = snapshot->records + i;
+		const char *string_ends[2];
+		for (size_t j = 0; j < 2; ++j) {
+			string_ends[j] = memchr(records_data, '\0', (size_t)(records_end - records_data));
+			if (string_ends[j] == NULL || string_ends[j] == records_data) goto invalid_snapshot;
+			if (j == 0) record->client_identity = records_data;
+			else record->topic_pattern = records_data;
+			records_data = string_ends[j] + 1;
+		}
+		record->is_claimed = 0;
+	}
+	if (records_data != records_end) goto invalid_snapshot;
+
+	snapshot->records_count = (size_t)header.records_count;
+	qsort(snapshot->records, snapshot->records_count, sizeof *snapshot->records, snapshot_compare_records);
+	return 1;
+
+invalid_snapshot:
+	snapshot_free(snapshot);
+	return -1;
+}
+
+void snapshot_free(struct server_snapshot *snapshot)
+{
+	if (snapshot->mapped_data != NULL) munmap(snapshot->mapped_data, snapshot->mapped_bytes);
+	free(snapshot->records);
+	memset(snapshot, 0, sizeof *snapshot);
+}
+
+size_t snapshot_find_identity(const struct server_snapshot *snapshot, const char *client_identity)
+{
+	/* Binary search for the first record at or after the identity */
+	size_t lower_index = 0, upper_index = snapshot->records_count;
+	while (lower_index < upper_index) {
+		const size_t middle_index = lower_index + (upper_index - lower_index) / 2;
+		if (strcmp(snapshot->records[middle_index].client_identity, client_identity) < 0) lower_index = middle_index + 1;
+		else upper_index = middle_index;
+	}
+
+	if (lower_index == snapshot->records_count || strcmp(snapshot->records[lower_index].client_identity, client_identity) != 0) {
+		return snapshot->records_count;
+	}
+	return lower_index;
+}
+
+void snapshot_writer_add(struct snapshot_writer *writer, const char *client_identity, const char *topic_pattern)
+{
+	const size_t identity_bytes = strlen(client_identity) + 1, pattern_bytes = strlen(topic_pattern) + 1;
+	if (writer->records_data != NULL) {
+		memcpy(writer->records_data, client_identity, identity_bytes);
+		memcpy(writer->records_data + identity_bytes, topic_pattern, pattern_bytes);
+		writer->records_data += identity_bytes + pattern_bytes;
+	}
+	writer->records_bytes += identity_bytes + pattern_bytes;
+	++writer->records_count;
+}
+
+int snapshot_write_file(const char *snapshot_path, void (*add_records)(struct snapshot_writer *writer))
+{
+	/* Count the records first, to size the file for all of them */
+	struct snapshot_writer writer = { NULL, 0, 0 };
+	add_records(&writer);
+
+	char temporary_path[PATH_MAX];
+	if (snprintf(temporary_path, sizeof temporary_path, "%s.tmp", snapshot_path) >= (int)sizeof temporary_path) return -1;
+	const int snapshot_fd = open(temporary_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (snapshot_fd == -1) return -1;
+
+	const size_t file_bytes = sizeof(struct snapshot_header) + writer.records_bytes;
+	char *mapped_data = MAP_FAILED;
+	if (ftruncate(snapshot_fd, (off_t)file_bytes) == -1 ||
+	    (mapped_data = mmap(NULL, file_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, snapshot_fd, 0)) == MAP_FAILED
+	) goto write_failed;
+
+	/* The records are then written straight into the mapping, followed by the header describing them */
+	const size_t counted_bytes = writer.records_bytes;
+	writer = (struct snapshot_writer){ mapped_data + sizeof(struct snapshot_header), 0, 0 };
+	add_records(&writer);
+	if (writer.records_bytes != counted_bytes) goto write_failed;
+
+	struct snapshot_header header = { SNAPSHOT_FILE_MAGIC, SNAPSHOT_FORMAT_VERSION, sizeof header, 0, 0, 0 };
+	header.records_count = writer.records_count;
+	header.records_bytes = writer.records_bytes;
+	header.records_checksum = snapshot_hash_bytes(mapped_data + sizeof header, writer.records_bytes);
+	memcpy(mapped_data, &header, sizeof header);
+
+	/* Only replace the previous snapshot once the new one is on the disk in full */
+	if (msync(mapped_data, file_bytes, MS_SYNC) == -1) goto write_failed;
+	munmap(mapped_data, file_bytes);
+	close(snapshot_fd);
+	if (rename(temporary_path, snapshot_path) == -1) {
+		unlink(temporary_path);
+		return -1;
+	}
+	return 0;
+
+write_failed:
+	if (mapped_data != MAP_FAILED) munmap(mapped_data, file_bytes);
+	close(snapshot_fd);
+	unlink(temporary_path);
+	return -1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NETWORK_DEMO_SERVER_SNAPSHOT_H */
@@ -0,0 +1,537 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#pragma once
+#ifndef NETWORK_DEMO_SERVER_TOPICS_H
+#define NETWORK_DEMO_SERVER_TOPICS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+   Hierarchical topics are made of 'levels' seperated by dots, such as 'region.eu.alerts'.
+   Subscription patterns may use '*' in place of exactly one level and '#' as the last
+   level to match any number (including zero) of remaining levels, so 'region.*.alerts'
+   and 'region.#' both match the topic above.
+*/
+
+#define TOPIC_LEVEL_SEPERATOR '.'
+#define TOPIC_SINGLE_LEVEL_WILDCARD "*"
+#define TOPIC_MULTI_LEVEL_WILDCARD "#"
+/* Maximum number of levels in a topic or pattern, which also bounds the matching recursion depth */
+#define TOPIC_MAXIMUM_LEVELS 32
+/* Maximum length of a topic or pattern string (excluding the null terminator) */
+#define TOPIC_MAXIMUM_LENGTH 255
+/* Number of entries in the direct-mapped cache of recently published topics */
+#define TOPIC_MATCH_CACHE_ENTRIES 64
+
+
+/* ---- Structs ---- */
+
+/* A single level in the topic trie. Literal children are kept sorted by name for binary searching,
+   with the two wildcard children stored seperately as they are checked for every published topic. */
+struct topic_trie_node {
+	struct topic_trie_node **literal_child_nodes; /* Children for literal level names, sorted by name */
+	size_t literal_children_count, literal_children_alloc_count;
+	struct topic_trie_node *single_wildcard_child; /* Child for the '*' level, or NULL */
+	struct topic_trie_node *multi_wildcard_child; /* Child for the '#' level, or NULL */
+
+	int *subscriber_sockfds; /* Sockets subscribed to the pattern ending at this node */
+	size_t subscribers_count, subscribers_alloc_count;
+
+	char level_name[]; /* Name of this level, allocated together with the node */
+};
+
+/* Resolved subscribers of a recently published topic. An entry is only valid if its generation
+   matches that of the trie, so any change to the subscriptions invalidates the whole cache at once. */
+struct topic_match_cache_entry {
+	unsigned long trie_generation; /* Generation of the trie when this entry was filled (0 if unused) */
+	uint64_t topic_hash; /* Hash of the topic name, checked before comparing the full name */
+	char topic_name[TOPIC_MAXIMUM_LENGTH + 1];
+	int *matched_sockfds; /* Sorted list of unique subscriber sockets of the topic */
+	size_t matched_count, matched_alloc_count;
+};
+
+/* Topic subscriptions of all clients along with the cache of resolved topics. */
+struct topic_trie {
+	struct topic_trie_node *root_node;
+	unsigned long generation; /* Incremented on every change to the subscriptions */
+	struct topic_match_cache_entry match_cache[TOPIC_MATCH_CACHE_ENTRIES];
+};
+
+
+/* ---- Function declarations ---- */
+
+/* Initializes an empty topic trie. Returns 0 on success and -1 on allocation failure. */
+static int topic_trie_init(struct topic_trie *trie);
+/* Frees all nodes and cached results of the given topic trie. */
+static void topic_trie_free(struct topic_trie *trie);
+
+/* Subscribes the given socket to the given pattern. Returns 1 if a new subscription was made,
+   0 if the socket was already subscribed to the pattern and -1 if the pattern is invalid or an allocation failed. */
+static int topic_trie_subscribe(struct topic_trie *trie, const char *topic_pattern, int subscriber_sockfd);
+/* Removes the subscription of the given socket to the given pattern. Returns 1 if a subscription was removed,
+   0 if the socket was not subscribed to the pattern and -1 if the pattern is invalid. */
+static int topic_trie_unsubscribe(struct topic_trie *trie, const char *topic_pattern, int subscriber_sockfd);
+/* Removes every subscription of the given socket, such as when it has disconnected. */
+static void topic_trie_remove_subscriber(struct topic_trie *trie, int subscriber_sockfd);
+
+/* Calls the given callback with every pattern and socket subscribed to it, such as to save the subscriptions elsewhere.
+   The pattern given to the callback is only valid during the call, and the trie must not be changed until all calls are made. */
+static void topic_trie_for_each_subscription(
+	const struct topic_trie *trie,
+	void (*on_subscription)(const char *topic_pattern, int subscriber_sockfd, void *callback_data),
+	void *callback_data
+);
+
+/* Finds all sockets subscribed to a pattern matching the given topic, which cannot contain wildcards.
+   A sorted list of unique sockets (valid until the next change to the trie) is given through 'matched_sockfds' along with its count.
+   Returns 0 on success and -1 if the topic is invalid or an allocation failed. */
+static int topic_trie_match(struct topic_trie *trie, const char *topic_name, const int **matched_sockfds, size_t *matched_count);
+
+/* Splits the given topic or pattern into its levels, writing them to 'level_buffer' and pointers to each level to 'levels'.
+   Returns the number of levels or -1 if the string is too long, too deep or has an empty level. */
+static int topic_split_levels(const char *topic_name, char *level_buffer, char **levels);
+
+
+/* ---- Function definitions ---- */
+
+
+/* Allocates a new trie node with the given level name, returning NULL on failure. */
+static struct topic_trie_node *topic_trie_node_create(const char *level_name)
+{
+	const size_t level_name_bytes = strlen(level_name) + 1;
+	struct topic_trie_node *new_node = calloc(1, sizeof *new_node + level_name_bytes);
+	if (new_node != NULL) memcpy(new_node->level_name, level_name, level_name_bytes);
+	return new_node;
+}
+
+/* Frees the given node and all of its children. */
+static void topic_trie_node_free(struct topic_trie_node *node)
+{
+	if (node == NULL) return;
+	for (size_t i = 0; i < node->literal_children_count; ++i) topic_trie_node_free(node->literal_child_nodes[i]);
+	topic_trie_node_free(node->single_wildcard_child);
+	topic_trie_node_free(node->multi_wildcard_child);
+	free(node->literal_child_nodes);
+	free(node->subscriber_sockfds);
+	free(node);
+}
+
+/* Returns non-zero if the given node no longer holds any subscriptions or children, meaning it can be removed. */
+static int topic_trie_node_is_unused(const struct topic_trie_node *node)
+{
+	return node->subscribers_count == 0 &&
+	       node->literal_children_count == 0 &&
+	       node->single_wildcard_child == NULL &&
+	       node->multi_wildcard_child == NULL;
+}
+
+/* Binary searches the sorted literal children of a node for the given level name. Returns the index of the match
+   if found, otherwise returns the index where it should be inserted and sets 'found' to 0. */
+static size_t topic_trie_find_literal_child(const struct topic_trie_node *node, const char *level_name, int *found)
+{
+	size_t lower_index = 0, upper_index = node->literal_children_count;
+
+	while (lower_index < upper_index) {
+		const size_t middle_index = lower_index + (upper_index - lower_index) / 2;
+		const int name_comparison = strcmp(node->literal_child_nodes[middle_index]->level_name, level_name);
+		if (name_comparison == 0) {
+			*found = 1;
+			return middle_index;
+		}
+		if (name_comparison < 0) lower_index = middle_index + 1;
+		else upper_index = middle_index;
+	}
+
+	*found = 0;
+	return lower_index;
+}
+
+/* Returns the child of the given node for the given level name, creating it if 'create_missing' is set.
+   NULL is returned if the child does not exist (and was not created) or an allocation failed. */
+static struct topic_trie_node *topic_trie_get_child(struct topic_trie_node *node, const char *level_name, int create_missing)
+{
+	/* Wildcard levels are stored seperately from literal levels */
+	struct topic_trie_node **wildcard_child = NULL;
+	if (strcmp(level_name, TOPIC_SINGLE_LEVEL_WILDCARD) == 0) wildcard_child = &node->single_wildcard_child;
+	else if (strcmp(level_name, TOPIC_MULTI_LEVEL_WILDCARD) == 0) wildcard_child = &node->multi_wildcard_child;
+
+	if (wildcard_child != NULL) {
+		if (*wildcard_child == NULL && create_missing) *wildcard_child = topic_trie_node_create(level_name);
+		return *wildcard_child;
+	}
+
+	int child_found;
+	const size_t child_index = topic_trie_find_literal_child(node, level_name, &child_found);
+	if (child_found) return node->literal_child_nodes[child_index];
+	if (!create_missing) return NULL;
+
+	/* Expand the children list (double its size) if needed, as done with the poll requests list */
+	if (node->literal_children_count >= node->literal_children_alloc_count) {
+		const size_t new_alloc_count = node->literal_children_alloc_count ? node->literal_children_alloc_count * 2 : 2;
+		void *new_child_nodes = realloc(node->literal_child_nodes, sizeof *node->literal_child_nodes * new_alloc_count);
+		if (new_child_nodes == NULL) return NULL;
+		node->literal_child_nodes = new_child_nodes;
+		node->literal_children_alloc_count = new_alloc_count;
+	}
+
+	struct topic_trie_node *new_child = topic_trie_node_create(level_name);
+	if (new_child == NULL) return NULL;
+
+	/* Shift the following children up to keep the list sorted */
+	memmove(
+		node->literal_child_nodes + child_index + 1,
+		node->literal_child_nodes + child_index,
+		sizeof *node->literal_child_nodes * (node->literal_children_count - child_index)
+	);
+	node->literal_child_nodes[child_index] = new_child;
+	++node->literal_children_count;
+
+	return new_child;
+}
+
+/* Removes and frees the given child from its parent node. */
+static void topic_trie_remove_child(struct topic_trie_node *parent_node, struct topic_trie_node *child_node)
+{
+	if (parent_node->single_wildcard_child == child_node) parent_node->single_wildcard_child = NULL;
+	else if (parent_node->multi_wildcard_child == child_node) parent_node->multi_wildcard_child = NULL;
+	else {
+		int child_found;
+		const size_t child_index = topic_trie_find_literal_child(parent_node, child_node->level_name, &child_found);
+		if (!child_found) return;
+		memmove(
+			parent_node->literal_child_nodes + child_index,
+			parent_node->literal_child_nodes + child_index + 1,
+			sizeof *parent_node->literal_child_nodes * (--parent_node->literal_children_count - child_index)
+		);
+	}
+
+	topic_trie_node_free(child_node);
+}
+
+/* Removes the given socket from the subscribers of a node. Returns 1 if it was removed and 0 if it was not subscribed. */
+static int topic_trie_node_remove_subscriber(struct topic_trie_node *node, int subscriber_sockfd)
+{
+	for (size_t i = 0; i < node->subscribers_count; ++i) {
+		if (node->subscriber_sockfds[i] != subscriber_sockfd) continue;
+		/* Order of subscribers is not important, so replace with the last one as done with poll requests */
+		node->subscriber_sockfds[i] = node->subscriber_sockfds[--node->subscribers_count];
+		return 1;
+	}
+	return 0;
+}
+
+/* Removes the given socket from every node under (and including) the given node, freeing any children left unused.
+   Returns the number of subscriptions removed. */
+static size_t topic_trie_node_remove_subscriber_recursive(struct topic_trie_node *node, int subscriber_sockfd)
+{
+	size_t removed_count = (size_t)topic_trie_node_remove_subscriber(node, subscriber_sockfd);
+
+	/* Iterate backwards so that removing a child does not affect the children yet to be visited */
+	for (size_t i = node->literal_children_count; i-- > 0;) {
+		struct topic_trie_node *child_node = node->literal_child_nodes[i];
+		removed_count += topic_trie_node_remove_subscriber_recursive(child_node, subscriber_sockfd);
+		if (topic_trie_node_is_unused(child_node)) topic_trie_remove_child(node, child_node);
+	}
+
+	struct topic_trie_node *wildcard_children[2] = { node->single_wildcard_child, node->multi_wildcard_child };
+	for (size_t i = 0; i < 2; ++i) {
+		if (wildcard_children[i] == NULL) continue;
+		removed_count += topic_trie_node_remove_subscriber_recursive(wildcard_children[i], subscriber_sockfd);
+		if (topic_trie_node_is_unused(wildcard_children[i])) topic_trie_remove_child(node, wildcard_children[i]);
+	}
+
+	return removed_count;
+}
+
+/* Appends the subscribers of the given node to the list of matches of a cache entry. Returns 0 on success and -1 on allocation failure. */
+static int topic_match_append_subscribers(struct topic_match_cache_entry *cache_entry, const struct topic_trie_node *node)
+{
+	if (node == NULL || node->subscribers_count == 0) return 0;
+
+	const size_t required_count = cache_entry->matched_count + node->subscribers_count;
+	if (required_count > cache_entry->matched_alloc_count) {
+		size_t new_alloc_count = cache_entry->matched_alloc_count ? cache_entry->matched_alloc_count : 4;
+		while (new_alloc_count < required_count) new_alloc_count *= 2;
+		void *new_matched_sockfds = realloc(cache_entry->matched_sockfds, sizeof *cache_entry->matched_sockfds * new_alloc_count);
+		if (new_matched_sockfds == NULL) return -1;
+		cache_entry->matched_sockfds = new_matched_sockfds;
+		cache_entry->matched_alloc_count = new_alloc_count;
+	}
+
+	memcpy(
+		cache_entry->matched_sockfds + cache_entry->matched_count,
+		node->subscriber_sockfds,
+		sizeof *node->subscriber_sockfds * node->subscribers_count
+	);
+	cache_entry->matched_count = required_count;
+	return 0;
+}
+
+/*
+   Collects the subscribers of every pattern under the given node that matches the remaining topic levels.
+   Only the literal child for the next level and the two wildcard children are ever visited, so the work
+   done depends on the depth of the topic rather than the number of subscriptions in the trie.
+*/
+static int topic_trie_collect_matches(
+	const struct topic_trie_node *node,
+	char *const *levels,
+	size_t remaining_levels,
+	struct topic_match_cache_entry *cache_entry
+) {
+	if (node == NULL) return 0;
+
+	/* A trailing '#' matches any number of remaining levels, including none */
+	if (topic_match_append_subscribers(cache_entry, node->multi_wildcard_child) == -1) return -1;
+
+	/* All levels matched: subscribers of patterns ending here are included */
+	if (remaining_levels == 0) return topic_match_append_subscribers(cache_entry, node);
+
+	int child_found;
+	const size_t child_index = topic_trie_find_literal_child(node, *levels, &child_found);
+	if (child_found && topic_trie_collect_matches(
+		node->literal_child_nodes[child_index],
+		levels + 1,
+		remaining_levels - 1,
+		cache_entry
+	) == -1) return -1;
+
+	return topic_trie_collect_matches(node->single_wildcard_child, levels + 1, remaining_levels - 1, cache_entry);
+}
+
+/* Calls the given callback for the subscribers of the given node and every node under it, with the levels leading to the node
+   being written to 'pattern_buffer' up to 'pattern_length'. */
+static void topic_trie_node_for_each_subscription(
+	const struct topic_trie_node *node,
+	char *pattern_buffer,
+	size_t pattern_length,
+	void (*on_subscription)(const char *topic_pattern, int subscriber_sockfd, void *callback_data),
+	void *callback_data
+) {
+	pattern_buffer[pattern_length] = '\0';
+	for (size_t i = 0; i < node->subscribers_count; ++i) on_subscription(pattern_buffer, node->subscriber_sockfds[i], callback_data);
+
+	/* Every child's level follows a seperator, besides those of the root node. Patterns were checked to fit when subscribed. */
+	const size_t seperator_length = pattern_length != 0;
+	const size_t children_count = node->literal_children_count + 2;
+	for (size_t i = 0; i < children_count; ++i) {
+		const struct topic_trie_node *child_node =
+			i < node->literal_children_count ? node->literal_child_nodes[i] :
+			i == node->literal_children_count ? node->single_wildcard_child : node->multi_wildcard_child;
+		if (child_node == NULL) continue;
+
+		const size_t level_length = strlen(child_node->level_name);
+		if (seperator_length != 0) pattern_buffer[pattern_length] = TOPIC_LEVEL_SEPERATOR;
+		memcpy(pattern_buffer + pattern_length + seperator_length, child_node->level_name, level_length);
+		topic_trie_node_for_each_subscription(
+			child_node,
+			pattern_buffer,
+			pattern_length + seperator_length + level_length,
+			on_subscription,
+			callback_data
+		);
+	}
+}
+
+/* Comparison function for sorting socket lists */
+static int topic_compare_sockfds(const void *first_sockfd, const void *second_sockfd)
+{
+	const int first_value = *(const int*)first_sockfd, second_value = *(const int*)second_sockfd;
+	return (first_value > second_value) - (first_value < second_value);
+}
+
+/* 64-bit FNV-1a hash of the given string, used to place topics in the match cache */
+static uint64_t topic_hash_name(const char *topic_name)
+{
+	uint64_t topic_hash = 0xCBF29CE484222325ULL;
+	while (*topic_name) {
+		topic_hash ^= (unsigned char)*topic_name++;
+		topic_hash *= 0x100000001B3ULL;
+	}
+	return topic_hash;
+}
+
+
+int topic_split_levels(const char *topic_name, char *level_buffer, char **levels)
+{
+	const size_t topic_name_length = strlen(topic_name);
+	if (topic_name_length == 0 || topic_name_length > TOPIC_MAXIMUM_LENGTH) return -1;
+	memcpy(level_buffer, topic_name, topic_name_length + 1);
+
+	int level_count = 0;
+	char *current_level = level_buffer;
+
+	do {
+		if (level_count == TOPIC_MAXIMUM_LEVELS) return -1; /* Too many levels */
+		levels[level_count++] = current_level;
+
+		/* Find the end of the current level and terminate it in place */
+		char *level_end = strchr(current_level, TOPIC_LEVEL_SEPERATOR);
+		if (level_end != NULL) *level_end++ = '\0';
+		if (*current_level == '\0') return -1; /* Empty levels are not allowed */
+
+		current_level = level_end;
+	} while (current_level != NULL);
+
+	return level_count;
+}
+
+int topic_trie_init(struct topic_trie *trie)
+{
+	memset(trie, 0, sizeof *trie);
+	trie->generation = 1; /* Cache entries with a generation of 0 are unused */
+	trie->root_node = topic_trie_node_create("");
+	return trie->root_node == NULL ? -1 : 0;
+}
+
+void topic_trie_free(struct topic_trie *trie)
+{
+	topic_trie_node_free(trie->root_node);
+	for (size_t i = 0; i < TOPIC_MATCH_CACHE_ENTRIES; ++i) free(trie->match_cache[i].matched_sockfds);
+	memset(trie, 0, sizeof *trie);
+}
+
+int topic_trie_subscribe(struct topic_trie *trie, const char *topic_pattern, int subscriber_sockfd)
+{
+	char level_buffer[TOPIC_MAXIMUM_LENGTH + 1], *levels[TOPIC_MAXIMUM_LEVELS];
+	const int level_count = topic_split_levels(topic_pattern, level_buffer, levels);
+	if (level_count == -1) return -1;
+
+	/* The multi-level wildcard is only valid as the final level, checked before any levels are created for the pattern */
+	for (int i = 0; i < level_count - 1; ++i) {
+		if (strcmp(levels[i], TOPIC_MULTI_LEVEL_WILDCARD) == 0) return -1;
+	}
+
+	/* Walk down the trie, creating any missing levels along the way and keeping the path taken to remove them on failure */
+	struct topic_trie_node *path_nodes[TOPIC_MAXIMUM_LEVELS + 1];
+	path_nodes[0] = trie->root_node;
+	int path_count = 0;
+	while (path_count < level_count) {
+		if ((path_nodes[path_count + 1] = topic_trie_get_child(path_nodes[path_count], levels[path_count], 1)) == NULL) goto remove_created_nodes;
+		++path_count;
+	}
+	struct topic_trie_node *current_node = path_nodes[level_count];
+
+	/* Check for an existing subscription to avoid duplicates */
+	for (size_t i = 0; i < current_node->subscribers_count; ++i) {
+		if (current_node->subscriber_sockfds[i] == subscriber_sockfd) return 0;
+	}
+
+	if (current_node->subscribers_count >= current_node->subscribers_alloc_count) {
+		const size_t new_alloc_count = current_node->subscribers_alloc_count ? current_node->subscribers_alloc_count * 2 : 2;
+		void *new_subscriber_sockfds = realloc(current_node->subscriber_sockfds, sizeof *current_node->subscriber_sockfds * new_alloc_count);
+		if (new_subscriber_sockfds == NULL) goto remove_created_nodes;
+		current_node->subscriber_sockfds = new_subscriber_sockfds;
+		current_node->subscribers_alloc_count = new_alloc_count;
+	}
+
+	current_node->subscriber_sockfds[current_node->subscribers_count++] = subscriber_sockfd;
+	++trie->generation; /* Invalidate cached matches */
+	return 1;
+
+remove_created_nodes:
+	/* Nodes left unused are the ones created for this pattern, removed from the bottom up as when unsubscribing */
+	for (int i = path_count; i > 0 && topic_trie_node_is_unused(path_nodes[i]); --i) {
+		topic_trie_remove_child(path_nodes[i - 1], path_nodes[i]);
+	}
+	return -1;
+}
+
+int topic_trie_unsubscribe(struct topic_trie *trie, const char *topic_pattern, int subscriber_sockfd)
+{
+	char level_buffer[TOPIC_MAXIMUM_LENGTH + 1], *levels[TOPIC_MAXIMUM_LEVELS];
+	const int level_count = topic_split_levels(topic_pattern, level_buffer, levels);
+	if (level_count == -1) return -1;
+
+	/* Keep track of the path taken to remove nodes left unused afterwards */
+	struct topic_trie_node *path_nodes[TOPIC_MAXIMUM_LEVELS + 1];
+	path_nodes[0] = trie->root_node;
+	for (int i = 0; i < level_count; ++i) {
+		if ((path_nodes[i + 1] = topic_trie_get_child(path_nodes[i], levels[i], 0)) == NULL) return 0;
+	}
+
+	if (topic_trie_node_remove_subscriber(path_nodes[level_count], subscriber_sockfd) == 0) return 0;
+
+	/* Remove unused nodes from the bottom up, stopping at the first node still in use */
+	for (int i = level_count; i > 0 && topic_trie_node_is_unused(path_nodes[i]); --i) {
+		topic_trie_remove_child(path_nodes[i - 1], path_nodes[i]);
+	}
+
+	++trie->generation; /* Invalidate cached matches */
+	return 1;
+}
+
+void topic_trie_remove_subscriber(struct topic_trie *trie, int subscriber_sockfd)
+{
+	if (trie->root_node == NULL) return;
+	if (topic_trie_node_remove_subscriber_recursive(trie->root_node, subscriber_sockfd) != 0) ++trie->generation;
+}
+
+void topic_trie_for_each_subscription(
+	const struct topic_trie *trie,
+	void (*on_subscription)(const char *topic_pattern, int subscriber_sockfd, void *callback_data),
+	void *callback_data
+) {
+	if (trie->root_node == NULL) return;
+	char pattern_buffer[TOPIC_MAXIMUM_LENGTH + 1];
+	topic_trie_node_for_each_subscription(trie->root_node, pattern_buffer, 0, on_subscription, callback_data);
+}
+
+int topic_trie_match(struct topic_trie *trie, const char *topic_name, const int **matched_sockfds, size_t *matched_count)
+{
+	char level_buffer[TOPIC_MAXIMUM_LENGTH + 1], *levels[TOPIC_MAXIMUM_LEVELS];
+	const int level_count = topic_split_levels(topic_name, level_buffer, levels);
+	if (level_count == -1) return -1;
+
+	/* Wildcards are only valid in subscription patterns */
+	for (int i = 0; i < level_count; ++i) {
+		if (strcmp(levels[i], TOPIC_SINGLE_LEVEL_WILDCARD) == 0 ||
+		    strcmp(levels[i], TOPIC_MULTI_LEVEL_WILDCARD) == 0) return -1;
+	}
+
+	/* Hot topics are likely to still be cached from a previous publish */
+	const uint64_t topic_hash = topic_hash_name(topic_name);
+	struct topic_match_cache_entry *cache_entry = trie->match_cache + (topic_hash % TOPIC_MATCH_CACHE_ENTRIES);
+	if (cache_entry->trie_generation == trie->generation &&
+	    cache_entry->topic_hash == topic_hash &&
+	    strcmp(cache_entry->topic_name, topic_name) == 0
+	) goto return_cache_entry;
+
+	/* Otherwise, replace the cache entry with the newly resolved subscribers */
+	cache_entry->trie_generation = 0;
+	cache_entry->matched_count = 0;
+	if (topic_trie_collect_matches(trie->root_node, levels, (size_t)level_count, cache_entry) == -1) return -1;
+
+	/* A socket subscribed through several matching patterns should only be included once */
+	qsort(cache_entry->matched_sockfds, cache_entry->matched_count, sizeof *cache_entry->matched_sockfds, topic_compare_sockfds);
+	size_t unique_count = 0;
+	for (size_t i = 0; i < cache_entry->matched_count; ++i) {
+		if (unique_count == 0 || cache_entry->matched_sockfds[unique_count - 1] != cache_entry->matched_sockfds[i]) {
+			cache_entry->matched_sockfds[unique_count++] = cache_entry->matched_sockfds[i];
+		}
+	}
+	cache_entry->matched_count = unique_count;
+
+	cache_entry->topic_hash = topic_hash;
+	memcpy(cache_entry->topic_name, topic_name, strlen(topic_name) + 1);
+	cache_entry->trie_generation = trie->generation;
+
+return_cache_entry:
+	*matched_sockfds = cache_entry->matched_sockfds;
+	*matched_count = cache_entry->matched_count;
+	return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NETWORK_DEMO_SERVER_TOPICS_H */
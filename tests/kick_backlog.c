@@ -0,0 +1,192 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+   Checks that a client with a backlog of messages waiting to be sent to it is still sent the notice of being kicked.
+   An interactive server is started, and a client that does not read subscribes to a topic that another client floods,
+   so that far more is waiting for it than its socket can hold. Every client is then kicked through the server's input,
+   and the client reads everything it was sent: the last messages before the server closes it have to be the empty
+   session token ending its session, followed by the kick notice.
+
+   Usage: tests/kick_backlog [port], run from the directory holding the built server.
+*/
+
+/* Size of each message published to the topic the kicked client subscribed to */
+#define KICK_PUBLISHED_MESSAGE_BYTES 1024
+/* Number of messages published, being far more than the socket of the kicked client holds */
+#define KICK_PUBLISHED_MESSAGES_COUNT 4096
+
+
+/* ---- Function declarations ---- */
+
+/* Connects to the server on the local address at the given port, recieving into a buffer of the given size (or the default if 0).
+   Returns the socket, or -1 on failure. */
+static int connect_test_server(int server_port, int recieve_buffer_bytes);
+/* Sends all of the given bytes to the given socket. Returns 0 on success and -1 on failure. */
+static int send_test_bytes(int target_sockfd, const char *data, size_t data_bytes);
+/* Sleeps for the given number of milliseconds. */
+static void sleep_milliseconds(long milliseconds);
+
+
+int main(int argc, char *argv[])
+{
+	const int server_port = argc > 1 ? (int)strtol(argv[1], NULL, 10) : 5980;
+	char server_port_text[16];
+	snprintf(server_port_text, sizeof server_port_text, "%d", server_port);
+
+	/* The server reads its interactive input from a pipe, with its own output discarded */
+	int input_pipe[2];
+	if (pipe(input_pipe) == -1) {
+		perror("Failed to create server input");
+		return EXIT_FAILURE;
+	}
+	const pid_t server_pid = fork();
+	if (server_pid == 0) {
+		dup2(input_pipe[0], STDIN_FILENO);
+		close(input_pipe[0]);
+		close(input_pipe[1]);
+		if (freopen("/dev/null", "w", stdout) == NULL || freopen("/dev/null", "w", stderr) == NULL) _exit(EXIT_FAILURE);
+		execl("./server", "./server", server_port_text, "-1", "1", (char*)NULL);
+		_exit(EXIT_FAILURE);
+	}
+	close(input_pipe[0]);
+	sleep_milliseconds(500);
+
+	int test_result = EXIT_FAILURE;
+	const int kicked_sockfd = connect_test_server(server_port, 0x1000);
+	const int publisher_sockfd = connect_test_server(server_port, 0);
+	if (kicked_sockfd == -1 || publisher_sockfd == -1) goto stop_server;
+
+	/* The reply to the subscription is read along with everything else at the end */
+	const char subscribe_message[] = "/sub kick.test";
+	if (send_test_bytes(kicked_sockfd, subscribe_message, sizeof subscribe_message) == -1) goto stop_server;
+	sleep_milliseconds(100);
+
+	/* The publisher never reads either, so its own replies wait at the server without holding anything back */
+	char published_message[KICK_PUBLISHED_MESSAGE_BYTES];
+	const char publish_prefix[] = "/pub kick.test ";
+	memcpy(published_message, publish_prefix, sizeof publish_prefix - 1);
+	memset(published_message + sizeof publish_prefix - 1, 'a', sizeof published_message - sizeof publish_prefix);
+	published_message[sizeof published_message - 1] = '\0';
+	for (int i = 0; i < KICK_PUBLISHED_MESSAGES_COUNT; ++i) {
+		if (send_test_bytes(publisher_sockfd, published_message, sizeof published_message) == -1) goto stop_server;
+	}
+	sleep_milliseconds(200);
+
+	const char kick_input[] = "all kick\n";
+	if (write(input_pipe[1], kick_input, sizeof kick_input - 1) != (ssize_t)(sizeof kick_input - 1)) goto stop_server;
+
+	/* Only the end of what was recieved is kept, as that is what is checked */
+	const struct timeval recieve_timeout = { 5, 0 };
+	setsockopt(kicked_sockfd, SOL_SOCKET, SO_RCVTIMEO, &recieve_timeout, sizeof recieve_timeout);
+	char recieved_tail[256], recieve_buffer[0x10000];
+	size_t recieved_tail_bytes = 0;
+	unsigned long long recieved_bytes_total = 0;
+	ssize_t recieved_bytes;
+	while ((recieved_bytes = recv(kicked_sockfd, recieve_buffer, sizeof recieve_buffer, 0)) > 0) {
+		recieved_bytes_total += (unsigned long long)recieved_bytes;
+		for (ssize_t i = 0; i < recieved_bytes; ++i) {
+			if (recieved_tail_bytes == sizeof recieved_tail) {
+				memmove(recieved_tail, recieved_tail + 1, sizeof recieved_tail - 1);
+				--recieved_tail_bytes;
+			}
+			recieved_tail[recieved_tail_bytes++] = recieve_buffer[i];
+		}
+	}
+	if (recieved_bytes == -1) {
+		fprintf(stderr, "FAIL: The kicked client was not closed (%s).\n", strerror(errno));
+		goto stop_server;
+	}
+
+	const char expected_tail[] = "\17\0You have been kicked.";
+	if (recieved_tail_bytes < sizeof expected_tail ||
+	    memcmp(recieved_tail + recieved_tail_bytes - sizeof expected_tail, expected_tail, sizeof expected_tail) != 0
+	) {
+		fprintf(stderr, "FAIL: The kicked client was not sent its notice last (%llu bytes recieved).\n", recieved_bytes_total);
+		goto stop_server;
+	}
+
+	printf("PASS: The kicked client was sent its notice after %llu bytes of waiting messages.\n", recieved_bytes_total);
+	test_result = EXIT_SUCCESS;
+
+stop_server:
+	if (kicked_sockfd != -1) close(kicked_sockfd);
+	if (publisher_sockfd != -1) close(publisher_sockfd);
+	close(input_pipe[1]);
+	kill(server_pid, SIGINT);
+	waitpid(server_pid, NULL, 0);
+	return test_result;
+}
+
+
+/*  ---- Function definitions ---- */
+
+
+int connect_test_server(int server_port, int recieve_buffer_bytes)
+{
+	const int connection_sockfd = socket(AF_INET, SOCK_STREAM, 0);
+	if (connection_sockfd == -1) return -1;
+
+	/* The buffer has to be set before connecting, as it decides the window the server is given */
+	if (recieve_buffer_bytes != 0) {
+		setsockopt(connection_sockfd, SOL_SOCKET, SO_RCVBUF, &recieve_buffer_bytes, sizeof recieve_buffer_bytes);
+	}
+
+	struct sockaddr_in server_address;
+	memset(&server_address, 0, sizeof server_address);
+	server_address.sin_family = AF_INET;
+	server_address.sin_port = htons((uint16_t)server_port);
+	server_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (connect(connection_sockfd, (struct sockaddr*)&server_address, sizeof server_address) == -1) {
+		perror("Failed to connect to server");
+		close(connection_sockfd);
+		return -1;
+	}
+	return connection_sockfd;
+}
+
+int send_test_bytes(int target_sockfd, const char *data, size_t data_bytes)
+{
+	while (data_bytes != 0) {
+		const ssize_t sent_bytes = send(target_sockfd, data, data_bytes, MSG_NOSIGNAL);
+		if (sent_bytes == -1) {
+			if (errno == EINTR) continue;
+			perror("Failed to send to server");
+			return -1;
+		}
+		data += sent_bytes;
+		data_bytes -= (size_t)sent_bytes;
+	}
+	return 0;
+}
+
+void sleep_milliseconds(long milliseconds)
+{
+	const struct timespec sleep_time = { milliseconds / 1000, (milliseconds % 1000) * 1000000L };
+	nanosleep(&sleep_time, NULL);
+}
+
+#ifdef __cplusplus
+}
+#endif
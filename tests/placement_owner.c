@@ -0,0 +1,113 @@
+/*
+	Copyright 2025 Mahdi Almusaad (https://github.com/mahdialmusaad)
+	under the MIT License (https://opensource.org/license/mit)
+*/
+
+#include "../server_placement.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+   Checks that every node of a federation finds the same owner for the same identity.
+   Each node lists itself first, so the same nodes are given different indexes on each of them: the rings of two
+   nodes are built as each would from its own list, and the owner found on both has to be the same node for every
+   identity. Rings with one more node are also checked to only move identities to the node that joined.
+
+   Usage: tests/placement_owner
+*/
+
+/* Number of identities looked up on each ring */
+#define PLACEMENT_TEST_IDENTITIES_COUNT 100000
+/* Number of nodes in the federation of each ring */
+#define PLACEMENT_TEST_NODES_COUNT 3
+
+
+/* ---- Function declarations ---- */
+
+/* Builds the ring of a node with the given node addresses, listing itself first as nodes do, replacing any nodes the ring
+   already has. Returns 0 on success and -1 on allocation failure. */
+static int build_node_ring(struct placement_ring *ring, const char *const *node_addresses, size_t nodes_count);
+
+
+int main(void)
+{
+	/* The same federation as listed by its first and second node */
+	const char *const first_node_addresses[PLACEMENT_TEST_NODES_COUNT] = { "127.0.0.1:5001", "127.0.0.1:5002", "127.0.0.1:5003" };
+	const char *const second_node_addresses[PLACEMENT_TEST_NODES_COUNT] = { "127.0.0.1:5002", "127.0.0.1:5001", "127.0.0.1:5003" };
+
+	int test_result = EXIT_FAILURE;
+	struct placement_ring first_node_ring = { 0 }, second_node_ring = { 0 }, smaller_ring = { 0 };
+	if (build_node_ring(&first_node_ring, first_node_addresses, PLACEMENT_TEST_NODES_COUNT) == -1 ||
+	    build_node_ring(&second_node_ring, second_node_addresses, PLACEMENT_TEST_NODES_COUNT) == -1 ||
+	    build_node_ring(&smaller_ring, first_node_addresses, PLACEMENT_TEST_NODES_COUNT - 1) == -1
+	) {
+		fprintf(stderr, "FAIL: Could not build placement rings.\n");
+		goto free_rings;
+	}
+
+	size_t owned_counts[PLACEMENT_TEST_NODES_COUNT] = { 0 }, moved_count = 0;
+	char client_identity[32];
+	for (int i = 0; i < PLACEMENT_TEST_IDENTITIES_COUNT; ++i) {
+		snprintf(client_identity, sizeof client_identity, "user%d", i);
+
+		const size_t first_owner_index = placement_ring_find_owner(&first_node_ring, client_identity);
+		const size_t second_owner_index = placement_ring_find_owner(&second_node_ring, client_identity);
+		if (first_owner_index >= PLACEMENT_TEST_NODES_COUNT || second_owner_index >= PLACEMENT_TEST_NODES_COUNT ||
+		    strcmp(first_node_addresses[first_owner_index], second_node_addresses[second_owner_index]) != 0
+		) {
+			fprintf(stderr, "FAIL: The nodes found different owners for '%s'.\n", client_identity);
+			goto free_rings;
+		}
+		++owned_counts[first_owner_index];
+
+		/* Before the last node joined, the identity was owned by the same node unless the new node now owns it */
+		const size_t previous_owner_index = placement_ring_find_owner(&smaller_ring, client_identity);
+		if (previous_owner_index == first_owner_index) continue;
+		if (first_owner_index != PLACEMENT_TEST_NODES_COUNT - 1) {
+			fprintf(stderr, "FAIL: '%s' moved between nodes that were already in the federation.\n", client_identity);
+			goto free_rings;
+		}
+		++moved_count;
+	}
+
+	for (size_t i = 0; i < PLACEMENT_TEST_NODES_COUNT; ++i) {
+		if (owned_counts[i] != 0) continue;
+		fprintf(stderr, "FAIL: Node '%s' owns no identities.\n", first_node_addresses[i]);
+		goto free_rings;
+	}
+
+	printf(
+		"PASS: Both nodes found the same owner for %d identities, with %d moving to the node that joined.\n",
+		PLACEMENT_TEST_IDENTITIES_COUNT, (int)moved_count
+	);
+	test_result = EXIT_SUCCESS;
+
+free_rings:
+	placement_ring_free(&first_node_ring);
+	placement_ring_free(&second_node_ring);
+	placement_ring_free(&smaller_ring);
+	return test_result;
+}
+
+
+/*  ---- Function definitions ---- */
+
+
+int build_node_ring(struct placement_ring *ring, const char *const *node_addresses, size_t nodes_count)
+{
+	placement_ring_clear(ring);
+	for (size_t i = 0; i < nodes_count; ++i) {
+		if (placement_ring_add_node(ring, node_addresses[i], i) == -1) return -1;
+	}
+	placement_ring_sort(ring);
+	return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif